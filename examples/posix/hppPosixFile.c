@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppPosixFile.c                                                         */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) File Helpers of the Host Tools                             */
+/*																	            */
+/*   - Reads whole files into memory                                            */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike											        */
+/* Dependencies: none                                                           */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#include "hppPosixFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// Read the whole file 'aszFileName'. Returns a null terminated buffer to be released with free or NULL if not successful.
+char* hppPosixReadFile(const char* aszFileName, size_t* apcbLen_Out)
+{
+	FILE* pFile = fopen(aszFileName, "rb");
+	char* pchData;
+	long cbLen;
+
+	if(pFile == NULL) return NULL;
+
+	fseek(pFile, 0, SEEK_END);
+	cbLen = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	pchData = cbLen >= 0 ? (char*)malloc((size_t)cbLen + 1) : NULL;
+
+	if(pchData != NULL && fread(pchData, 1, (size_t)cbLen, pFile) == (size_t)cbLen)
+	{
+		pchData[cbLen] = 0;
+		*apcbLen_Out = (size_t)cbLen;
+	}
+	else
+	{
+		free(pchData);
+		pchData = NULL;
+	}
+
+	fclose(pFile);
+	return pchData;
+}
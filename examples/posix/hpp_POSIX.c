@@ -0,0 +1,234 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hpp_POSIX.c												            */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Command Line Runner							            */
+/*																	            */
+/*   - Executes H++ script files or code given on the command line            	*/
+/*   - Interactive mode reading one line of H++ code after the other            */
+/*   - Snapshot images of the variables, mapped read only from a file           */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike											        */
+/* Dependencies: hppParser.c, hppVarStorage.c, hppProfiler.c, hppPosixFile.c    */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+// Build: cc -I../../include hpp_POSIX.c hppPosixFile.c ../../src/hppParser.c ../../src/hppVarStorage.c ../../src/hppProfiler.c -lm -o hpp_POSIX
+//        or use CMakeLists.txt in this folder
+//
+// Usage: hpp_POSIX [-m <image file>] [-s <image file>] [-f <name>=<file>] [-e <code>] [<script file> ...]
+//
+// Script files and code given with -e are executed in the order of the command line. Global variables (capital first letter)
+// are kept in between, such that a script may use the global variables of the scripts executed before. -f stores the content of a file in
+// the variable <name> without executing it, e.g. to provide a function called by the scripts. The result of each execution
+// is written to stdout. Without script files and code the runner reads H++ code from stdin and executes it line by line.
+// The exit code is 1 if any execution returned an error.
+//
+// -m maps a snapshot image file (see hppVarImageBuild) read only into memory and creates its variables without copying the
+// values, like the code restored from the hpp_xip flash partition on the device. A value is copied to the heap when it is
+// written. -s writes a snapshot image of all variables to the file after all scripts have been executed.
+
+#include "../../include/hppParser.h"
+#include "../../include/hppVarStorage.h"
+#include "hppPosixFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+#define HPP_POSIX_LINE_MAX_LEN	1024
+
+
+// Map the snapshot image file 'aszFileName' read only and create its variables with the values referencing the mapped file.
+// Returns false if not successful. The file stays mapped until the program ends.
+static bool hppPosixMapImage(const char* aszFileName)
+{
+	struct stat theStat;
+	char* pchImage;
+	int iFile = open(aszFileName, O_RDONLY);
+
+	if(iFile < 0) return false;
+
+	if(fstat(iFile, &theStat) != 0 || theStat.st_size <= 0)
+	{
+		close(iFile);
+		return false;
+	}
+
+	pchImage = (char*)mmap(NULL, (size_t)theStat.st_size, PROT_READ, MAP_PRIVATE, iFile, 0);
+	close(iFile);
+
+	if(pchImage == MAP_FAILED) return false;
+
+	return hppVarImageMap(pchImage, (size_t)theStat.st_size) >= 0;
+}
+
+
+// Variables of snapshot images written with -s. Temporary variables are excluded by hppVarImageBuild.
+static bool hppPosixIsImageKey(const char aszKey[])
+{
+	return strcmp(aszKey, "ReturnWithError") != 0;
+}
+
+
+// Write a snapshot image of all variables to the file 'aszFileName'. Returns false if not successful.
+static bool hppPosixWriteImage(const char* aszFileName)
+{
+	size_t cbImageLen = hppVarImageBuild(NULL, 0, hppPosixIsImageKey, 1);
+	char* pchImage = (char*)malloc(cbImageLen);
+	FILE* pFile;
+	bool bSuccess = false;
+
+	if(pchImage == NULL) return false;
+
+	hppVarImageBuild(pchImage, cbImageLen, hppPosixIsImageKey, 1);
+	pFile = fopen(aszFileName, "wb");
+
+	if(pFile != NULL)
+	{
+		bSuccess = fwrite(pchImage, 1, cbImageLen, pFile) == cbImageLen;
+		if(fclose(pFile) != 0) bSuccess = false;
+	}
+
+	free(pchImage);
+	return bSuccess;
+}
+
+
+// Execute the H++ code 'apchCode' and write the result to stdout. Returns false if the result is an error.
+static bool hppPosixExecute(char* apchCode, size_t acbCodeLen)
+{
+	char* pchResult;
+	bool bSuccess;
+
+	// The interpreter does not accept '/* */' comments. Code using them is executed minified.
+	if(strstr(apchCode, "/*") != NULL) hppMinifyCode(apchCode, acbCodeLen);
+
+	pchResult = hppParseExpression(apchCode, "ReturnWithError");
+	bSuccess = pchResult == NULL || strncmp(pchResult, "#Error", 6) != 0;
+
+	printf("%s\n", pchResult != NULL ? pchResult : "");
+	hppVarDelete("ReturnWithError");
+
+	return bSuccess;
+}
+
+
+int main(int argc, char* argv[])
+{
+	char szLine[HPP_POSIX_LINE_MAX_LEN];
+	char* pchCode;
+	char* pchName;
+	const char* szImageFileName = NULL;
+	size_t cbCodeLen;
+	bool bExecuted = false;
+	int iResult = 0;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+		{
+			cbCodeLen = strlen(argv[++i]);
+			if(!hppPosixExecute(argv[i], cbCodeLen)) iResult = 1;
+			bExecuted = true;
+		}
+		else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+		{
+			if(!hppPosixMapImage(argv[++i]))
+			{
+				fprintf(stderr, "hpp_POSIX: cannot map %s\n", argv[i]);
+				iResult = 1;
+			}
+		}
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) szImageFileName = argv[++i];
+		else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc && strchr(argv[i + 1], '=') != NULL)
+		{
+			pchName = argv[++i];
+			*strchr(pchName, '=') = 0;
+			pchCode = hppPosixReadFile(pchName + strlen(pchName) + 1, &cbCodeLen);
+
+			if(pchCode == NULL || hppVarPut(pchName, pchCode, hppMinifyCode(pchCode, cbCodeLen)) == NULL)
+			{
+				fprintf(stderr, "hpp_POSIX: cannot load %s\n", pchName + strlen(pchName) + 1);
+				iResult = 1;
+			}
+
+			free(pchCode);
+		}
+		else if(argv[i][0] != '-')
+		{
+			pchCode = hppPosixReadFile(argv[i], &cbCodeLen);
+
+			if(pchCode == NULL)
+			{
+				fprintf(stderr, "hpp_POSIX: cannot read %s\n", argv[i]);
+				iResult = 1;
+			}
+			else if(!hppPosixExecute(pchCode, cbCodeLen)) iResult = 1;
+
+			free(pchCode);
+			bExecuted = true;
+		}
+		else
+		{
+			fprintf(stderr, "usage: hpp_POSIX [-m <image file>] [-s <image file>] [-f <name>=<file>] [-e <code>] [<script file> ...]\n");
+			return 2;
+		}
+	}
+
+	// Interactive mode
+	while(!bExecuted && fgets(szLine, sizeof(szLine), stdin) != NULL)
+	{
+		cbCodeLen = strlen(szLine);
+		while(cbCodeLen > 0 && (szLine[cbCodeLen - 1] == '\n' || szLine[cbCodeLen - 1] == '\r')) szLine[--cbCodeLen] = 0;
+
+		if(cbCodeLen > 0 && !hppPosixExecute(szLine, cbCodeLen)) iResult = 1;
+	}
+
+	if(szImageFileName != NULL && !hppPosixWriteImage(szImageFileName))
+	{
+		fprintf(stderr, "hpp_POSIX: cannot write %s\n", szImageFileName);
+		iResult = 1;
+	}
+
+	hppVarDeleteAll("");
+
+	return iResult;
+}
@@ -0,0 +1,764 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hpp_bench.c												            */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Host Benchmarks								            */
+/*																	            */
+/*   - Variable storage scaling, arithmetic, structs, strings, calls            */
+/*   - Demo scripts of main.c with stubs for the device functions               */
+/*   - Results in CSV format to track regressions between releases              */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike											        */
+/* Dependencies: hppParser.c, hppVarStorage.c, hppProfiler.c, hppTimerWheel.c, */
+/*               hppAsyncQueue.c, hppSendBuffer.c                               */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+// Build: see CMakeLists.txt in this folder
+//
+// Usage: hpp_bench [--runs <n>] [<benchmark name prefix> ...]
+//
+// Each benchmark is executed n times (default 10) after one warm-up run. One CSV line is written to stdout per benchmark:
+//
+//   benchmark,runs,min_us,mean_us,max_us,var_lookups,heap_allocs,result
+//
+// Times are wall clock times of one run. var_lookups and heap_allocs are counted per run by the variable storage.
+// result is the return value of the H++ code (commas replaced) and allows to check the benchmark did what it should.
+// The exit code is 1 if any benchmark returned an error.
+//
+// The dispatch_xxx benchmarks drain HPP_BENCH_DISPATCH_COUNT entries from the queues of hppAsyncQueue.c like the dispatcher
+// of hppZephyr.c: bursts of updates of the same variable, each followed by a read which is responded to after the batch.
+// The parser mutex is locked once per batch and once more to release the outputs, the responses are sent with one lock of
+// the Thread mutex (pthread mutexes here). dispatch_single dispatches one entry per batch, dispatch_batch up to 
+// HPP_BENCH_DISPATCH_BATCH. result is the number of values stored, the other updates are coalesced.
+//
+// The timer_wheel benchmarks schedule HPP_TIMER_WHEEL_EVENT_COUNT events within one minute, cancel every fourth one and
+// advance the wheel from expiration to expiration like the kernel timer of hppZephyr.c. result is the number of wake-ups,
+// timer_wheel_slack allows 50 ms of slack per event. timer_wheel_overlap schedules the events within two seconds with
+// 250 ms of slack, such that the slack windows overlap, and fails unless it needs at most a quarter of the wake-ups
+// of the same events without slack.
+//
+// The restore_xxx benchmarks restore HPP_BENCH_RESTORE_COUNT variables into an empty storage like hppReadVarFromFlash in 
+// hppZephyr.c restores the code at boot: one variable per setting, one snapshot image and one snapshot image with the values
+// mapped in place (hpp_xip partition). restore_replace loads the snapshot image over the existing variables like flash_restore().
+// The flash read itself is not part of the host stand-in. heap_allocs shows the values not copied to the heap when mapped.
+//
+// The usb_send_xxx benchmarks write HPP_BENCH_USB_COUNT lines through the send buffer of hppZephyrUsbSend to an emulated
+// CDC ACM UART: the interrupt handler fills a FIFO of HPP_BENCH_USB_FIFO_SIZE bytes in chunks, the host empties it whenever
+// the handler runs. Waiting for space runs the handler instead of taking the semaphore. usb_send checks all bytes arrive in
+// order, usb_send_stalled stops the host for a while and checks the writer waits only once before it drops data and recovers
+// as soon as the host reads again. result is the number of bytes received by the host.
+
+#include "../../include/hppParser.h"
+#include "../../include/hppVarStorage.h"
+#include "../../include/hppTimerWheel.h"
+#include "../../include/hppAsyncQueue.h"
+#include "../../include/hppSendBuffer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+
+#define HPP_BENCH_DEFAULT_RUNS		10
+#define HPP_BENCH_RESULT_MAX_LEN	40
+
+#define HPP_BENCH_DISPATCH_COUNT	1000	// entries queued for the dispatch_xxx benchmarks
+#define HPP_BENCH_DISPATCH_BURST	4		// consecutive updates of the same variable followed by one read
+#define HPP_BENCH_DISPATCH_BATCH	8		// entries per batch of dispatch_batch (HPP_ASYNC_BATCH_MAX_COUNT of hppZephyr.c)
+#define HPP_BENCH_DISPATCH_OUTPUTS	4		// outputs per batch (HPP_ASYNC_BATCH_MAX_OUTPUTS)
+#define HPP_BENCH_DISPATCH_PUT		2		// entry types of hppZephyr.c: HPP_ASYNC_TLV_VAR_PUT
+#define HPP_BENCH_DISPATCH_GET		1		// HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE
+
+#define HPP_BENCH_WHEEL_TIME		60000	// ms within which the events of the timer_wheel benchmark expire
+#define HPP_BENCH_WHEEL_DENSE_TIME	2000	// ms within which the events of the timer_wheel_overlap benchmark expire
+
+#define HPP_BENCH_RESTORE_COUNT		200		// variables restored by the restore_xxx benchmarks
+
+#define HPP_BENCH_USB_COUNT			1000	// lines written by the usb_send_xxx benchmarks
+#define HPP_BENCH_USB_LINE_LEN		100		// bytes per line
+#define HPP_BENCH_USB_BUF_SIZE		512		// HPP_ZEPHYR_USB_SEND_BUF_SIZE of hppZephyr.c
+#define HPP_BENCH_USB_FIFO_SIZE		64		// HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE, the full speed bulk packet size
+#define HPP_BENCH_USB_STALL_FROM	100		// lines the host of usb_send_stalled does not read
+#define HPP_BENCH_USB_STALL_TO		200
+
+
+// Setup code executed once before the runs of the benchmark 'szCode'. 'szSetup' may be NULL.
+// Global variables (capital first letter) of the setup are kept until the benchmark has finished.
+typedef struct hppBenchStruct
+{
+	const char* szName;
+	const char* szSetup;
+	const char* szCode;
+
+} hppBench;
+
+
+// Demo scripts of LoadDemoScripts() in src/main.c. Device functions are replaced by hppBenchDeviceFunction.
+static const char* hppBenchDemoScripts[] =
+{
+	"init_led", 		"LED_state = 0;\n"
+						"io_cfg_output(13);\n"
+						"io_set(13, 0);\n",
+	"led_off", 			"io_pwm_stop();\n"
+						"timer_stop(0);\n"
+						"LED_state = 1;\n"
+						"io_set(6, 1);",
+	"switch_led", 		"LED_state = 1 - ?LED_state;\n"
+						"io_set(6, LED_state);\n",
+	"do_pwm", 			"timer_stop(0);\n"
+						"sqr = 'return param1 * param1;';\n"
+						"PWM::alloc(252 * 2);\n"
+						"while(?i < 126) PWM:uint16[i] = sqr(i++);\n"
+						"while(i <= 252) PWM:uint16[i] = sqr(252 - i++));\n"
+						"io_pwm_start(16000, PWM, 20, 1000, 6);\n"
+						"FirstToggle = true;\n",
+	"cli_parse", 		"cli_writeln('receive user command: ' ~ command ~ ' with ' ~ argc ~ ' argument(s)');\n",
+	"btn_push", 		"coap_put('ff03::fc', 'toggle', '', false);\n"
+						"toggle_handler();",
+	"hello_handler",	"if(coap_is_get()) coap_respond('Hello H++ world');\n"
+						"if(coap_is_post()) do_pwm();\n",
+	"toggle_handler",	"if(FirstToggle)\n"
+						"{\n"
+						"	FirstToggle = false;\n"
+						"	led_off();\n"
+						"}\n\n"
+						"switch_led();\n",
+	NULL
+};
+
+
+static const hppBench hppBenchList[] =
+{
+	// Variable storage scaling: the same loop with 10, 100 and 1000 other global variables in the storage
+	{ "var_store_10",		"i = 0; while(i < 10) Var::<i++> = i;",
+							"i = 0; s = 0; while(i < 200) { s = s + Var::<i % 10>; i++; } return s;" },
+	{ "var_store_100",		"i = 0; while(i < 100) Var::<i++> = i;",
+							"i = 0; s = 0; while(i < 200) { s = s + Var::<i % 100>; i++; } return s;" },
+	{ "var_store_1000",		"i = 0; while(i < 1000) Var::<i++> = i;",
+							"i = 0; s = 0; while(i < 200) { s = s + Var::<i % 1000>; i++; } return s;" },
+
+	// Interpreter core
+	{ "arith_loop",			NULL,
+							"i = 0; s = 0; while(i < 1000) { s = s + i * 3 - i / 2; i++; } return s;" },
+	{ "struct_array",		"A = struct('int16:x,int32:y,double:d');",
+							"i = 0; while(i < 100) { A[i].x = i; A[i].y = A[i].x * 2; A[i].d = A[i].y / 4; i++; } return A::count();" },
+	{ "binary_array",		"B::alloc(400);",
+							"i = 0; s = 0; while(i < 200) B:uint16[i] = i++; while(i > 0) s = s + B:uint16[--i]; return s;" },
+	{ "string_build",		NULL,
+							"i = 0; s = ''; while(i < 200) s = s ~ i++ ~ ','; return s::len();" },
+	{ "call_overhead",		NULL,
+							"inc = 'return param1 + 1;'; i = 0; while(i < 500) i = inc(i); return i;" },
+
+	// Demo scripts of main.c
+	{ "demo_do_pwm",		NULL,
+							"do_pwm();" },
+	{ "demo_toggle",		"FirstToggle = true; init_led();",
+							"i = 0; while(i++ < 100) toggle_handler(); return LED_state;" },
+	{ "demo_hello",			NULL,
+							"i = 0; while(i++ < 10) hello_handler(); return i;" },
+	{ "demo_btn_push",		"FirstToggle = true; init_led();",
+							"i = 0; while(i++ < 100) btn_push(); return LED_state;" },
+	{ "demo_cli_parse",		"command = 'mycmd'; argc = 2;",
+							"i = 0; while(i++ < 100) cli_parse(); return i;" },
+
+	// Async dispatcher: one entry per lock of the parser mutex versus batches
+	{ "dispatch_single",	NULL,
+							"return dispatch_run(1);" },
+	{ "dispatch_batch",		NULL,
+							"return dispatch_run(8);" },
+
+	// Scheduled events of choreographed sequences: insert, cancel and expiry of the events of one timer wheel
+	{ "timer_wheel",		NULL,
+							"return wheel_run(0);" },
+	{ "timer_wheel_slack",	NULL,
+							"return wheel_run(50);" },
+	{ "timer_wheel_overlap",NULL,
+							"return wheel_overlap_run(250);" },
+
+	// Restore of stored variables at boot: single settings versus one snapshot image
+	{ "restore_settings",	NULL,
+							"return restore_run(0);" },
+	{ "restore_snapshot",	NULL,
+							"return restore_run(1);" },
+	{ "restore_mapped",		NULL,
+							"return restore_run(2);" },
+	{ "restore_replace",	NULL,
+							"return restore_run(3);" },
+
+	// USB output: chunked transfer of the send buffer to the FIFO and backpressure on the writer
+	{ "usb_send",			NULL,
+							"return usb_send_run(0);" },
+	{ "usb_send_stalled",	NULL,
+							"return usb_send_run(1);" },
+
+	{ NULL, NULL, NULL }
+};
+
+
+static double hppBenchNowUs(void)
+{
+	struct timespec theTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &theTime);
+	return (double)theTime.tv_sec * 1e6 + (double)theTime.tv_nsec / 1e3;
+}
+
+
+// Queue the next entry of the dispatch_xxx benchmarks. Returns false if the queue is full.
+static bool hppBenchDispatchPut(struct hppAsyncQueueStruct* apQueue, int aiEntry)
+{
+	char szVarName[HPP_ASYNC_QUEUE_VAR_NAME_MAX_LEN + 1];
+	char szValue[HPP_NUMERIC_MAX_MEM];
+	int iBurst = aiEntry / (HPP_BENCH_DISPATCH_BURST + 1);
+	uint8_t uiType = aiEntry % (HPP_BENCH_DISPATCH_BURST + 1) < HPP_BENCH_DISPATCH_BURST ? HPP_BENCH_DISPATCH_PUT : HPP_BENCH_DISPATCH_GET;
+	uint16_t uiVarNameLen;
+	uint16_t cbValueLen;
+
+	sprintf(szVarName, "Dispatch_%d", iBurst % 16);
+	hppI2A(szValue, aiEntry);
+	uiVarNameLen = (uint16_t)strlen(szVarName);
+	cbValueLen = uiType == HPP_BENCH_DISPATCH_PUT ? (uint16_t)strlen(szValue) : 0;
+
+	if(hppAsyncQueueSpace(apQueue) < HPP_ASYNC_QUEUE_HEADER_SIZE + uiVarNameLen + sizeof(uint16_t) + cbValueLen) return false;
+
+	hppAsyncQueuePutHeader(apQueue, uiType, uiVarNameLen, 0);
+	hppAsyncQueuePut(apQueue, szVarName, uiVarNameLen);
+
+	if(uiType == HPP_BENCH_DISPATCH_PUT)
+	{
+		hppAsyncQueuePut(apQueue, &cbValueLen, sizeof(uint16_t));
+		hppAsyncQueuePut(apQueue, szValue, cbValueLen);
+	}
+
+	hppAsyncQueueRecordPut(apQueue);
+	return true;
+}
+
+
+// Drain HPP_BENCH_DISPATCH_COUNT entries with at most 'aiBatch' entries per lock of the parser mutex. The queue is filled 
+// whenever it is empty, like by a burst of CoAP requests. Returns the number of values stored or -1 if a read was lost.
+static int hppBenchDispatch(int aiBatch)
+{
+	static pthread_mutex_t theParseMutex = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_mutex_t theThreadMutex = PTHREAD_MUTEX_INITIALIZER;
+	static uint8_t aBuffer[1536];                  // HPP_ASYNC_RING_BUF_COAP_REQUEST_SIZE
+	struct hppAsyncQueueStruct theQueue;
+	struct hppAsyncBatchStruct theBatch;
+	char szVarName[HPP_ASYNC_QUEUE_VAR_NAME_MAX_LEN + 1];
+	char szValue[HPP_NUMERIC_MAX_MEM];
+	char szSent[HPP_NUMERIC_MAX_MEM];
+	char* apchOutputs[HPP_BENCH_DISPATCH_OUTPUTS];
+	size_t acbOutputs[HPP_BENCH_DISPATCH_OUTPUTS];
+	uint32_t nOutputs = 0;
+	int iResponseCount = 0;
+	int iStoreCount = 0;
+	int iEntry = 0;
+	uint32_t uiTime;
+	uint16_t uiLen;
+	uint16_t cbValueLen;
+	uint8_t uiType;
+	bool bBatchEnd;
+	uint32_t i;
+
+	hppAsyncQueueInit(&theQueue, "bench", aBuffer, sizeof(aBuffer), 1);
+	hppAsyncBatchInit(&theBatch, (uint32_t)aiBatch, 10, HPP_BENCH_DISPATCH_OUTPUTS);
+
+	while(iEntry < HPP_BENCH_DISPATCH_COUNT || !hppAsyncQueueIsEmpty(&theQueue))
+	{
+		while(iEntry < HPP_BENCH_DISPATCH_COUNT && hppBenchDispatchPut(&theQueue, iEntry)) iEntry++;
+
+		pthread_mutex_lock(&theParseMutex);
+		hppAsyncBatchBegin(&theBatch, (uint32_t)(hppBenchNowUs() / 1000));
+
+		do
+		{
+			hppAsyncQueueGetHeader(hppAsyncQueueSelect(&theQueue, 1), &uiType, &uiLen, &uiTime);
+			hppAsyncQueueGet(&theQueue, szVarName, uiLen);
+			szVarName[uiLen] = 0;
+			bBatchEnd = false;
+
+			if(uiType == HPP_BENCH_DISPATCH_PUT)
+			{
+				hppAsyncQueueGet(&theQueue, &cbValueLen, sizeof(uint16_t));
+				hppAsyncQueueGet(&theQueue, szValue, cbValueLen);
+
+				if(!hppAsyncQueueIsCoalesced(&theQueue, uiType, szVarName)) 
+				{
+					hppVarPut(szVarName, szValue, cbValueLen);
+					iStoreCount++;
+				}
+			}
+			else
+			{
+				// The response points to the value, which the next entries may change
+				apchOutputs[nOutputs] = hppVarGet(szVarName, &acbOutputs[nOutputs]);
+				nOutputs++;
+				bBatchEnd = true;
+			}
+		} while(hppAsyncBatchNext(&theBatch, (uint32_t)(hppBenchNowUs() / 1000), nOutputs, bBatchEnd, !hppAsyncQueueIsEmpty(&theQueue)));
+
+		pthread_mutex_unlock(&theParseMutex);
+
+		// Write the outputs with one lock of the Thread mutex and release them with one lock of the parser mutex
+		if(nOutputs > 0)
+		{
+			pthread_mutex_lock(&theThreadMutex);
+
+			for(i = 0; i < nOutputs; i++) 
+			{
+				if(apchOutputs[i] != NULL && acbOutputs[i] < sizeof(szSent)) memcpy(szSent, apchOutputs[i], acbOutputs[i]);
+				iResponseCount++;
+			}
+
+			pthread_mutex_unlock(&theThreadMutex);
+			pthread_mutex_lock(&theParseMutex);
+			nOutputs = 0;
+			pthread_mutex_unlock(&theParseMutex);
+		}
+	}
+
+	hppVarDeleteAll("Dispatch_");
+
+	return iResponseCount == HPP_BENCH_DISPATCH_COUNT / (HPP_BENCH_DISPATCH_BURST + 1) ? iStoreCount : -1;
+}
+
+
+static int hppBenchWheelExpiredCount;
+
+// Expired events are released at once (the dispatcher calls the handler before)
+static void hppBenchWheelExpired(uint32_t auiHandle, struct hppTimerWheelEventStruct* apEvent)
+{
+	(void)apEvent;
+	hppBenchWheelExpiredCount++;
+	hppTimerWheelRelease(auiHandle);
+}
+
+
+// Returns the number of wake-ups needed to expire all events with 'aiSlack' ms of slack each
+static int hppBenchWheel(int aiSlack, int aiTime)
+{
+	uint32_t auiHandles[HPP_TIMER_WHEEL_EVENT_COUNT];
+	uint32_t uiNow = 0;
+	int iWakeupCount = 0;
+	int i;
+
+	hppTimerWheelInit(uiNow);
+	hppBenchWheelExpiredCount = 0;
+	srand(1);
+
+	for(i = 0; i < HPP_TIMER_WHEEL_EVENT_COUNT; i++)
+		auiHandles[i] = hppTimerWheelAdd(uiNow, rand() % aiTime, 0, aiSlack, NULL, &i, sizeof(i), NULL);
+
+	for(i = 0; i < HPP_TIMER_WHEEL_EVENT_COUNT; i += 4) hppTimerWheelCancel(auiHandles[i]);
+
+	while(hppTimerWheelNextExpiry(&uiNow))
+	{
+		hppTimerWheelAdvance(uiNow, hppBenchWheelExpired);
+		iWakeupCount++;
+	}
+
+	return hppBenchWheelExpiredCount == HPP_TIMER_WHEEL_EVENT_COUNT * 3 / 4 ? iWakeupCount : -1;
+}
+
+
+// Events with overlapping slack windows must expire together. Returns the number of wake-ups with the slack 'aiSlack' or
+// -1 if these are more than a quarter of the wake-ups of the same events without slack.
+static int hppBenchWheelOverlap(int aiSlack)
+{
+	int iWakeupCount = hppBenchWheel(0, HPP_BENCH_WHEEL_DENSE_TIME);
+	int iSlackWakeupCount = hppBenchWheel(aiSlack, HPP_BENCH_WHEEL_DENSE_TIME);
+
+	if(iWakeupCount < 0 || iSlackWakeupCount < 0 || iSlackWakeupCount * 4 > iWakeupCount) return -1;
+
+	return iSlackWakeupCount;
+}
+
+
+// Variables of the restore_xxx benchmarks stand for the stored code, their values for the stored settings
+static bool hppBenchIsRestoreKey(const char aszKey[])
+{
+	return strncmp(aszKey, "Restore_", 8) == 0;
+}
+
+
+// Restore HPP_BENCH_RESTORE_COUNT variables from single settings (aiMode = 0) like hppReadVarSettingHandler, from a snapshot
+// image (aiMode = 1) or with the values mapped into a snapshot image (aiMode = 2). Like the code at boot the variables are
+// restored into an empty storage. aiMode = 3 loads the snapshot image over the existing variables like flash_restore().
+// Returns the number of variables restored.
+static int hppBenchRestore(int aiMode)
+{
+	static char* pchImage = NULL;
+	static size_t cbImageLen = 0;
+	char szKey[HPP_VAR_NAME_MAX_LEN + 1];
+	char szValue[HPP_NUMERIC_MAX_MEM + 40];
+	struct hppVarListStruct* pOtherVars;
+	struct hppVarListStruct** ppVar;
+	struct hppVarListStruct* pVar;
+	char* pValue;
+	int iCount = 0;
+	int i;
+
+	// The stored variables and the image are created once
+	if(pchImage == NULL)
+	{
+		for(i = 0; i < HPP_BENCH_RESTORE_COUNT; i++)
+		{
+			sprintf(szKey, "Restore_%d", i);
+			sprintf(szValue, "if(?Count_%d < 10) Count_%d++; return %d;", i, i, i);
+			hppVarPutStr(szKey, szValue, NULL);
+		}
+
+		cbImageLen = hppVarImageBuild(NULL, 0, hppBenchIsRestoreKey, 1);
+		pchImage = (char*)malloc(cbImageLen);
+		if(pchImage != NULL) hppVarImageBuild(pchImage, cbImageLen, hppBenchIsRestoreKey, 1);
+	}
+
+	// The existing variables are in the reverse order of the image like after all of them were changed since the snapshot
+	if(aiMode == 3)
+	{
+		for(pOtherVars = NULL; pFirstVar != NULL; pOtherVars = pVar)
+		{
+			pVar = pFirstVar;
+			pFirstVar = pVar->pNext;
+			pVar->pNext = pOtherVars;
+		}
+
+		pFirstVar = pOtherVars;
+		return pchImage != NULL ? hppVarImageLoad(pchImage, cbImageLen) : -1;
+	}
+
+	// Like after a reboot the variables are gone without tombstones of their persisted copies 
+	for(pVar = pFirstVar; pVar != NULL; pVar = pVar->pNext) 
+		if(hppBenchIsRestoreKey(pVar->szKey)) pVar->uiFlags &= ~HPP_VAR_FLAGS_PERSISTENCE;
+
+	hppVarDeleteAll("Restore_");
+
+	// The other variables (demo scripts, results) are put aside during the restore and added behind the restored ones
+	pOtherVars = pFirstVar;
+	pFirstVar = NULL;
+
+	if(aiMode == 1) iCount = pchImage != NULL ? hppVarImageLoad(pchImage, cbImageLen) : -1;
+	else if(aiMode == 2) iCount = pchImage != NULL ? hppVarImageMap(pchImage, cbImageLen) : -1;
+	else
+	{
+		for(i = 0; i < HPP_BENCH_RESTORE_COUNT; i++)
+		{
+			sprintf(szKey, "Restore_%d", i);
+			sprintf(szValue, "if(?Count_%d < 10) Count_%d++; return %d;", i, i, i);
+
+			pValue = hppVarPut(szKey, hppNoInitValue, strlen(szValue));
+
+			if(pValue != NULL) 
+			{
+				memcpy(pValue, szValue, strlen(szValue));
+				hppVarSetPersisted(szKey);
+				iCount++;
+			}
+		}
+	}
+
+	for(ppVar = &pFirstVar; *ppVar != NULL; ppVar = &(*ppVar)->pNext);
+	*ppVar = pOtherVars;
+
+	return iCount;
+}
+
+
+// Emulated CDC ACM UART of the usb_send_xxx benchmarks
+struct hppBenchUartStruct
+{
+	struct hppSendBufferStruct mSendBuffer;
+	uint8_t aSendBufferData[HPP_BENCH_USB_BUF_SIZE];
+	uint8_t aFifo[HPP_BENCH_USB_FIFO_SIZE];
+	uint32_t cbFifo;                               // bytes in the FIFO not read by the host yet
+	bool bHostReading;                             // false while the host does not read (stalled host)
+	uint8_t* pExpected;                            // bytes accepted by the send buffer in the order written
+	uint32_t cbExpected;
+	uint32_t cbReceived;                           // bytes read by the host
+	bool bMismatch;                                // the host received a byte not written at this position
+};
+
+
+static int hppBenchUartFifoFill(void* apContext, const uint8_t* apData, uint32_t acbDataLen)
+{
+	struct hppBenchUartStruct* pUart = (struct hppBenchUartStruct*)apContext;
+	uint32_t cbFill = HPP_BENCH_USB_FIFO_SIZE - pUart->cbFifo;
+
+	if(cbFill > acbDataLen) cbFill = acbDataLen;
+	memcpy(pUart->aFifo + pUart->cbFifo, apData, cbFill);
+	pUart->cbFifo += cbFill;
+
+	return (int)cbFill;
+}
+
+
+// One run of the interrupt handler of hppZephyr.c: the host reads the FIFO if it does, the send buffer refills the FIFO. 
+// Returns the number of bytes passed to the FIFO.
+static uint32_t hppBenchUartInterrupt(struct hppBenchUartStruct* apUart)
+{
+	uint32_t cbFilled = 0;
+	uint32_t cbChunk;
+	uint32_t i;
+
+	if(apUart->bHostReading)
+	{
+		for(i = 0; i < apUart->cbFifo; i++)
+		{
+			if(apUart->cbReceived >= apUart->cbExpected || apUart->aFifo[i] != apUart->pExpected[apUart->cbReceived]) apUart->bMismatch = true;
+			apUart->cbReceived++;
+		}
+
+		apUart->cbFifo = 0;
+	}
+
+	while(!hppSendBufferIsEmpty(&apUart->mSendBuffer) && 
+		  (cbChunk = hppSendBufferDrain(&apUart->mSendBuffer, HPP_BENCH_USB_FIFO_SIZE, hppBenchUartFifoFill, apUart)) > 0) cbFilled += cbChunk;
+
+	return cbFilled;
+}
+
+
+static void hppBenchUartKick(void* apContext)
+{
+	hppBenchUartInterrupt((struct hppBenchUartStruct*)apContext);
+}
+
+
+// Stands in for taking the semaphore given by the interrupt handler. Returns false like the timeout if nothing was sent.
+static bool hppBenchUartWait(void* apContext)
+{
+	return hppBenchUartInterrupt((struct hppBenchUartStruct*)apContext) > 0;
+}
+
+
+// Write HPP_BENCH_USB_COUNT lines like hppZephyrUsbSend and flush the send buffer. 'abStall' stops the host for the lines 
+// HPP_BENCH_USB_STALL_FROM to HPP_BENCH_USB_STALL_TO. Returns the number of bytes received or -1 if a self check failed.
+static int hppBenchUsbSend(bool abStall)
+{
+	static struct hppBenchUartStruct theUart;
+	static uint8_t aExpected[HPP_BENCH_USB_COUNT * HPP_BENCH_USB_LINE_LEN];
+	uint8_t aLine[HPP_BENCH_USB_LINE_LEN];
+	uint32_t uiStallWaitCount = 0;
+	uint32_t cbSent;
+	bool bSuccess = true;
+	int iLine;
+	int i;
+
+	memset(&theUart, 0, sizeof(theUart));
+	hppSendBufferInit(&theUart.mSendBuffer, theUart.aSendBufferData, sizeof(theUart.aSendBufferData));
+	theUart.pExpected = aExpected;
+	theUart.bHostReading = true;
+
+	for(iLine = 0; iLine < HPP_BENCH_USB_COUNT; iLine++)
+	{
+		for(i = 0; i < HPP_BENCH_USB_LINE_LEN - 2; i++) aLine[i] = (uint8_t)('0' + (iLine + i) % 64);
+		aLine[i++] = '\r';
+		aLine[i] = '\n';
+
+		if(abStall && iLine == HPP_BENCH_USB_STALL_FROM) theUart.bHostReading = false;
+
+		if(abStall && iLine == HPP_BENCH_USB_STALL_TO) 
+		{
+			// Once the host was found stalled the writer must not have waited again
+			if(!theUart.mSendBuffer.bStalled || theUart.mSendBuffer.uiWaitCount != uiStallWaitCount) bSuccess = false;
+			theUart.bHostReading = true;
+		}
+
+		// The host may read the first bytes of the line before the write returns, only the bytes not put are dropped
+		memcpy(aExpected + theUart.cbExpected, aLine, sizeof(aLine));
+		theUart.cbExpected += sizeof(aLine);
+
+		cbSent = hppSendBufferWrite(&theUart.mSendBuffer, aLine, sizeof(aLine), hppBenchUartKick, hppBenchUartWait, &theUart);
+		theUart.cbExpected -= sizeof(aLine) - cbSent;
+
+		if(theUart.mSendBuffer.bStalled && uiStallWaitCount == 0) uiStallWaitCount = theUart.mSendBuffer.uiWaitCount;
+	}
+
+	// Flush: the host reads the rest
+	while(!hppSendBufferIsEmpty(&theUart.mSendBuffer) || theUart.cbFifo > 0) hppBenchUartInterrupt(&theUart);
+
+	if(theUart.bMismatch || theUart.cbReceived != theUart.cbExpected || theUart.mSendBuffer.bStalled) bSuccess = false;
+	if(!abStall && (theUart.mSendBuffer.uiDropCount != 0 || theUart.cbReceived != sizeof(aExpected))) bSuccess = false;
+	if(abStall && (theUart.mSendBuffer.uiDropCount == 0 || uiStallWaitCount == 0)) bSuccess = false;
+	if(theUart.mSendBuffer.uiSentCount != theUart.cbReceived) bSuccess = false;
+
+	return bSuccess ? (int)theUart.cbReceived : -1;
+}
+
+
+// Store the result 'aiResult' of a host stand-in in 'aszResultVarKey'. A negative result means its self check failed. It is 
+// stored as error, such that the benchmark fails.
+static char* hppBenchPutResult(const char aszResultVarKey[], int aiResult, size_t* apcbResultLen_Out)
+{
+	char szNumeric[HPP_NUMERIC_MAX_MEM];
+
+	if(aiResult < 0) return hppVarPutStr(aszResultVarKey, "#Error: self check failed", apcbResultLen_Out);
+
+	return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, aiResult), apcbResultLen_Out);
+}
+
+
+// Stubs for the device functions used by the demo scripts (see hppZephyr.c and hppThread.c). They do nothing but return true.
+// The CoAP request is a POST such that hello_handler switches on the PWM.
+static char* hppBenchDeviceFunction(char aszFunctionName[], char aszParamName[], const char aszResultVarKey[], size_t* apcbResultLen_Out)
+{
+	static const char* aszPrefix[] = { "io_", "timer_", "coap_", "cli_", "flash_", "ip_", NULL };
+	int i;
+
+	if(strcmp(aszFunctionName, "dispatch_run") == 0) 
+		return hppBenchPutResult(aszResultVarKey, hppBenchDispatch(hppAtoI(hppVarGet(aszParamName, NULL))), apcbResultLen_Out);
+
+	if(strcmp(aszFunctionName, "wheel_run") == 0) 
+		return hppBenchPutResult(aszResultVarKey, hppBenchWheel(hppAtoI(hppVarGet(aszParamName, NULL)), HPP_BENCH_WHEEL_TIME), apcbResultLen_Out);
+
+	if(strcmp(aszFunctionName, "wheel_overlap_run") == 0) 
+		return hppBenchPutResult(aszResultVarKey, hppBenchWheelOverlap(hppAtoI(hppVarGet(aszParamName, NULL))), apcbResultLen_Out);
+
+	if(strcmp(aszFunctionName, "restore_run") == 0) 
+		return hppBenchPutResult(aszResultVarKey, hppBenchRestore(hppAtoI(hppVarGet(aszParamName, NULL))), apcbResultLen_Out);
+
+	if(strcmp(aszFunctionName, "usb_send_run") == 0) 
+		return hppBenchPutResult(aszResultVarKey, hppBenchUsbSend(hppAtoI(hppVarGet(aszParamName, NULL)) != 0), apcbResultLen_Out);
+
+	if(strncmp(aszFunctionName, "coap_is_", 8) == 0) 
+		return hppVarPutStr(aszResultVarKey, strcmp(aszFunctionName, "coap_is_post") == 0 ? "true" : "false", apcbResultLen_Out);
+
+	for(i = 0; aszPrefix[i] != NULL; i++)
+		if(strncmp(aszFunctionName, aszPrefix[i], strlen(aszPrefix[i])) == 0) return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+
+	return NULL;
+}
+
+
+// Execute 'aszCode' and copy the result to 'aszResult_Out' (at most HPP_BENCH_RESULT_MAX_LEN characters, commas replaced).
+// Returns false if the result is an error.
+static bool hppBenchExecute(const char* aszCode, char* aszResult_Out)
+{
+	char* pchResult = hppParseExpression(aszCode, "ReturnWithError");
+	bool bSuccess = pchResult == NULL || strncmp(pchResult, "#Error", 6) != 0;
+	int i;
+
+	for(i = 0; pchResult != NULL && pchResult[i] != 0 && pchResult[i] != '\n' && i < HPP_BENCH_RESULT_MAX_LEN; i++)
+		aszResult_Out[i] = pchResult[i] == ',' ? ';' : pchResult[i];
+	aszResult_Out[i] = 0;
+
+	hppVarDelete("ReturnWithError");
+	return bSuccess;
+}
+
+
+// Run the benchmark 'apBench' 'aiRuns' times and write the CSV line. Returns false if any execution returned an error.
+static bool hppBenchRun(const hppBench* apBench, int aiRuns)
+{
+	char szResult[HPP_BENCH_RESULT_MAX_LEN + 1] = "";
+	double dMin = 0, dMax = 0, dSum = 0, dTime;
+	uint32_t uiLookupCount, uiHeapAllocCount;
+	bool bSuccess = true;
+	int i;
+
+	hppVarDeleteAll("");
+	for(i = 0; hppBenchDemoScripts[i] != NULL; i += 2) hppVarPutStr(hppBenchDemoScripts[i], hppBenchDemoScripts[i + 1], NULL);
+
+	if(apBench->szSetup != NULL) bSuccess = hppBenchExecute(apBench->szSetup, szResult);
+	if(bSuccess) bSuccess = hppBenchExecute(apBench->szCode, szResult);   // warm-up
+
+	uiLookupCount = hppVarLookupCount;
+	uiHeapAllocCount = hppVarHeapAllocCount;
+
+	for(i = 0; i < aiRuns && bSuccess; i++)
+	{
+		dTime = hppBenchNowUs();
+		bSuccess = hppBenchExecute(apBench->szCode, szResult);
+		dTime = hppBenchNowUs() - dTime;
+
+		if(i == 0 || dTime < dMin) dMin = dTime;
+		if(i == 0 || dTime > dMax) dMax = dTime;
+		dSum += dTime;
+	}
+
+	printf("%s,%d,%.1f,%.1f,%.1f,%lu,%lu,%s\n", apBench->szName, aiRuns, dMin, dSum / aiRuns, dMax,
+		   (unsigned long)((hppVarLookupCount - uiLookupCount) / (uint32_t)aiRuns),
+		   (unsigned long)((hppVarHeapAllocCount - uiHeapAllocCount) / (uint32_t)aiRuns), szResult);
+
+	if(!bSuccess) fprintf(stderr, "hpp_bench: %s failed: %s\n", apBench->szName, szResult);
+
+	hppVarDeleteAll("");
+	return bSuccess;
+}
+
+
+// Returns true if the benchmark 'aszName' starts with one of the prefixes given on the command line or if there are none
+static bool hppBenchSelected(const char* aszName, int argc, char* argv[])
+{
+	bool bFilter = false;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--runs") == 0) { i++; continue; }
+
+		bFilter = true;
+		if(strncmp(aszName, argv[i], strlen(argv[i])) == 0) return true;
+	}
+
+	return !bFilter;
+}
+
+
+int main(int argc, char* argv[])
+{
+	int iRuns = HPP_BENCH_DEFAULT_RUNS;
+	int iResult = 0;
+	int i;
+
+	for(i = 1; i < argc - 1; i++) if(strcmp(argv[i], "--runs") == 0) iRuns = atoi(argv[i + 1]);
+
+	if(iRuns <= 0)
+	{
+		fprintf(stderr, "usage: hpp_bench [--runs <n>] [<benchmark name prefix> ...]\n");
+		return 2;
+	}
+
+	hppAddExternalFunctionLibrary(hppBenchDeviceFunction);
+
+	printf("benchmark,runs,min_us,mean_us,max_us,var_lookups,heap_allocs,result\n");
+
+	for(i = 0; hppBenchList[i].szName != NULL; i++)
+		if(hppBenchSelected(hppBenchList[i].szName, argc, argv) && !hppBenchRun(&hppBenchList[i], iRuns)) iResult = 1;
+
+	return iResult;
+}
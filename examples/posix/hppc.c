@@ -0,0 +1,231 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppc.c														            */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Image Compiler									            */
+/*																	            */
+/*   - Compiles H++ source code into pre-tokenized code images	            	*/
+/*   - Verifies images by executing source and image code			            */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike											        */
+/* Dependencies: hppParser.c, hppVarStorage.c, hppProfiler.c, hppPosixFile.c    */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+// Build: cc -I../../include hppc.c hppPosixFile.c ../../src/hppParser.c ../../src/hppVarStorage.c ../../src/hppProfiler.c -lm -o hppc
+//
+// Usage: hppc [-o <image file>] [--verify] [--profile <folded file>] <source file>
+//
+// The image is written to <source file>.hppi unless another file name is given with -o. Upload the image with a 
+// CoAP PUT to /var/<name> like source code. The device restores the code from the image when the variable is stored.
+// With --verify the image is loaded again and both the source code and the code restored from the image are executed. 
+// The program fails if the results differ. With --profile the source code is executed with the sampling profiler and the
+// samples are written in the folded stack format, e.g. as input for flamegraph.pl.
+
+#include "../../include/hppParser.h"
+#include "../../include/hppVarStorage.h"
+#include "../../include/hppProfiler.h"
+#include "../../include/hppZephyrImageTokens.h"
+#include "hppPosixFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+
+// Execute the H++ code 'aszCode' with a clean variable storage and return a copy of the result without column numbers
+// of errors, which refer to the minified code when executing the image. The result must be released with free.
+static char* hppcExecute(const char* aszCode)
+{
+	char* pchResult;
+	char* pchColumn;
+	char* pchEnd;
+
+	hppVarDeleteAll("");
+	pchResult = hppParseExpression(aszCode, "ReturnWithError");
+	pchResult = strdup(pchResult != NULL ? pchResult : "(null)");
+	hppVarDeleteAll("");
+
+	if(pchResult != NULL && (pchColumn = strstr(pchResult, " near column ")) != NULL)
+	{
+		for(pchEnd = pchColumn + 13; *pchEnd >= '0' && *pchEnd <= '9'; pchEnd++);
+		memmove(pchColumn, pchEnd, strlen(pchEnd) + 1);
+	}
+
+	return pchResult;
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* szSourceFileName = NULL;
+	const char* szImageFileName = NULL;
+	const char* szProfileFileName = NULL;
+	char szDefaultImageFileName[FILENAME_MAX];
+	bool bVerify = false;
+	char* pchSource;
+	char* pchCode;
+	char* pchSourceResult;
+	char* pchImageResult;
+	char* pchSamples;
+	uint8_t* pImage;
+	size_t cbSourceLen;
+	size_t cbImageLen;
+	size_t cbCodeLen;
+	FILE* pFile;
+	int i;
+	int iResult = 0;
+
+	// The builtin functions of the firmware are tokenized with the same token bytes as on the device
+	hppAddImageTokens(hppZephyrImageTokens);
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) szImageFileName = argv[++i];
+		else if(strcmp(argv[i], "--verify") == 0) bVerify = true;
+		else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) szProfileFileName = argv[++i];
+		else if(argv[i][0] != '-' && szSourceFileName == NULL) szSourceFileName = argv[i];
+		else szSourceFileName = NULL, i = argc;
+	}
+
+	if(szSourceFileName == NULL)
+	{
+		fprintf(stderr, "usage: hppc [-o <image file>] [--verify] [--profile <folded file>] <source file>\n");
+		return 2;
+	}
+
+	if(szImageFileName == NULL)
+	{
+		snprintf(szDefaultImageFileName, sizeof(szDefaultImageFileName), "%s.hppi", szSourceFileName);
+		szImageFileName = szDefaultImageFileName;
+	}
+
+	pchSource = hppPosixReadFile(szSourceFileName, &cbSourceLen);
+
+	if(pchSource == NULL)
+	{
+		fprintf(stderr, "hppc: cannot read %s\n", szSourceFileName);
+		return 1;
+	}
+
+	// Images are never larger than the source code plus header and line table
+	pImage = (uint8_t*)malloc(3 * cbSourceLen + HPP_IMAGE_HEADER_LEN + 16);
+	cbImageLen = pImage != NULL ? hppCompileImage(pchSource, cbSourceLen, pImage, 3 * cbSourceLen + HPP_IMAGE_HEADER_LEN + 16) : 0;
+
+	if(cbImageLen == 0)
+	{
+		fprintf(stderr, "hppc: cannot compile %s (code too long?)\n", szSourceFileName);
+		free(pchSource);
+		free(pImage);
+		return 1;
+	}
+
+	pFile = fopen(szImageFileName, "wb");
+
+	if(pFile == NULL || fwrite(pImage, 1, cbImageLen, pFile) != cbImageLen)
+	{
+		fprintf(stderr, "hppc: cannot write %s\n", szImageFileName);
+		iResult = 1;
+	}
+	else printf("%s: %u bytes source, %u bytes image (version %u, %u bytes line table)\n", szImageFileName, (unsigned int)cbSourceLen, 
+				(unsigned int)cbImageLen, HPP_IMAGE_VERSION, (unsigned int)(pImage[8] | (pImage[9] << 8)));
+
+	if(pFile != NULL) fclose(pFile);
+
+	// The interpreter does not accept '/* */' comments. Source code using them is executed minified.
+	if(strstr(pchSource, "/*") != NULL) hppMinifyCode(pchSource, cbSourceLen);
+
+	// Round trip: load the image like the device does and compare the execution results
+	if(bVerify && iResult == 0)
+	{
+		cbCodeLen = hppGetImageCodeLen(pImage, cbImageLen);
+		pchCode = (char*)malloc(cbCodeLen + 1);
+
+		if(pchCode == NULL || hppLoadImage(pImage, cbImageLen, pchCode, cbCodeLen + 1) != cbCodeLen)
+		{
+			fprintf(stderr, "hppc: cannot load image %s\n", szImageFileName);
+			iResult = 1;
+		}
+		else
+		{
+			pchSourceResult = hppcExecute(pchSource);
+			pchImageResult = hppcExecute(pchCode);
+
+			if(pchSourceResult == NULL || pchImageResult == NULL || strcmp(pchSourceResult, pchImageResult) != 0)
+			{
+				fprintf(stderr, "hppc: verify failed\n  source: %s\n  image:  %s\n", pchSourceResult, pchImageResult);
+				iResult = 1;
+			}
+			else printf("verify ok: %s\n", pchSourceResult);
+
+			free(pchSourceResult);
+			free(pchImageResult);
+		}
+
+		free(pchCode);
+	}
+
+	// Sample the execution of the source code 
+	if(szProfileFileName != NULL && iResult == 0)
+	{
+		hppAddExternalPollFunction(hppProfilerPollFunction);
+		hppProfilerReset();
+		hppProfilerEnableSampling(true);
+		free(hppcExecute(pchSource));
+		hppProfilerEnableSampling(false);
+
+		cbCodeLen = hppProfilerDumpSamples(NULL, 0);
+		pchSamples = (char*)malloc(cbCodeLen + 1);
+		pFile = fopen(szProfileFileName, "w");
+
+		if(pchSamples != NULL && pFile != NULL)
+		{
+			hppProfilerDumpSamples(pchSamples, cbCodeLen + 1);
+			fprintf(pFile, "%s\n", pchSamples);
+		}
+		else
+		{
+			fprintf(stderr, "hppc: cannot write %s\n", szProfileFileName);
+			iResult = 1;
+		}
+
+		if(pFile != NULL) fclose(pFile);
+		free(pchSamples);
+	}
+
+	free(pchSource);
+	free(pImage);
+
+	return iResult;
+}
@@ -0,0 +1,146 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppAsyncQueue.h                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Async Queues                                               */
+/*                                                                              */
+/*   - Ring buffers of entries passed to the dispatcher of the parser           */
+/*   - Weighted selection of queues, coalescing of updates, batched dispatch    */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: none                                                           */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#ifndef __INCL_HPP_ASYNC_QUEUE_
+#define __INCL_HPP_ASYNC_QUEUE_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define HPP_ASYNC_QUEUE_HEADER_SIZE (sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint16_t))   // type, enqueue time and length of each entry
+#define HPP_ASYNC_QUEUE_VAR_NAME_MAX_LEN 32         // longest variable name compared by hppAsyncQueueIsCoalesced
+
+
+// Entries of one priority in a ring buffer. Each entry starts with a header of its type, its enqueue time and the length 
+// of its data. The buffer holds one byte less than its size.
+struct hppAsyncQueueStruct
+{
+	uint8_t* pBuffer;
+	uint32_t cbSize;
+	volatile uint32_t uiHead;                      // Read position, only changed by the reader
+	volatile uint32_t uiTail;                      // Write position, only changed by the writers
+	uint32_t uiWeight;                             // Entries selected per round
+	uint32_t uiCredit;                             // Entries left to be selected in the present round
+	const char* szName;                            // Name in the statistics
+	uint32_t uiPutCount;                           // Entries queued since the statistics were reset
+	uint32_t uiDropCount;                          // Entries rejected since the ring buffer was full
+	uint32_t uiHighWater;                          // Maximum number of bytes used in the ring buffer
+};
+
+// Entries dispatched in one batch, i.e. with one lock of the parser mutex
+struct hppAsyncBatchStruct
+{
+	uint32_t uiMaxCount;                           // Maximum number of entries per batch (1 = no batching)
+	uint32_t uiMaxTime;                            // The batch is closed once it took longer than this number of ticks
+	uint32_t uiMaxOutputs;                         // Maximum number of outputs written after the batch
+	uint32_t uiCount;                              // Entries dispatched in the present batch
+	uint32_t uiStartTime;                          // Tick at which the present batch started
+};
+
+
+// The queue functions are not thread safe except that one reader and one writer may access the same queue at the same
+// time. Writers serialize their calls (e.g. with a scheduler lock), entries are read by a single dispatcher thread.
+
+// Use the 'acbSize' bytes of 'apBuffer' for the entries of 'apQueue'. The queue is selected 'auiWeight' times per round.
+void hppAsyncQueueInit(struct hppAsyncQueueStruct* apQueue, const char* aszName, uint8_t* apBuffer, uint32_t acbSize, uint32_t auiWeight);
+
+// Number of bytes which can be put in the queue
+uint32_t hppAsyncQueueSpace(const struct hppAsyncQueueStruct* apQueue);
+
+// Number of bytes in the queue
+uint32_t hppAsyncQueueUsed(const struct hppAsyncQueueStruct* apQueue);
+
+// Maximum number of bytes in the queue
+uint32_t hppAsyncQueueCapacity(const struct hppAsyncQueueStruct* apQueue);
+
+bool hppAsyncQueueIsEmpty(const struct hppAsyncQueueStruct* apQueue);
+
+// Put the header of an entry of the type 'auiType' with 'auiLen' bytes of data queued at 'auiTime'. The data follows with 
+// hppAsyncQueuePut. The space for the whole entry must have been checked with hppAsyncQueueSpace.
+void hppAsyncQueuePutHeader(struct hppAsyncQueueStruct* apQueue, uint8_t auiType, uint16_t auiLen, uint32_t auiTime);
+
+// Put 'acbLen' bytes of 'apData'. Returns the number of bytes put, which is less if the queue is full.
+uint32_t hppAsyncQueuePut(struct hppAsyncQueueStruct* apQueue, const void* apData, uint32_t acbLen);
+
+// Count an entry put (updates the high water mark) or rejected by the queue
+void hppAsyncQueueRecordPut(struct hppAsyncQueueStruct* apQueue);
+void hppAsyncQueueRecordDrop(struct hppAsyncQueueStruct* apQueue);
+
+// Reset the statistics of the queue
+void hppAsyncQueueResetStats(struct hppAsyncQueueStruct* apQueue);
+
+// Get the header of the next entry. Returns false if the queue is empty.
+bool hppAsyncQueueGetHeader(struct hppAsyncQueueStruct* apQueue, uint8_t* apuiType_Out, uint16_t* apuiLen_Out, uint32_t* apuiTime_Out);
+
+// Get 'acbLen' bytes of the entry in 'apData_Out' (skipped if NULL). Returns the number of bytes read.
+uint32_t hppAsyncQueueGet(struct hppAsyncQueueStruct* apQueue, void* apData_Out, uint32_t acbLen);
+
+// Read type and variable name of the next entry without removing it. Only for entries starting with a variable name of
+// at most 'acbVarNameMaxLen' bytes. Returns false if there is no such entry.
+bool hppAsyncQueuePeekVarName(const struct hppAsyncQueueStruct* apQueue, uint8_t* apuiType_Out, char* aszVarName_Out, uint32_t acbVarNameMaxLen);
+
+// Returns true if the next entry has the type 'auiType' and starts with the variable name 'aszVarName'. An update of the
+// variable just read is overwritten by the next entry then and needs not to be stored. 
+bool hppAsyncQueueIsCoalesced(const struct hppAsyncQueueStruct* apQueue, uint8_t auiType, const char* aszVarName);
+
+// Select the queue of the next entry out of the 'anQueues' queues of 'apQueues' given in the order of their priority.
+// Each queue is selected at most 'uiWeight' times per round while lower priority queues are waiting, such that none
+// of them starves. Returns NULL if all queues are empty.
+struct hppAsyncQueueStruct* hppAsyncQueueSelect(struct hppAsyncQueueStruct* apQueues, uint32_t anQueues);
+
+// Set the limits of batches
+void hppAsyncBatchInit(struct hppAsyncBatchStruct* apBatch, uint32_t auiMaxCount, uint32_t auiMaxTime, uint32_t auiMaxOutputs);
+
+// Start a batch at tick 'auiNow' after the parser mutex was locked
+void hppAsyncBatchBegin(struct hppAsyncBatchStruct* apBatch, uint32_t auiNow);
+
+// Count an entry dispatched in the batch. Returns true if the batch continues with the next entry without unlocking the
+// parser mutex: 'abReady' tells if there is a next entry, 'anOutputs' is the number of outputs collected so far and 
+// 'abEnd' is true if an output of the entry requires to end the batch.
+bool hppAsyncBatchNext(struct hppAsyncBatchStruct* apBatch, uint32_t auiNow, uint32_t anOutputs, bool abEnd, bool abReady);
+
+#endif
@@ -51,6 +51,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "hppVarStorage.h"
+
 
 #define HPP_ERROR_CODE_MIN 200              // Programatic Errors, not including timeout
 #define HPP_CALL_FUNCTION_NAME_MAX_LEN 20   // maximum lenght of function names (for error reporting only)
@@ -58,7 +60,13 @@
 #define HPP_PARAM_PREFIX "%04x:param1"
 #define HPP_PARAM_PREFIX_LEN 11
 
-#define HPP_EXP_STACK_SIZE 800
+#define HPP_IMAGE_VERSION 1                // version of the pre-tokenized code image format (see hppCompileImage)
+#define HPP_IMAGE_HEADER_LEN 12
+
+#define HPP_STACK_MAX_DEPTH 8             // maximum number of innermost function calls reported by hppParseExpressionGetStack
+
+#define HPP_EXP_STACK_SIZE 800     // default size of the expression stack; may be changed with hppSetParseLimits
+#define HPP_MAX_CALL_DEPTH 100     // default maximum nesting depth of expressions; may be changed with hppSetParseLimits
 
 
 enum hppReturnReasonEnum { hppReturnReason_None, hppReturnReason_Return, hppReturnReason_Break, hppReturnReason_Continue, hppReturnReason_EOF =100,
@@ -69,24 +77,48 @@ enum hppReturnReasonEnum { hppReturnReason_None, hppReturnReason_Return, hppRetu
 						   hppReturnReason_Error_MissingArgument, hppReturnReason_Error_DivisionByZero, hppReturnReason_Error_FirstOperand_BooleanValueExpected,
 						   hppReturnReason_Error_SecondOperand_BooleanValueExpected, hppReturnReason_Error_UnknownFunctionName, hppReturnReason_Error_CannotCallMethodOnResult,
 						   hppReturnReason_Error_UnknownArrayType, hppReturnReason_Error_OpeningSquaredBracketExpected, hppReturnReason_StructVarNameTooLong,
-						   hppReturnReason_Error_UnknownMemberType, hppReturnReason_Error_StackOverflow };
+						   hppReturnReason_Error_UnknownMemberType, hppReturnReason_Error_StackOverflow, hppReturnReason_Error_CodeChanged };
 
 
 enum hppExternalPollFunctionEventEnum { hppExternalPollFunctionEvent_Begin, hppExternalPollFunctionEvent_Poll, hppExternalPollFunctionEvent_End }; 
 
+// Parser frames are defined in hppParser.c 
+struct hppParseFrameStruct;
+struct hppProfilerCallStruct;
+
 struct hppParseExpressionStruct
 {
 	const char* szCode;
+	struct hppVarConstTableStruct* pConstTable;  // Constants interned for szCode (see hppVarConstPut), NULL if none are interned
 	char* szExpressionStack;
 	char* szExpressionStackPointer;
+	size_t cbExpressionStackSize;
 	size_t cbPos;
 	unsigned int iCallDepth;
 	unsigned int iFunctionCallDepth;
+	unsigned int uiMaxCallDepth;
+	struct hppParseFrameStruct* pFrame;          // Frame of the expression presently evaluated
+	struct hppParseFrameStruct* pFreeFrames;     // Frames available for reuse
 	enum hppReturnReasonEnum eReturnReason;
 	char szErrorCallFunctionName[HPP_CALL_FUNCTION_NAME_MAX_LEN + 1];
 	size_t cbErrorCallFunctionPos;
 	unsigned int uiExternalPollFunctionTickCount;
 	uint32_t uiExternalTimer;
+	uint32_t uiExternalTimeUsed;                 // Time used by all finished slices of the task, maintained by the external poll function
+	const char* szResultVarKey;                  // Result variable of the task 
+	char* pchResult;                             // Result of the task once it has finished
+	unsigned int uiLocalBase;                    // Call depth used for the local variables of the top level of the task
+	unsigned int uiSliceTickBudget;              // Number of expressions evaluated in one slice (0 = unlimited)
+	unsigned int uiSliceTickCount;
+	uint32_t uiCodeChangeCount;                  // Value of hppVarCodeChangeCount at the end of the last slice
+	const char* szTaskCode;                      // Code the task has been started with if it is the value of a variable, NULL otherwise
+	unsigned int uiSliceCount;                   // Number of slices after which the task has been suspended
+	bool bSuspended;                             // Task has been suspended and continues with the next slice
+	bool bYielded;                               // Task waits for the result of an external function (see hppParseExpressionYield)
+	struct hppProfilerCallStruct* pProfilerCall; // Innermost function call of the task recorded by the profiler
+	struct hppVarScratchArenaStruct mScratchArena;   // Temporary variables of the task, released by hppParseExpressionEnd
+	struct hppVarConstTableStruct mConstTable;       // Constants interned for code of the task which is not the value of a variable
+	size_t cbConstFirstPassPos;                      // End of the frames evaluated so far in the code of mConstTable (see hppConstCachePut)
 };
 
 
@@ -101,9 +133,72 @@ typedef void (*hppExternalPollFunctionType)(struct hppParseExpressionStruct*, en
 // error. Otherwise the result in NULL in case of a parse error. 
 char* hppParseExpression(const char* aszCode, const char* aszResultVarKey);
 
+// Prepare parsing of the H++ code in 'aszCode' as a task which is executed in one or more slices with hppParseExpressionContinue.
+// The return value is stored in the variable 'aszResultVarKey' which must remain valid until hppParseExpressionEnd is called.
+// Local variables of the task use the call depth 'auiLocalBase' and above for their prefix. Tasks running interleaved must use
+// distinct bases. Local variables of call depth zero (e.g. injected parameters) are moved to the base of the task.
+// Returns NULL if not successful.
+struct hppParseExpressionStruct* hppParseExpressionBegin(const char* aszCode, const char* aszResultVarKey, unsigned int auiLocalBase);
+
+// Continue parsing the task 'apParseContext' created with hppParseExpressionBegin. Parsing is suspended after 'auiTickBudget' 
+// expressions have been evaluated. A budget of zero continues until the end of the code. The task is aborted with the error
+// CodeChanged if the code of the task or of a function call in progress has been updated or deleted while it was suspended.
+// Returns true if parsing has finished and false if it has been suspended. 
+bool hppParseExpressionContinue(struct hppParseExpressionStruct* apParseContext, unsigned int auiTickBudget);
+
+// Suspend the task presently evaluated once the calling external function returns. The task continues with the next call 
+// of hppParseExpressionContinue and reads the result of the function from its result variable at this time.
+// Returns false if the code is not evaluated as a task in slices. The external function must return its result immediately then.
+bool hppParseExpressionYield();
+
+// Write the call stack of the task 'apParseContext' to 'aszStack_Out' in the format "main:line;function:line;..." starting with
+// the outermost level ('main' is the code the task has been started with). Only the innermost HPP_STACK_MAX_DEPTH levels are 
+// included. May be called from an external poll function. Returns the length of the text written.
+size_t hppParseExpressionGetStack(const struct hppParseExpressionStruct* apParseContext, char* aszStack_Out, size_t acbMaxLen);
+
+// Finish parsing of the task 'apParseContext' and release all its resources. A task which has not finished yet is aborted with 
+// a timeout error. Returns a pointer to the char array assoziated with the result variable of the task.
+// If the name of the result variable equals "ReturnWithError", an error text is created in case of a parse error. 
+// Otherwise the result in NULL in case of a parse error. A prefix ending with ':' is ignored for this name comparison.
+char* hppParseExpressionEnd(struct hppParseExpressionStruct* apParseContext);
+
+// Set the maximum nesting depth of expressions, brackets, arguments and function calls and the size of the
+// expression stack holding the names of the expressions of all nesting levels. Zero keeps the present value.
+// The new limits apply to subsequent calls of hppParseExpression. Exceeding a limit results in a stack overflow error.
+void hppSetParseLimits(unsigned int auiMaxCallDepth, size_t acbExpressionStackSize);
+
+// Get the present limits set with hppSetParseLimits. Pointers may be NULL. 
+void hppGetParseLimits(unsigned int* apuiMaxCallDepth_Out, size_t* apcbExpressionStackSize_Out);
+
+// Remove comments and whitespaces which are not needed from the 'acbCodeLen' bytes long H++ code in 'apchCode' (in place).
+// Line breaks are kept such that errors are reported with the line numbers of the original code. Returns the new length.
+size_t hppMinifyCode(char* apchCode, size_t acbCodeLen);
+
+// Compile the 'acbCodeLen' bytes long H++ code in 'aszCode' into a pre-tokenized code image in 'apImage_Out'.
+// The code is minified (see hppMinifyCode) and frequently used words are replaced by single byte tokens. 
+// The image starts with a 12 byte header: magic "\0HPI", version, flags, length of the code, length of the line table and 
+// length of the body (16 bit little endian each) followed by the line table and the body.
+// Returns the length of the image or zero if 'acbImageMaxLen' is too small.
+size_t hppCompileImage(const char* aszCode, size_t acbCodeLen, uint8_t* apImage_Out, size_t acbImageMaxLen);
+
+// Returns the length of the H++ code stored in the code image 'apImage' or zero if 'apImage' is no valid code image
+// of the present HPP_IMAGE_VERSION.
+size_t hppGetImageCodeLen(const uint8_t* apImage, size_t acbImageLen);
+
+// Restore the H++ code of the code image 'apImage' in 'apchCode_Out' including a terminating null byte. The code includes
+// the line breaks of the original code such that errors are reported with the original line numbers.
+// Returns the length of the code or zero if the image is invalid or 'acbCodeMaxLen' is too small.
+size_t hppLoadImage(const uint8_t* apImage, size_t acbImageLen, char* apchCode_Out, size_t acbCodeMaxLen);
+
 // Add an external function library 
 bool hppAddExternalFunctionLibrary(hppExternalFunctionType aExternalFunctionType);
 
+// Add a NULL terminated table of words which are replaced by a token byte in code images, usually the builtin functions
+// of the platform. The table must stay valid. Token bytes are assigned in the order the tables are added, so the device 
+// and the host compiler (examples/posix/hppc.c) must add the same tables in the same order.
+// Returns false if all tables are used or if there are too many words for the token bytes.
+bool hppAddImageTokens(const char* const aszTokens[]);
+
 // Add an external poll function which shall be called regularly while parsing h++ code
 // Returns an existing poll function, if it exists. Otherwhise returns NULL 
 hppExternalPollFunctionType hppAddExternalPollFunction(hppExternalPollFunctionType aNewExternalPollFunction);
@@ -0,0 +1,151 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppProfiler.h                                                          */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Profiler                                                   */
+/*                                                                              */
+/*   - Call count and run time of H++ functions (code variables)                */
+/*   - Variable lookups and heap allocations per function                       */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: hppVarStorage.h                                                */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#ifndef __INCL_HPP_PROFILER_
+#define __INCL_HPP_PROFILER_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hppParser.h"
+
+
+#define HPP_PROFILER_ENTRY_COUNT 32          // number of functions recorded; further functions are not recorded
+#define HPP_PROFILER_NAME_MAX_LEN 20         // function names are truncated to this length
+#define HPP_PROFILER_SAMPLE_COUNT 32         // number of distinct call stacks recorded by the sampling profiler
+#define HPP_PROFILER_STACK_MAX_LEN 63        // call stacks are truncated to this length
+
+
+// Clock used to measure the run time (e.g. microseconds). The value may wrap around.
+typedef uint32_t (*hppProfilerClockType)(void);
+
+// Totals of one function
+struct hppProfilerEntryStruct
+{
+	char szName[HPP_PROFILER_NAME_MAX_LEN + 1];
+	uint32_t uiCallCount;
+	uint32_t uiInclusiveTime;        // Run time including the functions called 
+	uint32_t uiExclusiveTime;        // Run time of the code of the function itself
+	uint32_t uiVarLookupCount;       // Variable lookups of the code of the function itself
+	uint32_t uiHeapAllocCount;       // Heap allocations of the code of the function itself
+};
+
+// Function call in progress. Part of the parser frame of the call.
+struct hppProfilerCallStruct
+{
+	struct hppProfilerCallStruct* pCaller;
+	int iEntry;                      // Index of the entry of the function or -1 if the call is not recorded
+	uint32_t uiGeneration;           // Value of hppProfilerGeneration when the call started
+	uint32_t uiStartTime;            // Elapsed values while the task is suspended (see hppProfilerSuspend) 
+	uint32_t uiStartVarLookupCount;
+	uint32_t uiStartHeapAllocCount;
+	uint32_t uiChildTime;
+	uint32_t uiChildVarLookupCount;
+	uint32_t uiChildHeapAllocCount;
+};
+
+
+// Number of samples taken with the same call stack and line
+struct hppProfilerSampleStruct
+{
+	char szStack[HPP_PROFILER_STACK_MAX_LEN + 1];    // Format "main:line;function:line;..." (see hppParseExpressionGetStack)
+	uint32_t uiCount;
+};
+
+
+// The parser only calls hppProfilerEnter if this flag is set
+extern bool hppProfilerEnabled;
+
+// hppProfilerSample only records samples if this flag is set
+extern bool hppProfilerSamplingEnabled;
+
+
+// Enable or disable profiling. Calls in progress are completed when profiling is disabled.
+void hppProfilerEnable(bool abEnable);
+
+// Enable or disable the sampling profiler
+void hppProfilerEnableSampling(bool abEnable);
+
+// Clear all entries and samples. Calls in progress are not recorded.
+void hppProfilerReset();
+
+// Set the clock used for the run time. No run time is recorded without clock.
+void hppProfilerSetClock(hppProfilerClockType aClock);
+
+// Start the call 'apCall' of the function 'aszName'. '*appCurrentCall' is the present call of the task, which becomes
+// the caller. '*appCurrentCall' is set to 'apCall'.
+void hppProfilerEnter(struct hppProfilerCallStruct** appCurrentCall, struct hppProfilerCallStruct* apCall, const char* aszName);
+
+// Finish the call 'apCall' started with hppProfilerEnter and add its totals to the entry of the function. 
+// '*appCurrentCall' is set to the caller.
+void hppProfilerExit(struct hppProfilerCallStruct** appCurrentCall, struct hppProfilerCallStruct* apCall);
+
+// Stop the clock of the calls 'apCurrentCall' and its callers while the task is suspended and continue with 
+// hppProfilerContinue when the next slice of the task starts. Time spent by other tasks is not added to these calls.
+void hppProfilerSuspend(struct hppProfilerCallStruct* apCurrentCall);
+void hppProfilerContinue(struct hppProfilerCallStruct* apCurrentCall);
+
+// Record the present call stack and line of the task 'apParseContext'. To be called from the external poll function, 
+// which is called every HPP_EXTERNAL_POLL_FUNCTION_TICK_COUNT expressions. Samples which do not fit in the table are counted 
+// for the stack "[other]".
+void hppProfilerSample(const struct hppParseExpressionStruct* apParseContext);
+
+// External poll function taking samples if sampling is enabled. It may be installed with hppAddExternalPollFunction 
+// if no other poll function is used (e.g. in host builds).
+void hppProfilerPollFunction(struct hppParseExpressionStruct* apParseContext, enum hppExternalPollFunctionEventEnum aPollFunctionEvent);
+
+// Get the entry with the index 'aiIndex'. Returns NULL if the entry is not in use.
+const struct hppProfilerEntryStruct* hppProfilerGetEntry(int aiIndex);
+
+// Write all entries in the compact format "name,calls,inclusive time,exclusive time,lookups,allocs" with one line 
+// per function to 'aszResult'. Returns the length of the full text even if 'acbMaxLen' is too small (like snprintf).
+size_t hppProfilerDump(char* aszResult, size_t acbMaxLen);
+
+// Write all samples in the folded stack format used by flame graph tools: one line "main:line;function:line count" per 
+// call stack. Returns the length of the full text even if 'acbMaxLen' is too small (like snprintf).
+size_t hppProfilerDumpSamples(char* aszResult, size_t acbMaxLen);
+
+#endif
@@ -0,0 +1,98 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppSendBuffer.h                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Send Buffer                                                */
+/*                                                                              */
+/*   - Byte stream from writers to a FIFO filled by an interrupt handler        */
+/*   - Transfer in chunks, backpressure on writers with stall detection         */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: none                                                           */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#ifndef __INCL_HPP_SEND_BUFFER_
+#define __INCL_HPP_SEND_BUFFER_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+// Called by hppSendBufferWrite after data was put, e.g. to enable the transmit interrupt
+typedef void (*hppSendBufferKickType)(void* apContext);
+
+// Called by hppSendBufferWrite while the buffer is full. Returns false if no data was passed on within the timeout.
+typedef bool (*hppSendBufferWaitType)(void* apContext);
+
+// Called by hppSendBufferDrain with the next chunk. Returns the number of bytes taken (e.g. by the FIFO), negative on error.
+typedef int (*hppSendBufferFillType)(void* apContext, const uint8_t* apData, uint32_t acbDataLen);
+
+// Ring buffer of the bytes to be sent. The buffer holds one byte less than its size.
+struct hppSendBufferStruct
+{
+	uint8_t* pBuffer;
+	uint32_t cbSize;
+	volatile uint32_t uiHead;                      // Read position, only changed by hppSendBufferDrain
+	volatile uint32_t uiTail;                      // Write position, only changed by hppSendBufferWrite
+	volatile bool bStalled;                        // The receiver did not read within the timeout, don't wait until it does
+	uint32_t uiSentCount;                          // Bytes taken by the fill function
+	uint32_t uiDropCount;                          // Bytes not sent since the buffer was full
+	uint32_t uiWaitCount;                          // Waits for space in the buffer
+};
+
+
+// One writer and one reader may access the buffer at the same time. Writers serialize their calls (e.g. with a mutex),
+// the buffer is drained by a single interrupt handler.
+
+// Use the 'acbSize' bytes of 'apBuffer' for the data to be sent
+void hppSendBufferInit(struct hppSendBufferStruct* apBuffer, uint8_t* apData, uint32_t acbSize);
+
+bool hppSendBufferIsEmpty(const struct hppSendBufferStruct* apBuffer);
+
+// Put the 'acbDataLen' bytes of 'apData' and call 'aKick' after each part put. While the buffer is full 'aWait' is called
+// (backpressure). If it times out the receiver is stalled: the rest of the data and further data is dropped without waiting
+// until the receiver takes data again. Returns the number of bytes put.
+uint32_t hppSendBufferWrite(struct hppSendBufferStruct* apBuffer, const uint8_t apData[], uint32_t acbDataLen, 
+							hppSendBufferKickType aKick, hppSendBufferWaitType aWait, void* apContext);
+
+// Pass the next chunk of at most 'acbChunkSize' bytes to 'aFill' and remove the bytes it has taken. The rest stays in the
+// buffer for the next call. Returns the number of bytes taken, which is zero if the buffer is empty.
+uint32_t hppSendBufferDrain(struct hppSendBufferStruct* apBuffer, uint32_t acbChunkSize, hppSendBufferFillType aFill, void* apContext);
+
+// Reset the counters of the buffer
+void hppSendBufferResetStats(struct hppSendBufferStruct* apBuffer);
+
+#endif
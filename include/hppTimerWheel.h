@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppTimerWheel.h                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Timer Wheel                                                */
+/*                                                                              */
+/*   - Hierarchical timer wheel for scheduled events and periodic timers        */
+/*   - O(1) insert and cancel, pooled events with inline data                   */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: none                                                           */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#ifndef __INCL_HPP_TIMER_WHEEL_
+#define __INCL_HPP_TIMER_WHEEL_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define HPP_TIMER_WHEEL_SLOT_BITS 6          // 64 slots per level
+#define HPP_TIMER_WHEEL_LEVEL_COUNT 4        // 64^4 ticks (about 4.6 hours at 1 ms per tick); later events are re-linked until due
+#define HPP_TIMER_WHEEL_EVENT_COUNT 256      // pending events; further events are rejected
+#define HPP_TIMER_WHEEL_DATA_SIZE 24         // event data is copied into the event; longer data is rejected (multiple of 4)
+
+#define HPP_TIMER_WHEEL_SLOT_COUNT (1 << HPP_TIMER_WHEEL_SLOT_BITS)
+
+
+// Handler of an event. Called by the owner of the wheel with the data and context given to hppTimerWheelAdd.
+typedef void (*hppTimerWheelHandlerType)(void* apData, uint32_t acbDataLen, void* apContext);
+
+enum hppTimerWheelStateEnum { hppTimerWheelState_Free, hppTimerWheelState_Pending, hppTimerWheelState_Expired };
+
+// Event of the wheel. Pending events are linked into one slot of one level.
+struct hppTimerWheelEventStruct
+{
+	struct hppTimerWheelEventStruct* pNext;
+	struct hppTimerWheelEventStruct** ppPrev;      // Link pointing to this event, for unlinking in O(1)
+	uint32_t uiDue;                                // Tick at which the next expiration is due
+	uint32_t uiExpiry;                             // Tick of the next expiration: uiDue moved within the slack
+	uint32_t uiExpired;                            // Due tick of the last expiration
+	uint32_t uiPeriod;                             // Ticks between expirations or 0 for single shot events
+	uint32_t uiSlack;                              // Ticks the expiration may be deferred to share a tick with other events
+	hppTimerWheelHandlerType pHandler;
+	void* pContext;
+	uint16_t uiGeneration;                         // Incremented when the event is released, invalidates old handles
+	uint8_t uiState;                               // hppTimerWheelStateEnum
+	uint8_t uiLevel;
+	uint32_t cbDataLen;
+	uint32_t auiData[HPP_TIMER_WHEEL_DATA_SIZE / 4];
+};
+
+// Called by hppTimerWheelAdvance for each expired event. Single shot events are kept until hppTimerWheelRelease.
+typedef void (*hppTimerWheelExpiredType)(uint32_t auiHandle, struct hppTimerWheelEventStruct* apEvent);
+
+
+// The functions are not thread safe. The owner of the wheel serializes the calls (e.g. with a spin lock if the
+// wheel is advanced by a timer interrupt).
+
+// Remove all events and start the wheel at tick 'auiNow'. The tick counter may wrap around.
+void hppTimerWheelInit(uint32_t auiNow);
+
+// Add an event expiring 'auiDelay' ticks after 'auiNow' and then every 'auiPeriod' ticks (0 for a single shot event).
+// Each expiration may be deferred by up to 'auiSlack' ticks (less than the period) such that events with overlapping slack
+// expire in the same tick. The data is copied into the event. Returns the handle of the event or 0 if no event is free or
+// the data is too long.
+uint32_t hppTimerWheelAdd(uint32_t auiNow, uint32_t auiDelay, uint32_t auiPeriod, uint32_t auiSlack, hppTimerWheelHandlerType apHandler, const void* apData, uint32_t acbDataLen, void* apContext);
+
+// Cancel a pending or expired event. Returns false if the handle is not valid (anymore).
+bool hppTimerWheelCancel(uint32_t auiHandle);
+
+// Get the event with the handle 'auiHandle'. Returns NULL if the event was cancelled or released.
+struct hppTimerWheelEventStruct* hppTimerWheelGet(uint32_t auiHandle);
+
+// Release an expired single shot event after its handler has been called. Pending (periodic) events are kept.
+void hppTimerWheelRelease(uint32_t auiHandle);
+
+// Advance the wheel to tick 'auiNow' and call 'aExpired' for every event expiring up to and including this tick.
+void hppTimerWheelAdvance(uint32_t auiNow, hppTimerWheelExpiredType aExpired);
+
+// Get the next tick at which events have to be moved to a lower level or expire. Returns false if no event is pending.
+bool hppTimerWheelNextTick(uint32_t* apuiTick_Out);
+
+// Get the tick of the next expiration. Advancing the wheel to this tick at once also moves the events to the lower levels
+// on the way, such that a timer interrupt is needed for expirations only. Returns false if no event is pending.
+bool hppTimerWheelNextExpiry(uint32_t* apuiTick_Out);
+
+// Last tick processed by hppTimerWheelAdvance
+uint32_t hppTimerWheelGetTick();
+
+// Number of pending and expired events not released yet
+uint32_t hppTimerWheelUsedCount();
+
+#endif
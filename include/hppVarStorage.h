@@ -75,6 +75,15 @@ enum hppBinaryTypeEnum { hppBinaryType_int8, hppBinaryType_int16, hppBinaryType_
 #define HPP_FIXSTR_MAX_LEN 32        				    // max. string lenght of null terminated string with fixed max. len, not including ending null byte
 #define HPP_MAX_MEMBER_NAME_LEN 15						// max. member name lenght, not including ending null byte
 
+// Scratch arena for temporary variables of the parser (keys with prefix '%04x:')
+#define HPP_VAR_SCRATCH_CHUNK_SIZE 1024					// size of the memory chunks of the arena
+#define HPP_VAR_SCRATCH_MIN_BLOCK_SIZE 64				// smallest block holding a variable including key and value
+#define HPP_VAR_SCRATCH_CLASS_COUNT 3					// number of block sizes (64, 128 and 256 bytes). Larger variables use the heap.
+
+// Constants interned for H++ code (see hppVarConstPut)
+#define HPP_VAR_CONST_MAX_LEN 32						// max. length of an interned value, not including ending null byte
+#define HPP_VAR_CONST_MAX_COUNT 64						// max. number of constants interned for one code
+
 
 // Tables with binary type properties  
 // Types var, array and string are represented by the name of the variable holding the content
@@ -86,16 +95,71 @@ extern const size_t hppTypeNameLenght[HPP_MAX_TYPE_ID + 1];
 
 // Structure for Key-Value pairs
 
+#define HPP_VAR_FLAG_DIRTY 0x01							// Changed since the persisted copy was written or restored
+#define HPP_VAR_FLAG_PERSISTED 0x02						// A copy is stored persistently (e.g. in flash memory)
+#define HPP_VAR_FLAG_MAPPED 0x04						// The value references read only memory (e.g. memory mapped flash), not the heap
+#define HPP_VAR_FLAG_CODE 0x08							// The value has been executed as H++ code (see hppVarGetCode)
+#define HPP_VAR_FLAG_INTERNED 0x10						// The mapped value references a constant interned for H++ code (see hppVarPutInterned)
+#define HPP_VAR_FLAGS_PERSISTENCE (HPP_VAR_FLAG_DIRTY | HPP_VAR_FLAG_PERSISTED)   // Flags replaced when the persistence state changes
+
 struct hppVarListStruct
 {
 	char* szKey;
 	char* pValue;
 	size_t cbValueLen;
 	struct hppVarListStruct* pNext;
+	uint8_t uiScratchClass;          // Block size class + 1 if stored in a scratch arena, 0 if stored on the heap
+	uint8_t uiFlags;                 // HPP_VAR_FLAG_XXX
+	uint32_t uiCodeChangeCount;      // Value of hppVarCodeChangeCount when the variable was created or its code was changed last
+	struct hppVarScratchArenaStruct* pScratchArena;   // Scratch arena the variable is stored in, NULL if stored on the heap
+	struct hppVarConstTableStruct* pConstTable;       // Constants interned for the code of the variable, NULL if not executed yet
+};
+
+// Constant expression interned for H++ code at a position of the code, e.g. a literal or a folded expression of literals
+struct hppVarConstStruct
+{
+	size_t cbPos;                    // Position of the expression in the code
+	uintptr_t uiTag;                 // Further key of the expression defined by the parser, e.g. its terminating operators
+	size_t cbSourceLen;              // Length of the expression in the code including the terminating operator
+	size_t cbValueLen;
+	char chTerm;                     // Operator terminating the expression
+	char achValue[];                 // Value including an ending null byte
+};
+
+// Constants interned for one code sorted by their position. The table of the code of a variable is cleared once the
+// variable is changed, it is released with the variable.
+struct hppVarConstTableStruct
+{
+	struct hppVarConstStruct** ppConsts;
+	unsigned int uiCount;
+	unsigned int uiSize;             // Number of entries allocated for ppConsts
+};
+
+// Scratch arena holding temporary variables in blocks of fixed size classes. Each parse context has its own arena, 
+// such that the arena of a finished execution can be reused at once (see hppVarScratchRelease). Temporary variables 
+// created outside of any parse context are stored in a default arena.
+struct hppVarScratchChunkStruct;
+
+struct hppVarScratchArenaStruct
+{
+	struct hppVarScratchChunkStruct* pChunks;                     // Chunk used for new blocks followed by the older chunks
+	size_t cbChunkUsed;                                           // Bytes used in the first chunk
+	struct hppVarListStruct* pFree[HPP_VAR_SCRATCH_CLASS_COUNT];  // Released blocks per size class
+	unsigned int uiLiveCount;                                     // Number of variables stored in the arena
 };
 
 extern struct hppVarListStruct* pFirstVar;
 
+// Keys of deleted variables with a persisted copy. The persisted copy must be deleted as well by the next save. 
+// A tombstone is removed if a variable with the same key is created again.
+struct hppVarTombstoneStruct
+{
+	struct hppVarTombstoneStruct* pNext;
+	char szKey[];
+};
+
+extern struct hppVarTombstoneStruct* pFirstTombstone;
+
 extern const char* hppNoInitValue; 
 extern const char* hppInitValueWithZero;
 
@@ -104,11 +168,22 @@ extern const char* hppVarGetAllRootNodes;
 extern const char* hppVarGetAllNodes;
 extern const char* hppVarGetAllKeyValuePair;
 
+// Incremented whenever a variable holding H++ code (key starting with a lower case letter and not including ':') or a variable
+// which has been executed as code is updated or deleted. Pointers into the code of such a variable are not valid anymore in this case.
+extern uint32_t hppVarCodeChangeCount;
+
+// Number of variable lookups (put, get) and heap operations (malloc, realloc) since start. Used for profiling.
+extern uint32_t hppVarLookupCount;
+extern uint32_t hppVarHeapAllocCount;
+
 
 /* ====================== */
 /* Key-Value pair storage */
 /* ====================== */
 
+// Returns true if the variable with the key 'aszKey' holds H++ code which may be executed
+bool hppVarIsCode(const char aszKey[]);
+
 // Update variable (key value pair) with the key 'aszKey' or create new variable with that key if it did not exist before.
 // The new value of the variable is a 'acbValueLen' bytes long binary copy of the 'apValue' array content plus an exta null byte at the end
 // to make sure it can safely be interpreted as a zero terminated string or as a byte arry.
@@ -117,6 +192,13 @@ extern const char* hppVarGetAllKeyValuePair;
 // Returns a pointer to the newly created or updated stored value or NULL if unsuccessfull or deleted. 
 char* hppVarPut(const char aszKey[], const char apValue[], size_t acbValueLen);
 
+// Update variable with the key 'aszKey' or create new variable with that key if it did not exist before.
+// The variable takes over the heap buffer 'apBuffer' as its value without copying it. 'apBuffer' must be allocated with
+// malloc(...) and hold 'acbValueLen' bytes plus one extra byte for the ending null byte. The buffer is owned by the variable
+// storage after the call and released with free(...) if unsuccessfull.
+// Returns a pointer to the stored value (same as 'apBuffer') or NULL if unsuccessfull.
+char* hppVarPutAdopt(const char aszKey[], char* apBuffer, size_t acbValueLen);
+
 // Update variable with the key 'aszKey' or create new variable with that key if it did not exist before.
 // The new value of the variable is a copy of the 'aszValue' string.
 // The variable is deleted if 'apValue' is NULL. The variable is not initalized if 'apValue' is hppNoInitValue.
@@ -127,6 +209,47 @@ char* hppVarPutStr(const char aszKey[], const char aszValue[], size_t* apcbResul
 // Get variable with the key 'aszKey' and provide the value array lenght in 'apcbValueLen_Out' 
 char* hppVarGet(const char aszKey[], size_t* apcbValueLen_Out);
 
+// Get variable with the key 'aszKey' like hppVarGet(...) for writing the value in place. A mapped value is copied to the heap
+// before. The value counts as changed code (see hppVarGetCode). Returns NULL if the variable does not exist or memory was not sufficient.
+char* hppVarGetWritable(const char aszKey[], size_t* apcbValueLen_Out);
+
+// Get variable with the key 'aszKey' like hppVarGet(...) for executing the value as H++ code. Any later change of the variable
+// increments hppVarCodeChangeCount, such that tasks executing the code notice it, even if the key does not look like code.
+char* hppVarGetCode(const char aszKey[], size_t* apcbValueLen_Out);
+
+// Get the table of the constants interned for the code 'apchCode' which is the value of a variable. An empty table is created
+// if the code has no table yet. Returns NULL if 'apchCode' is not the value of any variable or memory was not sufficient.
+struct hppVarConstTableStruct* hppVarGetConstTable(const char* apchCode);
+
+// Get the constant interned at the position 'acbPos' with the tag 'auiTag' from the table 'apTable'. Returns NULL if not found.
+const struct hppVarConstStruct* hppVarConstGet(const struct hppVarConstTableStruct* apTable, size_t acbPos, uintptr_t auiTag);
+
+// Intern a copy of the constant 'apValue' which has been evaluated from the 'acbSourceLen' bytes of code at the position 
+// 'acbPos' terminated by the operator 'achTerm' in the table 'apTable'. Returns false if the value is too long 
+// (HPP_VAR_CONST_MAX_LEN), the table is full (HPP_VAR_CONST_MAX_COUNT) or memory was not sufficient.
+bool hppVarConstPut(struct hppVarConstTableStruct* apTable, size_t acbPos, uintptr_t auiTag, size_t acbSourceLen, char achTerm, const char apValue[], size_t acbValueLen);
+
+// Release all constants of the table 'apTable', e.g. once the code is not executed anymore. Variables referencing one of them
+// (see hppVarPutInterned) get a copy of their value on the heap before. Returns the number of variables whose value moved.
+unsigned int hppVarConstTableClear(struct hppVarConstTableStruct* apTable);
+
+// Update variable with the key 'aszKey' or create it like hppVarPut(...), but reference the interned constant 'apConst' 
+// instead of copying it. The value is copied once it is written or the table of the constant is cleared.
+// Returns a pointer to the stored value or NULL if unsuccessfull.
+char* hppVarPutInterned(const char aszKey[], const struct hppVarConstStruct* apConst);
+
+// Returns true if 'apchCode' is the value of a variable which has not been updated, renamed or deleted since hppVarCodeChangeCount
+// had the value 'auiChangeCount', e.g. the code of a function a suspended task is executing.
+bool hppVarIsCodeUnchanged(const char* apchCode, uint32_t auiChangeCount);
+
+// Copy all mapped values located in the 'acbLen' bytes starting at 'apchStart' to the heap, e.g. before the memory is written or 
+// unmapped. Returns false if memory was not sufficient for all values.
+bool hppVarUnmap(const char* apchStart, size_t acbLen);
+
+// Mark the variable with the key 'aszKey' as unchanged since its persisted copy was written or restored.
+// Returns false if the variable does not exist.
+bool hppVarSetPersisted(const char aszKey[]);
+
 // Get variable key name reference based on URI string (not case sensitve search --> aCaseSensitive = false),
 // or based on the the key name itself (aCaseSensitive = true). 
 // The reference is stable unless the variable it deleted. Updating the value keeps the reference intact.  
@@ -138,6 +261,19 @@ bool hppVarDelete(const char aszKey[]);
 // Delete all variables starting with the key 'aszKeyPrefix'
 void hppVarDeleteAll(const char aszKeyPrefix[]);
 
+// Replace the prefix 'aszKeyPrefix' by 'aszNewKeyPrefix' in the keys of all variables starting with 'aszKeyPrefix'.
+// Variables already starting with 'aszNewKeyPrefix' are deleted before. Returns false if memory was not sufficient. 
+bool hppVarRenameAll(const char aszKeyPrefix[], const char aszNewKeyPrefix[]);
+
+// Store temporary variables created from now on in the scratch arena 'apArena' (NULL selects the default arena), e.g. while 
+// a parse context is executed. Returns the arena selected before.
+struct hppVarScratchArenaStruct* hppVarScratchSelect(struct hppVarScratchArenaStruct* apArena);
+
+// Release the scratch arena 'apArena' of a finished execution at once. Variables still stored in the arena (e.g. the result of 
+// the execution) are moved to the default arena before. Their values and keys move as well. The first chunk of the arena is
+// kept for the next execution if 'abKeepChunk' is true. Returns the number of variables moved.
+unsigned int hppVarScratchRelease(struct hppVarScratchArenaStruct* apArena, bool abKeepChunk);
+
 // Count variables starting with the key 'aszKeyPrefix'
 // If 'abExludeRootElements' is true then varaibles including another '.' behind the search text are not counted
 int hppVarCount(const char aszKeyPrefix[], bool abExludeRootElements);
@@ -168,6 +304,58 @@ int hppVarGetAll(char* aszResult, size_t acbMaxLen, const char aszKeyPrefix[], c
 
 
 
+/* ================ */
+/* Snapshot images  */
+/* ================ */
+
+// A snapshot image holds a set of variables in one contiguous block of memory, such that it can be written and read with
+// one operation: header, index with one entry per variable, keys and values. Keys and values are null terminated.
+// All offsets are counted from the start of the image. Values start at a multiple of HPP_VAR_IMAGE_VALUE_ALIGN bytes, such 
+// that binary values can be used in place if the image is mapped. The gaps are filled with null bytes.
+// The CRC-32 covers the image behind the header.
+
+#define HPP_VAR_IMAGE_MAGIC 0x53505048					// "HPPS" 
+#define HPP_VAR_IMAGE_VERSION 2
+#define HPP_VAR_IMAGE_VALUE_ALIGN 8						// alignment of the values (double) and of a mapped image 
+
+struct hppVarImageHeaderStruct
+{
+	uint32_t uiMagic;
+	uint16_t uiVersion;
+	uint16_t uiReserved;
+	uint32_t uiSequence;             // Incremented with every image written, the valid image with the highest number is the latest one
+	uint32_t uiCount;                // Number of variables
+	uint32_t cbImageLen;             // Length of the image including the header
+	uint32_t uiCrc;
+};
+
+struct hppVarImageIndexStruct
+{
+	uint32_t uiKeyOffset;
+	uint32_t uiValueOffset;
+	uint32_t uiValueLen;             // Not including the ending null byte
+};
+
+// Write a snapshot image of all variables accepted by 'apFilter' with the sequence number 'auiSequence' to 'apchImage'.
+// The image is written only if it fits in 'acbMaxLen' bytes. Similar to 'snprintf(...)' the return value is the size of 
+// the full image in any case. Temporary variables of the parser are never part of the image.
+size_t hppVarImageBuild(char* apchImage, size_t acbMaxLen, bool (*apFilter)(const char aszKey[]), uint32_t auiSequence);
+
+// Verify the snapshot image 'apchImage' of 'acbLen' bytes. Returns the sequence number of the image or 0 if the image is not valid.
+uint32_t hppVarImageCheck(const char* apchImage, size_t acbLen);
+
+// Create the variables of the snapshot image 'apchImage' of 'acbLen' bytes. Variables with the same key are replaced. 
+// The variables are marked as persisted. Returns the number of variables created or -1 if the image is not valid or 
+// memory was not sufficient for all variables. 
+int hppVarImageLoad(const char* apchImage, size_t acbLen);
+
+// Create the variables of the snapshot image 'apchImage' of 'acbLen' bytes like hppVarImageLoad(...), but the values are not 
+// copied. They reference the image, which must not change as long as any of the values is mapped (see hppVarUnmap(...)).
+// Values are copied to the heap when they are written. The image must start at a multiple of HPP_VAR_IMAGE_VALUE_ALIGN bytes.
+int hppVarImageMap(const char* apchImage, size_t acbLen);
+
+
+
 /* ============================================ */
 /* Conversion between Binary Types and Strings  */
 /* ============================================ */
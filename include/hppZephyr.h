@@ -70,11 +70,12 @@
 // Flash memory and settings relate functions 
 // ------------------------------------------
 
-// Load H++ variables from flash to RAM. 
+// Load H++ variables from flash to RAM. The latest snapshot image is loaded if there is one, the single settings otherwise.
 // If abGlobal is true, globale variables with capital letter in front are loader. Otherwise program code is loaded.
 bool hppReadVarFromFlash(bool abGlobal);
 
-// Write H++ variables from RAM to flash. 
+// Write H++ variables from RAM to flash. Only variables changed since they were written or restored are written and
+// variables deleted since then are deleted in flash. 
 // If abGlobal is true, globale variables with capital letter in front are written. Otherwise program code is written.
 bool hppWriteVarToFlash(bool abGlobal);
 
@@ -82,6 +83,23 @@ bool hppWriteVarToFlash(bool abGlobal);
 // If abGlobal is true, globale variables with capital letter in front are deleted. Otherwise program code is deleted.
 bool hppDeleteVarFromFlash(bool abGlobal);
 
+// Write all global variables (abGlobal = true) or the code to flash as one snapshot image, which is restored with a single read.
+// The single settings of the variables are deleted and later saves with hppWriteVarToFlash(...) write new images as well until
+// the variables are deleted from flash. Returns false if the image is larger than HPP_FLASH_IMAGE_MAX_SIZE (see hppZephyr.c).
+// Once the variables of a class with an image outgrow it, saves write all of them as single settings instead, delete the images
+// and return false. Later saves write single settings.
+bool hppWriteImageToFlash(bool abGlobal);
+
+// Write changed global variables (and code if 'abCode' is true) to flash every 'aPeriod' ms. 0 switches automatic saves off.
+// Returns true if successful and false if not
+bool hppFlashAutosave(uint32_t aPeriod, bool abCode);
+
+// Write the statistics of the flash saves (see hppZephyr.c). Returns the length like snprintf.
+size_t hppFlashStatsDump(char* aszOut, size_t acbMaxLen);
+
+// Reset the statistics of the flash saves
+void hppFlashStatsReset();
+
 
 // ------------------------------------------------------------------
 // Synchronized function calls for relevant hppVarXXX functions
@@ -154,6 +172,8 @@ bool hppAsyncVarGetFromUriCoapResponse(const char aszVarName[]);
 // Put variable value update in queue for processing. Returns true if successful and false if not (no buffer).
 // If 'abSyncWithNext' is true, this command will be executed with the next one. If successful it therefore must be
 // followed by another hppAsyncXXX command immediatelly to avoid permanently locking the parser and the variable mutex.
+// Parameters of the H++ code started by the last command of such a group (keys starting with "0000:") are moved to the task 
+// executing the code. If the group writes other variables, the code runs to completion without being suspended instead.
 bool hppAsyncVarPut(const char aszVarName[], const char apValue[], uint16_t acbValueLen, bool abSyncWithNext);
 
 // Put string variable value update in queue for processing. Returns true if successful and false if not (no buffer).
@@ -165,6 +185,23 @@ bool hppAsyncVarPutStr(const char aszVarName[], const char aszValue[], bool abSy
 // Returns true if successful and false if not (no buffer).
 bool hppAsyncVarPutFromUri(const char aszVarName[], const char apValue[], uint16_t acbValueLen);
 
+// Allocate a block of 'acbLen' bytes (plus one extra byte for zero termination) for a value passed to hppAsyncVarPutBlock(...). 
+// The blocks are taken from the heap but their total size is limited by a pool size. Returns NULL if the pool is exhausted.
+char* hppAsyncBlockAlloc(uint16_t acbLen);
+
+// Release a block of 'acbLen' bytes allocated with hppAsyncBlockAlloc(...) which was not passed to hppAsyncVarPutBlock(...).
+void hppAsyncBlockFree(char* apBlock, uint16_t acbLen);
+
+// Put variable value update in queue for processing without copying the value. Only the reference to 'apBlock' allocated with
+// hppAsyncBlockAlloc(...) is queued and the block becomes the value of the variable. The block is owned by the queue after the call 
+// and must not be used anymore, also if not successful. Returns true if successful and false if not (no buffer).
+// If 'abSyncWithNext' is true, this command will be executed with the next one. If successful it therefore must be
+// followed by another hppAsyncXXX command immediatelly to avoid permanently locking the parser and the variable mutex.
+bool hppAsyncVarPutBlock(const char aszVarName[], char* apBlock, uint16_t acbValueLen, bool abSyncWithNext);
+
+// Same as hppAsyncVarPutBlock(...) but the variable name is non-case-sensitve (may come from a CoAP URI).
+bool hppAsyncVarPutBlockFromUri(const char aszVarName[], char* apBlock, uint16_t acbValueLen);
+
 // Put string variable detetion in queue for processing. Returns true if successful and false if not (no buffer).
 bool hppAsyncVarDelete(const char aszVarName[]);
 
@@ -181,10 +218,18 @@ bool hppAsyncParseVar(const char* aszVarName);
 // Responds to the present Thread CoAP context with the H++ result or error text if no response was given by the H++ code already
 bool hppAsyncParseVarCoapResponse(const char* aszVarName);
 
+// Put H++ variable name to be executed by a timer in queue for processing. Returns true if successful and false if not (no buffer).
+// Same as hppAsyncParseVar(...) but the code is executed with the execution time budget of timer handlers.
+bool hppAsyncParseVarTimer(const char* aszVarName);
+
 // Put .wellknown/core get request in queue for processing. Returns true if successful and false if not (no buffer).
 // Responds to the present Thread CoAP context with the actual list of resources in CoRE link format (40).
 bool hppAsyncVarGetWellKnownCore();
 
+// Put get request for the statistics 'aszName' (e.g. "prof") in queue for processing. Returns true if successful and false if not (no buffer).
+// Responds to the present Thread CoAP context with the statistics in text format.
+bool hppAsyncStatsGet(const char* aszName);
+
 // Put lock/unlock request for variables in .well-known/core queires in queue for processing. Returns true if successful and false if not (no buffer).
 // Calling this function with aszPassword set to a value different from the value of the variable "Var_Hide_PW" or its default value enable hiding valiables.  
 bool hppAsyncVarHide(const char* aszPassword);
@@ -200,6 +245,55 @@ bool hppAsyncVarHide(const char* aszPassword);
 bool hppAsyncSetCoapContext(hppCoapMessageContext* apCoapMessageContext, bool abSyncWithNext);
 
 
+// ------------------------------------------------------------------
+// H++ tasks waiting for events
+// ------------------------------------------------------------------
+
+// Suspend the H++ task presently executed until hppTaskResume or hppAsyncTaskResume is called with the returned ID. 
+// The result of the event is stored in the variable 'aszResultVarKey' then. Must be called from a H++ function binding 
+// which returns immediately afterwards. Other tasks and events are processed while the task is waiting.
+// Returns 0 if the H++ code does not run as task. The function binding must not wait for the event in this case.
+uint32_t hppTaskWait(const char aszResultVarKey[]);
+
+// End the wait for the event 'aTaskWaitID' after 'auiTime' ms with the result 'aszValue' (a constant string) unless the task is 
+// woken up before. The timer event is cancelled once the task is woken up. Returns false if no timer event is available.
+bool hppTaskWaitTimeout(uint32_t aTaskWaitID, uint32_t auiTime, const char aszValue[]);
+
+// Wake up the task waiting for the event 'aTaskWaitID' and pass the result 'apValue'. Events of finished tasks are ignored.
+// A timer event set with hppTaskWaitTimeout is cancelled. The parser mutex must be locked, e.g. within a H++ function binding. 
+// Returns true if a waiting task has been found.
+bool hppTaskResume(uint32_t aTaskWaitID, const char apValue[], size_t acbValueLen);
+
+// Put the wake-up of the task waiting for the event 'aTaskWaitID' in queue for processing, e.g. from a response handler.
+// Returns true if successful and false if not (no buffer).
+bool hppAsyncTaskResume(uint32_t aTaskWaitID, const char apValue[], uint16_t acbValueLen);
+
+
+
+// ------------------------------------------------------------------
+// Execution time budgets
+// ------------------------------------------------------------------
+
+// Entry points of H++ code. Each entry point has its own execution time budget and statistics.
+enum hppEntryPointEnum { hppEntryPoint_Other, hppEntryPoint_CoAP, hppEntryPoint_Timer, hppEntryPoint_CLI, hppEntryPoint_Count };
+
+// Get the entry point with the name 'aszName' ("other", "coap", "timer" or "cli"). Returns hppEntryPoint_Count if there is none.
+enum hppEntryPointEnum hppEntryPointGetByName(const char* aszName);
+
+// Execution time budget in ms of the H++ code presently executed. 0 means no limit.
+// The budget is consumed by all slices of a task but not by the time a task is suspended.
+uint32_t hppEntryPointGetBudget();
+
+// Set the execution time budget in ms of the entry point 'aEntryPoint'. hppEntryPoint_Count sets the budget of all entry points.
+void hppEntryPointSetBudget(enum hppEntryPointEnum aEntryPoint, uint32_t auiBudget);
+
+// Record the execution time in ms of the H++ code presently executed once it has finished
+void hppEntryPointRecordRun(uint32_t auiTime);
+
+// Record that the H++ code presently executed has been stopped since its budget is used up
+void hppEntryPointRecordOverrun();
+
+
 
 // ------------------------------------------------------------------
 // Timer functions 
@@ -212,18 +306,68 @@ typedef void (*hppTimerHandler)(void *apContext);
 typedef void (*hppQueuedTimerHandler)(void* apData, uint32_t aDataLen, void *apContext);
 
 // Start the timer with the given ID. The timeout time is measured in in milliseconds.
+// Each expiration may be deferred by up to 'aSlack' milliseconds to share a wake-up with other timers (0 for exact timing).
 // Returns true if successful and false if not
-bool hppTimerStart(uint32_t aTimerID, uint32_t aTime, bool aIsContinous, hppTimerHandler aTimerHandler, void *apContext);
+bool hppTimerStart(uint32_t aTimerID, uint32_t aTime, bool aIsContinous, uint32_t aSlack, hppTimerHandler aTimerHandler, void *apContext);
+
+// Native actions of timers started with hppTimerStartAction(...)
+enum hppTimerActionEnum { hppTimerAction_None, hppTimerAction_GpioSet, hppTimerAction_GpioClear, hppTimerAction_GpioToggle, hppTimerAction_PwmRestart, hppTimerAction_VarPut };
+
+// Start the periodic timer with the given ID executing a native action every 'aTime' milliseconds instead of a handler.
+// GPIO actions use the pin 'auiPin' (0..63), hppTimerAction_VarPut writes 'aszValue' to the variable 'aszVarName'.
+// The action runs in the timer interrupt without the interpreter. Variables are written by the dispatcher without parsing H++ code.
+// Returns true if successful and false if not
+bool hppTimerStartAction(uint32_t aTimerID, uint32_t aTime, uint8_t auiAction, uint32_t auiPin, const char* aszVarName, const char* aszValue);
 
 // Stop a timer with a given ID
 // Returns true if successful and false if not
 bool hppTimerStop(uint32_t aTimerID);
 
+// Scheduling of periodic timers with H++ handlers if the dispatcher falls behind. hppTimerPolicy_CatchUp and hppTimerPolicy_Skip
+// are drift compensated: the expirations stay on the grid of the start time. CatchUp dispatches all missed expirations, Skip
+// drops expirations while one is still queued. hppTimerPolicy_Delay starts the next period when the previous one is dispatched.
+enum hppTimerPolicyEnum { hppTimerPolicy_CatchUp, hppTimerPolicy_Skip, hppTimerPolicy_Delay };
+
+// Set the policy of the timer with the given ID used by the next hppTimerStart(...). Default: hppTimerPolicy_CatchUp.
+// Returns true if successful and false if not
+bool hppTimerSetPolicy(uint32_t aTimerID, uint8_t auiPolicy);
+
+// Write the dispatch statistics of the timers with IDs (one line per timer, see hppZephyr.c). Returns the length like snprintf.
+size_t hppTimerStatsDump(char* aszOut, size_t acbMaxLen);
+
+// Reset the statistics of all timers
+void hppTimerStatsReset();
+
+// Write the wake-up counters of the timers and events (see hppZephyr.c). Returns the length like snprintf.
+size_t hppTimerWakeupsDump(char* aszOut, size_t acbMaxLen);
+
+// Reset the wake-up counters
+void hppTimerWakeupsReset();
+
 // Create a single shoot timer event and put it in a queue of timer events
-// The timeout time is measured in in milliseconds
-// The attached data will be copied in a and deleted after the handler has been executed
+// The timeout time is measured in in milliseconds, the event may be deferred by up to 'aSlack' milliseconds (see hppTimerStart)
+// The attached data (max. HPP_TIMER_WHEEL_DATA_SIZE bytes) will be copied in the event and released after the handler has been executed
+// Returns the handle of the event for hppTimerCancelEvent(...) if successful and 0 if not
+uint32_t hppTimerScheduleEvent(uint32_t aDelayFromNow, uint32_t aSlack, hppQueuedTimerHandler apHandler, void* apData, uint32_t aDataLen, void *apContext);
+
+// Cancel an event created with hppTimerScheduleEvent(...). The handler is not called anymore, even if the event has already expired.
+// Returns true if successful and false if the handler has already been called
+bool hppTimerCancelEvent(uint32_t aHandle);
+
+
+
+// ------------------------------------------------------------------
+// Buttons 
+// ------------------------------------------------------------------
+
+// Changes of a button reported to the H++ handlers btn_push and btn_release
+enum hppButtonEdgeEnum { hppButtonEdge_Both, hppButtonEdge_Push, hppButtonEdge_Release };
+
+// Configure the pin 'auiPin' (0..63) as button input with an interrupt on both edges. The pin is sampled 'auiDebounceTime' ms 
+// after the first edge of a burst, a change of the sampled state queues one entry calling btn_push or btn_release (see README).
+// 'aiPull': 1 = pull up, 0 = pull down, -1 = none. Configuring a pin again replaces its settings.
 // Returns true if successful and false if not
-bool hppTimerScheduleEvent(uint32_t aDelayFromNow, hppQueuedTimerHandler apHandler, void* apData, uint32_t aDataLen, void *apContext);
+bool hppButtonConfigure(uint32_t auiPin, bool abActiveHigh, int aiPull, uint32_t auiDebounceTime, uint8_t auiEdge);
 
 
 
@@ -231,10 +375,16 @@ bool hppTimerScheduleEvent(uint32_t aDelayFromNow, hppQueuedTimerHandler apHandl
 // USB Communication
 // ------------------------------------------------------------------
 
-// Send data to the USB interface.
-// Returns the number of bytes sent or 0 in case of a buffer overflow.
+// Send data to the USB interface. Waits for space in the send buffer while the host reads the data. Must not be called from an ISR.
+// Returns the number of bytes queued for sending, less than 'acbDataLen' if the host did not read the data in time.
 int hppZephyrUsbSend(const uint8_t apData[], uint16_t acbDataLen);
 
+// Write the USB transfer statistics (see hppZephyr.c). Returns the length like snprintf.
+size_t hppZephyrUsbStatsDump(char* aszOut, size_t acbMaxLen);
+
+// Reset the USB transfer statistics
+void hppZephyrUsbStatsReset();
+
 
 // ------------------------------------------------------------------
 // Zephyr main Loop
@@ -0,0 +1,61 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppZephyrImageTokens.h                                                 */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Image Tokens of the Zephyr and OpenThread Platform         */
+/*                                                                              */
+/*   - Builtin function names replaced by token bytes in code images            */
+/*   - Shared by the firmware and the host image compiler hppc                  */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: Zephyr RTOS with OpenThread, POSIX (hppc)                          */
+/* Dependencies: none                                                           */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#ifndef __INCL_HPP_ZEPHYR_IMAGE_TOKENS_
+#define __INCL_HPP_ZEPHYR_IMAGE_TOKENS_
+
+
+// Builtin functions of hppZephyr.c and hppThread.c. Added with hppAddImageTokens after the words of the parser.
+// Append new words only and increase HPP_IMAGE_VERSION when the meaning of an existing token byte changes.
+static const char* const hppZephyrImageTokens[] = { "io_pin", "io_set", "io_get", "io_cfg_output", 
+													"io_cfg_input", "io_cfg_btn", "io_pwm_start", "io_pwm_stop", "io_pwm_restart", 
+													"flash_save", "flash_save_code", "flash_restore", "flash_delete", "flash_delete_code", 
+													"timer_start", "timer_once", "timer_stop", "timer_event", "sleep", "task_slice", 
+													"task_count", "get_time_ms", "timeout", "parse_limits", "coap", "coaps", 
+													"coap_get", "coap_put", "coap_post", "coap_get_await", "coap_respond", "coap_respond_to", 
+													"coap_is_get", "coap_is_put", "coap_is_post", "coap_is_delete", "coap_add_resource", 
+													"cli_put", "cli_writeln", "payload", NULL };
+
+#endif
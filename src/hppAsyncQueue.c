@@ -0,0 +1,258 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppAsyncQueue.c                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Async Queues                                               */
+/*                                                                              */
+/*   - Ring buffers of entries passed to the dispatcher of the parser           */
+/*   - Weighted selection of queues, coalescing of updates, batched dispatch    */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: hppAsyncQueue.h                                                */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#include "../include/hppAsyncQueue.h"
+
+#include <string.h>
+
+
+// Copy 'acbLen' bytes starting 'acbOffset' bytes behind the read position without removing them
+static void hppAsyncQueueCopyOut(const struct hppAsyncQueueStruct* apQueue, uint32_t acbOffset, uint8_t* apData_Out, uint32_t acbLen)
+{
+	uint32_t uiPos = (apQueue->uiHead + acbOffset) % apQueue->cbSize;
+	uint32_t cbFirst = apQueue->cbSize - uiPos;
+
+	if(cbFirst > acbLen) cbFirst = acbLen;
+
+	memcpy(apData_Out, apQueue->pBuffer + uiPos, cbFirst);
+	memcpy(apData_Out + cbFirst, apQueue->pBuffer, acbLen - cbFirst);
+}
+
+
+void hppAsyncQueueInit(struct hppAsyncQueueStruct* apQueue, const char* aszName, uint8_t* apBuffer, uint32_t acbSize, uint32_t auiWeight)
+{
+	memset(apQueue, 0, sizeof(struct hppAsyncQueueStruct));
+
+	apQueue->pBuffer = apBuffer;
+	apQueue->cbSize = acbSize;
+	apQueue->szName = aszName;
+	apQueue->uiWeight = auiWeight;
+	apQueue->uiCredit = auiWeight;
+}
+
+
+uint32_t hppAsyncQueueUsed(const struct hppAsyncQueueStruct* apQueue)
+{
+	uint32_t uiHead = apQueue->uiHead;
+	uint32_t uiTail = apQueue->uiTail;
+
+	return uiTail >= uiHead ? uiTail - uiHead : apQueue->cbSize - uiHead + uiTail;
+}
+
+
+uint32_t hppAsyncQueueCapacity(const struct hppAsyncQueueStruct* apQueue)
+{
+	return apQueue->cbSize - 1;
+}
+
+
+uint32_t hppAsyncQueueSpace(const struct hppAsyncQueueStruct* apQueue)
+{
+	return hppAsyncQueueCapacity(apQueue) - hppAsyncQueueUsed(apQueue);
+}
+
+
+bool hppAsyncQueueIsEmpty(const struct hppAsyncQueueStruct* apQueue)
+{
+	return apQueue->uiHead == apQueue->uiTail;
+}
+
+
+uint32_t hppAsyncQueuePut(struct hppAsyncQueueStruct* apQueue, const void* apData, uint32_t acbLen)
+{
+	uint32_t uiTail = apQueue->uiTail;
+	uint32_t cbFirst = apQueue->cbSize - uiTail;
+	uint32_t cbSpace = hppAsyncQueueSpace(apQueue);
+
+	if(acbLen > cbSpace) acbLen = cbSpace;
+	if(cbFirst > acbLen) cbFirst = acbLen;
+
+	memcpy(apQueue->pBuffer + uiTail, apData, cbFirst);
+	memcpy(apQueue->pBuffer, (const uint8_t*)apData + cbFirst, acbLen - cbFirst);
+
+	// The reader sees the data once the write position has moved
+	apQueue->uiTail = (uiTail + acbLen) % apQueue->cbSize;
+
+	return acbLen;
+}
+
+
+void hppAsyncQueuePutHeader(struct hppAsyncQueueStruct* apQueue, uint8_t auiType, uint16_t auiLen, uint32_t auiTime)
+{
+	hppAsyncQueuePut(apQueue, &auiType, sizeof(uint8_t));
+	hppAsyncQueuePut(apQueue, &auiTime, sizeof(uint32_t));
+	hppAsyncQueuePut(apQueue, &auiLen, sizeof(uint16_t));
+}
+
+
+void hppAsyncQueueRecordPut(struct hppAsyncQueueStruct* apQueue)
+{
+	uint32_t cbUsed = hppAsyncQueueUsed(apQueue);
+
+	apQueue->uiPutCount++;
+	if(apQueue->uiHighWater < cbUsed) apQueue->uiHighWater = cbUsed;
+}
+
+
+void hppAsyncQueueRecordDrop(struct hppAsyncQueueStruct* apQueue)
+{
+	apQueue->uiDropCount++;
+}
+
+
+void hppAsyncQueueResetStats(struct hppAsyncQueueStruct* apQueue)
+{
+	apQueue->uiPutCount = 0;
+	apQueue->uiDropCount = 0;
+	apQueue->uiHighWater = hppAsyncQueueUsed(apQueue);
+}
+
+
+uint32_t hppAsyncQueueGet(struct hppAsyncQueueStruct* apQueue, void* apData_Out, uint32_t acbLen)
+{
+	uint32_t cbUsed = hppAsyncQueueUsed(apQueue);
+
+	if(acbLen > cbUsed) acbLen = cbUsed;
+	if(apData_Out != NULL) hppAsyncQueueCopyOut(apQueue, 0, (uint8_t*)apData_Out, acbLen);
+
+	// The writers may reuse the space once the read position has moved
+	apQueue->uiHead = (apQueue->uiHead + acbLen) % apQueue->cbSize;
+
+	return acbLen;
+}
+
+
+bool hppAsyncQueueGetHeader(struct hppAsyncQueueStruct* apQueue, uint8_t* apuiType_Out, uint16_t* apuiLen_Out, uint32_t* apuiTime_Out)
+{
+	if(hppAsyncQueueUsed(apQueue) < HPP_ASYNC_QUEUE_HEADER_SIZE) return false;
+
+	hppAsyncQueueGet(apQueue, apuiType_Out, sizeof(uint8_t));
+	hppAsyncQueueGet(apQueue, apuiTime_Out, sizeof(uint32_t));
+	hppAsyncQueueGet(apQueue, apuiLen_Out, sizeof(uint16_t));
+
+	return true;
+}
+
+
+bool hppAsyncQueuePeekVarName(const struct hppAsyncQueueStruct* apQueue, uint8_t* apuiType_Out, char* aszVarName_Out, uint32_t acbVarNameMaxLen)
+{
+	uint32_t cbUsed = hppAsyncQueueUsed(apQueue);
+	uint16_t uiLen;
+
+	if(cbUsed < HPP_ASYNC_QUEUE_HEADER_SIZE) return false;
+
+	hppAsyncQueueCopyOut(apQueue, HPP_ASYNC_QUEUE_HEADER_SIZE - sizeof(uint16_t), (uint8_t*)&uiLen, sizeof(uint16_t));
+	if(uiLen > acbVarNameMaxLen || cbUsed < HPP_ASYNC_QUEUE_HEADER_SIZE + uiLen) return false;
+
+	hppAsyncQueueCopyOut(apQueue, 0, apuiType_Out, sizeof(uint8_t));
+	hppAsyncQueueCopyOut(apQueue, HPP_ASYNC_QUEUE_HEADER_SIZE, (uint8_t*)aszVarName_Out, uiLen);
+	aszVarName_Out[uiLen] = 0;
+
+	return true;
+}
+
+
+bool hppAsyncQueueIsCoalesced(const struct hppAsyncQueueStruct* apQueue, uint8_t auiType, const char* aszVarName)
+{
+	char szNextVarName[HPP_ASYNC_QUEUE_VAR_NAME_MAX_LEN + 1];
+	uint8_t uiNextType;
+
+	if(!hppAsyncQueuePeekVarName(apQueue, &uiNextType, szNextVarName, HPP_ASYNC_QUEUE_VAR_NAME_MAX_LEN)) return false;
+
+	return uiNextType == auiType && strcmp(szNextVarName, aszVarName) == 0;
+}
+
+
+struct hppAsyncQueueStruct* hppAsyncQueueSelect(struct hppAsyncQueueStruct* apQueues, uint32_t anQueues)
+{
+	struct hppAsyncQueueStruct* pQueue;
+	uint32_t i;
+	int iRound;
+
+	for(iRound = 0; iRound < 2; iRound++)
+	{
+		for(i = 0; i < anQueues; i++)
+		{
+			pQueue = &(apQueues[i]);
+
+			if(pQueue->uiCredit > 0 && !hppAsyncQueueIsEmpty(pQueue))
+			{
+				pQueue->uiCredit--;
+				return pQueue;
+			}
+		}
+
+		// Start a new round once all waiting queues have used up their share
+		for(i = 0; i < anQueues; i++) apQueues[i].uiCredit = apQueues[i].uiWeight;
+	}
+
+	return NULL;
+}
+
+
+void hppAsyncBatchInit(struct hppAsyncBatchStruct* apBatch, uint32_t auiMaxCount, uint32_t auiMaxTime, uint32_t auiMaxOutputs)
+{
+	memset(apBatch, 0, sizeof(struct hppAsyncBatchStruct));
+
+	apBatch->uiMaxCount = auiMaxCount;
+	apBatch->uiMaxTime = auiMaxTime;
+	apBatch->uiMaxOutputs = auiMaxOutputs;
+}
+
+
+void hppAsyncBatchBegin(struct hppAsyncBatchStruct* apBatch, uint32_t auiNow)
+{
+	apBatch->uiCount = 0;
+	apBatch->uiStartTime = auiNow;
+}
+
+
+bool hppAsyncBatchNext(struct hppAsyncBatchStruct* apBatch, uint32_t auiNow, uint32_t anOutputs, bool abEnd, bool abReady)
+{
+	apBatch->uiCount++;
+
+	return !abEnd && abReady && apBatch->uiCount < apBatch->uiMaxCount && anOutputs < apBatch->uiMaxOutputs && 
+		   auiNow - apBatch->uiStartTime < apBatch->uiMaxTime;
+}
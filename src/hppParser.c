@@ -46,6 +46,7 @@
 
 #include "../include/hppParser.h"
 #include "../include/hppVarStorage.h"
+#include "../include/hppProfiler.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -64,13 +65,98 @@
 #define HPP_EXTERNAL_FUNCTION_LIBRARY_COUNT 5
 
 #define HPP_EXTERNAL_POLL_FUNCTION_TICK_COUNT 25
+#define HPP_SPARE_PARSE_FRAME_COUNT 32      // number of frames kept for reuse by the next execution
+
+#define HPP_IMAGE_MAGIC "\0HPI"             // first bytes of a pre-tokenized code image
+#define HPP_IMAGE_MAGIC_LEN 4
+#define HPP_IMAGE_TOKEN_FIRST 0x80          // token byte of the first word of hppImageTokens
+#define HPP_IMAGE_TOKEN_TABLE_COUNT 3       // maximum number of token tables added with hppAddImageTokens
+#define HPP_IMAGE_TOKEN_ESCAPE 0xff         // escape for bytes >= 0x80 outside string literals
+
+#define HPP_EXP_STACK_MIN_SIZE 2 * (HPP_EXP_MAX_LEN + HPP_EXP_LOCAL_VAL_PREFIX_LEN + 1)     // room for at least one expression 
+#define HPP_MAX_CALL_DEPTH_LIMIT 0xffff     // call depth is part of local variable names with format '%04x'
 
 // Control Status
 enum hppControlStatusEnum { hppControlStatus_None, hppControlStatus_If, hppControlStatus_While, hppControlStatus_Repeat, hppControlStatus_Else, hppControlStatus_Done };
 
+// Points in hppParseExpressionInt where a frame continues once the frame pushed on top of it has been evaluated
+enum hppResumePointEnum { hppResumePoint_AngleBrackets, hppResumePoint_ArrayIndex, hppResumePoint_ArrayWrite, hppResumePoint_Brackets,
+						  hppResumePoint_Argument, hppResumePoint_FunctionCall, hppResumePoint_ControlBody, hppResumePoint_ElseBody,
+						  hppResumePoint_Assignment, hppResumePoint_CodeBlock, hppResumePoint_Return, hppResumePoint_SecondOperand };
+
+// Parser frame holding the state of one expression level of hppParseExpressionInt.
+// All values which must survive the evaluation of a nested expression are stored here instead of the native stack.
+struct hppParseFrameStruct
+{
+	struct hppParseFrameStruct* pParent;        // Calling frame (or next free frame if the frame is not in use)
+	enum hppResumePointEnum eResumePoint;
+
+	// Arguments
+	const char* szResultVarKey;
+	size_t* pcbResultLen_Out;
+	const char* szTerminatingOperators;
+	char* pchTerminatingOperator_Out;
+
+	// Expression
+	char chTerm;
+	char* pchResult;
+	size_t cbResultLen;
+	char* szExpresssion;
+	char* szExpresssionWithPrefix;
+	char* szExpressionStackPointerBuf;
+
+	// Binary data access with '[', '.' and ':' operators
+	size_t iIndex;
+	size_t cbOffset;
+	size_t nSizeof;
+	size_t nIndexMultiplier;
+	enum hppBinaryTypeEnum nTypeID;
+	char* pchArray;
+
+	// Function calls and control structures
+	char szParamName[HPP_PARAM_PREFIX_LEN + 1];
+	char* pchLastParam;
+	enum hppControlStatusEnum eControlStatus;
+	size_t cbBoolExpPos;
+	size_t cbBoolBehindExpPos;
+	const char* szCallingCode;
+	struct hppVarConstTableStruct* pCallingConstTable;
+	size_t cbCallingPosition;
+	unsigned int iCallingFunctionCallDepth;
+
+	// Binary operators
+	char szSecondOpName[HPP_SECOND_OP_PREFIX_LEN + 1];
+	size_t cbSecondOperandLen;
+	char chNextTerm;
+
+	// Constant folding
+	size_t cbStartPos;         // Position in the code where the evaluation of the frame has started
+	bool bConstant;            // Only literals and binary operators on constant operands have been evaluated so far
+	bool bFolded;              // At least one binary operator has been evaluated
+
+	// Profiling of function calls
+	struct hppProfilerCallStruct theProfilerCall;
+};
+
+// Binary operators in the order of their priority followed by the terminating operators
+static const char* hppOperatorPriority = "%/*-+~<>GSUE&^|AO=)]},;";
+
+// Words replaced by a single token byte in pre-tokenized code images. The tables registered by the platform with 
+// hppAddImageTokens follow. Append new words only and increase HPP_IMAGE_VERSION when the meaning of an existing 
+// token byte changes.
+static const char* const hppImageTokens[] = { "return", "if", "else", "while", "break", "continue", "true", "false", 
+											  "param1", "param2", "param3", "abs", "int", "val", "sin", "cos", "tan", "writeln", 
+											  "struct", "alloc", "realloc", "len", "count", "item", "find", "sub", "replace", 
+											  "typeof", "vars", "vars_count", "roots", NULL };
+
 // Static variables
 static hppExternalFunctionType hppExternalFunctions[HPP_EXTERNAL_FUNCTION_LIBRARY_COUNT];
 static hppExternalPollFunctionType hppExternalPollFunction = NULL;
+static const char* const* hppImageTokenTables[HPP_IMAGE_TOKEN_TABLE_COUNT + 1] = { hppImageTokens };
+static unsigned int hppMaxCallDepth = HPP_MAX_CALL_DEPTH;
+static size_t hppExpressionStackSize = HPP_EXP_STACK_SIZE;
+static struct hppParseExpressionStruct* hppCurrentParseContext = NULL;   // Context presently evaluated by hppParseExpressionContinue
+static struct hppParseExpressionStruct* hppSpareParseContext = NULL;     // Context of a finished execution kept for reuse including its frames
 
 
 #ifdef __arm__
@@ -255,6 +341,358 @@ char hppIgnoreExpression(struct hppParseExpressionStruct* apParseContext)
 }
 
 
+// Returns true if the character 'ach' is part of a name, number or string literal (minification only)
+static bool hppIsWordChar(char ach)
+{
+	return isalnum((int)ach) || ach == '_' || ach == '.' || ach == '"' || ach == '\'';
+}
+
+
+// Remove comments and whitespaces not needed to separate names, numbers and operators from the 'acbCodeLen' bytes
+// long H++ code in 'apchCode'. Both '//' and '/* */' comments are removed. The code is modified in place.
+// Line breaks are kept such that errors are still reported with the line numbers of the original code.
+// Returns the new length of the code. A null byte is appended if the code was shortened.
+size_t hppMinifyCode(char* apchCode, size_t acbCodeLen)
+{
+	size_t cbRead = 0;
+	size_t cbWrite = 0;
+	size_t cbSkipStart;
+	size_t cbLines;
+	char chQuote;
+	char chPrev = 0;
+	char chNext;
+	
+	if(apchCode == NULL) return 0;
+	
+	while(cbRead < acbCodeLen)
+	{
+		// Copy string literals unchanged
+		if(apchCode[cbRead] == '"' || apchCode[cbRead] == '\'')
+		{
+			chQuote = apchCode[cbRead];
+			do apchCode[cbWrite++] = apchCode[cbRead++];
+			while(cbRead < acbCodeLen && apchCode[cbRead] != chQuote);
+			
+			if(cbRead < acbCodeLen) apchCode[cbWrite++] = apchCode[cbRead++];   // closing quotation mark
+			chPrev = chQuote;
+			continue;
+		}
+		
+		// Skip whitespaces and comments counting the line breaks 
+		cbLines = 0;
+		cbSkipStart = cbRead;
+		
+		while(cbRead < acbCodeLen)
+		{
+			if(isspace((int)apchCode[cbRead])) { if(apchCode[cbRead++] == 10) cbLines++; }
+			else if(cbRead + 1 < acbCodeLen && apchCode[cbRead] == '/' && apchCode[cbRead + 1] == '/')
+			{
+				while(cbRead < acbCodeLen && apchCode[cbRead] != 10) cbRead++;
+			}
+			else if(cbRead + 1 < acbCodeLen && apchCode[cbRead] == '/' && apchCode[cbRead + 1] == '*')
+			{
+				cbRead += 2;
+				while(cbRead < acbCodeLen && !(apchCode[cbRead] == '*' && cbRead + 1 < acbCodeLen && apchCode[cbRead + 1] == '/')) 
+					if(apchCode[cbRead++] == 10) cbLines++;
+				cbRead += 2;
+				if(cbRead > acbCodeLen) cbRead = acbCodeLen;
+			}
+			else break;
+		}
+		
+		chNext = cbRead < acbCodeLen ? apchCode[cbRead] : 0;
+		
+		if(cbLines > 0)
+		{
+			// Line breaks separate expressions like spaces. Leading line breaks are kept for the line numbers.
+			if(chNext != 0) while(cbLines-- > 0) apchCode[cbWrite++] = 10;
+		}
+		else if(cbRead > cbSkipStart && chPrev != 0 && chNext != 0)
+		{
+			// Keep a space between two names or numbers, between two operators which might be merged (e.g. '- -') and 
+			// behind '+' or '-' followed by a number or name (e.g. '- 1' is not a negative number)
+			if((hppIsWordChar(chPrev) && hppIsWordChar(chNext)) ||
+			   (!hppIsWordChar(chPrev) && !hppIsWordChar(chNext) && strchr("(){}[];,", chPrev) == NULL && strchr("(){}[];,", chNext) == NULL) ||
+			   ((chPrev == '+' || chPrev == '-') && hppIsWordChar(chNext)))
+				apchCode[cbWrite++] = ' ';
+		}
+		
+		if(cbRead > cbSkipStart) continue;
+		
+		chPrev = apchCode[cbWrite++] = apchCode[cbRead++];
+	}
+	
+	if(cbWrite < acbCodeLen) apchCode[cbWrite] = 0;
+	
+	return cbWrite;
+}
+
+
+// Returns true if the character 'ach' is part of a name or number (code images only)
+static bool hppIsNameChar(char ach)
+{
+	return isalnum((int)ach) || ach == '_';
+}
+
+
+// Append 'auiValue' with 7 bits per byte and the highest bit set in all but the last byte. Returns the new position.
+static size_t hppImagePutVarint(uint8_t* apImage, size_t acbPos, size_t acbMaxLen, size_t auiValue)
+{
+	do
+	{
+		if(acbPos < acbMaxLen) apImage[acbPos] = (uint8_t)((auiValue & 0x7f) | (auiValue > 0x7f ? 0x80 : 0));
+		acbPos++;
+		auiValue >>= 7;
+	} while(auiValue > 0);
+
+	return acbPos;
+}
+
+
+// Read a value written by hppImagePutVarint at '*apcbPos' and advance the position. Returns false if the end of the data is reached.
+static bool hppImageGetVarint(const uint8_t* apImage, size_t* apcbPos, size_t acbEnd, size_t* apuiValue_Out)
+{
+	size_t uiShift = 0;
+
+	*apuiValue_Out = 0;
+
+	while(*apcbPos < acbEnd && uiShift < 8 * sizeof(size_t))
+	{
+		*apuiValue_Out |= (size_t)(apImage[*apcbPos] & 0x7f) << uiShift;
+		if((apImage[(*apcbPos)++] & 0x80) == 0) return true;
+		uiShift += 7;
+	}
+
+	return false;
+}
+
+
+// Returns the word of the token byte HPP_IMAGE_TOKEN_FIRST + 'auiToken' or NULL if there is no such token
+static const char* hppImageGetToken(size_t auiToken)
+{
+	const char* const* pTable;
+	size_t iTable;
+	size_t i;
+
+	for(iTable = 0; iTable <= HPP_IMAGE_TOKEN_TABLE_COUNT && (pTable = hppImageTokenTables[iTable]) != NULL; iTable++)
+	{
+		for(i = 0; pTable[i] != NULL; i++) if(auiToken-- == 0) return pTable[i];
+	}
+
+	return NULL;
+}
+
+
+// Compile the 'acbCodeLen' bytes long H++ code in 'aszCode' into a pre-tokenized code image
+size_t hppCompileImage(const char* aszCode, size_t acbCodeLen, uint8_t* apImage_Out, size_t acbImageMaxLen)
+{
+	char* pchCode;
+	uint8_t* pLineTable;
+	size_t cbCodeLen;
+	size_t cbRead = 0;
+	size_t cbWord;
+	size_t cbBody = HPP_IMAGE_HEADER_LEN;
+	size_t cbLineTable = 0;
+	size_t cbLineTableMaxLen;
+	size_t cbDecodedPos = 0;                  // Position in the decoded code without line breaks
+	size_t cbLastBreakPos = 0;
+	size_t nLines;
+	size_t i;
+	const char* szToken;
+	char chQuote;
+
+	if(aszCode == NULL || apImage_Out == NULL || acbImageMaxLen < HPP_IMAGE_HEADER_LEN) return 0;
+
+	// Work on a minified copy. The line table takes at most two varints per line break. 
+	cbLineTableMaxLen = 2 * acbCodeLen + 16;
+	pchCode = (char*)malloc(acbCodeLen + 1);
+	pLineTable = (uint8_t*)malloc(cbLineTableMaxLen);
+
+	if(pchCode == NULL || pLineTable == NULL) { free(pchCode); free(pLineTable); return 0; }
+
+	memcpy(pchCode, aszCode, acbCodeLen);
+	cbCodeLen = hppMinifyCode(pchCode, acbCodeLen);
+
+	while(cbRead < cbCodeLen)
+	{
+		if(pchCode[cbRead] == 10)
+		{
+			// Line breaks are stored in the line table as distance to the last line break and number of lines
+			for(nLines = 0; cbRead < cbCodeLen && pchCode[cbRead] == 10; cbRead++) nLines++;
+			cbLineTable = hppImagePutVarint(pLineTable, cbLineTable, cbLineTableMaxLen, cbDecodedPos - cbLastBreakPos);
+			cbLineTable = hppImagePutVarint(pLineTable, cbLineTable, cbLineTableMaxLen, nLines);
+			cbLastBreakPos = cbDecodedPos;
+		}
+		else if(pchCode[cbRead] == '"' || pchCode[cbRead] == '\'')
+		{
+			// String literals are copied unchanged
+			chQuote = pchCode[cbRead];
+
+			do
+			{
+				if(cbBody < acbImageMaxLen) apImage_Out[cbBody] = (uint8_t)pchCode[cbRead];
+				cbBody++; cbRead++; cbDecodedPos++;
+			} while(cbRead < cbCodeLen && pchCode[cbRead] != chQuote);
+
+			if(cbRead < cbCodeLen)
+			{
+				if(cbBody < acbImageMaxLen) apImage_Out[cbBody] = (uint8_t)chQuote;
+				cbBody++; cbRead++; cbDecodedPos++;
+			}
+		}
+		else if(hppIsNameChar(pchCode[cbRead]))
+		{
+			// Replace known words by their token
+			for(cbWord = 1; cbRead + cbWord < cbCodeLen && hppIsNameChar(pchCode[cbRead + cbWord]); cbWord++);
+			for(i = 0; (szToken = hppImageGetToken(i)) != NULL; i++) if(strlen(szToken) == cbWord && strncmp(szToken, pchCode + cbRead, cbWord) == 0) break;
+
+			if(szToken != NULL)
+			{
+				if(cbBody < acbImageMaxLen) apImage_Out[cbBody] = (uint8_t)(HPP_IMAGE_TOKEN_FIRST + i);
+				cbBody++;
+			}
+			else
+			{
+				if(cbBody + cbWord <= acbImageMaxLen) memcpy(apImage_Out + cbBody, pchCode + cbRead, cbWord);
+				cbBody += cbWord;
+			}
+
+			cbRead += cbWord;
+			cbDecodedPos += cbWord;
+		}
+		else
+		{
+			if((uint8_t)pchCode[cbRead] >= HPP_IMAGE_TOKEN_FIRST)
+			{
+				if(cbBody < acbImageMaxLen) apImage_Out[cbBody] = HPP_IMAGE_TOKEN_ESCAPE;
+				cbBody++;
+			}
+
+			if(cbBody < acbImageMaxLen) apImage_Out[cbBody] = (uint8_t)pchCode[cbRead];
+			cbBody++; cbRead++; cbDecodedPos++;
+		}
+	}
+
+	// Move the body behind the line table and write the header. Lengths in the header are 16 bit.
+	if(cbCodeLen <= 0xffff && cbLineTable <= 0xffff && cbBody - HPP_IMAGE_HEADER_LEN <= 0xffff && cbBody + cbLineTable <= acbImageMaxLen)
+	{
+		memmove(apImage_Out + HPP_IMAGE_HEADER_LEN + cbLineTable, apImage_Out + HPP_IMAGE_HEADER_LEN, cbBody - HPP_IMAGE_HEADER_LEN);
+		memcpy(apImage_Out + HPP_IMAGE_HEADER_LEN, pLineTable, cbLineTable);
+		memcpy(apImage_Out, HPP_IMAGE_MAGIC, HPP_IMAGE_MAGIC_LEN);
+		apImage_Out[4] = HPP_IMAGE_VERSION;
+		apImage_Out[5] = 0;                                     // flags (reserved)
+		apImage_Out[6] = (uint8_t)(cbCodeLen & 0xff);           // length of the decoded code
+		apImage_Out[7] = (uint8_t)(cbCodeLen >> 8);
+		apImage_Out[8] = (uint8_t)(cbLineTable & 0xff);
+		apImage_Out[9] = (uint8_t)(cbLineTable >> 8);
+		apImage_Out[10] = (uint8_t)((cbBody - HPP_IMAGE_HEADER_LEN) & 0xff);
+		apImage_Out[11] = (uint8_t)((cbBody - HPP_IMAGE_HEADER_LEN) >> 8);
+		cbBody += cbLineTable;
+	}
+	else cbBody = 0;
+
+	free(pchCode);
+	free(pLineTable);
+
+	return cbBody;
+}
+
+
+// Returns the length of the code stored in the code image 'apImage' or zero if 'apImage' is not a valid code image
+size_t hppGetImageCodeLen(const uint8_t* apImage, size_t acbImageLen)
+{
+	if(apImage == NULL || acbImageLen < HPP_IMAGE_HEADER_LEN || memcmp(apImage, HPP_IMAGE_MAGIC, HPP_IMAGE_MAGIC_LEN) != 0) return 0;
+	if(apImage[4] != HPP_IMAGE_VERSION) return 0;
+	if((size_t)HPP_IMAGE_HEADER_LEN + (apImage[8] | (apImage[9] << 8)) + (apImage[10] | (apImage[11] << 8)) != acbImageLen) return 0;
+
+	return apImage[6] | (apImage[7] << 8);
+}
+
+
+// Load the code image 'apImage' created with hppCompileImage
+size_t hppLoadImage(const uint8_t* apImage, size_t acbImageLen, char* apchCode_Out, size_t acbCodeMaxLen)
+{
+	size_t cbCodeLen = hppGetImageCodeLen(apImage, acbImageLen);
+	size_t cbLineTable = HPP_IMAGE_HEADER_LEN;
+	size_t cbLineTableEnd;
+	size_t cbRead;
+	size_t cbWrite = 0;
+	size_t cbDecodedPos = 0;
+	size_t cbNextBreakPos = 0;
+	size_t nLines = 0;
+	size_t cbWord;
+	const char* szToken;
+	char chQuote = 0;
+	uint8_t uiByte;
+
+	if(cbCodeLen == 0 || apchCode_Out == NULL || acbCodeMaxLen <= cbCodeLen) return 0;
+
+	cbLineTableEnd = cbLineTable + (apImage[8] | (apImage[9] << 8));
+	cbRead = cbLineTableEnd;
+
+	if(cbLineTable < cbLineTableEnd)
+	{
+		if(!hppImageGetVarint(apImage, &cbLineTable, cbLineTableEnd, &cbNextBreakPos)) return 0;
+		if(!hppImageGetVarint(apImage, &cbLineTable, cbLineTableEnd, &nLines)) return 0;
+	}
+
+	while(cbWrite < cbCodeLen)
+	{
+		// Insert line breaks found in the line table
+		if(nLines > 0 && cbDecodedPos == cbNextBreakPos)
+		{
+			while(nLines > 0 && cbWrite < cbCodeLen) { apchCode_Out[cbWrite++] = 10; nLines--; }
+
+			if(cbLineTable < cbLineTableEnd)
+			{
+				if(!hppImageGetVarint(apImage, &cbLineTable, cbLineTableEnd, &cbWord)) return 0;
+				if(!hppImageGetVarint(apImage, &cbLineTable, cbLineTableEnd, &nLines)) return 0;
+				cbNextBreakPos += cbWord;
+			}
+
+			continue;
+		}
+
+		if(cbRead >= acbImageLen) return 0;
+		uiByte = apImage[cbRead++];
+
+		if(chQuote == 0 && uiByte >= HPP_IMAGE_TOKEN_FIRST)
+		{
+			if(uiByte == HPP_IMAGE_TOKEN_ESCAPE)
+			{
+				if(cbRead >= acbImageLen) return 0;
+				apchCode_Out[cbWrite++] = (char)apImage[cbRead++];
+				cbDecodedPos++;
+				continue;
+			}
+
+			// Expand token
+			szToken = hppImageGetToken(uiByte - HPP_IMAGE_TOKEN_FIRST);
+			if(szToken == NULL) return 0;
+			cbWord = strlen(szToken);
+			if(cbWrite + cbWord > cbCodeLen) return 0;
+
+			memcpy(apchCode_Out + cbWrite, szToken, cbWord);
+			cbWrite += cbWord;
+			cbDecodedPos += cbWord;
+			continue;
+		}
+
+		if(chQuote == 0 && (uiByte == '"' || uiByte == '\'')) chQuote = (char)uiByte;
+		else if(chQuote == (char)uiByte) chQuote = 0;
+
+		apchCode_Out[cbWrite++] = (char)uiByte;
+		cbDecodedPos++;
+	}
+
+	if(cbRead != acbImageLen) return 0;
+
+	apchCode_Out[cbWrite] = 0;
+
+	return cbWrite;
+}
+
+
 // Evaluate Function 'aszFunctionName' with parameters stored in varibales with name passed by 'aszParamName', whereby
 // variable names have the format '%04x_Param1'. The byte 'aszParamName[HPP_PARAM_PREFIX_LEN - 1]' may be modifiyed to read the
 // respectiv paramter. The hex number '%04x' stands for the hppParseExpression recusive call count and
@@ -294,6 +732,47 @@ char* hppEvaluateFuction(char aszFunctionName[], char aszParamName[], const char
 		return hppVarPutStr(aszResultVarKey, szText, apcbResultLen_Out);
 	}
 	
+	if(strncmp(aszFunctionName, "prof_", 5) == 0)
+	{
+		if(strcmp(aszFunctionName, "prof_enable") == 0)
+		{
+			char* szEnable = hppVarGet(aszParamName, NULL);
+			hppProfilerEnable(szEnable == NULL || strcmp(szEnable, "false") != 0);    // enabled without parameter
+			return hppVarPutStr(aszResultVarKey, hppProfilerEnabled ? "true" : "false", apcbResultLen_Out);
+		}
+		
+		if(strcmp(aszFunctionName, "prof_reset") == 0)
+		{
+			hppProfilerReset();
+			return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+		}
+		
+		if(strcmp(aszFunctionName, "prof_sample") == 0)
+		{
+			char* szEnable = hppVarGet(aszParamName, NULL);
+			hppProfilerEnableSampling(szEnable == NULL || strcmp(szEnable, "false") != 0);    // enabled without parameter
+			return hppVarPutStr(aszResultVarKey, hppProfilerSamplingEnabled ? "true" : "false", apcbResultLen_Out);
+		}
+		
+		if(strcmp(aszFunctionName, "prof_samples") == 0)
+		{
+			char* pchDump;
+			*apcbResultLen_Out = hppProfilerDumpSamples(NULL, 0);
+			pchDump = hppVarPut(aszResultVarKey, hppNoInitValue, *apcbResultLen_Out);
+			if(pchDump != NULL) hppProfilerDumpSamples(pchDump, *apcbResultLen_Out + 1);
+			return pchDump;
+		}
+		
+		if(strcmp(aszFunctionName, "prof_dump") == 0)
+		{
+			char* pchDump;
+			*apcbResultLen_Out = hppProfilerDump(NULL, 0);
+			pchDump = hppVarPut(aszResultVarKey, hppNoInitValue, *apcbResultLen_Out);
+			if(pchDump != NULL) hppProfilerDump(pchDump, *apcbResultLen_Out + 1);
+			return pchDump;
+		}
+	}
+	
 	if(strcmp(aszFunctionName, "struct") == 0)
 	{
 		char* pchStruct = NULL;
@@ -317,7 +796,7 @@ char* hppEvaluateMethod(char aszFunctionName[], char aszParamName[], const char
 	char* szMethodTest;
 	size_t cbInstanceDataLenght;
 	char* pchReturn = NULL;
-	char* szInstanceName;
+	char szInstanceName[HPP_EXP_MAX_LEN + 1];
 	char* pchInstanceData;
 	char* szParam;
 	enum hppBinaryTypeEnum theBinaryType;
@@ -325,8 +804,7 @@ char* hppEvaluateMethod(char aszFunctionName[], char aszParamName[], const char
 	
 	// Find method name
 	while((szMethodTest = strchr(szMethodName, '.')) != NULL) szMethodName = szMethodTest + 1;	
-	szInstanceName = (char *)malloc(szMethodName - aszFunctionName + 1);   // reseve memory for instance name + 1 byte for '.'
-	if(szInstanceName == NULL) return NULL; 
+	if(szMethodName - aszFunctionName - 1 > HPP_EXP_MAX_LEN) return NULL; 
 	memcpy(szInstanceName, aszFunctionName, szMethodName - aszFunctionName - 1);   // first copy instance name without '.'
 	szInstanceName[szMethodName - aszFunctionName - 1] = 0;  		
 	pchInstanceData = hppVarGet(szInstanceName, &cbInstanceDataLenght);
@@ -451,40 +929,158 @@ char* hppEvaluateMethod(char aszFunctionName[], char aszParamName[], const char
 					break; 
 	}
 						
-	free(szInstanceName);
 	return pchReturn;
 }
 
 
-// Parse H++ code in 'apParseContext->szCode' from 'apParseContext->cbPos' on. Store result in the variable 'aszResultVarKey' and
-// return a pointer to the char array assoziated with that valiable. The length of the result array
-// is stored in 'apcbResultLen_Out' (unless NULL). Parsing stops once on operation contained in   
-// 'aszTerminatingOperators' is hit. The operator actually terminating parsing is stored in 
-// 'apchTerminatingOperator_Out' (unless NULL). The parameter 'aiCallDepth' tracks the numner of sub-routine calls
-// and supports creation of local variables by adding call count to the key of the variable name key.  
-char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, const char* aszResultVarKey,
-						   size_t* apcbResultLen_Out, const char* aszTerminatingOperators, char* apchTerminatingOperator_Out)
+// Assign the constant interned for the present position of the code to the frame 'apFrame' and move behind the expression.
+// The result variable references the interned value instead of a copy. Returns false if no constant is interned for the position.
+static bool hppConstCacheGet(struct hppParseExpressionStruct* apParseContext, struct hppParseFrameStruct* apFrame)
+{
+	const struct hppVarConstStruct* pConst = hppVarConstGet(apParseContext->pConstTable, apParseContext->cbPos, (uintptr_t)apFrame->szTerminatingOperators);
+	
+	if(pConst == NULL) return false;
+	
+	apFrame->pchResult = hppVarPutInterned(apFrame->szResultVarKey, pConst);
+	if(apFrame->pchResult == NULL) return false;
+	
+	apFrame->cbResultLen = pConst->cbValueLen;
+	apFrame->chTerm = pConst->chTerm;
+	apParseContext->cbPos += pConst->cbSourceLen;
+	
+	return true;
+}
+
+
+// Intern the result of the literal or the constant expression evaluated by the frame 'apFrame' for the code presently executed
+static void hppConstCachePut(struct hppParseExpressionStruct* apParseContext, struct hppParseFrameStruct* apFrame)
+{
+	if(apParseContext->eReturnReason != hppReturnReason_None || apFrame->pchResult == NULL) return;
+	
+	// Code which is not the value of a variable is usually executed once. Its constants are interned once they are evaluated 
+	// again, e.g. in a loop. Frames of the first pass end at a position at or behind the end of all frames evaluated before.
+	if(apParseContext->pConstTable == &apParseContext->mConstTable && apParseContext->cbPos >= apParseContext->cbConstFirstPassPos)
+	{
+		apParseContext->cbConstFirstPassPos = apParseContext->cbPos;
+		return;
+	}
+	
+	hppVarConstPut(apParseContext->pConstTable, apFrame->cbStartPos, (uintptr_t)apFrame->szTerminatingOperators, apParseContext->cbPos - apFrame->cbStartPos, 
+				   apFrame->chTerm, apFrame->pchResult, apFrame->cbResultLen);
+}
+
+
+// Allocate a new parser frame (continuation) for 'hppParseExpressionInt' on top of the frame stack of 'apParseContext'.
+// Frames released before are reused. Returns false if no memory is available.
+static bool hppParseFramePush(struct hppParseExpressionStruct* apParseContext, const char* aszResultVarKey,
+							  size_t* apcbResultLen_Out, const char* aszTerminatingOperators, char* apchTerminatingOperator_Out)
+{
+	struct hppParseFrameStruct* pFrame = apParseContext->pFreeFrames;
+
+	if(pFrame != NULL) apParseContext->pFreeFrames = pFrame->pParent;
+	else 
+	{
+		pFrame = (struct hppParseFrameStruct*)malloc(sizeof(struct hppParseFrameStruct));
+		if(pFrame == NULL) 
+		{
+			apParseContext->eReturnReason = hppReturnReason_FatalError;
+			return false;
+		}
+	}
+
+	pFrame->pParent = apParseContext->pFrame;
+	pFrame->szResultVarKey = aszResultVarKey;
+	pFrame->pcbResultLen_Out = apcbResultLen_Out;
+	pFrame->szTerminatingOperators = aszTerminatingOperators;
+	pFrame->pchTerminatingOperator_Out = apchTerminatingOperator_Out;
+	apParseContext->pFrame = pFrame;
+
+	return true;
+}
+
+
+// Release the frame on top of the frame stack of 'apParseContext' for reuse. Returns the frame of the calling expression or NULL. 
+static struct hppParseFrameStruct* hppParseFramePop(struct hppParseExpressionStruct* apParseContext)
+{
+	struct hppParseFrameStruct* pFrame = apParseContext->pFrame;
+	
+	apParseContext->pFrame = pFrame->pParent;
+	pFrame->pParent = apParseContext->pFreeFrames;
+	apParseContext->pFreeFrames = pFrame;
+
+	return apParseContext->pFrame;
+}
+
+
+// Parse H++ code in 'apParseContext->szCode' from 'apParseContext->cbPos' on, starting with the frame on top of the frame stack
+// of 'apParseContext'. Each frame stores its result in the variable 'szResultVarKey' of the frame and stores a pointer to the
+// char array assoziated with that valiable in the calling frame. The length of the result array is stored in 
+// 'pcbResultLen_Out' (unless NULL). Parsing of a frame stops once on operation contained in 'szTerminatingOperators' is hit.
+// The operator actually terminating parsing is stored in 'pchTerminatingOperator_Out' (unless NULL). The context member 
+// 'iCallDepth' tracks the numner of nested expressions and supports creation of local variables by adding call count to the
+// key of the variable name key.  
+// Sub-expressions, brackets, arguments and function calls are not evaluated by recursion. Instead a new frame is pushed
+// on the heap based frame stack of 'apParseContext' and the calling frame continues at its resume point once the new 
+// frame has been evaluated. The native stack usage is therefore independent of the nesting depth of the H++ code.
+// Returns the result of the bottom frame once all frames have been evaluated. If the tick budget of the present slice
+// is used up before, 'bSuspended' is set and NULL is returned. Calling the function again continues with the next frame.
+char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext)
 {
+	struct hppParseFrameStruct* pFrame;
+	char* pchReturn = NULL;      // Result of the last frame returned to its calling frame
+	char* pchParam;
+	char* pchSecondOperand;
+	char* szExpresssionBehindPrefix;
+	const char* hppTerminatingOperators;
 	bool isValue;
-	char chTerm = 32;
-	char* pchResult = NULL; 
-	size_t cbResultLen;
-	char* szExpresssion;
-	char* szExpresssionWithPrefix;
-	char* szExpressionStackPointerBuf = apParseContext->szExpressionStackPointer;   // Buffer stack level of calling function
+	bool bReturnConstant = false;   // Result of the last frame returned to its calling frame is a constant
+	size_t cbLen;
+	size_t iEntry;
+	char chNewTerm;
+	char szNumeric[HPP_NUMERIC_MAX_MEM];   // 12 numbers => max 19 characters + null byte: -1.23456789012+e123
+	char szMemberName[HPP_MAX_MEMBER_NAME_LEN + 1];
 
-	//szExpresssionWithPrefix = (char*) malloc(HPP_EXP_MAX_LEN + HPP_EXP_LOCAL_VAL_PREFIX_LEN + 1);
-	apParseContext->szExpressionStackPointer += strlen(szExpressionStackPointerBuf) + 1;  // Put stack pointer behind present expression
-	szExpresssionWithPrefix = apParseContext->szExpressionStackPointer;
-	if(apParseContext->szExpressionStack + HPP_EXP_STACK_SIZE - HPP_EXP_MAX_LEN - HPP_EXP_LOCAL_VAL_PREFIX_LEN - 1 < szExpresssionWithPrefix)
+	// Continue behind the function call which has requested to yield the task 
+	if(apParseContext->bYielded)
 	{
-		apParseContext->eReturnReason = hppReturnReason_Error_StackOverflow;
+		apParseContext->bYielded = false;
+		pFrame = apParseContext->pFrame;
+		goto resume_yield;
+	}
+
+parse_frame:
+	// Suspend before the next frame is evaluated if the tick budget of the present slice has been used up
+	if(apParseContext->uiSliceTickBudget != 0 && apParseContext->eReturnReason == hppReturnReason_None &&
+	   ++apParseContext->uiSliceTickCount > apParseContext->uiSliceTickBudget)
+	{
+		apParseContext->bSuspended = true;
 		return NULL;
 	}
+
+	pFrame = apParseContext->pFrame;
+	pFrame->chTerm = 32;
+	pFrame->pchResult = NULL;
+	pFrame->cbResultLen = 0;
+	pFrame->szExpressionStackPointerBuf = apParseContext->szExpressionStackPointer;   // Buffer stack level of calling function
+
+	apParseContext->szExpressionStackPointer += strlen(pFrame->szExpressionStackPointerBuf) + 1;  // Put stack pointer behind present expression
+	pFrame->szExpresssionWithPrefix = apParseContext->szExpressionStackPointer;
+	if(apParseContext->szExpressionStack + apParseContext->cbExpressionStackSize - HPP_EXP_MAX_LEN - HPP_EXP_LOCAL_VAL_PREFIX_LEN - 1 < pFrame->szExpresssionWithPrefix ||
+	   apParseContext->iCallDepth - apParseContext->uiLocalBase >= apParseContext->uiMaxCallDepth)
+	{
+		apParseContext->eReturnReason = hppReturnReason_Error_StackOverflow;
+		pFrame->szResultVarKey = NULL;
+	}
+	
+	if(pFrame->szResultVarKey == NULL) 
+	{
+		apParseContext->szExpressionStackPointer = pFrame->szExpressionStackPointerBuf;
+		pchReturn = NULL;
+		bReturnConstant = false;
+		goto parse_frame_return;    // Return without touching the output parameters
+	}
 	
-	//if(szExpresssionWithPrefix == NULL || aszResultVarKey == NULL) return NULL;
-	if(aszResultVarKey == NULL) return NULL;
-    sprintf(szExpresssionWithPrefix, HPP_EXP_LOCAL_VAL_PREFIX, apParseContext->iFunctionCallDepth); 
+    sprintf(pFrame->szExpresssionWithPrefix, HPP_EXP_LOCAL_VAL_PREFIX, apParseContext->iFunctionCallDepth); 
 
 	apParseContext->iCallDepth++;
 	if(hppExternalPollFunction != NULL && ++apParseContext->uiExternalPollFunctionTickCount == HPP_EXTERNAL_POLL_FUNCTION_TICK_COUNT)
@@ -493,217 +1089,250 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 		apParseContext->uiExternalPollFunctionTickCount = 0;
 	}
 
-	while(strchr(aszTerminatingOperators, chTerm) == NULL && apParseContext->eReturnReason == hppReturnReason_None)
+	// Literals and constant expressions are evaluated once per position of the code and interned for the code afterwards
+	pFrame->cbStartPos = apParseContext->cbPos;
+	pFrame->bConstant = true;
+	pFrame->bFolded = false;
+	if(apParseContext->eReturnReason == hppReturnReason_None && hppConstCacheGet(apParseContext, pFrame)) goto parse_frame_done;
+
+	while(strchr(pFrame->szTerminatingOperators, pFrame->chTerm) == NULL && apParseContext->eReturnReason == hppReturnReason_None)
 	{
-		szExpresssion = szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN;   // Write expression behind the prefix such the prefix can be used selectively
-		chTerm = hppGetExpression(apParseContext, szExpresssion, &isValue, HPP_EXP_MAX_LEN);
+		pFrame->szExpresssion = pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN;   // Write expression behind the prefix such the prefix can be used selectively
+		pFrame->chTerm = hppGetExpression(apParseContext, pFrame->szExpresssion, &isValue, HPP_EXP_MAX_LEN);
 		if(apParseContext->eReturnReason == hppReturnReason_EOF)
 		{ 
-			if(pchResult != NULL) break;  // Preserve the result of the last command if hppParseExpressionInt has reached the end of the code
+			if(pFrame->pchResult != NULL) break;  // Preserve the result of the last command if hppParseExpressionInt has reached the end of the code
 			else  apParseContext->eReturnReason = hppReturnReason_Error_SemicolonExpected;
 		}
 		
-		pchResult = NULL;  	// All code paths should assign pchResult
+		pFrame->pchResult = NULL;  	// All code paths should assign pchResult
 		
 		if(isValue)  
 		{ 
-			cbResultLen = strlen(szExpresssion);
-			pchResult = hppVarPut(aszResultVarKey, szExpresssion, cbResultLen); 
+			pFrame->cbResultLen = strlen(pFrame->szExpresssion);
+			pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, pFrame->szExpresssion, pFrame->cbResultLen); 
 		}
 		else 
 		{	 
+			pFrame->bConstant = false;    // Variables, functions and control structures are never constant
+
 			// Unitary opertors not evaluating the expression keeping 'aszResultVarKey' unchanged
-			if(islower((int)szExpresssion[0])) szExpresssion = szExpresssionWithPrefix;  // local variable or function 
+			if(islower((int)pFrame->szExpresssion[0])) pFrame->szExpresssion = pFrame->szExpresssionWithPrefix;  // local variable or function 
 
 			// operators '::', '<' , '[', '.', ':type[' or leading '?'
 			// Some code branches use 'aszResultVarKey' to temporarily store parameter values. 
 			// This loop end if a code branch calculates a value for further processing and assignes pchResult  
-			while(strchr("MN[.Q:", chTerm) != NULL && apParseContext->eReturnReason == hppReturnReason_None && pchResult == NULL)
+			while(strchr("MN[.Q:", pFrame->chTerm) != NULL && apParseContext->eReturnReason == hppReturnReason_None && pFrame->pchResult == NULL)
 			{
-				size_t cbLen;
-				char* pchParam;
-				
 				// Parameters for binary data access with '[' operator
-				size_t iIndex = 0;            	// Index from value between [] operatores. Zero if not present
-				size_t cbOffset = 0;            // No intital offset. May come from '.' operator
-				size_t nSizeof = 1;             // Standard type size for [ operator;  may be overwritten by : operator
-				size_t nIndexMultiplier = 1;    // Must be same as nSizeof or 1 depending on the type addressing  
-				enum hppBinaryTypeEnum nTypeID = hppBinaryType_uint8;  // uint8 --> unsigned char
-				char* pchArray;
-
-				switch(chTerm)
+				pFrame->iIndex = 0;            	   // Index from value between [] operatores. Zero if not present
+				pFrame->cbOffset = 0;              // No intital offset. May come from '.' operator
+				pFrame->nSizeof = 1;               // Standard type size for [ operator;  may be overwritten by : operator
+				pFrame->nIndexMultiplier = 1;      // Must be same as nSizeof or 1 depending on the type addressing  
+				pFrame->nTypeID = hppBinaryType_uint8;  // uint8 --> unsigned char
+
+				switch(pFrame->chTerm)
 				{
 								// add text to the expression name behind '.' (member or method)
-					case 'M':  	cbLen = strlen(szExpresssion);   // The below limit to HPP_EXP_MAX_LEN does not consider extra available bytes for the local var prefix (uncritcal)
-								if(cbLen < HPP_EXP_MAX_LEN) strcat(szExpresssion, ".");
+					case 'M':  	cbLen = strlen(pFrame->szExpresssion);   // The below limit to HPP_EXP_MAX_LEN does not consider extra available bytes for the local var prefix (uncritcal)
+								if(cbLen < HPP_EXP_MAX_LEN) strcat(pFrame->szExpresssion, ".");
 								cbLen++;
-								chTerm = hppGetExpression(apParseContext, szExpresssion + cbLen, NULL, HPP_EXP_MAX_LEN - cbLen);
+								pFrame->chTerm = hppGetExpression(apParseContext, pFrame->szExpresssion + cbLen, NULL, HPP_EXP_MAX_LEN - cbLen);
 								break;
 					
 								// add evaluated string to the expression name
-					case 'N':  	cbLen = strlen(szExpresssion);   // The below limit to HPP_EXP_MAX_LEN does not consider extra available bytes for the local var prefix (uncritcal)
-								pchParam = hppParseExpressionInt(apParseContext, aszResultVarKey, NULL , ">;", &chTerm); // Temporary use of result variable
-								if(chTerm == '>') 
+					case 'N':  	pFrame->eResumePoint = hppResumePoint_AngleBrackets;   // Temporary use of result variable
+								if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, NULL , ">;", &pFrame->chTerm)) goto parse_frame;
+								pchReturn = NULL;
+			resume_angle_brackets:
+								if(apParseContext->eReturnReason != hppReturnReason_None) break;   // Unwinding, the code must not be read anymore
+								cbLen = strlen(pFrame->szExpresssion);   // The below limit to HPP_EXP_MAX_LEN does not consider extra available bytes for the local var prefix (uncritcal)
+								if(pFrame->chTerm == '>') 
 								{
-									strncat(szExpresssion, pchParam, HPP_EXP_MAX_LEN - cbLen);
-									chTerm = hppGetOperator(apParseContext);
+									strncat(pFrame->szExpresssion, pchReturn, HPP_EXP_MAX_LEN - cbLen);
+									pFrame->chTerm = hppGetOperator(apParseContext);
 								}
 								else apParseContext->eReturnReason = hppReturnReason_Error_ClosingAngleBracketsExpected;
 								break;
 								
 			   struct_method:				
-					case '.':   pchArray = hppVarGet(szExpresssion, &cbResultLen);   // Read array
-								if(pchArray != NULL) 
+					case '.':   pFrame->pchArray = hppVarGet(pFrame->szExpresssion, &pFrame->cbResultLen);   // Read array
+								if(pFrame->pchArray != NULL) 
 								{
-									char szMemberName[HPP_MAX_MEMBER_NAME_LEN + 1];
-									chTerm = hppGetExpression(apParseContext, szMemberName, NULL, HPP_MAX_MEMBER_NAME_LEN);
-									cbOffset = hppGetMemberFromStruct(pchArray, cbResultLen, szMemberName, &nTypeID, &nIndexMultiplier);
-									if(nTypeID == hppBinaryType_unvalid) { apParseContext->eReturnReason = hppReturnReason_Error_UnknownMemberType; break; }
-									nSizeof = hppTypeSizeof[nTypeID];
+									pFrame->chTerm = hppGetExpression(apParseContext, szMemberName, NULL, HPP_MAX_MEMBER_NAME_LEN);
+									pFrame->cbOffset = hppGetMemberFromStruct(pFrame->pchArray, pFrame->cbResultLen, szMemberName, &pFrame->nTypeID, &pFrame->nIndexMultiplier);
+									if(pFrame->nTypeID == hppBinaryType_unvalid) { apParseContext->eReturnReason = hppReturnReason_Error_UnknownMemberType; break; }
+									pFrame->nSizeof = hppTypeSizeof[pFrame->nTypeID];
 									goto struct_access;
 								}
 								else apParseContext->eReturnReason = hppReturnReason_Error_UnknownVariable; 
 								break;
 					
-					case ':':   nTypeID = hppGetTypeID(apParseContext->szCode + apParseContext->cbPos);
-								if(nTypeID == hppBinaryType_unvalid) { apParseContext->eReturnReason = hppReturnReason_Error_UnknownArrayType; break; }
-								nSizeof = nIndexMultiplier = hppTypeSizeof[nTypeID];
-								apParseContext->cbPos += hppTypeNameLenght[nTypeID];
-								if(apParseContext->szCode[apParseContext->cbPos] == '*') { nIndexMultiplier = 1; apParseContext->cbPos++; } // Bytewise access
+					case ':':   pFrame->nTypeID = hppGetTypeID(apParseContext->szCode + apParseContext->cbPos);
+								if(pFrame->nTypeID == hppBinaryType_unvalid) { apParseContext->eReturnReason = hppReturnReason_Error_UnknownArrayType; break; }
+								pFrame->nSizeof = pFrame->nIndexMultiplier = hppTypeSizeof[pFrame->nTypeID];
+								apParseContext->cbPos += hppTypeNameLenght[pFrame->nTypeID];
+								if(apParseContext->szCode[apParseContext->cbPos] == '*') { pFrame->nIndexMultiplier = 1; apParseContext->cbPos++; } // Bytewise access
 								if(apParseContext->szCode[apParseContext->cbPos] == '[') apParseContext->cbPos++;  // Continue with '[' operator
 								else { apParseContext->eReturnReason = hppReturnReason_Error_OpeningSquaredBracketExpected; break; }
 								
-					case '[':   pchParam = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, "]};", &chTerm);
-								iIndex = hppAtoI(pchParam);
-								if(chTerm != ']') { apParseContext->eReturnReason = hppReturnReason_Error_ClosingSquaredBracketExpected; break; }
-								chTerm = hppGetOperator(apParseContext);
-								if(chTerm == '.') goto struct_method; // continue with '.' operator, otherwise continue processing the array
-								pchArray = hppVarGet(szExpresssion, &cbResultLen);   // Read array
+					case '[':   pFrame->eResumePoint = hppResumePoint_ArrayIndex;
+								if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, "]};", &pFrame->chTerm)) goto parse_frame;
+								pchReturn = NULL;
+			resume_array_index:
+								if(apParseContext->eReturnReason != hppReturnReason_None) break;   // Unwinding, the code must not be read anymore
+								pFrame->iIndex = hppAtoI(pchReturn);
+								if(pFrame->chTerm != ']') { apParseContext->eReturnReason = hppReturnReason_Error_ClosingSquaredBracketExpected; break; }
+								pFrame->chTerm = hppGetOperator(apParseContext);
+								if(pFrame->chTerm == '.') goto struct_method; // continue with '.' operator, otherwise continue processing the array
+								pFrame->pchArray = hppVarGet(pFrame->szExpresssion, &pFrame->cbResultLen);   // Read array
 								
-			   struct_access:	cbOffset += iIndex * nIndexMultiplier;   // Calcualte offset including array index   
+			   struct_access:	pFrame->cbOffset += pFrame->iIndex * pFrame->nIndexMultiplier;   // Calcualte offset including array index   
 								
 								// Increase size to accommodate the new array entry?
-								if(cbResultLen < cbOffset + nSizeof) pchArray = hppVarPut(szExpresssion, hppInitValueWithZero, cbOffset + nSizeof);
-								if(pchArray == NULL) { apParseContext->eReturnReason = hppReturnReason_FatalError; break; }
+								if(pFrame->cbResultLen < pFrame->cbOffset + pFrame->nSizeof) pFrame->pchArray = hppVarPut(pFrame->szExpresssion, hppInitValueWithZero, pFrame->cbOffset + pFrame->nSizeof);
+								if(pFrame->pchArray == NULL) { apParseContext->eReturnReason = hppReturnReason_FatalError; break; }
 						
 								// Get new L-value expression from array or structure entry. Length is limited to HPP_VAR_NAME_MAX_LEN.
-								if(nTypeID == hppBinaryType_var || nTypeID == hppBinaryType_array || nTypeID == hppBinaryType_string)
+								if(pFrame->nTypeID == hppBinaryType_var || pFrame->nTypeID == hppBinaryType_array || pFrame->nTypeID == hppBinaryType_string)
 								{
-									if(*(pchArray + cbOffset) == 0)   // Invent new variable name, based on the name of the base variable, if it was not assigned before
+									if(*(pFrame->pchArray + pFrame->cbOffset) == 0)   // Invent new variable name, based on the name of the base variable, if it was not assigned before
 									{
-										if(snprintf(pchArray + cbOffset, HPP_VAR_NAME_MAX_LEN + 1, "%s.%d", szExpresssion, (unsigned int)cbOffset) > HPP_VAR_NAME_MAX_LEN)
+										pFrame->pchArray = hppVarGetWritable(pFrame->szExpresssion, NULL);
+										if(pFrame->pchArray == NULL) { apParseContext->eReturnReason = hppReturnReason_FatalError; break; }
+										
+										if(snprintf(pFrame->pchArray + pFrame->cbOffset, HPP_VAR_NAME_MAX_LEN + 1, "%s.%d", pFrame->szExpresssion, (unsigned int)pFrame->cbOffset) > HPP_VAR_NAME_MAX_LEN)
 										{	
 											apParseContext->eReturnReason = hppReturnReason_StructVarNameTooLong; 
 											break;
 										}
 									}
 									
-									strncpy(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, pchArray + cbOffset, HPP_VAR_NAME_MAX_LEN + 1);
-									szExpresssion = szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN;
-									szExpresssion[HPP_VAR_NAME_MAX_LEN] = 0;   // Make sure expressions are always zero terminated
+									strncpy(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, pFrame->pchArray + pFrame->cbOffset, HPP_VAR_NAME_MAX_LEN + 1);
+									pFrame->szExpresssion = pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN;
+									pFrame->szExpresssion[HPP_VAR_NAME_MAX_LEN] = 0;   // Make sure expressions are always zero terminated
 									break;
 								}
 											
-								if(chTerm == '=')  // Write array?
+								if(pFrame->chTerm == '=')  // Write array?
 								{
-									pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, ")]};", &chTerm);
-									if(pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_FatalError;
+									pFrame->eResumePoint = hppResumePoint_ArrayWrite;
+									if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, ")]};", &pFrame->chTerm)) goto parse_frame;
+									pchReturn = NULL;
+			resume_array_write:
+									pFrame->pchResult = pchReturn;
+									if(pFrame->pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_FatalError;
+
+									// Read array again. The right hand side or other tasks running in between may have changed it.
+									pFrame->pchArray = hppVarGetWritable(pFrame->szExpresssion, &cbLen);
+									if(pFrame->pchArray == NULL || cbLen < pFrame->cbOffset + pFrame->nSizeof)
+									{
+										if(apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_Error_UnknownVariable;
+										break;
+									}
 											
-									switch(nTypeID)
+									switch(pFrame->nTypeID)
 									{
-										case hppBinaryType_uint8:  	*(unsigned char*)(pchArray + cbOffset) = hppAtoI(pchResult); break;
-										case hppBinaryType_int8:   	*(signed char*)(pchArray + cbOffset) = hppAtoI(pchResult); break;
-										case hppBinaryType_uint16: 	*(uint16_t*)(pchArray + cbOffset) = hppAtoUI16(pchResult); break;
-										case hppBinaryType_int16:  	*(int16_t*)(pchArray + cbOffset) = hppAtoI16(pchResult); break;
-										case hppBinaryType_uint32: 	*(uint32_t*)(pchArray + cbOffset) = hppAtoUI32(pchResult); break;
-										case hppBinaryType_int32:  	*(int32_t*)(pchArray + cbOffset) = hppAtoI32(pchResult); break;
-										case hppBinaryType_bool:  	*(pchArray + cbOffset) = pchResult != NULL ? (strcmp(pchResult, "true") == 0 ? 1 : 0) : 0; break;
-										case hppBinaryType_float:  	*(float*)(pchArray + cbOffset) = hppAtoF(pchResult); break;
-										case hppBinaryType_double: 	{ 	double d = hppAtoF(pchResult);     // avoid alignment issue for ARM compiler
-																		memcpy(pchArray + cbOffset, &d, sizeof(double)); break; 
+										case hppBinaryType_uint8:  	*(unsigned char*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoI(pFrame->pchResult); break;
+										case hppBinaryType_int8:   	*(signed char*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoI(pFrame->pchResult); break;
+										case hppBinaryType_uint16: 	*(uint16_t*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoUI16(pFrame->pchResult); break;
+										case hppBinaryType_int16:  	*(int16_t*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoI16(pFrame->pchResult); break;
+										case hppBinaryType_uint32: 	*(uint32_t*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoUI32(pFrame->pchResult); break;
+										case hppBinaryType_int32:  	*(int32_t*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoI32(pFrame->pchResult); break;
+										case hppBinaryType_bool:  	*(pFrame->pchArray + pFrame->cbOffset) = pFrame->pchResult != NULL ? (strcmp(pFrame->pchResult, "true") == 0 ? 1 : 0) : 0; break;
+										case hppBinaryType_float:  	*(float*)(pFrame->pchArray + pFrame->cbOffset) = hppAtoF(pFrame->pchResult); break;
+										case hppBinaryType_double: 	{ 	double d = hppAtoF(pFrame->pchResult);     // avoid alignment issue for ARM compiler
+																		memcpy(pFrame->pchArray + pFrame->cbOffset, &d, sizeof(double)); break; 
 																	}
 					
-										case hppBinaryType_fixstr:  if(pchResult != NULL) strncpy(pchArray + cbOffset, pchResult, HPP_FIXSTR_MAX_LEN + 1);
-																	*(pchArray + cbOffset + HPP_FIXSTR_MAX_LEN) = 0; // truncate string
+										case hppBinaryType_fixstr:  if(pFrame->pchResult != NULL) strncpy(pFrame->pchArray + pFrame->cbOffset, pFrame->pchResult, HPP_FIXSTR_MAX_LEN + 1);
+																	*(pFrame->pchArray + pFrame->cbOffset + HPP_FIXSTR_MAX_LEN) = 0; // truncate string
 																	break;
 										default: break;									
 									}   
 								}
 								else       // Read array 
 								{
-									char szNumeric[HPP_NUMERIC_MAX_MEM];   
-					
-									switch(nTypeID)
+									switch(pFrame->nTypeID)
 									{
-										case hppBinaryType_uint8:  	hppI2A(szNumeric, *(unsigned char*)(pchArray + cbOffset)); break;
-										case hppBinaryType_int8:   	hppI2A(szNumeric, *(signed char*)(pchArray + cbOffset)); break;
-										case hppBinaryType_uint16: 	hppUI16toA(szNumeric, *(uint16_t*)(pchArray + cbOffset)); break;
-										case hppBinaryType_int16:  	hppI16toA(szNumeric, *(int16_t*)(pchArray + cbOffset)); break;
-										case hppBinaryType_uint32: 	hppUI32toA(szNumeric, *(uint32_t*)(pchArray + cbOffset)); break;
-										case hppBinaryType_int32:  	hppI32toA(szNumeric, *(int32_t*)(pchArray + cbOffset)); break;
-										case hppBinaryType_bool:  	strcpy(szNumeric, *(pchArray + cbOffset) == 0 ? "false" : "true"); break;
-										case hppBinaryType_float:  	hppD2A(szNumeric, *(float*)(pchArray + cbOffset)); break;
+										case hppBinaryType_uint8:  	hppI2A(szNumeric, *(unsigned char*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_int8:   	hppI2A(szNumeric, *(signed char*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_uint16: 	hppUI16toA(szNumeric, *(uint16_t*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_int16:  	hppI16toA(szNumeric, *(int16_t*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_uint32: 	hppUI32toA(szNumeric, *(uint32_t*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_int32:  	hppI32toA(szNumeric, *(int32_t*)(pFrame->pchArray + pFrame->cbOffset)); break;
+										case hppBinaryType_bool:  	strcpy(szNumeric, *(pFrame->pchArray + pFrame->cbOffset) == 0 ? "false" : "true"); break;
+										case hppBinaryType_float:  	hppD2A(szNumeric, *(float*)(pFrame->pchArray + pFrame->cbOffset)); break;
 										case hppBinaryType_double: 	{	double d;   // avoid alignment issue for ARM compiler 
-																		memcpy(&d, pchArray + cbOffset, sizeof(double));
+																		memcpy(&d, pFrame->pchArray + pFrame->cbOffset, sizeof(double));
 																		hppD2A(szNumeric, d); break;
 																	}
 																	
-										case hppBinaryType_fixstr:  pchResult = hppVarPutStr(aszResultVarKey, pchArray + cbOffset, &cbResultLen);
+										case hppBinaryType_fixstr:  pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, pFrame->pchArray + pFrame->cbOffset, &pFrame->cbResultLen);
 										default: *szNumeric = 0;										
 									}
 								
-									if(nTypeID != hppBinaryType_fixstr) pchResult = hppVarPutStr(aszResultVarKey, szNumeric, &cbResultLen);
-									if(pchResult == NULL && apParseContext->eReturnReason != hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_FatalError;
+									if(pFrame->nTypeID != hppBinaryType_fixstr) pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, szNumeric, &pFrame->cbResultLen);
+									if(pFrame->pchResult == NULL && apParseContext->eReturnReason != hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_FatalError;
 								}
 								break;
 			
 								// Initialze unkonwn variables having a questionmark in front; also works with arrays
-					case 'Q':	chTerm = hppGetExpression(apParseContext, szExpresssion, NULL, HPP_EXP_MAX_LEN);
-								if(islower((int)szExpresssion[0])) szExpresssion = szExpresssionWithPrefix;  // local variable or function 
+					case 'Q':	pFrame->chTerm = hppGetExpression(apParseContext, pFrame->szExpresssion, NULL, HPP_EXP_MAX_LEN);
+								if(islower((int)pFrame->szExpresssion[0])) pFrame->szExpresssion = pFrame->szExpresssionWithPrefix;  // local variable or function 
 
-								pchParam = hppVarGet(szExpresssion, NULL);
-								if(pchParam == NULL) hppVarPutStr(szExpresssion, "", &cbResultLen);
+								pchParam = hppVarGet(pFrame->szExpresssion, NULL);
+								if(pchParam == NULL) hppVarPutStr(pFrame->szExpresssion, "", &pFrame->cbResultLen);
 								break;
 				}
 			}
 				
 			if(apParseContext->eReturnReason != hppReturnReason_None) break;
 
-			if(pchResult == NULL) // Continue evaluating other L-value operators if no result has been assigned in the loop before  
+			if(pFrame->pchResult == NULL) // Continue evaluating other L-value operators if no result has been assigned in the loop before  
 			{
-				char chNewTerm = 32;    // Assign value to a avoid warning
+				chNewTerm = 32;    // Assign value to a avoid warning
 				
-				switch(chTerm)    // Unitary opertors evaluating the expression and storing in var 'aszResultVarKey'
+				switch(pFrame->chTerm)    // Unitary opertors evaluating the expression and storing in var 'aszResultVarKey'
 				{
 					case '(':  	while(isspace((int)apParseContext->szCode[apParseContext->cbPos])) (apParseContext->cbPos)++;    // Ignore white spaces such it can be checked if ')' immediately follows
 					
-								if(szExpresssion[0] == 0)    // Function call or just brackets?
+								if(pFrame->szExpresssion[0] == 0)    // Function call or just brackets?
 								{
-									pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, ")", &chTerm);
-									if(chTerm !=')' && apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_Error_ClosingBracketExpected;
+									pFrame->eResumePoint = hppResumePoint_Brackets;
+									if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, ")", &pFrame->chTerm)) goto parse_frame;
+									pchReturn = NULL;
+			resume_brackets:
+									pFrame->pchResult = pchReturn;
+									if(pFrame->chTerm !=')' && apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_Error_ClosingBracketExpected;
 								}
 								else
 								{
-									char szParamName[HPP_PARAM_PREFIX_LEN + 1];
-									char *pchLastParam = NULL;
-									enum hppControlStatusEnum eControlStatus = hppControlStatus_None;
-									size_t cbBoolExpPos = apParseContext->cbPos;
-									size_t cbBoolBehindExpPos;
-									sprintf(szParamName, HPP_PARAM_PREFIX, apParseContext->iCallDepth);
+									pFrame->pchLastParam = NULL;
+									pFrame->eControlStatus = hppControlStatus_None;
+									pFrame->cbBoolExpPos = apParseContext->cbPos;
+									sprintf(pFrame->szParamName, HPP_PARAM_PREFIX, apParseContext->iCallDepth);
 
-									if(strcmp(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, "if") == 0) eControlStatus = hppControlStatus_If;
-									else if(strcmp(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, "while") == 0) eControlStatus = hppControlStatus_While;
+									if(strcmp(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, "if") == 0) pFrame->eControlStatus = hppControlStatus_If;
+									else if(strcmp(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, "while") == 0) pFrame->eControlStatus = hppControlStatus_While;
 
 									do
 									{
-										apParseContext->cbPos = cbBoolExpPos;   // While may need to reevaluate the condition expression to tell if the loop shall continue  	
+										apParseContext->cbPos = pFrame->cbBoolExpPos;   // While may need to reevaluate the condition expression to tell if the loop shall continue  	
 										
 										if(apParseContext->szCode[apParseContext->cbPos] != ')')    // Verify if there is an argument at all
 										{
-											do pchLastParam = hppParseExpressionInt(apParseContext, szParamName, NULL, ",)", &chTerm);
-											while(chTerm ==',' && ++szParamName[HPP_PARAM_PREFIX_LEN - 1] <='9');
+											do 
+											{
+												pFrame->eResumePoint = hppResumePoint_Argument;
+												if(hppParseFramePush(apParseContext, pFrame->szParamName, NULL, ",)", &pFrame->chTerm)) goto parse_frame;
+												pchReturn = NULL;
+			resume_argument:
+												pFrame->pchLastParam = pchReturn;
+											}
+											while(pFrame->chTerm ==',' && ++pFrame->szParamName[HPP_PARAM_PREFIX_LEN - 1] <='9');
 										
-											if(chTerm !=')') 
+											if(pFrame->chTerm !=')') 
 											{
 												if(apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_Error_ClosingBracketExpected; 
 												break;   // Error
@@ -711,50 +1340,71 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 										}
 										else (apParseContext->cbPos)++;   // move behind the ')'
 										
-										cbBoolBehindExpPos = apParseContext->cbPos; // Store position behind the logic expression. This is used to igonre the code in case of the code after "continue;"
-										szParamName[HPP_PARAM_PREFIX_LEN - 1] = '1';  // Start over with first parameter 
+										pFrame->cbBoolBehindExpPos = apParseContext->cbPos; // Store position behind the logic expression. This is used to igonre the code in case of the code after "continue;"
+										pFrame->szParamName[HPP_PARAM_PREFIX_LEN - 1] = '1';  // Start over with first parameter 
 										
-										if(eControlStatus == hppControlStatus_None)   // is it a control structure or a fuction call?
+										if(pFrame->eControlStatus == hppControlStatus_None)   // is it a control structure or a fuction call?
 										{
 											// Build in function or method call?
-											if(strchr(szExpresssion, '.') == NULL) 
+											if(strchr(pFrame->szExpresssion, '.') == NULL) 
 											{
-												size_t iEntry = 0;
+												iEntry = 0;
 												
-												pchResult = hppEvaluateFuction(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, szParamName, aszResultVarKey, &cbResultLen);
+												pFrame->pchResult = hppEvaluateFuction(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, pFrame->szParamName, pFrame->szResultVarKey, &pFrame->cbResultLen);
 												
-												while(pchResult == NULL && iEntry < HPP_EXTERNAL_FUNCTION_LIBRARY_COUNT)
+												while(pFrame->pchResult == NULL && iEntry < HPP_EXTERNAL_FUNCTION_LIBRARY_COUNT)
 												{
-													szParamName[HPP_PARAM_PREFIX_LEN - 1] = '1';  // Start over with first parameter 
+													pFrame->szParamName[HPP_PARAM_PREFIX_LEN - 1] = '1';  // Start over with first parameter 
 													
 													if(hppExternalFunctions[iEntry] != NULL) 
-														pchResult = (hppExternalFunctions[iEntry])(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, szParamName, aszResultVarKey, &cbResultLen);
+														pFrame->pchResult = (hppExternalFunctions[iEntry])(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, pFrame->szParamName, pFrame->szResultVarKey, &pFrame->cbResultLen);
 														
 													iEntry++;
 												}
 											}		
-											else pchResult = hppEvaluateMethod(szExpresssion, szParamName, aszResultVarKey, &cbResultLen);
+											else pFrame->pchResult = hppEvaluateMethod(pFrame->szExpresssion, pFrame->szParamName, pFrame->szResultVarKey, &pFrame->cbResultLen);
+											
+											// Suspend the task if the function has called hppParseExpressionYield. The function result is 
+											// stored in the result variable by the time the task continues (e.g. when a timer has expired). 
+											if(apParseContext->bYielded)
+											{
+												apParseContext->bSuspended = true;
+												return NULL;
+			resume_yield:
+												pFrame->pchResult = hppVarGet(pFrame->szResultVarKey, &pFrame->cbResultLen);
+												if(pFrame->pchResult == NULL) pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, "", &pFrame->cbResultLen);
+											}
 											
-											if(pchResult == NULL)  // Not a build in function -> invoke H++ code ? 
+											if(pFrame->pchResult == NULL)  // Not a build in function -> invoke H++ code ? 
 											{  
-												const char* szCallingCode = apParseContext->szCode;
-												size_t cbCallingPosition = apParseContext->cbPos;
-												int iCallingFunctionCallDepth = apParseContext->iFunctionCallDepth; 
+												pFrame->szCallingCode = apParseContext->szCode;
+												pFrame->pCallingConstTable = apParseContext->pConstTable;
+												pFrame->cbCallingPosition = apParseContext->cbPos;
+												pFrame->iCallingFunctionCallDepth = apParseContext->iFunctionCallDepth; 
 												 
-												apParseContext->szCode = hppVarGet(szExpresssion, NULL);
+												apParseContext->szCode = hppVarGetCode(pFrame->szExpresssion, NULL);
 												// if no non-cap local var or cap global var was found, also try non-cap global var (from PUT or from flash)
-												if(apParseContext->szCode == NULL) apParseContext->szCode = hppVarGet(szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, NULL);
+												if(apParseContext->szCode == NULL) apParseContext->szCode = hppVarGetCode(pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, NULL);
+												apParseContext->pConstTable = hppVarGetConstTable(apParseContext->szCode);
 												apParseContext->cbPos = 0;
 												apParseContext->iFunctionCallDepth = apParseContext->iCallDepth;
 												 
 												if(apParseContext->szCode != NULL)
 												{
-													pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, "", NULL);
+													if(hppProfilerEnabled) hppProfilerEnter(&apParseContext->pProfilerCall, &pFrame->theProfilerCall, pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN);
+													
+													pFrame->eResumePoint = hppResumePoint_FunctionCall;
+													if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, "", NULL)) goto parse_frame;
+													pchReturn = NULL;
+			resume_function_call:
+													pFrame->pchResult = pchReturn;
+													
+													if(apParseContext->pProfilerCall == &pFrame->theProfilerCall) hppProfilerExit(&apParseContext->pProfilerCall, &pFrame->theProfilerCall);
 													
 													// Store Function Name if error occured and there was no function name stored earlier
 													if(apParseContext->eReturnReason >= HPP_ERROR_CODE_MIN && apParseContext->szErrorCallFunctionName[0] == 0)
 													{
-														strncpy(apParseContext->szErrorCallFunctionName, szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, HPP_CALL_FUNCTION_NAME_MAX_LEN);
+														strncpy(apParseContext->szErrorCallFunctionName, pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN, HPP_CALL_FUNCTION_NAME_MAX_LEN);
 														// set null byte at the end in case szExpression was too long
 														apParseContext->szErrorCallFunctionName[HPP_CALL_FUNCTION_NAME_MAX_LEN] = 0;
 														apParseContext->cbErrorCallFunctionPos = apParseContext->cbPos;
@@ -762,9 +1412,10 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 												}
 												else apParseContext->eReturnReason = hppReturnReason_Error_UnknownFunctionName;
 												
-												apParseContext->szCode = szCallingCode;
-												apParseContext->cbPos = cbCallingPosition;
-												apParseContext->iFunctionCallDepth = iCallingFunctionCallDepth;
+												apParseContext->szCode = pFrame->szCallingCode;
+												apParseContext->pConstTable = pFrame->pCallingConstTable;
+												apParseContext->cbPos = pFrame->cbCallingPosition;
+												apParseContext->iFunctionCallDepth = pFrame->iCallingFunctionCallDepth;
 												
 												if(apParseContext->eReturnReason == hppReturnReason_EOF ||
 												   apParseContext->eReturnReason == hppReturnReason_Return) apParseContext->eReturnReason = hppReturnReason_None;
@@ -775,138 +1426,159 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 										}
 										else     // control structure 
 										{	
-											if(pchLastParam == NULL)  // Argument missing?
+											if(pFrame->pchLastParam == NULL)  // Argument missing?
 											{
 												apParseContext->eReturnReason = hppReturnReason_Error_MissingArgument;
-												eControlStatus = hppControlStatus_Done;
+												pFrame->eControlStatus = hppControlStatus_Done;
 											}	
-											else if(strcmp(pchLastParam, "true") == 0) 
+											else if(strcmp(pFrame->pchLastParam, "true") == 0) 
 											{ 
 												apParseContext->eReturnReason = hppReturnReason_None;
-												pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, ";}", &chTerm);  // Temporary use of result variable
+												pFrame->eResumePoint = hppResumePoint_ControlBody;   // Temporary use of result variable
+												if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, ";}", &pFrame->chTerm)) goto parse_frame;
+												pchReturn = NULL;
+			resume_control_body:
+												pFrame->pchResult = pchReturn;
 												
-												if(eControlStatus == hppControlStatus_If) eControlStatus = hppControlStatus_Done;
+												if(pFrame->eControlStatus == hppControlStatus_If) pFrame->eControlStatus = hppControlStatus_Done;
 												else if(apParseContext->eReturnReason == hppReturnReason_Break) 
 												{ 
 													//chTerm = ';';   // break -> exit loop (done) but continue after the loop    
-													apParseContext->cbPos = cbBoolBehindExpPos; // Restore position behind logic expression
-													chTerm = hppIgnoreExpression(apParseContext);  // Ingore the following expression or codeblock
-													eControlStatus = hppControlStatus_Done;  // End Loop, no else
+													apParseContext->cbPos = pFrame->cbBoolBehindExpPos; // Restore position behind logic expression
+													pFrame->chTerm = hppIgnoreExpression(apParseContext);  // Ingore the following expression or codeblock
+													pFrame->eControlStatus = hppControlStatus_Done;  // End Loop, no else
 													apParseContext->eReturnReason = hppReturnReason_None;  // Continue code execusion after loop
 												}
 												else if(apParseContext->eReturnReason == hppReturnReason_Continue) 
 												{ 
 													apParseContext->eReturnReason = hppReturnReason_None; // Continue code execusion after loop
-													eControlStatus = hppControlStatus_Repeat;
+													pFrame->eControlStatus = hppControlStatus_Repeat;
 												}
-												else if(apParseContext->eReturnReason != hppReturnReason_None) eControlStatus = hppControlStatus_Done;
-												else eControlStatus = hppControlStatus_Repeat;  // no error
+												else if(apParseContext->eReturnReason != hppReturnReason_None) pFrame->eControlStatus = hppControlStatus_Done;
+												else pFrame->eControlStatus = hppControlStatus_Repeat;  // no error
 											}
 											else 
 											{
-												if(strcmp(pchLastParam, "false") != 0) 	
+												if(strcmp(pFrame->pchLastParam, "false") != 0) 	
 												{ 
 													apParseContext->eReturnReason = hppReturnReason_Error_BooleanValueExpected;
 													break;
 												}
 												
-												chTerm = hppIgnoreExpression(apParseContext); // Ingore the following expression or codeblock
-												if(eControlStatus == hppControlStatus_Repeat) eControlStatus = hppControlStatus_Done;
-												else eControlStatus = hppControlStatus_Else;
+												pFrame->chTerm = hppIgnoreExpression(apParseContext); // Ingore the following expression or codeblock
+												if(pFrame->eControlStatus == hppControlStatus_Repeat) pFrame->eControlStatus = hppControlStatus_Done;
+												else pFrame->eControlStatus = hppControlStatus_Else;
 											}
 										}
 									}
-									while(eControlStatus == hppControlStatus_Repeat);
+									while(pFrame->eControlStatus == hppControlStatus_Repeat);
 									
 									// Delete Paramters
-									szParamName[HPP_PARAM_PREFIX_LEN - 1] = 0;
-									hppVarDeleteAll(szParamName);
+									pFrame->szParamName[HPP_PARAM_PREFIX_LEN - 1] = 0;
+									hppVarDeleteAll(pFrame->szParamName);
 											
 									// Verify if there is an else branch if it was a control structure and no error occured		
-									if(eControlStatus != hppControlStatus_None && apParseContext->eReturnReason == hppReturnReason_None)
+									if(pFrame->eControlStatus != hppControlStatus_None && apParseContext->eReturnReason == hppReturnReason_None)
 									{
 										while(isspace((int)apParseContext->szCode[apParseContext->cbPos])) (apParseContext->cbPos)++;    // Ignore white spaces such we can check if "else" is the next code element
 							
 										if(strncmp(apParseContext->szCode + apParseContext->cbPos, "else", 4) == 0 && apParseContext->eReturnReason == hppReturnReason_None)
 										{
 											apParseContext->cbPos += 4;   // Continue behind 'else'
-											if(eControlStatus == hppControlStatus_Else) pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, ";}", &chTerm);  // Temporary use of result variable
-											else chTerm = hppIgnoreExpression(apParseContext);
+											if(pFrame->eControlStatus == hppControlStatus_Else) 
+											{
+												pFrame->eResumePoint = hppResumePoint_ElseBody;   // Temporary use of result variable
+												if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, ";}", &pFrame->chTerm)) goto parse_frame;
+												pchReturn = NULL;
+			resume_else_body:
+												pFrame->pchResult = pchReturn;
+											}
+											else pFrame->chTerm = hppIgnoreExpression(apParseContext);
 										}
 										
-										chTerm = 32;
+										pFrame->chTerm = 32;
 										continue;  // Expression stops here. Return to main loop for next expression 
 									}
 								}
 
 								if(apParseContext->eReturnReason == hppReturnReason_None) 
 								{	
-									chTerm = hppGetOperator(apParseContext);
-									if(chTerm == 'M') apParseContext->eReturnReason = hppReturnReason_Error_CannotCallMethodOnResult;  // Nesting of method calls is not supported
+									pFrame->chTerm = hppGetOperator(apParseContext);
+									if(pFrame->chTerm == 'M') apParseContext->eReturnReason = hppReturnReason_Error_CannotCallMethodOnResult;  // Nesting of method calls is not supported
 								}
 								break;
 
-					case '=':   pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, ")]};", &chTerm);
-								hppVarPut(szExpresssion, pchResult, cbResultLen);
+					case '=':   pFrame->eResumePoint = hppResumePoint_Assignment;
+								if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, ")]};", &pFrame->chTerm)) goto parse_frame;
+								pchReturn = NULL;
+			resume_assignment:
+								pFrame->pchResult = pchReturn;
+								hppVarPut(pFrame->szExpresssion, pFrame->pchResult, pFrame->cbResultLen);
 								break;
 								 
 					case 'B':   // Operator '{' result is the the result of the last expression inside the brackets or after return operator
-								pchResult = hppParseExpressionInt(apParseContext, aszResultVarKey, &cbResultLen, "}", &chTerm); 
+								pFrame->eResumePoint = hppResumePoint_CodeBlock;
+								if(hppParseFramePush(apParseContext, pFrame->szResultVarKey, &pFrame->cbResultLen, "}", &pFrame->chTerm)) goto parse_frame;
+								pchReturn = NULL;
+			resume_code_block:
+								pFrame->pchResult = pchReturn;
 								break;
 								
 					case 'i':   // Leading '++' or '--' operator
-					case 'd':	chNewTerm = hppGetExpression(apParseContext, szExpresssion, NULL, HPP_EXP_MAX_LEN);
-								if(islower((int)szExpresssion[0])) szExpresssion = szExpresssionWithPrefix;  // local variable or function
+					case 'd':	chNewTerm = hppGetExpression(apParseContext, pFrame->szExpresssion, NULL, HPP_EXP_MAX_LEN);
+								if(islower((int)pFrame->szExpresssion[0])) pFrame->szExpresssion = pFrame->szExpresssionWithPrefix;  // local variable or function
 								 
 					case 'I':   // Trailing '++' or '--' operator
-					case 'D':  	pchResult = hppVarGet(szExpresssion, &cbResultLen);
-								if(pchResult != NULL)
+					case 'D':  	pFrame->pchResult = hppVarGet(pFrame->szExpresssion, &pFrame->cbResultLen);
+								if(pFrame->pchResult != NULL)
 								{
-									char szNumeric[HPP_NUMERIC_MAX_MEM];   // 12 numbers => max 19 characters + null byte: -1.23456789012+e123
-									double dResult = hppAtoF(pchResult);
-									if(chTerm == 'D' || chTerm == 'd') dResult--;
+									double dResult = hppAtoF(pFrame->pchResult);
+									if(pFrame->chTerm == 'D' || pFrame->chTerm == 'd') dResult--;
 									else  dResult++;
 									
-									if(chTerm == 'I' || chTerm == 'D')   // Trailing -> Put 'aszResultVarKey' with old value first 
+									if(pFrame->chTerm == 'I' || pFrame->chTerm == 'D')   // Trailing -> Put 'aszResultVarKey' with old value first 
 									{
-										pchResult = hppVarPut(aszResultVarKey, pchResult, cbResultLen);
-										hppVarPutStr(szExpresssion, hppD2A(szNumeric, dResult), &cbResultLen);
+										pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, pFrame->pchResult, pFrame->cbResultLen);
+										hppVarPutStr(pFrame->szExpresssion, hppD2A(szNumeric, dResult), &pFrame->cbResultLen);
 										chNewTerm = hppGetOperator(apParseContext);
 									}
 									else  // Leading -> Variable in 'szExpresssion' and in 'aszResultVarKey' get the same new value
 									{
-										pchResult = hppVarPutStr(szExpresssion, hppD2A(szNumeric, dResult), &cbResultLen);
-										pchResult = hppVarPut(aszResultVarKey, pchResult, cbResultLen);
+										pFrame->pchResult = hppVarPutStr(pFrame->szExpresssion, hppD2A(szNumeric, dResult), &pFrame->cbResultLen);
+										pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, pFrame->pchResult, pFrame->cbResultLen);
 									}
 								}
 								else apParseContext->eReturnReason = hppReturnReason_Error_UnknownVariable;
 								
-								chTerm = chNewTerm;
+								pFrame->chTerm = chNewTerm;
 								break;
 								
-					case 'R':	chTerm = hppGetExpression(apParseContext, szExpresssion, NULL, HPP_EXP_MAX_LEN);
-								if(islower((int)szExpresssion[0])) szExpresssion = szExpresssionWithPrefix;  // local variable or function
+					case 'R':	pFrame->chTerm = hppGetExpression(apParseContext, pFrame->szExpresssion, NULL, HPP_EXP_MAX_LEN);
+								if(islower((int)pFrame->szExpresssion[0])) pFrame->szExpresssion = pFrame->szExpresssionWithPrefix;  // local variable or function
 							
-								pchResult = hppVarPutStr(aszResultVarKey, szExpresssion, &cbResultLen);
+								pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, pFrame->szExpresssion, &pFrame->cbResultLen);
 								break;
 			
 
 					default:	do
 								{
-									if(szExpresssion == szExpresssionWithPrefix)       // Check if it is a keyword to variable
+									if(pFrame->szExpresssion == pFrame->szExpresssionWithPrefix)       // Check if it is a keyword to variable
 									{
-										char *szExpresssionBehindPrefix = szExpresssion + HPP_EXP_LOCAL_VAL_PREFIX_LEN;
+										szExpresssionBehindPrefix = pFrame->szExpresssion + HPP_EXP_LOCAL_VAL_PREFIX_LEN;
 										
-										if(strcmp(szExpresssionBehindPrefix, "true") == 0 )   { pchResult = hppVarPutStr(aszResultVarKey, "true", &cbResultLen); break; }
-										if(strcmp(szExpresssionBehindPrefix, "false") == 0 )  { pchResult = hppVarPutStr(aszResultVarKey, "false", &cbResultLen); break; }
+										if(strcmp(szExpresssionBehindPrefix, "true") == 0 )   { pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, "true", &pFrame->cbResultLen); break; }
+										if(strcmp(szExpresssionBehindPrefix, "false") == 0 )  { pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, "false", &pFrame->cbResultLen); break; }
 										
 										if(strcmp(szExpresssionBehindPrefix, "return") == 0 ) 
 										{ 
-											pchResult = hppParseExpressionInt(apParseContext, szExpresssion, &cbResultLen, ";", &chTerm);
-											pchResult = hppVarPut(aszResultVarKey, pchResult, cbResultLen);
+											pFrame->eResumePoint = hppResumePoint_Return;
+											if(hppParseFramePush(apParseContext, pFrame->szExpresssion, &pFrame->cbResultLen, ";", &pFrame->chTerm)) goto parse_frame;
+											pchReturn = NULL;
+			resume_return:
+											pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, pchReturn, pFrame->cbResultLen);
 											if(apParseContext->eReturnReason == hppReturnReason_None)
 											{
-												if(chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Return;
+												if(pFrame->chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Return;
 												else apParseContext->eReturnReason = hppReturnReason_Error_SemicolonExpected; 
 											}
 											break;
@@ -914,22 +1586,22 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 										
 										if(strcmp(szExpresssionBehindPrefix, "break") == 0) 
 										{ 
-											if(chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Break;
+											if(pFrame->chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Break;
 											else apParseContext->eReturnReason = hppReturnReason_Error_SemicolonExpected;
 											break;
 										}
 										
 										if(strcmp(szExpresssionBehindPrefix, "continue") == 0) 
 										{ 
-											if(chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Continue;
+											if(pFrame->chTerm == ';') apParseContext->eReturnReason = hppReturnReason_Continue;
 											else apParseContext->eReturnReason = hppReturnReason_Error_SemicolonExpected;
 											break;
 										}
 							
 									}	
 									
-									pchResult = hppVarGet(szExpresssion, &cbResultLen);    // Read variable
-									if(pchResult != NULL) pchResult = hppVarPut(aszResultVarKey, pchResult, cbResultLen);
+									pFrame->pchResult = hppVarGet(pFrame->szExpresssion, &pFrame->cbResultLen);    // Read variable
+									if(pFrame->pchResult != NULL) pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, pFrame->pchResult, pFrame->cbResultLen);
 									else apParseContext->eReturnReason = hppReturnReason_Error_UnknownVariable;
 									
 								} while(false);
@@ -938,103 +1610,126 @@ char* hppParseExpressionInt(struct hppParseExpressionStruct* apParseContext, con
 		}
 			
 		// Binary operators 
-		if(pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None)
+		if(pFrame->pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None)
 			apParseContext->eReturnReason = hppReturnReason_FatalError;   // hppVarPutStr could fail due to no memory   
 		else 
 		{
-			char szSecondOpName[HPP_SECOND_OP_PREFIX_LEN + 1];
-			sprintf(szSecondOpName, HPP_SECOND_OP_PREFIX, apParseContext->iCallDepth);
+			sprintf(pFrame->szSecondOpName, HPP_SECOND_OP_PREFIX, apParseContext->iCallDepth);
 			
-			while(strchr(aszTerminatingOperators, chTerm) == NULL && apParseContext->eReturnReason == hppReturnReason_None && chTerm != ';')
+			while(strchr(pFrame->szTerminatingOperators, pFrame->chTerm) == NULL && apParseContext->eReturnReason == hppReturnReason_None && pFrame->chTerm != ';')
 			{
-				char szNumeric[HPP_NUMERIC_MAX_MEM];   // 12 numbers => max 19 characters + null byte: -1.23456789012+e123
-				char *pchSecondOperand;
-				size_t cbSecondOperandLen;
-				const char* hppTerminatingOperators = "%/*-+~<>GSUE&^|AO=)]},;";
-				char chNextTerm;
-							
-				hppTerminatingOperators = strchr(hppTerminatingOperators, chTerm);        // Get terminating operators in line  with operator priority
+				hppTerminatingOperators = strchr(hppOperatorPriority, pFrame->chTerm);        // Get terminating operators in line  with operator priority
 				if(hppTerminatingOperators == NULL) { apParseContext->eReturnReason = hppReturnReason_Error_InvalidOperator; break; }    // Invalid operator?
 
 				if(hppTerminatingOperators[0] == '*') hppTerminatingOperators -= 2;       // '%/*' have same priority; '/' handled below
 				if(strchr("+/E", hppTerminatingOperators[0]) != NULL) hppTerminatingOperators--;  // '+/E' have same priotity like '-%U' respectively     
 			
-				pchSecondOperand = hppParseExpressionInt(apParseContext, szSecondOpName, &cbSecondOperandLen, hppTerminatingOperators, &chNextTerm);
+				pFrame->eResumePoint = hppResumePoint_SecondOperand;
+				if(hppParseFramePush(apParseContext, pFrame->szSecondOpName, &pFrame->cbSecondOperandLen, hppTerminatingOperators, &pFrame->chNextTerm)) goto parse_frame;
+				pchReturn = NULL;
+			resume_second_operand:
+				pchSecondOperand = pchReturn;
+				if(!bReturnConstant) pFrame->bConstant = false;
+				pFrame->bFolded = true;
 				if(apParseContext->eReturnReason != hppReturnReason_None) break;
 
-				switch(chTerm)
+				switch(pFrame->chTerm)
 				{
-					case '+':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoF(pchResult) + hppAtoF(pchSecondOperand)), &cbResultLen);
+					case '+':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoF(pFrame->pchResult) + hppAtoF(pchSecondOperand)), &pFrame->cbResultLen);
 								break;
-					case '-':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoF(pchResult) - hppAtoF(pchSecondOperand)), &cbResultLen);
+					case '-':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoF(pFrame->pchResult) - hppAtoF(pchSecondOperand)), &pFrame->cbResultLen);
 								break;
-					case '*':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoF(pchResult) * hppAtoF(pchSecondOperand)), &cbResultLen);
+					case '*':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoF(pFrame->pchResult) * hppAtoF(pchSecondOperand)), &pFrame->cbResultLen);
 								break;
 					case '/':	if(hppAtoF(pchSecondOperand) == 0.0f) apParseContext->eReturnReason = hppReturnReason_Error_DivisionByZero;
-								else pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoF(pchResult) / hppAtoF(pchSecondOperand)), &cbResultLen);									
+								else pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoF(pFrame->pchResult) / hppAtoF(pchSecondOperand)), &pFrame->cbResultLen);									
 								break;
 					case '%':	if(hppAtoI(pchSecondOperand) == 0) apParseContext->eReturnReason = hppReturnReason_Error_DivisionByZero;
-								else pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoI(pchResult) % hppAtoI(pchSecondOperand)), &cbResultLen);									
+								else pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoI(pFrame->pchResult) % hppAtoI(pchSecondOperand)), &pFrame->cbResultLen);									
 								break;
-					case '&':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoI(pchResult) & hppAtoI(pchSecondOperand)), &cbResultLen);									
+					case '&':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoI(pFrame->pchResult) & hppAtoI(pchSecondOperand)), &pFrame->cbResultLen);									
 								break;
-					case '|':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoI(pchResult) | hppAtoI(pchSecondOperand)), &cbResultLen);									
+					case '|':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoI(pFrame->pchResult) | hppAtoI(pchSecondOperand)), &pFrame->cbResultLen);									
 								break;
-					case '^':	pchResult = hppVarPutStr(aszResultVarKey, hppD2A(szNumeric, hppAtoI(pchResult) ^ hppAtoI(pchSecondOperand)), &cbResultLen);									
+					case '^':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppD2A(szNumeric, hppAtoI(pFrame->pchResult) ^ hppAtoI(pchSecondOperand)), &pFrame->cbResultLen);									
 								break;
-					case 'E':	if(cbResultLen != cbSecondOperandLen) pchResult = hppVarPutStr(aszResultVarKey, "false", &cbResultLen);
-								else pchResult = hppVarPutStr(aszResultVarKey, memcmp(pchResult, pchSecondOperand, cbResultLen) == 0 ? "true": "false", &cbResultLen);
+					case 'E':	if(pFrame->cbResultLen != pFrame->cbSecondOperandLen) pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, "false", &pFrame->cbResultLen);
+								else pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, memcmp(pFrame->pchResult, pchSecondOperand, pFrame->cbResultLen) == 0 ? "true": "false", &pFrame->cbResultLen);
 								break;
-					case 'U':	if(cbResultLen != cbSecondOperandLen) pchResult = hppVarPutStr(aszResultVarKey, "true", &cbResultLen);
-								else pchResult = hppVarPutStr(aszResultVarKey, memcmp(pchResult, pchSecondOperand, cbResultLen) == 0 ? "false": "true", &cbResultLen);
+					case 'U':	if(pFrame->cbResultLen != pFrame->cbSecondOperandLen) pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, "true", &pFrame->cbResultLen);
+								else pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, memcmp(pFrame->pchResult, pchSecondOperand, pFrame->cbResultLen) == 0 ? "false": "true", &pFrame->cbResultLen);
 								break;			
-					case '<':	pchResult = hppVarPutStr(aszResultVarKey, hppAtoF(pchResult) < hppAtoF(pchSecondOperand) ? "true": "false", &cbResultLen);
+					case '<':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppAtoF(pFrame->pchResult) < hppAtoF(pchSecondOperand) ? "true": "false", &pFrame->cbResultLen);
 								break;
-					case '>':	pchResult = hppVarPutStr(aszResultVarKey, hppAtoF(pchResult) > hppAtoF(pchSecondOperand) ? "true": "false", &cbResultLen);
+					case '>':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppAtoF(pFrame->pchResult) > hppAtoF(pchSecondOperand) ? "true": "false", &pFrame->cbResultLen);
 								break;			
-					case 'S':	pchResult = hppVarPutStr(aszResultVarKey, hppAtoF(pchResult) <= hppAtoF(pchSecondOperand) ? "true": "false", &cbResultLen);
+					case 'S':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppAtoF(pFrame->pchResult) <= hppAtoF(pchSecondOperand) ? "true": "false", &pFrame->cbResultLen);
 								break;
-					case 'G':	pchResult = hppVarPutStr(aszResultVarKey, hppAtoF(pchResult) >= hppAtoF(pchSecondOperand) ? "true": "false", &cbResultLen);
+					case 'G':	pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, hppAtoF(pFrame->pchResult) >= hppAtoF(pchSecondOperand) ? "true": "false", &pFrame->cbResultLen);
 								break;
 												
 					case 'O':	// For logic operators '&&' and '||' we assume both operands are either 'true' or 'false'
-					case 'A':	if(strcmp(pchResult, "true") != 0 && strcmp(pchResult, "false") != 0) apParseContext->eReturnReason = hppReturnReason_Error_FirstOperand_BooleanValueExpected;
+					case 'A':	if(strcmp(pFrame->pchResult, "true") != 0 && strcmp(pFrame->pchResult, "false") != 0) apParseContext->eReturnReason = hppReturnReason_Error_FirstOperand_BooleanValueExpected;
 								if(strcmp(pchSecondOperand, "true") != 0 && strcmp(pchSecondOperand, "false") != 0) apParseContext->eReturnReason = hppReturnReason_Error_SecondOperand_BooleanValueExpected;
-								if(chTerm == 'A') pchResult = hppVarPutStr(aszResultVarKey, (*pchResult == 't' && *pchSecondOperand == 't') ? "true": "false", &cbResultLen);
-								if(chTerm == 'O') pchResult = hppVarPutStr(aszResultVarKey, (*pchResult == 't' || *pchSecondOperand == 't') ? "true": "false", &cbResultLen);
+								if(pFrame->chTerm == 'A') pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, (*pFrame->pchResult == 't' && *pchSecondOperand == 't') ? "true": "false", &pFrame->cbResultLen);
+								if(pFrame->chTerm == 'O') pFrame->pchResult = hppVarPutStr(pFrame->szResultVarKey, (*pFrame->pchResult == 't' || *pchSecondOperand == 't') ? "true": "false", &pFrame->cbResultLen);
 								break;	
 								
-					case '~':	pchResult = hppVarPut(aszResultVarKey, hppNoInitValue, cbResultLen + cbSecondOperandLen);
-								if(pchResult != NULL) memcpy(pchResult + cbResultLen, pchSecondOperand, cbSecondOperandLen);
-								cbResultLen += cbSecondOperandLen;  
+					case '~':	pFrame->pchResult = hppVarPut(pFrame->szResultVarKey, hppNoInitValue, pFrame->cbResultLen + pFrame->cbSecondOperandLen);
+								if(pFrame->pchResult != NULL) memcpy(pFrame->pchResult + pFrame->cbResultLen, pchSecondOperand, pFrame->cbSecondOperandLen);
+								pFrame->cbResultLen += pFrame->cbSecondOperandLen;  
 								break;					
 				}
 
-				chTerm = chNextTerm;
+				pFrame->chTerm = pFrame->chNextTerm;
 			
-				if(pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None)
+				if(pFrame->pchResult == NULL && apParseContext->eReturnReason == hppReturnReason_None)
 					apParseContext->eReturnReason = hppReturnReason_FatalError;   // hppVarPutStr could fail due to no memory  
 			}
 			
-			hppVarDelete(szSecondOpName);
+			hppVarDelete(pFrame->szSecondOpName);
 		}	
 	}
 	
+	if(pFrame->bConstant) hppConstCachePut(apParseContext, pFrame);
 	
+parse_frame_done:
 	apParseContext->iCallDepth--;
 	
 	if(apParseContext->iFunctionCallDepth == apParseContext->iCallDepth)
 	{
-		szExpresssionWithPrefix[HPP_EXP_LOCAL_VAL_PREFIX_LEN] = 0;
-		hppVarDeleteAll(szExpresssionWithPrefix);  // delete local variables
+		pFrame->szExpresssionWithPrefix[HPP_EXP_LOCAL_VAL_PREFIX_LEN] = 0;
+		hppVarDeleteAll(pFrame->szExpresssionWithPrefix);  // delete local variables
 	}
 	
-	// free(szExpresssionWithPrefix);
-	apParseContext->szExpressionStackPointer = szExpressionStackPointerBuf;   // Restore expression stack level
-	if(apchTerminatingOperator_Out != NULL) *apchTerminatingOperator_Out = chTerm;
-	if(apcbResultLen_Out != NULL) *apcbResultLen_Out = cbResultLen;
+	apParseContext->szExpressionStackPointer = pFrame->szExpressionStackPointerBuf;   // Restore expression stack level
+	if(pFrame->pchTerminatingOperator_Out != NULL) *pFrame->pchTerminatingOperator_Out = pFrame->chTerm;
+	if(pFrame->pcbResultLen_Out != NULL) *pFrame->pcbResultLen_Out = pFrame->cbResultLen;
+	pchReturn = pFrame->pchResult;
+	bReturnConstant = pFrame->bConstant && apParseContext->eReturnReason == hppReturnReason_None;
+
+parse_frame_return:
+	// Return to the calling frame and continue behind the point where the frame has been pushed
+	pFrame = hppParseFramePop(apParseContext);
+	if(pFrame == NULL) return pchReturn;
+
+	switch(pFrame->eResumePoint)
+	{
+		case hppResumePoint_AngleBrackets:	goto resume_angle_brackets;
+		case hppResumePoint_ArrayIndex:		goto resume_array_index;
+		case hppResumePoint_ArrayWrite:		goto resume_array_write;
+		case hppResumePoint_Brackets:		goto resume_brackets;
+		case hppResumePoint_Argument:		goto resume_argument;
+		case hppResumePoint_FunctionCall:	goto resume_function_call;
+		case hppResumePoint_ControlBody:	goto resume_control_body;
+		case hppResumePoint_ElseBody:		goto resume_else_body;
+		case hppResumePoint_Assignment:		goto resume_assignment;
+		case hppResumePoint_CodeBlock:		goto resume_code_block;
+		case hppResumePoint_Return:			goto resume_return;
+		case hppResumePoint_SecondOperand:	goto resume_second_operand;
+	}
 
-	return pchResult;
+	return NULL;
 }
 
 
@@ -1052,80 +1747,401 @@ void hppTestFloatPrint()
 }
 
 
-// Parse H++ code in 'aszCode' and store return value in the variable 'aszResultVarKey'. Returns a pointer to
-// the char array assoziated with that variable 'aszResultVarKey'.
-// If the string value of 'aszResultVarKey' equals "ReturnWithError", an error text is created in cas of a parse
-// error. Otherwise the result in NULL in case of a parse error.
-char* hppParseExpression(const char* aszCode, const char* aszResultVarKey)
+// Release the parse context 'apParseContext' including its expression stack and all frames
+static void hppParseContextFree(struct hppParseExpressionStruct* apParseContext)
+{
+	struct hppParseFrameStruct* pFrame;
+	
+	if(apParseContext == NULL) return;
+	
+	while(apParseContext->pFrame != NULL) hppParseFramePop(apParseContext);
+	
+	while(apParseContext->pFreeFrames != NULL)
+	{
+		pFrame = apParseContext->pFreeFrames;
+		apParseContext->pFreeFrames = pFrame->pParent;
+		free(pFrame);
+	}
+
+	hppVarConstTableClear(&apParseContext->mConstTable);
+	hppVarScratchRelease(&apParseContext->mScratchArena, false);
+	free(apParseContext->szExpressionStack);	
+	free(apParseContext);
+}
+
+
+// Returns true if the name of the result variable 'aszResultVarKey' behind an optional prefix ending with ':' equals 'aszName'
+static bool hppIsResultVarName(const char* aszResultVarKey, const char* aszName)
+{
+	const char* pchName = strrchr(aszResultVarKey, ':');
+	
+	if(pchName == NULL) pchName = aszResultVarKey;
+	else pchName++;
+	
+	return strcmp(pchName, aszName) == 0;
+}
+
+
+// Prepare parsing of the H++ code in 'aszCode' as a task which is executed in one or more slices with hppParseExpressionContinue.
+// The return value is stored in the variable 'aszResultVarKey' which must remain valid until hppParseExpressionEnd is called.
+// Local variables of the task use the call depth 'auiLocalBase' and above for their prefix. Tasks running interleaved must use
+// distinct bases. Local variables of call depth zero (e.g. injected parameters) are moved to the base of the task.
+// Returns NULL if not successful.
+struct hppParseExpressionStruct* hppParseExpressionBegin(const char* aszCode, const char* aszResultVarKey, unsigned int auiLocalBase)
 {
-	char* pchResult;
 	struct hppParseExpressionStruct* theParseContext;
+	char* szExpressionStack;
+	struct hppParseFrameStruct* pFreeFrames;
+	struct hppVarScratchArenaStruct mScratchArena;
+	char szPrefix[HPP_EXP_LOCAL_VAL_PREFIX_LEN + 1];
+	char szNewPrefix[HPP_EXP_LOCAL_VAL_PREFIX_LEN + 1];
 
 	if(aszCode == NULL || aszResultVarKey == NULL) return NULL;
-	theParseContext = (struct hppParseExpressionStruct*)malloc(sizeof(struct hppParseExpressionStruct));
-	if(theParseContext == NULL) return NULL;
+	if(auiLocalBase >= HPP_MAX_CALL_DEPTH_LIMIT) return NULL;
+	
+	// Reuse the context, the expression stack, the frames and the scratch arena of the last execution if the stack size did not 
+	// change. Typical handlers then do not need any heap operation for the parser state and their temporary variables.
+	if(hppSpareParseContext != NULL && hppSpareParseContext->cbExpressionStackSize == hppExpressionStackSize)
+	{
+		theParseContext = hppSpareParseContext;
+		hppSpareParseContext = NULL;
+		szExpressionStack = theParseContext->szExpressionStack;
+		pFreeFrames = theParseContext->pFreeFrames;
+		mScratchArena = theParseContext->mScratchArena;
+	}
+	else
+	{
+		hppParseContextFree(hppSpareParseContext);
+		hppSpareParseContext = NULL;
+		
+		theParseContext = (struct hppParseExpressionStruct*)malloc(sizeof(struct hppParseExpressionStruct));
+		if(theParseContext == NULL) return NULL;
+		szExpressionStack = (char*)malloc(hppExpressionStackSize);
+		if(szExpressionStack == NULL) { free(theParseContext); return NULL; }
+		pFreeFrames = NULL;
+		memset(&mScratchArena, 0, sizeof(struct hppVarScratchArenaStruct));
+	}
+	
 	memset(theParseContext, 0, sizeof(struct hppParseExpressionStruct));
 	theParseContext->szCode = aszCode;
+	theParseContext->pConstTable = hppVarGetConstTable(aszCode);
+	if(theParseContext->pConstTable == NULL) theParseContext->pConstTable = &theParseContext->mConstTable;   // Code of no variable
+	theParseContext->szTaskCode = aszCode;
+	theParseContext->szResultVarKey = aszResultVarKey;
 	theParseContext->eReturnReason = hppReturnReason_None;
-	theParseContext->szExpressionStack = (char*)malloc(HPP_EXP_STACK_SIZE);
+	theParseContext->uiLocalBase = auiLocalBase;
+	theParseContext->iCallDepth = auiLocalBase;
+	theParseContext->iFunctionCallDepth = auiLocalBase;
+	theParseContext->uiMaxCallDepth = hppMaxCallDepth;
+	if(theParseContext->uiMaxCallDepth > HPP_MAX_CALL_DEPTH_LIMIT - auiLocalBase) theParseContext->uiMaxCallDepth = HPP_MAX_CALL_DEPTH_LIMIT - auiLocalBase;  // Prefix must keep 4 digits
+	theParseContext->cbExpressionStackSize = hppExpressionStackSize;
+	theParseContext->szExpressionStack = szExpressionStack;
 	theParseContext->szExpressionStackPointer = theParseContext->szExpressionStack;
-	if(theParseContext->szExpressionStack == NULL) { free(theParseContext); return NULL; }
+	theParseContext->pFreeFrames = pFreeFrames;
+	theParseContext->mScratchArena = mScratchArena;
 	*theParseContext->szExpressionStack = 0;   // Stack starts as empty string
 	
+	if(!hppParseFramePush(theParseContext, aszResultVarKey, NULL, "", NULL))
+	{
+		hppParseContextFree(theParseContext);
+		return NULL;
+	}
+	
+	if(auiLocalBase != 0)
+	{
+		sprintf(szPrefix, HPP_EXP_LOCAL_VAL_PREFIX, 0);
+		sprintf(szNewPrefix, HPP_EXP_LOCAL_VAL_PREFIX, auiLocalBase);
+		hppVarRenameAll(szPrefix, szNewPrefix);
+	}
+
+	theParseContext->uiCodeChangeCount = hppVarCodeChangeCount;
 	hppTestFloatPrint();
-	if(hppExternalPollFunction != NULL) hppExternalPollFunction(theParseContext, hppExternalPollFunctionEvent_Begin);  // Initialize external poll function, e.g. timer
+	
+	return theParseContext;
+}
 
-	pchResult = hppParseExpressionInt(theParseContext, aszResultVarKey, NULL, "", NULL);
+
+// Returns true if the code of a function called by the suspended task 'apParseContext' or the code of the task itself has been 
+// updated or deleted since the end of its last slice. Frames waiting for a called function know the code of the caller.
+static bool hppParseIsCodeChanged(const struct hppParseExpressionStruct* apParseContext)
+{
+	const struct hppParseFrameStruct* pFrame;
+	const char* szCode = apParseContext->szCode;
+
+	// The resume point of the frame on top is not valid since it does not wait for any other frame
+	for(pFrame = apParseContext->pFrame != NULL ? apParseContext->pFrame->pParent : NULL; pFrame != NULL; pFrame = pFrame->pParent)
+	{
+		if(pFrame->eResumePoint != hppResumePoint_FunctionCall) continue;
+		if(!hppVarIsCodeUnchanged(szCode, apParseContext->uiCodeChangeCount)) return true;
+		szCode = pFrame->szCallingCode;
+	}
+
+	return apParseContext->szTaskCode != NULL && !hppVarIsCodeUnchanged(apParseContext->szTaskCode, apParseContext->uiCodeChangeCount);
+}
+
+
+// Continue parsing the task 'apParseContext' created with hppParseExpressionBegin. Parsing is suspended after 'auiTickBudget' 
+// expressions have been evaluated. A budget of zero continues until the end of the code. 
+// Returns true if parsing has finished and false if it has been suspended. 
+bool hppParseExpressionContinue(struct hppParseExpressionStruct* apParseContext, unsigned int auiTickBudget)
+{
+	struct hppParseExpressionStruct* pCallingParseContext;
+	struct hppVarScratchArenaStruct* pCallingScratchArena;
 	
-	if(hppExternalPollFunction != NULL) hppExternalPollFunction(theParseContext, hppExternalPollFunctionEvent_End);    // Terminate external poll function activities
+	if(apParseContext == NULL) return true;
+	if(apParseContext->pFrame == NULL) return true;   // Finished already
+
+	// The code of the task or of a called function may have been deleted or replaced while the task was suspended. 
+	// Positions in the code are not valid anymore in this case. The frames are unwound without evaluating any code.
+	// Changes of code the task does not execute do not matter.
+	if(apParseContext->bSuspended && apParseContext->uiCodeChangeCount != hppVarCodeChangeCount && hppParseIsCodeChanged(apParseContext)) 
+		apParseContext->eReturnReason = hppReturnReason_Error_CodeChanged;
+
+	apParseContext->bSuspended = false;
+	apParseContext->uiSliceTickBudget = auiTickBudget;
+	apParseContext->uiSliceTickCount = 0;
+	
+	if(hppExternalPollFunction != NULL) hppExternalPollFunction(apParseContext, hppExternalPollFunctionEvent_Begin);  // Initialize external poll function, e.g. timer
+
+	// Function calls in progress do not include the time the task has been suspended
+	if(apParseContext->pProfilerCall != NULL) hppProfilerContinue(apParseContext->pProfilerCall);
+
+	// Tasks may be continued from a function called by another task, e.g. by hppParseExpressionEnd
+	pCallingParseContext = hppCurrentParseContext;
+	hppCurrentParseContext = apParseContext;
+	pCallingScratchArena = hppVarScratchSelect(&apParseContext->mScratchArena);
+	apParseContext->pchResult = hppParseExpressionInt(apParseContext);
+	hppVarScratchSelect(pCallingScratchArena);
+	hppCurrentParseContext = pCallingParseContext;
+	
+	if(apParseContext->pProfilerCall != NULL) hppProfilerSuspend(apParseContext->pProfilerCall);
+	
+	if(hppExternalPollFunction != NULL) hppExternalPollFunction(apParseContext, hppExternalPollFunctionEvent_End);    // Terminate external poll function activities
+
+	// Code of the task which is not the value of a variable (e.g. a copy of a text) cannot be changed by others
+	if(apParseContext->bSuspended && ++apParseContext->uiSliceCount == 1 && !hppVarIsCodeUnchanged(apParseContext->szTaskCode, hppVarCodeChangeCount)) 
+		apParseContext->szTaskCode = NULL;
+
+	apParseContext->uiCodeChangeCount = hppVarCodeChangeCount;
+	
+	return !apParseContext->bSuspended;
+}
+
+
+// Suspend the task presently evaluated once the calling external function returns. The task continues with the next call 
+// of hppParseExpressionContinue and reads the result of the function from its result variable at this time. This allows
+// external functions to wait for an event (e.g. a timer or a response) without blocking other tasks.
+// Returns false if no task is evaluated in slices, e.g. when called from hppParseExpression. The function must not yield then.
+bool hppParseExpressionYield()
+{
+	if(hppCurrentParseContext == NULL) return false;
+	if(hppCurrentParseContext->uiSliceTickBudget == 0) return false;
+	if(hppCurrentParseContext->eReturnReason != hppReturnReason_None) return false;
+	
+	hppCurrentParseContext->bYielded = true;
+	return true;
+}
 
+
+// Returns the line number of the position 'acbPos' in 'aszCode' 
+static unsigned int hppGetLineNumber(const char* aszCode, size_t acbPos)
+{
+	unsigned int nLine = 1;
+	size_t i;
+	
+	if(aszCode == NULL) return 0;
 	
-	if(theParseContext->eReturnReason == hppReturnReason_Break) theParseContext->eReturnReason = hppReturnReason_Error_BreakWithoutWhile;
-	if(theParseContext->eReturnReason == hppReturnReason_Continue) theParseContext->eReturnReason = hppReturnReason_Error_ContinueWithoutWhile;
+	for(i = 0; i < acbPos && aszCode[i] != 0; i++) if(aszCode[i] == 10) nLine++;
+	
+	return nLine;
+}
+
 
+// Write the call stack of the task presently evaluated in the format "main:line;function:line;..."
+size_t hppParseExpressionGetStack(const struct hppParseExpressionStruct* apParseContext, char* aszStack_Out, size_t acbMaxLen)
+{
+	const struct hppParseFrameStruct* pFrame;
+	const char* aszName[HPP_STACK_MAX_DEPTH];
+	unsigned int auiLine[HPP_STACK_MAX_DEPTH];
+	const char* szCode;
+	size_t cbPos;
+	size_t cbLen = 0;
+	int nDepth = 0;
+	int iLen;
+	
+	if(aszStack_Out == NULL || acbMaxLen == 0) return 0;
+	aszStack_Out[0] = 0;
+	if(apParseContext == NULL) return 0;
+	
+	szCode = apParseContext->szCode;
+	cbPos = apParseContext->cbPos;
 	
-	if(theParseContext->eReturnReason != hppReturnReason_EOF && theParseContext->eReturnReason != hppReturnReason_Return)
+	// Collect the innermost levels. Frames waiting for a called function know the code position of the caller.
+	// The resume point of the frame on top is not valid since it does not wait for any other frame.
+	for(pFrame = apParseContext->pFrame != NULL ? apParseContext->pFrame->pParent : NULL; pFrame != NULL && nDepth < HPP_STACK_MAX_DEPTH; pFrame = pFrame->pParent)
 	{
-		if(strcmp(aszResultVarKey, "ReturnWithError") == 0 || strcmp(aszResultVarKey, "ReturnWithDebugInfo") == 0)
+		if(pFrame->eResumePoint != hppResumePoint_FunctionCall) continue;
+		
+		aszName[nDepth] = pFrame->szExpresssionWithPrefix + HPP_EXP_LOCAL_VAL_PREFIX_LEN;
+		auiLine[nDepth++] = hppGetLineNumber(szCode, cbPos);
+		szCode = pFrame->szCallingCode;
+		cbPos = pFrame->cbCallingPosition;
+	}
+	
+	if(nDepth < HPP_STACK_MAX_DEPTH)
+	{
+		aszName[nDepth] = "main";
+		auiLine[nDepth++] = hppGetLineNumber(szCode, cbPos);
+	}
+	
+	// Write the outermost level first
+	while(nDepth-- > 0 && cbLen < acbMaxLen)
+	{
+		iLen = snprintf(aszStack_Out + cbLen, acbMaxLen - cbLen, "%s%s:%u", cbLen > 0 ? ";" : "", aszName[nDepth], auiLine[nDepth]);
+		if(iLen < 0) break;
+		cbLen += (size_t)iLen;
+	}
+	
+	if(cbLen >= acbMaxLen) cbLen = acbMaxLen - 1;   // truncated
+	
+	return cbLen;
+}
+
+
+// Finish parsing of the task 'apParseContext' and release all its resources. A task which has not finished yet is aborted with 
+// a timeout error. Returns a pointer to the char array assoziated with the result variable of the task.
+// If the name of the result variable equals "ReturnWithError", an error text is created in case of a parse error. 
+// Otherwise the result in NULL in case of a parse error. A prefix ending with ':' is ignored for this name comparison.
+char* hppParseExpressionEnd(struct hppParseExpressionStruct* apParseContext)
+{
+	char* pchResult;
+	const char* aszResultVarKey;
+	unsigned int uiMoved;
+	bool bAborted = false;   // The task has been suspended and is aborted, its code may have been changed in the meantime
+
+	if(apParseContext == NULL) return NULL;
+	aszResultVarKey = apParseContext->szResultVarKey;
+
+	if(apParseContext->pFrame != NULL)
+	{
+		bAborted = true;
+		if(apParseContext->eReturnReason == hppReturnReason_None) apParseContext->eReturnReason = hppReturnReason_Timeout;
+		hppParseExpressionContinue(apParseContext, 0);    // Unwind the frames, not evaluating any further code
+	}
+
+	pchResult = apParseContext->pchResult;
+	
+	if(apParseContext->eReturnReason == hppReturnReason_Break) apParseContext->eReturnReason = hppReturnReason_Error_BreakWithoutWhile;
+	if(apParseContext->eReturnReason == hppReturnReason_Continue) apParseContext->eReturnReason = hppReturnReason_Error_ContinueWithoutWhile;
+
+	
+	if(apParseContext->eReturnReason != hppReturnReason_EOF && apParseContext->eReturnReason != hppReturnReason_Return)
+	{
+		if(hppIsResultVarName(aszResultVarKey, "ReturnWithError") || hppIsResultVarName(aszResultVarKey, "ReturnWithDebugInfo"))
 		{
 			char szErr[49 + HPP_CALL_FUNCTION_NAME_MAX_LEN];
 			int nLine = 1;
 			size_t cbLineStart = 0;
 			size_t cbSearchPos = 0;
-			size_t cbErrorPos = theParseContext->cbPos;
-			const char* szErrorCode = aszCode;
+			size_t cbErrorPos = apParseContext->cbPos;
+			size_t cbErrorCodeLen = cbErrorPos;
+			const char* szErrorCode = apParseContext->szCode;
 			
 			// Check if the Error occured in a sub function call 
-			if(theParseContext->szErrorCallFunctionName[0] != 0) 
+			if(apParseContext->szErrorCallFunctionName[0] != 0) 
 			{ 
-				szErrorCode = hppVarGet(theParseContext->szErrorCallFunctionName, NULL);
-				cbErrorPos = theParseContext->cbErrorCallFunctionPos;
+				szErrorCode = hppVarGet(apParseContext->szErrorCallFunctionName, &cbErrorCodeLen);
+				cbErrorPos = apParseContext->cbErrorCallFunctionPos;
 			}
 			
+			// Positions do not match the code anymore if the code may have been changed while the task was suspended
+			if(bAborted || apParseContext->eReturnReason == hppReturnReason_Error_CodeChanged || cbErrorPos > cbErrorCodeLen) szErrorCode = NULL;
+			
 			// Count the number of lines until the error position
 			if(szErrorCode != NULL)
 				while(cbSearchPos < cbErrorPos) 
 					if(szErrorCode[cbSearchPos++] == 10) { nLine++; cbLineStart = cbSearchPos; }
 				  
-			if(theParseContext->szErrorCallFunctionName[0] == 0)
-				sprintf(szErr, "#Error %d in line %d near column %d", (int)theParseContext->eReturnReason, nLine, (int)(cbErrorPos - cbLineStart) - 1);
+			if(apParseContext->szErrorCallFunctionName[0] == 0)
+				sprintf(szErr, "#Error %d in line %d near column %d", (int)apParseContext->eReturnReason, nLine, (int)(cbErrorPos - cbLineStart) - 1);
 			else
-				sprintf(szErr, "#Error %d in line %d near column %d in '%s'", (int)theParseContext->eReturnReason, nLine, (int)(cbErrorPos - cbLineStart) - 1, theParseContext->szErrorCallFunctionName);
+				sprintf(szErr, "#Error %d in line %d near column %d in '%s'", (int)apParseContext->eReturnReason, nLine, (int)(cbErrorPos - cbLineStart) - 1, apParseContext->szErrorCallFunctionName);
 					
 			pchResult = hppVarPutStr(aszResultVarKey, szErr, NULL);
 		}
 		else pchResult = NULL;	
 	}
 	
-	if(theParseContext->eReturnReason == hppReturnReason_EOF)
-		if(strcmp(aszResultVarKey, "ReturnWithDebugInfo") != 0) pchResult = NULL;   // No return value if code has reached EOF unless needed for debug reasons
+	if(apParseContext->eReturnReason == hppReturnReason_EOF)
+		if(!hppIsResultVarName(aszResultVarKey, "ReturnWithDebugInfo")) pchResult = NULL;   // No return value if code has reached EOF unless needed for debug reasons
+	
+	// Temporary variables of the task are gone, the result variable may still be stored in its arena and moves to the default arena.
+	// Its value may also reference a constant interned for the code of the task which is not the value of a variable.
+	uiMoved = hppVarConstTableClear(&apParseContext->mConstTable);
+	uiMoved += hppVarScratchRelease(&apParseContext->mScratchArena, hppSpareParseContext == NULL);
+	if(uiMoved > 0 && pchResult != NULL) pchResult = hppVarGet(aszResultVarKey, NULL);
 		
-	free(theParseContext->szExpressionStack);	
-	free(theParseContext);
+	// Keep the context and some of its frames for the next execution (all frames have been released at this point)
+	if(hppSpareParseContext == NULL) 
+	{
+		struct hppParseFrameStruct* pFrame = apParseContext->pFreeFrames;
+		unsigned int uiCount = 1;
+		
+		while(pFrame != NULL && pFrame->pParent != NULL)
+		{
+			if(uiCount++ < HPP_SPARE_PARSE_FRAME_COUNT) pFrame = pFrame->pParent;
+			else
+			{
+				struct hppParseFrameStruct* pFreeFrame = pFrame->pParent;
+				pFrame->pParent = pFreeFrame->pParent;
+				free(pFreeFrame);
+			}
+		}
+		
+		hppSpareParseContext = apParseContext;
+	}
+	else hppParseContextFree(apParseContext);
+	
 	return pchResult;	
 }
 
 
+// Parse H++ code in 'aszCode' and store return value in the variable 'aszResultVarKey'. Returns a pointer to
+// the char array assoziated with that variable 'aszResultVarKey'.
+// If the string value of 'aszResultVarKey' equals "ReturnWithError", an error text is created in cas of a parse
+// error. Otherwise the result in NULL in case of a parse error.
+char* hppParseExpression(const char* aszCode, const char* aszResultVarKey)
+{
+	struct hppParseExpressionStruct* theParseContext = hppParseExpressionBegin(aszCode, aszResultVarKey, 0);
+
+	if(theParseContext == NULL) return NULL;
+	
+	hppParseExpressionContinue(theParseContext, 0);
+	return hppParseExpressionEnd(theParseContext);	
+}
+
+
+// Set the maximum nesting depth of expressions, brackets, arguments and function calls and the size of the
+// expression stack holding the names of the expressions of all nesting levels. Zero keeps the present value.
+// The new limits apply to subsequent calls of hppParseExpression. Exceeding a limit results in a stack overflow error.
+void hppSetParseLimits(unsigned int auiMaxCallDepth, size_t acbExpressionStackSize)
+{
+	if(auiMaxCallDepth > HPP_MAX_CALL_DEPTH_LIMIT) auiMaxCallDepth = HPP_MAX_CALL_DEPTH_LIMIT;
+	if(auiMaxCallDepth > 0) hppMaxCallDepth = auiMaxCallDepth;
+	
+	if(acbExpressionStackSize > 0 && acbExpressionStackSize < HPP_EXP_STACK_MIN_SIZE) acbExpressionStackSize = HPP_EXP_STACK_MIN_SIZE;
+	if(acbExpressionStackSize > 0) hppExpressionStackSize = acbExpressionStackSize;
+}
+
+
+// Get the present limits set with hppSetParseLimits. Pointers may be NULL. 
+void hppGetParseLimits(unsigned int* apuiMaxCallDepth_Out, size_t* apcbExpressionStackSize_Out)
+{
+	if(apuiMaxCallDepth_Out != NULL) *apuiMaxCallDepth_Out = hppMaxCallDepth;
+	if(apcbExpressionStackSize_Out != NULL) *apcbExpressionStackSize_Out = hppExpressionStackSize;
+}
+
+
 // Add an external function library 
 bool hppAddExternalFunctionLibrary(hppExternalFunctionType aExternalFunctionType)
 {
@@ -1146,6 +2162,35 @@ bool hppAddExternalFunctionLibrary(hppExternalFunctionType aExternalFunctionType
 }
 
 
+// Add a NULL terminated table of words which are tokenized in code images
+bool hppAddImageTokens(const char* const aszTokens[])
+{
+	size_t iTable = 1;
+	size_t nTokens = 0;
+	size_t i;
+
+	if(aszTokens == NULL) return false;
+
+	// Token bytes of all tables must stay below the escape byte
+	while(hppImageGetToken(nTokens) != NULL) nTokens++;
+	for(i = 0; aszTokens[i] != NULL; i++) nTokens++;
+	if(HPP_IMAGE_TOKEN_FIRST + nTokens > HPP_IMAGE_TOKEN_ESCAPE) return false;
+
+	while(iTable <= HPP_IMAGE_TOKEN_TABLE_COUNT)
+	{
+		if(hppImageTokenTables[iTable] == NULL)
+		{
+			hppImageTokenTables[iTable] = aszTokens;
+			return true;
+		}
+
+		iTable++;
+	}
+
+	return false;
+}
+
+
 // Add an external poll function which shall be called regularly while parsing h++ code
 // Returns an existing poll function, if it exists. Otherwhise returns NULL 
 hppExternalPollFunctionType hppAddExternalPollFunction(hppExternalPollFunctionType aNewExternalPollFunction)
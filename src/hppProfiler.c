@@ -0,0 +1,252 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppProfiler.c                                                          */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Profiler                                                   */
+/*                                                                              */
+/*   - Call count and run time of H++ functions (code variables)                */
+/*   - Variable lookups and heap allocations per function                       */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: hppVarStorage.h                                                */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#include "../include/hppProfiler.h"
+#include "../include/hppVarStorage.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+// Global variables
+bool hppProfilerEnabled = false;
+bool hppProfilerSamplingEnabled = false;
+
+// Static variables
+static struct hppProfilerEntryStruct hppProfilerEntries[HPP_PROFILER_ENTRY_COUNT];
+static hppProfilerClockType hppProfilerClock = NULL;
+static uint32_t hppProfilerGeneration = 0;          // Incremented by hppProfilerReset
+static struct hppProfilerSampleStruct hppProfilerSamples[HPP_PROFILER_SAMPLE_COUNT];
+static uint32_t hppProfilerOtherSampleCount = 0;     // Samples not fitting in hppProfilerSamples
+
+
+static uint32_t hppProfilerGetTime()
+{
+	return hppProfilerClock != NULL ? hppProfilerClock() : 0;
+}
+
+
+void hppProfilerEnable(bool abEnable)
+{
+	hppProfilerEnabled = abEnable;
+}
+
+
+void hppProfilerEnableSampling(bool abEnable)
+{
+	hppProfilerSamplingEnabled = abEnable;
+}
+
+
+void hppProfilerReset()
+{
+	memset(hppProfilerEntries, 0, sizeof(hppProfilerEntries));
+	memset(hppProfilerSamples, 0, sizeof(hppProfilerSamples));
+	hppProfilerOtherSampleCount = 0;
+	hppProfilerGeneration++;
+}
+
+
+void hppProfilerSetClock(hppProfilerClockType aClock)
+{
+	hppProfilerClock = aClock;
+}
+
+
+void hppProfilerEnter(struct hppProfilerCallStruct** appCurrentCall, struct hppProfilerCallStruct* apCall, const char* aszName)
+{
+	int i;
+
+	// Find the entry of the function or a free entry
+	for(i = 0; i < HPP_PROFILER_ENTRY_COUNT && hppProfilerEntries[i].szName[0] != 0; i++)
+		if(strncmp(hppProfilerEntries[i].szName, aszName, HPP_PROFILER_NAME_MAX_LEN) == 0) break;
+
+	if(i < HPP_PROFILER_ENTRY_COUNT && hppProfilerEntries[i].szName[0] == 0)
+	{
+		strncpy(hppProfilerEntries[i].szName, aszName, HPP_PROFILER_NAME_MAX_LEN);
+		hppProfilerEntries[i].szName[HPP_PROFILER_NAME_MAX_LEN] = 0;
+	}
+
+	apCall->pCaller = *appCurrentCall;
+	apCall->iEntry = i < HPP_PROFILER_ENTRY_COUNT ? i : -1;
+	apCall->uiGeneration = hppProfilerGeneration;
+	apCall->uiChildTime = 0;
+	apCall->uiChildVarLookupCount = 0;
+	apCall->uiChildHeapAllocCount = 0;
+	apCall->uiStartVarLookupCount = hppVarLookupCount;
+	apCall->uiStartHeapAllocCount = hppVarHeapAllocCount;
+	apCall->uiStartTime = hppProfilerGetTime();
+
+	*appCurrentCall = apCall;
+}
+
+
+void hppProfilerExit(struct hppProfilerCallStruct** appCurrentCall, struct hppProfilerCallStruct* apCall)
+{
+	struct hppProfilerEntryStruct* pEntry;
+	uint32_t uiTime = hppProfilerGetTime() - apCall->uiStartTime;
+	uint32_t uiVarLookupCount = hppVarLookupCount - apCall->uiStartVarLookupCount;
+	uint32_t uiHeapAllocCount = hppVarHeapAllocCount - apCall->uiStartHeapAllocCount;
+
+	*appCurrentCall = apCall->pCaller;
+
+	// Inclusive values of this call are not counted as exclusive values of the caller
+	if(apCall->pCaller != NULL)
+	{
+		apCall->pCaller->uiChildTime += uiTime;
+		apCall->pCaller->uiChildVarLookupCount += uiVarLookupCount;
+		apCall->pCaller->uiChildHeapAllocCount += uiHeapAllocCount;
+	}
+
+	if(apCall->iEntry < 0 || apCall->uiGeneration != hppProfilerGeneration) return;   // not recorded or reset in the meantime
+
+	pEntry = &hppProfilerEntries[apCall->iEntry];
+	pEntry->uiCallCount++;
+	pEntry->uiInclusiveTime += uiTime;
+	pEntry->uiExclusiveTime += uiTime - apCall->uiChildTime;
+	pEntry->uiVarLookupCount += uiVarLookupCount - apCall->uiChildVarLookupCount;
+	pEntry->uiHeapAllocCount += uiHeapAllocCount - apCall->uiChildHeapAllocCount;
+}
+
+
+void hppProfilerSuspend(struct hppProfilerCallStruct* apCurrentCall)
+{
+	uint32_t uiTime = hppProfilerGetTime();
+
+	for(; apCurrentCall != NULL; apCurrentCall = apCurrentCall->pCaller)
+	{
+		apCurrentCall->uiStartTime = uiTime - apCurrentCall->uiStartTime;
+		apCurrentCall->uiStartVarLookupCount = hppVarLookupCount - apCurrentCall->uiStartVarLookupCount;
+		apCurrentCall->uiStartHeapAllocCount = hppVarHeapAllocCount - apCurrentCall->uiStartHeapAllocCount;
+	}
+}
+
+
+void hppProfilerContinue(struct hppProfilerCallStruct* apCurrentCall)
+{
+	hppProfilerSuspend(apCurrentCall);    // the same operation turns elapsed values back into start values
+}
+
+
+void hppProfilerSample(const struct hppParseExpressionStruct* apParseContext)
+{
+	char szStack[HPP_PROFILER_STACK_MAX_LEN + 1];
+	int i;
+
+	hppParseExpressionGetStack(apParseContext, szStack, sizeof(szStack));
+
+	// Find the entry of the stack or a free entry
+	for(i = 0; i < HPP_PROFILER_SAMPLE_COUNT && hppProfilerSamples[i].uiCount != 0; i++)
+		if(strcmp(hppProfilerSamples[i].szStack, szStack) == 0) break;
+
+	if(i == HPP_PROFILER_SAMPLE_COUNT) 
+	{
+		hppProfilerOtherSampleCount++;
+		return;
+	}
+
+	if(hppProfilerSamples[i].uiCount == 0) strcpy(hppProfilerSamples[i].szStack, szStack);
+	hppProfilerSamples[i].uiCount++;
+}
+
+
+void hppProfilerPollFunction(struct hppParseExpressionStruct* apParseContext, enum hppExternalPollFunctionEventEnum aPollFunctionEvent)
+{
+	if(aPollFunctionEvent == hppExternalPollFunctionEvent_Poll && hppProfilerSamplingEnabled) hppProfilerSample(apParseContext);
+}
+
+
+const struct hppProfilerEntryStruct* hppProfilerGetEntry(int aiIndex)
+{
+	if(aiIndex < 0 || aiIndex >= HPP_PROFILER_ENTRY_COUNT || hppProfilerEntries[aiIndex].szName[0] == 0) return NULL;
+
+	return &hppProfilerEntries[aiIndex];
+}
+
+
+size_t hppProfilerDump(char* aszResult, size_t acbMaxLen)
+{
+	const struct hppProfilerEntryStruct* pEntry;
+	size_t cbLen = 0;
+	int iLen;
+	int i;
+
+	if(aszResult != NULL && acbMaxLen > 0) aszResult[0] = 0;
+
+	for(i = 0; (pEntry = hppProfilerGetEntry(i)) != NULL; i++)
+	{
+		iLen = snprintf(cbLen < acbMaxLen ? aszResult + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s%s,%lu,%lu,%lu,%lu,%lu", 
+						i > 0 ? "\n" : "", pEntry->szName, (unsigned long)pEntry->uiCallCount, (unsigned long)pEntry->uiInclusiveTime, 
+						(unsigned long)pEntry->uiExclusiveTime, (unsigned long)pEntry->uiVarLookupCount, (unsigned long)pEntry->uiHeapAllocCount);
+
+		if(iLen > 0) cbLen += (size_t)iLen;
+	}
+
+	return cbLen;
+}
+
+
+size_t hppProfilerDumpSamples(char* aszResult, size_t acbMaxLen)
+{
+	size_t cbLen = 0;
+	int iLen;
+	int i;
+
+	if(aszResult != NULL && acbMaxLen > 0) aszResult[0] = 0;
+
+	for(i = 0; i <= HPP_PROFILER_SAMPLE_COUNT; i++)
+	{
+		if(i < HPP_PROFILER_SAMPLE_COUNT && hppProfilerSamples[i].uiCount == 0) continue;
+		if(i == HPP_PROFILER_SAMPLE_COUNT && hppProfilerOtherSampleCount == 0) break;
+
+		iLen = snprintf(cbLen < acbMaxLen ? aszResult + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s%s %lu", cbLen > 0 ? "\n" : "", 
+						i < HPP_PROFILER_SAMPLE_COUNT ? hppProfilerSamples[i].szStack : "[other]",
+						(unsigned long)(i < HPP_PROFILER_SAMPLE_COUNT ? hppProfilerSamples[i].uiCount : hppProfilerOtherSampleCount));
+
+		if(iLen > 0) cbLen += (size_t)iLen;
+	}
+
+	return cbLen;
+}
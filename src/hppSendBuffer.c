@@ -0,0 +1,152 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppSendBuffer.c                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Send Buffer                                                */
+/*                                                                              */
+/*   - Byte stream from writers to a FIFO filled by an interrupt handler        */
+/*   - Transfer in chunks, backpressure on writers with stall detection         */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: hppSendBuffer.h                                                */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#include "../include/hppSendBuffer.h"
+
+#include <string.h>
+
+
+static uint32_t hppSendBufferUsed(const struct hppSendBufferStruct* apBuffer)
+{
+	uint32_t uiHead = apBuffer->uiHead;
+	uint32_t uiTail = apBuffer->uiTail;
+
+	return uiTail >= uiHead ? uiTail - uiHead : apBuffer->cbSize - uiHead + uiTail;
+}
+
+
+// Put as many bytes as fit. Returns the number of bytes put.
+static uint32_t hppSendBufferPut(struct hppSendBufferStruct* apBuffer, const uint8_t apData[], uint32_t acbDataLen)
+{
+	uint32_t uiTail = apBuffer->uiTail;
+	uint32_t cbSpace = apBuffer->cbSize - 1 - hppSendBufferUsed(apBuffer);
+	uint32_t cbFirst = apBuffer->cbSize - uiTail;
+
+	if(acbDataLen > cbSpace) acbDataLen = cbSpace;
+	if(cbFirst > acbDataLen) cbFirst = acbDataLen;
+
+	memcpy(apBuffer->pBuffer + uiTail, apData, cbFirst);
+	memcpy(apBuffer->pBuffer, apData + cbFirst, acbDataLen - cbFirst);
+
+	// The reader sees the data once the write position has moved
+	apBuffer->uiTail = (uiTail + acbDataLen) % apBuffer->cbSize;
+
+	return acbDataLen;
+}
+
+
+void hppSendBufferInit(struct hppSendBufferStruct* apBuffer, uint8_t* apData, uint32_t acbSize)
+{
+	memset(apBuffer, 0, sizeof(struct hppSendBufferStruct));
+
+	apBuffer->pBuffer = apData;
+	apBuffer->cbSize = acbSize;
+}
+
+
+bool hppSendBufferIsEmpty(const struct hppSendBufferStruct* apBuffer)
+{
+	return apBuffer->uiHead == apBuffer->uiTail;
+}
+
+
+uint32_t hppSendBufferWrite(struct hppSendBufferStruct* apBuffer, const uint8_t apData[], uint32_t acbDataLen, 
+							hppSendBufferKickType aKick, hppSendBufferWaitType aWait, void* apContext)
+{
+	uint32_t cbSent = 0;
+
+	while(true)
+	{
+		cbSent += hppSendBufferPut(apBuffer, apData + cbSent, acbDataLen - cbSent);
+		if(aKick != NULL) aKick(apContext);
+
+		if(cbSent == acbDataLen || apBuffer->bStalled) break;
+
+		// Backpressure: wait until the reader passed data on. A receiver not reading the data stalls the output and the data 
+		// is dropped without waiting until the receiver reads again.
+		apBuffer->uiWaitCount++;
+
+		if(aWait == NULL || !aWait(apContext))
+		{
+			apBuffer->bStalled = true;
+			break;
+		}
+	}
+
+	apBuffer->uiDropCount += acbDataLen - cbSent;
+
+	return cbSent;
+}
+
+
+uint32_t hppSendBufferDrain(struct hppSendBufferStruct* apBuffer, uint32_t acbChunkSize, hppSendBufferFillType aFill, void* apContext)
+{
+	uint32_t uiHead = apBuffer->uiHead;
+	uint32_t cbChunk = hppSendBufferUsed(apBuffer);
+	int iLen;
+
+	// Chunks end at the end of the buffer, the rest is passed with the next call
+	if(cbChunk > apBuffer->cbSize - uiHead) cbChunk = apBuffer->cbSize - uiHead;
+	if(cbChunk > acbChunkSize) cbChunk = acbChunkSize;
+	if(cbChunk == 0) return 0;
+
+	iLen = aFill(apContext, apBuffer->pBuffer + uiHead, cbChunk);
+	if(iLen <= 0) return 0;
+	if((uint32_t)iLen > cbChunk) iLen = (int)cbChunk;
+
+	apBuffer->uiHead = (uiHead + (uint32_t)iLen) % apBuffer->cbSize;
+	apBuffer->uiSentCount += (uint32_t)iLen;
+	apBuffer->bStalled = false;
+
+	return (uint32_t)iLen;
+}
+
+
+void hppSendBufferResetStats(struct hppSendBufferStruct* apBuffer)
+{
+	apBuffer->uiSentCount = 0;
+	apBuffer->uiDropCount = 0;
+	apBuffer->uiWaitCount = 0;
+}
@@ -62,6 +62,7 @@
 
 // Include Halloween Zephyr library with thread synchronized versions of the H++ scripting libraries
 #include "../include/hppZephyr.h"
+#include "../include/hppProfiler.h"
 
 // Zephir OpenThread integration Library
 #include <net/openthread.h>
@@ -99,9 +100,7 @@ char* hppCoapsCert = NULL;
 char* hppCoapsCertKey = NULL;
 char* hppCoapsCaCert = NULL;
 
-static uint32_t hppThreadTimeoutTime = 1000;   // stop H++ interpreter after 1000 ms by default -> 0 means no timeout
-
-// The maximum time consumed by a H++ code execution call should always stay well below hppThreadTimeoutTime to avoid random timeout errors
+// The maximum time consumed by a H++ code execution call should always stay well below the execution time budgets to avoid random timeout errors
 static uint32_t hppThreadMaxTimeMeasured = 0;  // maximum time span measured for any H++ script being executed
 
 // Current CoAP context for coap_respond() H++ command 
@@ -911,15 +910,14 @@ static bool hppAsyncParseWithCoAPContext(const char* aszVarName, otMessage* apMe
 
     hppCoapStoreMessageContext(&theCoapMessageContext, apMessage, apMessageInfo);
 
-    // Read playload
+    // Read playload once into a block which is passed on by reference and becomes the value of the payload variable
     if(cbPayloadLength > 0 && cbPayloadLength <= HPP_MAX_PAYLOAD_LENGTH)
     {
-        pchPayload = (char*) malloc(cbPayloadLength);
+        pchPayload = hppAsyncBlockAlloc(cbPayloadLength);
         if(pchPayload != NULL) 
         {
             hppCoapReadPayload(apMessage, pchPayload, cbPayloadLength);
-            bSuccess = hppAsyncVarPut("0000:payload", pchPayload, cbPayloadLength, true);
-            free(pchPayload);
+            bSuccess = hppAsyncVarPutBlock("0000:payload", pchPayload, cbPayloadLength, true);
         }
         else bSuccess = false;
     }
@@ -938,6 +936,32 @@ static bool hppAsyncParseWithCoAPContext(const char* aszVarName, otMessage* apMe
 }
 
 
+// ------------------------------------
+// Handler for GET on /stats/xxx
+// ------------------------------------
+
+// Responds with the statistics named by the context of the resource (e.g. "prof" for /stats/prof)
+
+static void hppCoapHandler_Stats(void* apContext, otMessage* apMessage, const otMessageInfo* apMessageInfo)
+{
+    hppCoapMessageContext theCoapMessageContext;
+    bool bSuccess;
+    
+    if (hppIsCoapGET(apMessage))
+    {
+        hppCoapStoreMessageContext(&theCoapMessageContext, apMessage, apMessageInfo);
+
+        bSuccess = hppAsyncSetCoapContext(&theCoapMessageContext, true);   // executed with the next async operation
+        if(bSuccess) bSuccess = hppAsyncStatsGet((const char*)apContext);
+        
+        // Make sure to unlock the parser mutex after any hppAsyncXXX(...) call with abSyncWithNext=true if hppAsyncParseVarCoapResponse(...) was not executed.
+        if(!bSuccess) hppAsyncParseVar("");
+
+        hppCoapRespondEmpty(apMessage, apMessageInfo);
+    }    
+}
+
+
 // ------------------------------------
 // Handler for PUT on /var_hide
 // ------------------------------------
@@ -999,19 +1023,19 @@ static void hppCoapVarHandler(void* pContext, otMessage* apMessage, const otMess
 
                 if(cbPayloadLength <= HPP_MAX_PAYLOAD_LENGTH)
                 {
-                    pchPayload = (char*) malloc(cbPayloadLength);
+                    // The block becomes the value of the variable without further copies
+                    pchPayload = hppAsyncBlockAlloc(cbPayloadLength);
                     if(pchPayload != NULL) 
                     {
                         hppCoapReadPayload(apMessage, pchPayload, cbPayloadLength);
 
-                        if(hppAsyncVarPutFromUri(szVarPath, pchPayload, cbPayloadLength) == true)
+                        if(hppAsyncVarPutBlockFromUri(szVarPath, pchPayload, cbPayloadLength) == true)
                         {
                             theCoapResultCode = OT_COAP_CODE_CHANGED;
                         }
                         else theCoapResultCode = OT_COAP_CODE_PRECONDITION_FAILED;   // Parser busy 
-
-                        free(pchPayload);
                     }
+                    else theCoapResultCode = OT_COAP_CODE_PRECONDITION_FAILED;       // Too many payloads queued 
 
                     hppCoapConfirmWithCode(apMessage, apMessageInfo, theCoapResultCode);
                 }
@@ -1081,6 +1105,40 @@ static void hppCoapGenericResponseHandler(void* apContext, otMessage* apMessage,
 }
 
 
+// Coap response handler waking up the H++ task waiting in 'coap_get_await'. The payload becomes the result of 'coap_get_await'.
+static void hppCoapAwaitResponseHandler(void* apContext, otMessage* apMessage, const otMessageInfo* apMessageInfo, otError aError)
+{
+    uint32_t uiTaskWaitID = (uint32_t)apContext;
+    int cbPayloadLength;
+    char* pchPayload;
+    bool bSuccess = false;
+
+    if(aError != OT_ERROR_NONE || apMessage == NULL) 
+    {
+        hppAsyncTaskResume(uiTaskWaitID, "false", 5);      // e.g. response timeout
+        return;
+    }
+
+    // Read playload
+    cbPayloadLength = hppCoapGetPayloadLenght(apMessage);
+
+    if(cbPayloadLength > 0 && cbPayloadLength <= HPP_MAX_PAYLOAD_LENGTH)
+    {
+        pchPayload = (char*) malloc(cbPayloadLength);
+        if(pchPayload != NULL) 
+        {
+            hppCoapReadPayload(apMessage, pchPayload, cbPayloadLength);
+            bSuccess = hppAsyncTaskResume(uiTaskWaitID, pchPayload, cbPayloadLength);
+            free(pchPayload);
+        }
+    }
+    else bSuccess = hppAsyncTaskResume(uiTaskWaitID, "", 0);
+
+    // Do not leave the task waiting forever if the payload could not be passed on
+    if(!bSuccess) hppAsyncTaskResume(uiTaskWaitID, "false", 5);
+}
+
+
 // Handler for H++ triggered connection events
 void hppCoapsConnectedHppHandler(bool abConnected, void *apContext) 
 {           
@@ -1234,13 +1292,38 @@ static char* hppEvaluateOtFunction(char aszFunctionName[], char aszParamName[],
     if(strcmp(aszFunctionName, "get_time_ms") == 0)     // no parameters
         return hppVarPutStr(aszResultVarKey, hppUI32toA(szNumeric, otPlatAlarmMilliGetNow()), apcbResultLen_Out);
 
-    if(strcmp(aszFunctionName, "timeout") == 0)     // [timeout time in ms]     --> returns the maximum consumed time in ms by any H++ script start after boottime
+    if(strcmp(aszFunctionName, "timeout") == 0)     // [timeout time in ms], [entry point 'coap', 'timer', 'cli' or 'other']     --> returns the maximum consumed time in ms by any H++ script start after boottime
     {
+        enum hppEntryPointEnum eEntryPoint = hppEntryPoint_Count;     // all entry points
         char* pchParam1 = hppVarGet(aszParamName, NULL);
-        if(pchParam1 != NULL) hppThreadTimeoutTime = atoi(pchParam1);
+        char* pchParam2;
+        
+        aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '2';
+        pchParam2 = hppVarGet(aszParamName, NULL);
+
+        if(pchParam2 != NULL) 
+        {
+            eEntryPoint = hppEntryPointGetByName(pchParam2);
+            if(eEntryPoint == hppEntryPoint_Count) return NULL;
+        }
+
+        if(pchParam1 != NULL) hppEntryPointSetBudget(eEntryPoint, atoi(pchParam1));
         return hppVarPutStr(aszResultVarKey, hppUI32toA(szNumeric, hppThreadMaxTimeMeasured), apcbResultLen_Out);
     }
 
+    if(strcmp(aszFunctionName, "parse_limits") == 0)     // [maximum nesting depth], [expression stack size]    --> returns the maximum nesting depth
+    {
+        unsigned int uiMaxCallDepth;
+        char* pchParam1 = hppVarGet(aszParamName, NULL);
+        char* pchParam2;
+        
+        aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '2';
+        pchParam2 = hppVarGet(aszParamName, NULL);
+        hppSetParseLimits(pchParam1 != NULL ? hppAtoUI32(pchParam1) : 0, pchParam2 != NULL ? hppAtoUI32(pchParam2) : 0);
+        hppGetParseLimits(&uiMaxCallDepth, NULL);
+        return hppVarPutStr(aszResultVarKey, hppUI32toA(szNumeric, uiMaxCallDepth), apcbResultLen_Out);
+    }
+
     if(strncmp(aszFunctionName, "ip_", 3) == 0)
     {
         char* pchParam1 = hppVarGet(aszParamName, NULL);
@@ -1474,6 +1557,27 @@ static char* hppEvaluateOtFunction(char aszFunctionName[], char aszParamName[],
                 theError = hppCoapSend(pchParam1, pchParam2, NULL, 0, OT_COAP_CODE_GET, hppCoapGenericResponseHandler, (void*)hppVarGetKey(pchParam3, true), *pchParam4 == 't' ? true : false);
                 openthread_api_mutex_unlock(hppOpenThreadContext);
             }
+            else if(strcmp(aszFunctionName, "_get_await") == 0)  // addr, path[, confirm, timeout]  --> suspends the task until the response has been received
+            {  
+                // Returns false immediately without raising an error if the code does not run as task (see 'sleep') or if no timer 
+                // event is available for the timeout. A response arriving after the timeout is ignored.
+                uint32_t uiTaskWaitID = hppTaskWait(aszResultVarKey);
+                uint32_t uiTimeout = strtoul(pchParam4, NULL, 10);
+
+                if(uiTaskWaitID != 0)
+                {
+                    openthread_api_mutex_lock(hppOpenThreadContext);
+                    theError = hppCoapSend(pchParam1, pchParam2, NULL, 0, OT_COAP_CODE_GET, hppCoapAwaitResponseHandler, (void*)uiTaskWaitID, *pchParam3 == 't' ? true : false);
+                    openthread_api_mutex_unlock(hppOpenThreadContext);
+
+                    if(theError != OT_ERROR_NONE) hppTaskResume(uiTaskWaitID, "false", 5);   // Continue with the next slice
+                    else if(uiTimeout > 0 && !hppTaskWaitTimeout(uiTaskWaitID, uiTimeout, "false"))   // cancelled by the response
+                    {
+                        hppTaskResume(uiTaskWaitID, "false", 5);   // No timer available, the response will be ignored
+                        theError = OT_ERROR_NO_BUFS;
+                    }
+                }
+            }
             else if(strcmp(aszFunctionName, "_post") == 0)  // addr, path, payload, handler, confirm
             {
                 openthread_api_mutex_lock(hppOpenThreadContext);
@@ -1578,28 +1682,35 @@ static char* hppEvaluateOtFunction(char aszFunctionName[], char aszParamName[],
 
 static void hppThreadPollFunction(struct hppParseExpressionStruct* apParseContext, enum hppExternalPollFunctionEventEnum aPollFunctionEvent)
 {
-    if(aPollFunctionEvent == hppExternalPollFunctionEvent_Poll && hppThreadTimeoutTime != 0)
+    if(aPollFunctionEvent == hppExternalPollFunctionEvent_Poll && hppProfilerSamplingEnabled) hppProfilerSample(apParseContext);
+
+    // The kernel uptime is read without locking the OpenThread mutex. The budget is consumed by all slices of a task.
+    if(aPollFunctionEvent == hppExternalPollFunctionEvent_Poll)
     {
-        openthread_api_mutex_lock(hppOpenThreadContext);
-        if(otPlatAlarmMilliGetNow() - apParseContext->uiExternalTimer > hppThreadTimeoutTime)
+        uint32_t uiBudget = hppEntryPointGetBudget();
+
+        if(uiBudget != 0 && apParseContext->eReturnReason == hppReturnReason_None &&
+           apParseContext->uiExternalTimeUsed + (k_uptime_get_32() - apParseContext->uiExternalTimer) > uiBudget)
+        {
             apParseContext->eReturnReason = hppReturnReason_Timeout;   // Stop H++ exection with timeout error
-        openthread_api_mutex_unlock(hppOpenThreadContext);
+            hppEntryPointRecordOverrun();
+        }
     }
     else if(aPollFunctionEvent == hppExternalPollFunctionEvent_Begin)
     {
-        // Remember start time
-        openthread_api_mutex_lock(hppOpenThreadContext);
-        apParseContext->uiExternalTimer = otPlatAlarmMilliGetNow();
-        openthread_api_mutex_unlock(hppOpenThreadContext);
+        // Remember start time of the slice
+        apParseContext->uiExternalTimer = k_uptime_get_32();
     }
     else if(aPollFunctionEvent == hppExternalPollFunctionEvent_End)
     {
-        // Keep track of the longest execution time
-        openthread_api_mutex_lock(hppOpenThreadContext);
-        uint32_t uiTimeDiff = otPlatAlarmMilliGetNow() - apParseContext->uiExternalTimer;
-        openthread_api_mutex_unlock(hppOpenThreadContext);
+        apParseContext->uiExternalTimeUsed += k_uptime_get_32() - apParseContext->uiExternalTimer;
 
-        if(hppThreadMaxTimeMeasured < uiTimeDiff) hppThreadMaxTimeMeasured = uiTimeDiff;
+        // Keep track of the longest execution time once the H++ code has finished
+        if(!apParseContext->bSuspended)
+        {
+            if(hppThreadMaxTimeMeasured < apParseContext->uiExternalTimeUsed) hppThreadMaxTimeMeasured = apParseContext->uiExternalTimeUsed;
+            hppEntryPointRecordRun(apParseContext->uiExternalTimeUsed);
+        }
     }
 }
 
@@ -1661,6 +1772,12 @@ void hppThreadInit()
     hppCoapAddResource(".well-known/core", "", hppCoapHandler_Wellknown_Core, NULL, false);
 	otCoapSetDefaultHandler(hppOpenThreadInstance, hppCoapVarHandler, NULL);
     hppCoapAddResource("var_hide", NULL, hppCoapHandler_VarHide, NULL, false);      // NULL in second parameter means not discoverable
+    hppCoapAddResource("stats/prof", "", hppCoapHandler_Stats, (void*)"prof", false);
+    hppCoapAddResource("stats/budget", "", hppCoapHandler_Stats, (void*)"budget", false);
+    hppCoapAddResource("stats/queue", "", hppCoapHandler_Stats, (void*)"queue", false);
+    hppCoapAddResource("stats/timer", "", hppCoapHandler_Stats, (void*)"timer", false);
+    hppCoapAddResource("stats/usb", "", hppCoapHandler_Stats, (void*)"usb", false);
+    hppCoapAddResource("stats/flash", "", hppCoapHandler_Stats, (void*)"flash", false);
 
     // The H++ function library callback in this file locks the openthread mutex if an openthread API function is called. 
     hppSyncAddExternalFunctionLibrary(hppEvaluateOtFunction);
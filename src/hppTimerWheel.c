@@ -0,0 +1,353 @@
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++														            */
+/* ----------------------------------------------------------------------------	*/
+/* Open source scripting language for microcontrollers and embedded	            */
+/* systems.															            */
+/* Invented for remote controlled Halloween ghosts and candles :-)	            */
+/* ----------------------------------------------------------------------------	*/
+/* File: hppTimerWheel.c                                                        */
+/* ----------------------------------------------------------------------------	*/
+/* Halloween++ (H++) Timer Wheel                                                */
+/*                                                                              */
+/*   - Hierarchical timer wheel for scheduled events and periodic timers        */
+/*   - O(1) insert and cancel, pooled events with inline data                   */
+/* ----------------------------------------------------------------------------	*/
+/* Platform: POSIX and alike                                                    */
+/* Dependencies: hppTimerWheel.h                                                */
+/* ----------------------------------------------------------------------------	*/
+/* Copyright (c) 2018 - 2021, Arnulf Rupp							            */
+/* arnulf.rupp@web.de												            */
+/* All rights reserved.												            */
+/* 	                                                                            */
+/* Redistribution and use in source and binary forms, with or without           */
+/* modification, are permitted provided that the following conditions are met:  */
+/* 	                                                                            */
+/* 1. Redistributions of source code must retain the above copyright notice,    */
+/* this list of conditions and the following disclaimer.                        */
+/* 	                                                                            */
+/* 2. Redistributions in binary form must reproduce the above copyright notice, */
+/* this list of conditions and the following disclaimer in the documentation    */
+/* and/or other materials provided with the distribution.                       */
+/* 	                                                                            */
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  */
+/* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    */
+/* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   */
+/* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    */
+/* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          */
+/* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         */
+/* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     */
+/* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      */
+/* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      */
+/* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF       */
+/* THE POSSIBILITY OF SUCH DAMAGE.                                              */
+/* ----------------------------------------------------------------------------	*/
+
+
+#include "../include/hppTimerWheel.h"
+
+#include <string.h>
+
+
+#define HPP_TIMER_WHEEL_SLOT_MASK (HPP_TIMER_WHEEL_SLOT_COUNT - 1)
+#define HPP_TIMER_WHEEL_RANGE (1UL << (HPP_TIMER_WHEEL_SLOT_BITS * HPP_TIMER_WHEEL_LEVEL_COUNT))
+
+// Ticks covered by one slot of the level 'aiLevel' (1 for level 0)
+#define HPP_TIMER_WHEEL_LEVEL_TICKS(aiLevel) (1UL << (HPP_TIMER_WHEEL_SLOT_BITS * (aiLevel)))
+
+
+// Static variables
+static struct hppTimerWheelEventStruct hppTimerWheelEvents[HPP_TIMER_WHEEL_EVENT_COUNT];
+static struct hppTimerWheelEventStruct* hppTimerWheelFreeList = NULL;
+static struct hppTimerWheelEventStruct* hppTimerWheelSlots[HPP_TIMER_WHEEL_LEVEL_COUNT][HPP_TIMER_WHEEL_SLOT_COUNT];
+static uint32_t hppTimerWheelLevelCounts[HPP_TIMER_WHEEL_LEVEL_COUNT];   // Events linked into the levels
+static uint32_t hppTimerWheelNow = 0;                                     // Last tick processed by hppTimerWheelAdvance
+static uint32_t hppTimerWheelUsed = 0;
+
+
+static uint32_t hppTimerWheelHandle(struct hppTimerWheelEventStruct* apEvent)
+{
+	return ((uint32_t)apEvent->uiGeneration << 16) | (uint32_t)(apEvent - hppTimerWheelEvents + 1);
+}
+
+
+// Link the event into the slot of its expiry tick. The level is chosen by the distance to the current tick, such that
+// the slot is moved to the next lower level (or expires) before the wheel has turned once.
+static void hppTimerWheelLink(struct hppTimerWheelEventStruct* apEvent)
+{
+	struct hppTimerWheelEventStruct** ppSlot;
+	uint32_t uiExpiry = apEvent->uiExpiry;
+	int32_t iDelta = (int32_t)(uiExpiry - hppTimerWheelNow);
+	int iLevel = 0;
+
+	// Expiring in the current tick: only while moving events down, the slot is processed after this
+	if(iDelta < 0)
+	{
+		uiExpiry = hppTimerWheelNow;
+		iDelta = 0;
+	}
+
+	// Beyond the range of the wheel: link into the last slot and link again when it is moved down
+	if((uint32_t)iDelta >= HPP_TIMER_WHEEL_RANGE) uiExpiry = hppTimerWheelNow + HPP_TIMER_WHEEL_RANGE - 1;
+
+	while(iLevel < HPP_TIMER_WHEEL_LEVEL_COUNT - 1 && (uint32_t)iDelta >= HPP_TIMER_WHEEL_LEVEL_TICKS(iLevel + 1)) iLevel++;
+
+	ppSlot = &hppTimerWheelSlots[iLevel][(uiExpiry >> (HPP_TIMER_WHEEL_SLOT_BITS * iLevel)) & HPP_TIMER_WHEEL_SLOT_MASK];
+
+	apEvent->pNext = *ppSlot;
+	if(apEvent->pNext != NULL) apEvent->pNext->ppPrev = &apEvent->pNext;
+	apEvent->ppPrev = ppSlot;
+	*ppSlot = apEvent;
+
+	apEvent->uiLevel = (uint8_t)iLevel;
+	hppTimerWheelLevelCounts[iLevel]++;
+}
+
+
+static void hppTimerWheelUnlink(struct hppTimerWheelEventStruct* apEvent)
+{
+	*apEvent->ppPrev = apEvent->pNext;
+	if(apEvent->pNext != NULL) apEvent->pNext->ppPrev = apEvent->ppPrev;
+
+	apEvent->pNext = NULL;
+	apEvent->ppPrev = NULL;
+	hppTimerWheelLevelCounts[apEvent->uiLevel]--;
+}
+
+
+// Move the due tick within the slack to the tick with the most trailing zero bits, such that events with overlapping 
+// slack windows expire in the same tick
+static uint32_t hppTimerWheelApplySlack(uint32_t auiDue, uint32_t auiSlack)
+{
+	uint32_t uiLimit = auiDue + auiSlack;
+	uint32_t uiMask = auiDue ^ uiLimit;
+	int iBit = 31;
+
+	if(uiMask == 0) return auiDue;
+
+	while((uiMask & (1UL << iBit)) == 0) iBit--;
+
+	return uiLimit & ~((1UL << iBit) - 1);
+}
+
+
+static void hppTimerWheelFree(struct hppTimerWheelEventStruct* apEvent)
+{
+	apEvent->uiGeneration++;
+	apEvent->uiState = hppTimerWheelState_Free;
+	apEvent->pNext = hppTimerWheelFreeList;
+	hppTimerWheelFreeList = apEvent;
+	hppTimerWheelUsed--;
+}
+
+
+void hppTimerWheelInit(uint32_t auiNow)
+{
+	int i;
+
+	memset(hppTimerWheelSlots, 0, sizeof(hppTimerWheelSlots));
+	memset(hppTimerWheelLevelCounts, 0, sizeof(hppTimerWheelLevelCounts));
+	hppTimerWheelFreeList = NULL;
+
+	for(i = HPP_TIMER_WHEEL_EVENT_COUNT - 1; i >= 0; i--)
+	{
+		hppTimerWheelEvents[i].uiGeneration++;
+		hppTimerWheelEvents[i].uiState = hppTimerWheelState_Free;
+		hppTimerWheelEvents[i].ppPrev = NULL;
+		hppTimerWheelEvents[i].pNext = hppTimerWheelFreeList;
+		hppTimerWheelFreeList = &hppTimerWheelEvents[i];
+	}
+
+	hppTimerWheelNow = auiNow;
+	hppTimerWheelUsed = 0;
+}
+
+
+uint32_t hppTimerWheelAdd(uint32_t auiNow, uint32_t auiDelay, uint32_t auiPeriod, uint32_t auiSlack, hppTimerWheelHandlerType apHandler, const void* apData, uint32_t acbDataLen, void* apContext)
+{
+	struct hppTimerWheelEventStruct* pEvent = hppTimerWheelFreeList;
+
+	if(pEvent == NULL || acbDataLen > HPP_TIMER_WHEEL_DATA_SIZE) return 0;
+
+	hppTimerWheelFreeList = pEvent->pNext;
+	hppTimerWheelUsed++;
+
+	// The current tick has already been processed
+	pEvent->uiDue = auiNow + auiDelay;
+	if((int32_t)(pEvent->uiDue - hppTimerWheelNow) <= 0) pEvent->uiDue = hppTimerWheelNow + 1;
+
+	// A periodic event must not be deferred into its next period
+	pEvent->uiSlack = auiPeriod > 0 && auiSlack >= auiPeriod ? auiPeriod - 1 : auiSlack;
+	pEvent->uiExpiry = hppTimerWheelApplySlack(pEvent->uiDue, pEvent->uiSlack);
+	pEvent->uiPeriod = auiPeriod;
+	pEvent->pHandler = apHandler;
+	pEvent->pContext = apContext;
+	pEvent->cbDataLen = acbDataLen;
+	if(acbDataLen > 0) memcpy(pEvent->auiData, apData, acbDataLen);
+
+	pEvent->uiState = hppTimerWheelState_Pending;
+	hppTimerWheelLink(pEvent);
+
+	return hppTimerWheelHandle(pEvent);
+}
+
+
+struct hppTimerWheelEventStruct* hppTimerWheelGet(uint32_t auiHandle)
+{
+	uint32_t uiIndex = (auiHandle & 0xFFFF) - 1;
+	struct hppTimerWheelEventStruct* pEvent;
+
+	if(uiIndex >= HPP_TIMER_WHEEL_EVENT_COUNT) return NULL;
+
+	pEvent = &hppTimerWheelEvents[uiIndex];
+	if(pEvent->uiState == hppTimerWheelState_Free || pEvent->uiGeneration != (uint16_t)(auiHandle >> 16)) return NULL;
+
+	return pEvent;
+}
+
+
+bool hppTimerWheelCancel(uint32_t auiHandle)
+{
+	struct hppTimerWheelEventStruct* pEvent = hppTimerWheelGet(auiHandle);
+
+	if(pEvent == NULL) return false;
+
+	if(pEvent->uiState == hppTimerWheelState_Pending) hppTimerWheelUnlink(pEvent);
+	hppTimerWheelFree(pEvent);
+
+	return true;
+}
+
+
+void hppTimerWheelRelease(uint32_t auiHandle)
+{
+	struct hppTimerWheelEventStruct* pEvent = hppTimerWheelGet(auiHandle);
+
+	if(pEvent != NULL && pEvent->uiState == hppTimerWheelState_Expired) hppTimerWheelFree(pEvent);
+}
+
+
+bool hppTimerWheelNextTick(uint32_t* apuiTick_Out)
+{
+	uint32_t uiTick;
+	bool bFound = false;
+	int iLevel;
+	int i;
+
+	// Level 0: the first used slot after the current tick
+	if(hppTimerWheelLevelCounts[0] > 0)
+	{
+		for(i = 1; i < HPP_TIMER_WHEEL_SLOT_COUNT && hppTimerWheelSlots[0][(hppTimerWheelNow + i) & HPP_TIMER_WHEEL_SLOT_MASK] == NULL; i++) ;
+
+		uiTick = hppTimerWheelNow + i;
+		bFound = true;
+	}
+
+	// Higher levels: the next tick at which a slot of the lowest used level is moved down
+	for(iLevel = 1; iLevel < HPP_TIMER_WHEEL_LEVEL_COUNT; iLevel++)
+	{
+		if(hppTimerWheelLevelCounts[iLevel] > 0)
+		{
+			uint32_t uiLevelTick = (hppTimerWheelNow | (HPP_TIMER_WHEEL_LEVEL_TICKS(iLevel) - 1)) + 1;
+
+			if(!bFound || (int32_t)(uiLevelTick - uiTick) < 0) uiTick = uiLevelTick;
+			bFound = true;
+			break;
+		}
+	}
+
+	if(bFound) *apuiTick_Out = uiTick;
+	return bFound;
+}
+
+
+bool hppTimerWheelNextExpiry(uint32_t* apuiTick_Out)
+{
+	struct hppTimerWheelEventStruct* pEvent;
+	uint32_t uiTick;
+	bool bFound = false;
+	int iLevel;
+	int i;
+
+	for(iLevel = 0; iLevel < HPP_TIMER_WHEEL_LEVEL_COUNT; iLevel++)
+	{
+		if(hppTimerWheelLevelCounts[iLevel] == 0) continue;
+
+		// The first used slot after the current one holds the earliest events of the level
+		for(i = 1; i <= HPP_TIMER_WHEEL_SLOT_COUNT; i++)
+		{
+			pEvent = hppTimerWheelSlots[iLevel][((hppTimerWheelNow >> (HPP_TIMER_WHEEL_SLOT_BITS * iLevel)) + i) & HPP_TIMER_WHEEL_SLOT_MASK];
+			if(pEvent != NULL) break;
+		}
+
+		for( ; pEvent != NULL; pEvent = pEvent->pNext)
+		{
+			if(!bFound || (int32_t)(pEvent->uiExpiry - uiTick) < 0) uiTick = pEvent->uiExpiry;
+			bFound = true;
+		}
+	}
+
+	if(bFound) *apuiTick_Out = uiTick;
+	return bFound;
+}
+
+
+uint32_t hppTimerWheelGetTick()
+{
+	return hppTimerWheelNow;
+}
+
+
+void hppTimerWheelAdvance(uint32_t auiNow, hppTimerWheelExpiredType aExpired)
+{
+	struct hppTimerWheelEventStruct** ppSlot;
+	struct hppTimerWheelEventStruct* pEvent;
+	uint32_t uiTick;
+	int iLevel;
+
+	// Skip ticks without anything to do, such that long idle times do not take long
+	while((int32_t)(auiNow - hppTimerWheelNow) > 0 && hppTimerWheelNextTick(&uiTick) && (int32_t)(auiNow - uiTick) >= 0)
+	{
+		hppTimerWheelNow = uiTick;
+
+		// Move the slots of the higher levels reaching the current tick down, highest level first
+		for(iLevel = HPP_TIMER_WHEEL_LEVEL_COUNT - 1; iLevel > 0; iLevel--)
+		{
+			if((uiTick & (HPP_TIMER_WHEEL_LEVEL_TICKS(iLevel) - 1)) != 0) continue;
+
+			ppSlot = &hppTimerWheelSlots[iLevel][(uiTick >> (HPP_TIMER_WHEEL_SLOT_BITS * iLevel)) & HPP_TIMER_WHEEL_SLOT_MASK];
+
+			while((pEvent = *ppSlot) != NULL)
+			{
+				hppTimerWheelUnlink(pEvent);
+				hppTimerWheelLink(pEvent);
+			}
+		}
+
+		// Expire the events of the current tick
+		ppSlot = &hppTimerWheelSlots[0][uiTick & HPP_TIMER_WHEEL_SLOT_MASK];
+
+		while((pEvent = *ppSlot) != NULL)
+		{
+			hppTimerWheelUnlink(pEvent);
+			pEvent->uiExpired = pEvent->uiDue;
+
+			if(pEvent->uiPeriod > 0)
+			{
+				pEvent->uiDue += pEvent->uiPeriod;
+				pEvent->uiExpiry = hppTimerWheelApplySlack(pEvent->uiDue, pEvent->uiSlack);
+				hppTimerWheelLink(pEvent);
+			}
+			else pEvent->uiState = hppTimerWheelState_Expired;
+
+			if(aExpired != NULL) aExpired(hppTimerWheelHandle(pEvent), pEvent);
+		}
+	}
+
+	if((int32_t)(auiNow - hppTimerWheelNow) > 0) hppTimerWheelNow = auiNow;
+}
+
+
+uint32_t hppTimerWheelUsedCount()
+{
+	return hppTimerWheelUsed;
+}
@@ -52,6 +52,7 @@
 #include <limits.h>
 
 struct hppVarListStruct* pFirstVar = NULL;
+struct hppVarTombstoneStruct* pFirstTombstone = NULL;
 
 const char* hppNoInitValue = (const char*) 0x01; 
 const char* hppInitValueWithZero = (const char*) 0x02;
@@ -63,6 +64,9 @@ const char* hppVarGetAllKeyValuePair = "\\1;%s=\"%s\"";
 
 
 // Global variables
+uint32_t hppVarCodeChangeCount = 0;
+uint32_t hppVarLookupCount = 0;
+uint32_t hppVarHeapAllocCount = 0;
 bool hppFloatPrintOn = false;
 bool hppIsFloatTested = false;
 	
@@ -85,24 +89,769 @@ const size_t hppTypeNameLenght[HPP_MAX_TYPE_ID + 1] = { 4, 5, 5, 4, 3, 5, 6, 5,
 #endif
 
 
+// Scratch arena for temporary variables
+#define HPP_VAR_SCRATCH_VAR_SIZE ((sizeof(struct hppVarListStruct) + 7) & ~7)            // key and value follow the variable in the same block
+#define HPP_VAR_SCRATCH_CHUNK_HEADER_SIZE ((sizeof(struct hppVarScratchChunkStruct) + 7) & ~7)
+
+struct hppVarScratchChunkStruct
+{
+	struct hppVarScratchChunkStruct* pNext;
+};
+
+static struct hppVarScratchArenaStruct hppVarScratchDefault;               // Arena used outside of parse contexts
+static struct hppVarScratchArenaStruct* hppVarScratchArena = &hppVarScratchDefault;   // Arena used for new temporary variables
+
+// Constants interned for H++ code
+static struct hppVarListStruct* hppVarLastCodeVar = NULL;   // Variable found by hppVarGetCode last, checked first by hppVarGetConstTable
+static unsigned int hppVarInternedCount = 0;                // Number of variables referencing an interned constant
+
+
 /* ====================== */
 /* Key-Value pair storage */
 /* ====================== */
 
-// Update variable (key value pair) with the key 'aszKey' or create new variable with that key if it did not exist before.
-// The new value of the variable is a 'acbValueLen' bytes long binary copy of the 'apValue' array content plus an exta null byte at the end
-// to make sure it can safely be interpreted as a zero terminated string or as a byte arry.
-// The variable is deleted if 'apValue' is NULL. The variable is not initalized if 'apValue' is hppNoInitValue.
-// The variable is initalized with null bytes if 'apValue' is hppInitValueWithZero.
-// Returns a pointer to the newly created or updated stored value or NULL if unsuccessfull or deleted. 
-char* hppVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
+// Returns true if the variable with the key 'aszKey' holds H++ code which may be executed
+bool hppVarIsCode(const char aszKey[])
+{
+	return islower((int)aszKey[0]) && strchr(aszKey, ':') == NULL;
+}
+
+
+// Returns true if changes of the variable 'apVar' must increment hppVarCodeChangeCount
+static bool hppVarIsExecuted(const struct hppVarListStruct* apVar)
+{
+	return (apVar->uiFlags & HPP_VAR_FLAG_CODE) || hppVarIsCode(apVar->szKey);
+}
+
+
+// Record a change of the value or the key of the variable 'apVar' which invalidates pointers into its code and the constants
+// interned for it
+static void hppVarCodeChanged(struct hppVarListStruct* apVar)
+{
+	if(hppVarIsExecuted(apVar)) apVar->uiCodeChangeCount = ++hppVarCodeChangeCount;
+	if(apVar->pConstTable != NULL) hppVarConstTableClear(apVar->pConstTable);
+}
+
+
+// Mark the value of the variable 'apVar' as not referencing read only memory or an interned constant anymore
+static void hppVarClearMapped(struct hppVarListStruct* apVar)
+{
+	if(apVar->uiFlags & HPP_VAR_FLAG_INTERNED) hppVarInternedCount--;
+	apVar->uiFlags &= ~(HPP_VAR_FLAG_MAPPED | HPP_VAR_FLAG_INTERNED);
+}
+
+
+// Returns true if the variable with the key 'aszKey' is a temporary variable of the parser: Local variables, parameters and
+// intermediate results with a key starting with the prefix '%04x:' as well as the result variables of a whole execution. 
+static bool hppVarIsTemporary(const char aszKey[])
+{
+	int i;
+	
+	if(aszKey[0] == '#' || strcmp(aszKey, "ReturnWithError") == 0 || strcmp(aszKey, "ReturnWithDebugInfo") == 0) return true;
+	
+	for(i = 0; i < 4; i++)
+		if(!isdigit((int)aszKey[i]) && (aszKey[i] < 'a' || aszKey[i] > 'f')) return false;
+		
+	return aszKey[4] == ':';
+}
+
+
+// Returns true if 'apMem' is located in the scratch arena block of the variable 'apVar' 
+static bool hppVarIsInScratchBlock(const struct hppVarListStruct* apVar, const char* apMem)
+{
+	if(apVar->uiScratchClass == 0) return false;
+	
+	return apMem >= (const char*)apVar && apMem < (const char*)apVar + (HPP_VAR_SCRATCH_MIN_BLOCK_SIZE << (apVar->uiScratchClass - 1));
+}
+
+
+// Returns the position of the value in the scratch arena block of the variable 'apVar' or NULL if it is not stored in an arena
+static char* hppVarScratchBlockValue(const struct hppVarListStruct* apVar)
+{
+	size_t cbValueOffset = HPP_VAR_SCRATCH_VAR_SIZE;
+	
+	if(apVar->uiScratchClass == 0) return NULL;
+	if(hppVarIsInScratchBlock(apVar, apVar->szKey)) cbValueOffset = (cbValueOffset + strlen(apVar->szKey) + 1 + 7) & ~7;   // Aligned like in hppVarAlloc
+	
+	return (char*)apVar + cbValueOffset;
+}
+
+
+// Release all chunks of the scratch arena 'apArena' except the one used last if 'abKeepChunk' is true. 
+// Must only be called if no variable is stored in the arena.
+static void hppVarScratchReset(struct hppVarScratchArenaStruct* apArena, bool abKeepChunk)
+{
+	struct hppVarScratchChunkStruct* pChunk;
+	int i;
+	
+	while(apArena->pChunks != NULL && (!abKeepChunk || apArena->pChunks->pNext != NULL))
+	{
+		pChunk = abKeepChunk ? apArena->pChunks->pNext : apArena->pChunks;
+		if(abKeepChunk) apArena->pChunks->pNext = pChunk->pNext;
+		else apArena->pChunks = pChunk->pNext;
+		free(pChunk);
+	}
+	
+	apArena->cbChunkUsed = 0;
+	for(i = 0; i < HPP_VAR_SCRATCH_CLASS_COUNT; i++) apArena->pFree[i] = NULL;
+}
+
+
+// Take a block of the size class 'auiClass' from the scratch arena 'apArena'. Returns NULL if memory was not sufficient.
+static struct hppVarListStruct* hppVarScratchTake(struct hppVarScratchArenaStruct* apArena, unsigned int auiClass)
+{
+	struct hppVarListStruct* newVar = apArena->pFree[auiClass];
+	size_t cbBlockSize = HPP_VAR_SCRATCH_MIN_BLOCK_SIZE << auiClass;
+	
+	if(newVar != NULL) apArena->pFree[auiClass] = newVar->pNext;
+	else 
+	{
+		// Take a new block from the present chunk of the arena or start a new chunk 
+		if(apArena->pChunks == NULL || apArena->cbChunkUsed + cbBlockSize > HPP_VAR_SCRATCH_CHUNK_SIZE)
+		{
+			struct hppVarScratchChunkStruct* pChunk = (struct hppVarScratchChunkStruct*) malloc(HPP_VAR_SCRATCH_CHUNK_HEADER_SIZE + HPP_VAR_SCRATCH_CHUNK_SIZE);
+			hppVarHeapAllocCount++;
+			
+			if(pChunk == NULL) return NULL;
+			
+			pChunk->pNext = apArena->pChunks;
+			apArena->pChunks = pChunk;
+			apArena->cbChunkUsed = 0;
+		}
+		
+		newVar = (struct hppVarListStruct*)((char*)apArena->pChunks + HPP_VAR_SCRATCH_CHUNK_HEADER_SIZE + apArena->cbChunkUsed);
+		apArena->cbChunkUsed += cbBlockSize;
+	}
+	
+	newVar->uiScratchClass = auiClass + 1;
+	newVar->pScratchArena = apArena;
+	apArena->uiLiveCount++;
+	
+	return newVar;
+}
+
+
+// Create a variable with the key 'aszKey' and memory for a value of 'acbValueLen' bytes plus the ending null byte.
+// Temporary variables are stored in a single block of the selected scratch arena, such that no heap operation is needed in 
+// most cases. Other variables use the heap. If 'apAdoptValue' is not NULL, the variable uses this heap buffer as value instead 
+// and 'acbValueLen' must be zero. Returns NULL if memory was not sufficient.
+static struct hppVarListStruct* hppVarAlloc(const char aszKey[], size_t acbValueLen, char* apAdoptValue)
+{
+	struct hppVarListStruct* newVar;
+	size_t cbKeyLen = strlen(aszKey) + 1;
+	size_t cbValueOffset = (HPP_VAR_SCRATCH_VAR_SIZE + cbKeyLen + 7) & ~7;   // Values are aligned like heap memory for binary access
+	size_t cbBlockSize = HPP_VAR_SCRATCH_MIN_BLOCK_SIZE;
+	unsigned int uiClass = 0;
+	
+	if(hppVarIsTemporary(aszKey))
+	{
+		// Find the smallest block size class the variable fits in
+		while(uiClass < HPP_VAR_SCRATCH_CLASS_COUNT && cbValueOffset + acbValueLen + 1 > cbBlockSize) 
+		{
+			uiClass++;
+			cbBlockSize <<= 1;
+		}
+		
+		newVar = uiClass < HPP_VAR_SCRATCH_CLASS_COUNT ? hppVarScratchTake(hppVarScratchArena, uiClass) : NULL;
+		
+		if(newVar != NULL)
+		{
+			newVar->uiCodeChangeCount = hppVarCodeChangeCount;
+			newVar->pConstTable = NULL;
+			newVar->szKey = (char*)newVar + HPP_VAR_SCRATCH_VAR_SIZE;
+			newVar->pValue = apAdoptValue != NULL ? apAdoptValue : (char*)newVar + cbValueOffset;
+			strcpy(newVar->szKey, aszKey);
+			return newVar;
+		}
+	}
+	
+	newVar = (struct hppVarListStruct*) malloc(sizeof(struct hppVarListStruct));
+	if(newVar == NULL) return NULL;
+
+	hppVarHeapAllocCount += 2;
+
+	newVar->uiScratchClass = 0;
+	newVar->pScratchArena = NULL;
+	newVar->pConstTable = NULL;
+	newVar->uiCodeChangeCount = hppVarCodeChangeCount;
+	newVar->szKey = (char*) malloc(cbKeyLen);
+	if(newVar->szKey == NULL)
+	{
+		free(newVar);
+		return NULL;
+	}
+
+	strcpy(newVar->szKey, aszKey);
+	
+	if(apAdoptValue != NULL) 
+	{
+		newVar->pValue = apAdoptValue;
+		return newVar;
+	}
+	
+	newVar->pValue = (char *) malloc(acbValueLen + 1); // Add one byte for zero termination
+	hppVarHeapAllocCount++;
+	if(newVar->pValue == NULL)
+	{
+		free(newVar->szKey);
+		free(newVar);
+		return NULL;
+	}
+	
+	return newVar;
+}
+
+
+// Release the memory of the variable 'apVar' which has been removed from the list before.
+// A scratch arena is reset once the last variable stored in the arena has been released. 
+static void hppVarFree(struct hppVarListStruct* apVar)
+{
+	struct hppVarScratchArenaStruct* pArena = apVar->pScratchArena;
+	
+	if(apVar->uiFlags & HPP_VAR_FLAG_INTERNED) hppVarInternedCount--;
+	if(apVar == hppVarLastCodeVar) hppVarLastCodeVar = NULL;
+	
+	if(apVar->pConstTable != NULL)
+	{
+		hppVarConstTableClear(apVar->pConstTable);
+		free(apVar->pConstTable);
+	}
+	
+	if(apVar->uiScratchClass == 0)
+	{
+		if((apVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0) free(apVar->pValue);
+		free(apVar->szKey);
+		free(apVar);
+		return;
+	}
+	
+	// Key and value have been moved to the heap if they did not fit in the block anymore 
+	if(!hppVarIsInScratchBlock(apVar, apVar->pValue) && (apVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0) free(apVar->pValue);
+	if(!hppVarIsInScratchBlock(apVar, apVar->szKey)) free(apVar->szKey);
+	
+	apVar->pNext = pArena->pFree[apVar->uiScratchClass - 1];
+	pArena->pFree[apVar->uiScratchClass - 1] = apVar;
+	
+	if(--pArena->uiLiveCount == 0) hppVarScratchReset(pArena, true);
+}
+
+
+// Remember the key of a deleted variable with a persisted copy 
+static void hppVarTombstoneAdd(const char aszKey[])
+{
+	struct hppVarTombstoneStruct* pTombstone = (struct hppVarTombstoneStruct*) malloc(sizeof(struct hppVarTombstoneStruct) + strlen(aszKey) + 1);
+	
+	if(pTombstone == NULL) return;   // The persisted copy is restored again after the next start
+	
+	strcpy(pTombstone->szKey, aszKey);
+	pTombstone->pNext = pFirstTombstone;
+	pFirstTombstone = pTombstone;
+}
+
+
+// Remove the tombstone of the key 'aszKey'. Returns true if the key had a tombstone, i.e. a persisted copy still exists.
+static bool hppVarTombstoneRemove(const char aszKey[])
+{
+	struct hppVarTombstoneStruct** ppTombstone = &pFirstTombstone;
+	struct hppVarTombstoneStruct* pTombstone;
+	
+	while(*ppTombstone != NULL)
+	{
+		pTombstone = *ppTombstone;
+		
+		if(strcmp(pTombstone->szKey, aszKey) == 0)
+		{
+			*ppTombstone = pTombstone->pNext;
+			free(pTombstone);
+			return true;
+		}
+		
+		ppTombstone = &pTombstone->pNext;
+	}
+	
+	return false;
+}
+
+
+// Flags of a variable with the key 'aszKey' which is created
+static uint8_t hppVarNewFlags(const char aszKey[])
+{
+	if(pFirstTombstone != NULL && hppVarTombstoneRemove(aszKey)) return HPP_VAR_FLAG_DIRTY | HPP_VAR_FLAG_PERSISTED;
+	
+	return HPP_VAR_FLAG_DIRTY;
+}
+
+
+// Release the variable 'apVar' which has been removed from the list before and which is deleted
+static void hppVarRelease(struct hppVarListStruct* apVar)
+{
+	if(apVar->uiFlags & HPP_VAR_FLAG_PERSISTED) hppVarTombstoneAdd(apVar->szKey);
+	
+	hppVarFree(apVar);
+}
+
+
+// Copy the mapped value of the variable 'apVar' to the heap, such that it can be written. Returns false if memory was not sufficient.
+static bool hppVarPromote(struct hppVarListStruct* apVar)
+{
+	char *pValue = (char *) malloc(apVar->cbValueLen + 1);
+	
+	hppVarHeapAllocCount++;
+	if(pValue == NULL) return false;
+	
+	memcpy(pValue, apVar->pValue, apVar->cbValueLen + 1);
+	apVar->pValue = pValue;
+	hppVarClearMapped(apVar);
+	
+	hppVarCodeChanged(apVar);
+	
+	return true;
+}
+
+
+// Resize the value array of the variable 'apVar' to 'acbValueLen' bytes plus the ending null byte keeping its present content.
+// Values of temporary variables stay in their block of the scratch arena as long as they fit. Mapped values are moved to the heap.
+// Returns false if memory was not sufficient. The value is released and set to NULL in this case.
+static bool hppVarResize(struct hppVarListStruct* apVar, size_t acbValueLen)
+{
+	char *pTmp = apVar->pValue;
+
+	if(apVar->uiFlags & HPP_VAR_FLAG_MAPPED)
+	{
+		char* pchBlockValue = hppVarScratchBlockValue(apVar);
+		
+		// Temporary variables referencing an interned constant use their block again if the value fits
+		if(pchBlockValue != NULL && hppVarIsInScratchBlock(apVar, pchBlockValue + acbValueLen)) apVar->pValue = pchBlockValue;
+		else 
+		{
+			apVar->pValue = (char *) malloc(acbValueLen + 1);
+			hppVarHeapAllocCount++;
+		}
+		
+		if(apVar->pValue != NULL) memcpy(apVar->pValue, pTmp, acbValueLen < apVar->cbValueLen ? acbValueLen : apVar->cbValueLen);
+		hppVarClearMapped(apVar);
+	}
+	else if(hppVarIsInScratchBlock(apVar, pTmp))
+	{
+		if(hppVarIsInScratchBlock(apVar, pTmp + acbValueLen)) return true;   // Still fits
+		
+		apVar->pValue = (char *) malloc(acbValueLen + 1);
+		hppVarHeapAllocCount++;
+		if(apVar->pValue != NULL) memcpy(apVar->pValue, pTmp, apVar->cbValueLen + 1);   // New value is longer than the old one 
+	}
+	else
+	{
+		apVar->pValue = (char *) realloc(pTmp, acbValueLen + 1); // Add one byte for zero termination
+		hppVarHeapAllocCount++;
+		if(apVar->pValue == NULL) free(pTmp);                    // New allocation failed, free old memory 
+	}
+	
+	return apVar->pValue != NULL;
+}
+
+
+// Update variable (key value pair) with the key 'aszKey' or create new variable with that key if it did not exist before.
+// The new value of the variable is a 'acbValueLen' bytes long binary copy of the 'apValue' array content plus an exta null byte at the end
+// to make sure it can safely be interpreted as a zero terminated string or as a byte arry.
+// The variable is deleted if 'apValue' is NULL. The variable is not initalized if 'apValue' is hppNoInitValue.
+// The variable is initalized with null bytes if 'apValue' is hppInitValueWithZero.
+// Returns a pointer to the newly created or updated stored value or NULL if unsuccessfull or deleted. 
+char* hppVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
+{
+	struct hppVarListStruct* newVar;
+	struct hppVarListStruct** newVarRef;
+
+	//printf("PUT: %s=%s\n", aszKey, apValue);
+    
+	if(aszKey == NULL) return NULL;
+	hppVarLookupCount++;
+	newVar = pFirstVar;
+	newVarRef = &pFirstVar;
+
+	// Search for the right entry in the list
+	while(newVar != NULL)
+	{
+		if(strcmp(newVar->szKey, aszKey) == 0) break;
+		newVarRef = &newVar->pNext;
+		newVar = newVar->pNext;
+	}
+
+	//  Create new key if it did not already exist or just update the length of the value
+	if(newVar == NULL)
+	{
+		if(apValue == NULL) return NULL;  // Entry not valid
+	
+		newVar = hppVarAlloc(aszKey, acbValueLen, NULL);
+		if(newVar == NULL) return NULL;
+		
+		newVar->uiFlags = hppVarNewFlags(aszKey);
+	}
+	else
+	{
+		// Remove entry found for the list such it can later be added back if everything went ok
+		*newVarRef = newVar->pNext;
+		
+		hppVarCodeChanged(newVar);
+
+		// Just delete entry?
+		if(apValue == NULL)
+		{
+			hppVarRelease(newVar);
+			return NULL;
+		}
+
+		// Resize value array to accommodate new length
+		if(!hppVarResize(newVar, acbValueLen))
+		{
+			hppVarRelease(newVar);
+			return NULL;
+		}
+		
+		newVar->uiFlags |= HPP_VAR_FLAG_DIRTY;
+		
+		// If only the size of the variable changes, it must be possible to initialize the newly added bytes with zero     
+		if(apValue == hppInitValueWithZero && acbValueLen > newVar->cbValueLen) 
+		{
+			memset(newVar->pValue + newVar->cbValueLen, 0, acbValueLen - newVar->cbValueLen);
+			apValue = hppNoInitValue;   // Make sure the present value bytes are not overwritten further below
+		}
+	}
+
+	newVar->cbValueLen = acbValueLen;
+
+	if(apValue == hppInitValueWithZero) memset(newVar->pValue, 0, acbValueLen); 
+	else if(apValue != hppNoInitValue) memcpy(newVar->pValue, apValue, acbValueLen);
+	newVar->pValue[acbValueLen] = 0;   // Always terminate the array wiht zero to make sure it can always be interpretet as a zero terminted string
+
+    // Add the new value to the list
+	newVar->pNext = pFirstVar;
+	pFirstVar = newVar;
+
+	return newVar->pValue;
+}
+
+
+// Update variable with the key 'aszKey' or create new variable with that key if it did not exist before.
+// The variable takes over the heap buffer 'apBuffer' as its value without copying it. 'apBuffer' must be allocated with
+// malloc(...) and hold 'acbValueLen' bytes plus one extra byte for the ending null byte. The buffer is owned by the variable
+// storage after the call and released with free(...) if unsuccessfull.
+// Returns a pointer to the stored value (same as 'apBuffer') or NULL if unsuccessfull.
+char* hppVarPutAdopt(const char aszKey[], char* apBuffer, size_t acbValueLen)
+{
+	struct hppVarListStruct* newVar;
+	struct hppVarListStruct** newVarRef;
+
+	if(aszKey == NULL || apBuffer == NULL)
+	{
+		free(apBuffer);
+		return NULL;
+	}
+	
+	hppVarLookupCount++;
+	newVar = pFirstVar;
+	newVarRef = &pFirstVar;
+
+	// Search for the right entry in the list
+	while(newVar != NULL)
+	{
+		if(strcmp(newVar->szKey, aszKey) == 0) break;
+		newVarRef = &newVar->pNext;
+		newVar = newVar->pNext;
+	}
+
+	if(newVar == NULL)
+	{
+		newVar = hppVarAlloc(aszKey, 0, apBuffer);
+		if(newVar == NULL) 
+		{
+			free(apBuffer);
+			return NULL;
+		}
+		
+		newVar->uiFlags = hppVarNewFlags(aszKey);
+	}
+	else
+	{
+		// Remove entry found for the list and replace the value array
+		*newVarRef = newVar->pNext;
+		
+		hppVarCodeChanged(newVar);
+		if(!hppVarIsInScratchBlock(newVar, newVar->pValue) && (newVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0) free(newVar->pValue);
+		
+		newVar->pValue = apBuffer;
+		hppVarClearMapped(newVar);
+		newVar->uiFlags |= HPP_VAR_FLAG_DIRTY;
+	}
+
+	newVar->cbValueLen = acbValueLen;
+	newVar->pValue[acbValueLen] = 0;
+
+	// Add the variable to the list
+	newVar->pNext = pFirstVar;
+	pFirstVar = newVar;
+
+	return newVar->pValue;
+}
+
+
+// Update variable with the key 'aszKey' or create new variable with that key if it did not exist before.
+// The new value of the variable is a copy of the 'aszValue' string.
+// The variable is deleted if 'apValue' is NULL. The variable is not initalized if 'apValue' is hppNoInitValue.
+// The variable is not initalized with null bytes if 'apValue' is hppInitValueWithZero.
+// Returns a pointer to the newly created or updated stored value or NULL if unsuccessfull or deleted.
+char* hppVarPutStr(const char aszKey[], const char aszValue[], size_t* apcbResultLen_Out)
+{
+	size_t cbValLen = 0;
+	if(aszValue != NULL) cbValLen = strlen(aszValue);
+	if(apcbResultLen_Out != NULL) *apcbResultLen_Out = cbValLen;
+	return hppVarPut(aszKey, aszValue, cbValLen);
+}
+
+
+// Get variable with the key 'aszKey' and provide the value array lenght in 'apcbValueLen_Out' 
+char* hppVarGet(const char aszKey[], size_t* apcbValueLen_Out)
+{
+	struct hppVarListStruct* searchVar;
+
+	if(aszKey == NULL) return NULL;
+	hppVarLookupCount++;
+	searchVar = pFirstVar;
+
+	// Search for the right entry in the list
+	while(searchVar != NULL)
+	{
+		if(strcmp(searchVar->szKey, aszKey) == 0) break;
+		searchVar = searchVar->pNext;
+	}
+
+	if(apcbValueLen_Out != NULL)
+	{
+		if(searchVar != NULL) *apcbValueLen_Out = searchVar->cbValueLen;
+		else *apcbValueLen_Out = 0; 
+	}
+
+	if(searchVar == NULL) return NULL;
+
+	return searchVar->pValue;
+}
+
+
+// Get variable with the key 'aszKey' like hppVarGet(...) for writing the value in place. A mapped value is copied to the heap
+// before. Returns NULL if the variable does not exist or memory was not sufficient.
+char* hppVarGetWritable(const char aszKey[], size_t* apcbValueLen_Out)
+{
+	struct hppVarListStruct* searchVar;
+
+	if(apcbValueLen_Out != NULL) *apcbValueLen_Out = 0; 
+	if(aszKey == NULL) return NULL;
+	hppVarLookupCount++;
+	searchVar = pFirstVar;
+
+	// Search for the right entry in the list
+	while(searchVar != NULL)
+	{
+		if(strcmp(searchVar->szKey, aszKey) == 0) break;
+		searchVar = searchVar->pNext;
+	}
+
+	if(searchVar == NULL) return NULL;
+	if((searchVar->uiFlags & HPP_VAR_FLAG_MAPPED) && !hppVarPromote(searchVar)) return NULL;
+	
+	hppVarCodeChanged(searchVar);
+	searchVar->uiFlags |= HPP_VAR_FLAG_DIRTY;
+	if(apcbValueLen_Out != NULL) *apcbValueLen_Out = searchVar->cbValueLen;
+
+	return searchVar->pValue;
+}
+
+
+// Get variable with the key 'aszKey' like hppVarGet(...) for executing the value as H++ code. Any later change of the variable
+// increments hppVarCodeChangeCount, such that tasks executing the code notice it.
+char* hppVarGetCode(const char aszKey[], size_t* apcbValueLen_Out)
+{
+	struct hppVarListStruct* searchVar;
+
+	if(apcbValueLen_Out != NULL) *apcbValueLen_Out = 0; 
+	if(aszKey == NULL) return NULL;
+	hppVarLookupCount++;
+	searchVar = pFirstVar;
+
+	// Search for the right entry in the list
+	while(searchVar != NULL)
+	{
+		if(strcmp(searchVar->szKey, aszKey) == 0) break;
+		searchVar = searchVar->pNext;
+	}
+
+	if(searchVar == NULL) return NULL;
+	
+	searchVar->uiFlags |= HPP_VAR_FLAG_CODE;
+	hppVarLastCodeVar = searchVar;
+	if(apcbValueLen_Out != NULL) *apcbValueLen_Out = searchVar->cbValueLen;
+
+	return searchVar->pValue;
+}
+
+
+// Get the table of the constants interned for the code 'apchCode'. Only the pointers are compared, no key is looked up.
+struct hppVarConstTableStruct* hppVarGetConstTable(const char* apchCode)
+{
+	struct hppVarListStruct* searchVar = hppVarLastCodeVar;
+
+	if(apchCode == NULL) return NULL;
+
+	// The code is usually the value of the variable just found by hppVarGetCode
+	if(searchVar == NULL || searchVar->pValue != apchCode)
+		for(searchVar = pFirstVar; searchVar != NULL && searchVar->pValue != apchCode; searchVar = searchVar->pNext);
+	
+	if(searchVar == NULL) return NULL;
+	
+	if(searchVar->pConstTable == NULL)
+	{
+		searchVar->pConstTable = (struct hppVarConstTableStruct*) calloc(1, sizeof(struct hppVarConstTableStruct));
+		hppVarHeapAllocCount++;
+	}
+
+	return searchVar->pConstTable;
+}
+
+
+// Returns the index of the first constant of the table 'apTable' at the position 'acbPos' with the tag 'auiTag' or behind it
+static unsigned int hppVarConstFind(const struct hppVarConstTableStruct* apTable, size_t acbPos, uintptr_t auiTag)
+{
+	unsigned int uiLow = 0;
+	unsigned int uiHigh = apTable->uiCount;
+	unsigned int uiMid;
+	const struct hppVarConstStruct* pConst;
+	
+	while(uiLow < uiHigh)
+	{
+		uiMid = (uiLow + uiHigh) / 2;
+		pConst = apTable->ppConsts[uiMid];
+		
+		if(pConst->cbPos < acbPos || (pConst->cbPos == acbPos && pConst->uiTag < auiTag)) uiLow = uiMid + 1;
+		else uiHigh = uiMid;
+	}
+	
+	return uiLow;
+}
+
+
+// Get the constant interned at the position 'acbPos' with the tag 'auiTag' from the table 'apTable'
+const struct hppVarConstStruct* hppVarConstGet(const struct hppVarConstTableStruct* apTable, size_t acbPos, uintptr_t auiTag)
+{
+	unsigned int uiIndex;
+	
+	if(apTable == NULL || apTable->uiCount == 0) return NULL;
+	
+	uiIndex = hppVarConstFind(apTable, acbPos, auiTag);
+	if(uiIndex == apTable->uiCount || apTable->ppConsts[uiIndex]->cbPos != acbPos || apTable->ppConsts[uiIndex]->uiTag != auiTag) return NULL;
+	
+	return apTable->ppConsts[uiIndex];
+}
+
+
+// Intern a copy of the constant 'apValue' at the position 'acbPos' with the tag 'auiTag' in the table 'apTable'
+bool hppVarConstPut(struct hppVarConstTableStruct* apTable, size_t acbPos, uintptr_t auiTag, size_t acbSourceLen, char achTerm, const char apValue[], size_t acbValueLen)
+{
+	struct hppVarConstStruct* pConst;
+	unsigned int uiIndex;
+	
+	if(apTable == NULL || apValue == NULL || acbValueLen > HPP_VAR_CONST_MAX_LEN || apTable->uiCount >= HPP_VAR_CONST_MAX_COUNT) return false;
+	
+	uiIndex = hppVarConstFind(apTable, acbPos, auiTag);
+	if(uiIndex < apTable->uiCount && apTable->ppConsts[uiIndex]->cbPos == acbPos && apTable->ppConsts[uiIndex]->uiTag == auiTag) return true;
+	
+	if(apTable->uiCount == apTable->uiSize)
+	{
+		unsigned int uiSize = apTable->uiSize == 0 ? 8 : 2 * apTable->uiSize;
+		struct hppVarConstStruct** ppConsts = (struct hppVarConstStruct**) realloc(apTable->ppConsts, uiSize * sizeof(struct hppVarConstStruct*));
+		
+		hppVarHeapAllocCount++;
+		if(ppConsts == NULL) return false;
+		
+		apTable->ppConsts = ppConsts;
+		apTable->uiSize = uiSize;
+	}
+	
+	pConst = (struct hppVarConstStruct*) malloc(sizeof(struct hppVarConstStruct) + acbValueLen + 1);
+	hppVarHeapAllocCount++;
+	if(pConst == NULL) return false;
+	
+	pConst->cbPos = acbPos;
+	pConst->uiTag = auiTag;
+	pConst->cbSourceLen = acbSourceLen;
+	pConst->cbValueLen = acbValueLen;
+	pConst->chTerm = achTerm;
+	memcpy(pConst->achValue, apValue, acbValueLen);
+	pConst->achValue[acbValueLen] = 0;
+	
+	memmove(apTable->ppConsts + uiIndex + 1, apTable->ppConsts + uiIndex, (apTable->uiCount - uiIndex) * sizeof(struct hppVarConstStruct*));
+	apTable->ppConsts[uiIndex] = pConst;
+	apTable->uiCount++;
+	
+	return true;
+}
+
+
+// Returns true if 'apchValue' is the value of one of the constants of the table 'apTable'
+static bool hppVarConstTableHas(const struct hppVarConstTableStruct* apTable, const char* apchValue)
+{
+	unsigned int i;
+	
+	for(i = 0; i < apTable->uiCount; i++) if(apTable->ppConsts[i]->achValue == apchValue) return true;
+	
+	return false;
+}
+
+
+// Release all constants of the table 'apTable'. Variables referencing one of them get a copy of their value before.
+unsigned int hppVarConstTableClear(struct hppVarConstTableStruct* apTable)
+{
+	struct hppVarListStruct* searchVar;
+	unsigned int uiInternedCount = 0;
+	unsigned int uiMoved = 0;
+	unsigned int i;
+	
+	if(apTable == NULL || apTable->ppConsts == NULL) return 0;
+	
+	// Interned values are referenced by a few temporary variables at most, which are usually found at the begin of the list
+	for(searchVar = pFirstVar; searchVar != NULL && uiInternedCount < hppVarInternedCount; searchVar = searchVar->pNext)
+	{
+		if((searchVar->uiFlags & HPP_VAR_FLAG_INTERNED) == 0) continue;
+		
+		if(!hppVarConstTableHas(apTable, searchVar->pValue)) uiInternedCount++;
+		else if(hppVarPromote(searchVar)) uiMoved++;
+		else 
+		{
+			// Memory was not sufficient, the value is lost
+			searchVar->pValue = (char*)"";
+			searchVar->cbValueLen = 0;
+			hppVarClearMapped(searchVar);
+			searchVar->uiFlags |= HPP_VAR_FLAG_MAPPED;
+		}
+	}
+	
+	for(i = 0; i < apTable->uiCount; i++) free(apTable->ppConsts[i]);
+	free(apTable->ppConsts);
+	
+	apTable->ppConsts = NULL;
+	apTable->uiCount = 0;
+	apTable->uiSize = 0;
+	
+	return uiMoved;
+}
+
+
+// Update variable with the key 'aszKey' or create it referencing the interned constant 'apConst' instead of a copy
+char* hppVarPutInterned(const char aszKey[], const struct hppVarConstStruct* apConst)
 {
 	struct hppVarListStruct* newVar;
 	struct hppVarListStruct** newVarRef;
 
-	//printf("PUT: %s=%s\n", aszKey, apValue);
-    
-	if(aszKey == NULL) return NULL;
+	if(aszKey == NULL || apConst == NULL) return NULL;
+	
+	hppVarLookupCount++;
 	newVar = pFirstVar;
 	newVarRef = &pFirstVar;
 
@@ -114,64 +863,31 @@ char* hppVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
 		newVar = newVar->pNext;
 	}
 
-	//  Create new key if it did not already exist or just update the length of the value
 	if(newVar == NULL)
 	{
-		if(apValue == NULL) return NULL;  // Entry not valid
-	
-		newVar = (struct hppVarListStruct*) malloc(sizeof(struct hppVarListStruct));
+		newVar = hppVarAlloc(aszKey, 0, (char*)apConst->achValue);
 		if(newVar == NULL) return NULL;
-
-		newVar->szKey = (char*) malloc(strlen(aszKey) + 1);
-		if(newVar->szKey == NULL)
-		{
-			free(newVar);
-			return NULL;
-		}
-
-		strcpy(newVar->szKey, aszKey);
-		newVar->pValue = (char *) malloc(acbValueLen + 1); // Add one byte for zero termination
+		
+		newVar->uiFlags = hppVarNewFlags(aszKey);
 	}
 	else
 	{
-		// Remove entry found for the list such it can later be added back if everything went ok
+		// Remove entry found for the list and replace the value array
 		*newVarRef = newVar->pNext;
-
-		// Just delete entry?
-		if(apValue == NULL)
-		{
-			free(newVar->szKey);
-			free(newVar->pValue);
-			free(newVar);
-			return NULL;
-		}
-
-		// Realloc value array to accommodate new length
-		char *pTmp = newVar->pValue;
-		newVar->pValue = (char *) realloc(pTmp, acbValueLen + 1); // Add one byte for zero termination
-		if(newVar->pValue == NULL) free(pTmp);                    // New allocation failed, free old memory 
 		
-		// If only the size of the variable changes, it must be possible to initialize the newly added bytes with zero     
-		if(apValue == hppInitValueWithZero && acbValueLen > newVar->cbValueLen) 
-		{
-			if(newVar->pValue != NULL) memset(newVar->pValue + newVar->cbValueLen, 0, acbValueLen - newVar->cbValueLen);
-			apValue = hppNoInitValue;   // Make sure the present value bytes are not overwritten further below
-		}
-	}
-
-	newVar->cbValueLen = acbValueLen;
-	if(newVar->pValue == NULL)
-	{
-		free(newVar->szKey);
-		free(newVar);
-		return NULL;
+		hppVarCodeChanged(newVar);
+		if(!hppVarIsInScratchBlock(newVar, newVar->pValue) && (newVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0) free(newVar->pValue);
+		
+		hppVarClearMapped(newVar);
+		newVar->pValue = (char*)apConst->achValue;
+		newVar->uiFlags |= HPP_VAR_FLAG_DIRTY;
 	}
 
-	if(apValue == hppInitValueWithZero) memset(newVar->pValue, 0, acbValueLen); 
-	else if(apValue != hppNoInitValue) memcpy(newVar->pValue, apValue, acbValueLen);
-	newVar->pValue[acbValueLen] = 0;   // Always terminate the array wiht zero to make sure it can always be interpretet as a zero terminted string
+	newVar->uiFlags |= HPP_VAR_FLAG_MAPPED | HPP_VAR_FLAG_INTERNED;
+	newVar->cbValueLen = apConst->cbValueLen;
+	hppVarInternedCount++;
 
-    // Add the new value to the list
+	// Add the variable to the list
 	newVar->pNext = pFirstVar;
 	pFirstVar = newVar;
 
@@ -179,44 +895,62 @@ char* hppVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
 }
 
 
-// Update variable with the key 'aszKey' or create new variable with that key if it did not exist before.
-// The new value of the variable is a copy of the 'aszValue' string.
-// The variable is deleted if 'apValue' is NULL. The variable is not initalized if 'apValue' is hppNoInitValue.
-// The variable is not initalized with null bytes if 'apValue' is hppInitValueWithZero.
-// Returns a pointer to the newly created or updated stored value or NULL if unsuccessfull or deleted.
-char* hppVarPutStr(const char aszKey[], const char aszValue[], size_t* apcbResultLen_Out)
+// Returns true if 'apchCode' is the value of a variable which has not been updated, renamed or deleted since hppVarCodeChangeCount
+// had the value 'auiChangeCount'. Only the pointers are compared, no key is looked up.
+bool hppVarIsCodeUnchanged(const char* apchCode, uint32_t auiChangeCount)
 {
-	size_t cbValLen = 0;
-	if(aszValue != NULL) cbValLen = strlen(aszValue);
-	if(apcbResultLen_Out != NULL) *apcbResultLen_Out = cbValLen;
-	return hppVarPut(aszKey, aszValue, cbValLen);
+	struct hppVarListStruct* searchVar;
+
+	if(apchCode == NULL) return false;
+
+	for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+	{
+		if(searchVar->pValue == apchCode) return (int32_t)(searchVar->uiCodeChangeCount - auiChangeCount) <= 0;
+	}
+
+	return false;
 }
 
 
-// Get variable with the key 'aszKey' and provide the value array lenght in 'apcbValueLen_Out' 
-char* hppVarGet(const char aszKey[], size_t* apcbValueLen_Out)
+// Copy all mapped values located in the 'acbLen' bytes starting at 'apchStart' to the heap, e.g. before the memory is written or 
+// unmapped. Returns false if memory was not sufficient for all values.
+bool hppVarUnmap(const char* apchStart, size_t acbLen)
 {
 	struct hppVarListStruct* searchVar;
+	bool bSuccess = true;
 
-	if(aszKey == NULL) return NULL;
+	for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+	{
+		if((searchVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0 || searchVar->pValue < apchStart || searchVar->pValue >= apchStart + acbLen) continue;
+		
+		if(!hppVarPromote(searchVar)) bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+
+// Mark the variable with the key 'aszKey' as unchanged since its persisted copy was written or restored.
+// Returns false if the variable does not exist.
+bool hppVarSetPersisted(const char aszKey[])
+{
+	struct hppVarListStruct* searchVar;
+
+	if(aszKey == NULL) return false;
 	searchVar = pFirstVar;
 
-	// Search for the right entry in the list
 	while(searchVar != NULL)
 	{
-		if(strcmp(searchVar->szKey, aszKey) == 0) break;
+		if(strcmp(searchVar->szKey, aszKey) == 0) 
+		{
+			searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | HPP_VAR_FLAG_PERSISTED;
+			return true;
+		}
+		
 		searchVar = searchVar->pNext;
 	}
 
-	if(apcbValueLen_Out != NULL)
-	{
-		if(searchVar != NULL) *apcbValueLen_Out = searchVar->cbValueLen;
-		else *apcbValueLen_Out = 0; 
-	}
-
-	if(searchVar == NULL) return NULL;
-
-	return searchVar->pValue;
+	return false;
 }
 
 
@@ -229,6 +963,7 @@ const char* hppVarGetKey(const char aszKey[], bool abCaseSensitive)
 	size_t i;
 
 	if(aszKey == NULL) return NULL;
+	hppVarLookupCount++;
 	searchVar = pFirstVar;
 
 	// Search for the right entry in the list
@@ -275,10 +1010,9 @@ void hppVarDeleteAll(const char aszKeyPrefix[])
 	{
 		if(strncmp(searchVar->szKey, aszKeyPrefix, cbKeyPrefixLen) == 0) 
 		{
+			hppVarCodeChanged(searchVar);
 			*searchVarRef = searchVar->pNext;   // Remove entry from list and keep the reference of pointer for next element
-			free(searchVar->pValue);			// free memory of this element
-			free(searchVar->szKey);
-			free(searchVar);
+			hppVarRelease(searchVar);			// free memory of this element
 		}
 		else searchVarRef = &searchVar->pNext;   // store reference of pointer for next element
 
@@ -287,6 +1021,120 @@ void hppVarDeleteAll(const char aszKeyPrefix[])
 }
 
 
+// Replace the prefix 'aszKeyPrefix' by 'aszNewKeyPrefix' in the keys of all variables starting with 'aszKeyPrefix'.
+// Variables already starting with 'aszNewKeyPrefix' are deleted before. Returns false if memory was not sufficient. 
+bool hppVarRenameAll(const char aszKeyPrefix[], const char aszNewKeyPrefix[])
+{
+	struct hppVarListStruct* searchVar;
+	size_t cbKeyPrefixLen;
+	size_t cbNewKeyPrefixLen;
+	char* szNewKey;
+	bool bRetVal = true;
+
+	if(aszKeyPrefix == NULL || aszNewKeyPrefix == NULL) return false;
+	cbKeyPrefixLen = strlen(aszKeyPrefix);
+	cbNewKeyPrefixLen = strlen(aszNewKeyPrefix);
+	
+	hppVarDeleteAll(aszNewKeyPrefix);
+	searchVar = pFirstVar;
+
+	while(searchVar != NULL)
+	{
+		if(strncmp(searchVar->szKey, aszKeyPrefix, cbKeyPrefixLen) == 0) 
+		{
+			szNewKey = (char*) malloc(strlen(searchVar->szKey) - cbKeyPrefixLen + cbNewKeyPrefixLen + 1);
+			
+			if(szNewKey != NULL)
+			{
+				strcpy(szNewKey, aszNewKeyPrefix);
+				strcpy(szNewKey + cbNewKeyPrefixLen, searchVar->szKey + cbKeyPrefixLen);
+				if(hppVarIsExecuted(searchVar) || hppVarIsCode(szNewKey)) searchVar->uiCodeChangeCount = ++hppVarCodeChangeCount;
+				if(searchVar->uiFlags & HPP_VAR_FLAG_PERSISTED) hppVarTombstoneAdd(searchVar->szKey);
+				if(!hppVarIsInScratchBlock(searchVar, searchVar->szKey)) free(searchVar->szKey);
+				searchVar->szKey = szNewKey;
+				searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | hppVarNewFlags(szNewKey);
+			}
+			else bRetVal = false;
+		}
+
+		searchVar = searchVar->pNext;
+	}
+	
+	return bRetVal;
+}
+
+
+// Store temporary variables created from now on in the scratch arena 'apArena'. Returns the arena selected before.
+struct hppVarScratchArenaStruct* hppVarScratchSelect(struct hppVarScratchArenaStruct* apArena)
+{
+	struct hppVarScratchArenaStruct* pPrevious = hppVarScratchArena;
+	
+	hppVarScratchArena = apArena != NULL ? apArena : &hppVarScratchDefault;
+	
+	return pPrevious != &hppVarScratchDefault ? pPrevious : NULL;
+}
+
+
+// Release the scratch arena 'apArena' of a finished execution. Variables still stored in it are moved to the default arena.
+unsigned int hppVarScratchRelease(struct hppVarScratchArenaStruct* apArena, bool abKeepChunk)
+{
+	struct hppVarListStruct** searchVarRef = &pFirstVar;
+	struct hppVarListStruct* searchVar;
+	struct hppVarListStruct* newVar;
+	unsigned int uiMoved = 0;
+	
+	if(apArena == NULL || apArena == &hppVarScratchDefault) return 0;
+	if(hppVarScratchArena == apArena) hppVarScratchArena = &hppVarScratchDefault;
+	
+	// New variables are inserted at the begin of the list, such that the search usually ends after a few variables
+	while(apArena->uiLiveCount > 0 && *searchVarRef != NULL)
+	{
+		searchVar = *searchVarRef;
+		
+		if(searchVar->pScratchArena != apArena) 
+		{
+			searchVarRef = &searchVar->pNext;
+			continue;
+		}
+		
+		apArena->uiLiveCount--;
+		newVar = hppVarScratchTake(&hppVarScratchDefault, searchVar->uiScratchClass - 1);
+		
+		if(newVar == NULL)
+		{
+			// Memory was not sufficient, the variable is lost
+			*searchVarRef = searchVar->pNext;
+			hppVarCodeChanged(searchVar);
+			if(searchVar->uiFlags & HPP_VAR_FLAG_INTERNED) hppVarInternedCount--;
+			if(searchVar == hppVarLastCodeVar) hppVarLastCodeVar = NULL;
+			free(searchVar->pConstTable);
+			if(!hppVarIsInScratchBlock(searchVar, searchVar->pValue) && (searchVar->uiFlags & HPP_VAR_FLAG_MAPPED) == 0) free(searchVar->pValue);
+			if(!hppVarIsInScratchBlock(searchVar, searchVar->szKey)) free(searchVar->szKey);
+			continue;
+		}
+		
+		// Copy the whole block and move the key and the value with it unless they have been moved to the heap before
+		memcpy(newVar, searchVar, HPP_VAR_SCRATCH_MIN_BLOCK_SIZE << (searchVar->uiScratchClass - 1));
+		newVar->pScratchArena = &hppVarScratchDefault;
+		if(searchVar == hppVarLastCodeVar) hppVarLastCodeVar = newVar;
+		if(hppVarIsInScratchBlock(searchVar, searchVar->szKey)) newVar->szKey = (char*)newVar + (searchVar->szKey - (char*)searchVar);
+		if(hppVarIsInScratchBlock(searchVar, searchVar->pValue)) 
+		{
+			newVar->pValue = (char*)newVar + (searchVar->pValue - (char*)searchVar);
+			hppVarCodeChanged(newVar);
+		}
+		
+		*searchVarRef = newVar;
+		searchVarRef = &newVar->pNext;
+		uiMoved++;
+	}
+	
+	hppVarScratchReset(apArena, abKeepChunk);
+	
+	return uiMoved;
+}
+
+
 // Count variables starting with the key 'aszKeyPrefix'
 // If 'abExludeRootElements' is true then varaibles including another '.' behind the search text are not counted
 int hppVarCount(const char aszKeyPrefix[], bool abExludeRootElements)
@@ -418,6 +1266,259 @@ int hppVarGetAll(char* aszResult, size_t acbMaxLen, const char aszKeyPrefix[], c
 
 
 
+/* ================ */
+/* Snapshot images  */
+/* ================ */
+
+// Offset of a value behind a key ending at 'acbOffset'
+#define HPP_VAR_IMAGE_VALUE_OFFSET(acbOffset) (((acbOffset) + HPP_VAR_IMAGE_VALUE_ALIGN - 1) & ~(size_t)(HPP_VAR_IMAGE_VALUE_ALIGN - 1))
+
+
+// CRC-32 (IEEE 802.3, reflected) with a table of 16 entries, one nibble per step
+static uint32_t hppVarImageCrc(const char* apchData, size_t acbLen)
+{
+	static const uint32_t auiTable[16] = { 0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	                                       0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+	uint32_t uiCrc = 0xFFFFFFFF;
+	size_t i;
+
+	for(i = 0; i < acbLen; i++)
+	{
+		uiCrc ^= (uint8_t)apchData[i];
+		uiCrc = (uiCrc >> 4) ^ auiTable[uiCrc & 0x0F];
+		uiCrc = (uiCrc >> 4) ^ auiTable[uiCrc & 0x0F];
+	}
+
+	return ~uiCrc;
+}
+
+
+// Write a snapshot image of all variables accepted by 'apFilter' with the sequence number 'auiSequence' to 'apchImage'.
+// The image is written only if it fits in 'acbMaxLen' bytes. Similar to 'snprintf(...)' the return value is the size of 
+// the full image in any case, such that the image can be written to a buffer allocated according to a first call with 
+// 'acbMaxLen' = 0. Temporary variables of the parser are never part of the image.
+size_t hppVarImageBuild(char* apchImage, size_t acbMaxLen, bool (*apFilter)(const char aszKey[]), uint32_t auiSequence)
+{
+	struct hppVarImageHeaderStruct* pHeader = (struct hppVarImageHeaderStruct*)apchImage;
+	struct hppVarImageIndexStruct* pIndex;
+	struct hppVarListStruct* searchVar;
+	size_t cbImageLen;
+	size_t cbKeyLen;
+	uint32_t uiCount = 0;
+	uint32_t uiOffset;
+
+	for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+		if(!hppVarIsTemporary(searchVar->szKey) && apFilter(searchVar->szKey)) uiCount++;
+	
+	// Size of the index and of the keys and the aligned values
+	cbImageLen = sizeof(struct hppVarImageHeaderStruct) + uiCount * sizeof(struct hppVarImageIndexStruct);
+	
+	for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+	{
+		if(hppVarIsTemporary(searchVar->szKey) || !apFilter(searchVar->szKey)) continue;
+		
+		cbImageLen = HPP_VAR_IMAGE_VALUE_OFFSET(cbImageLen + strlen(searchVar->szKey) + 1) + searchVar->cbValueLen + 1;
+	}
+	
+	if(apchImage == NULL || cbImageLen > acbMaxLen) return cbImageLen;
+	
+	pIndex = (struct hppVarImageIndexStruct*)(apchImage + sizeof(struct hppVarImageHeaderStruct));
+	uiOffset = sizeof(struct hppVarImageHeaderStruct) + uiCount * sizeof(struct hppVarImageIndexStruct);
+	
+	// Index entry followed by the key and the value of each variable. Keys and values are null terminated.
+	for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+	{
+		if(hppVarIsTemporary(searchVar->szKey) || !apFilter(searchVar->szKey)) continue;
+
+		cbKeyLen = strlen(searchVar->szKey) + 1;
+		pIndex->uiKeyOffset = uiOffset;
+		pIndex->uiValueOffset = HPP_VAR_IMAGE_VALUE_OFFSET(uiOffset + cbKeyLen);
+		pIndex->uiValueLen = searchVar->cbValueLen;
+		
+		memcpy(apchImage + pIndex->uiKeyOffset, searchVar->szKey, cbKeyLen);
+		memset(apchImage + pIndex->uiKeyOffset + cbKeyLen, 0, pIndex->uiValueOffset - pIndex->uiKeyOffset - cbKeyLen);
+		memcpy(apchImage + pIndex->uiValueOffset, searchVar->pValue, searchVar->cbValueLen + 1);
+		
+		uiOffset = pIndex->uiValueOffset + searchVar->cbValueLen + 1;
+		pIndex++;
+	}
+	
+	pHeader->uiMagic = HPP_VAR_IMAGE_MAGIC;
+	pHeader->uiVersion = HPP_VAR_IMAGE_VERSION;
+	pHeader->uiReserved = 0;
+	pHeader->uiSequence = auiSequence;
+	pHeader->uiCount = uiCount;
+	pHeader->cbImageLen = cbImageLen;
+	pHeader->uiCrc = hppVarImageCrc(apchImage + sizeof(struct hppVarImageHeaderStruct), cbImageLen - sizeof(struct hppVarImageHeaderStruct));
+	
+	return cbImageLen;
+}
+
+
+// Verify the snapshot image 'apchImage' of 'acbLen' bytes. Returns the sequence number of the image or 0 if the image is not valid.
+uint32_t hppVarImageCheck(const char* apchImage, size_t acbLen)
+{
+	const struct hppVarImageHeaderStruct* pHeader = (const struct hppVarImageHeaderStruct*)apchImage;
+	const struct hppVarImageIndexStruct* pIndex;
+	size_t cbIndexEnd;
+	uint32_t i;
+
+	if(apchImage == NULL || acbLen < sizeof(struct hppVarImageHeaderStruct)) return 0;
+	if(pHeader->uiMagic != HPP_VAR_IMAGE_MAGIC || pHeader->uiVersion != HPP_VAR_IMAGE_VERSION || pHeader->cbImageLen != acbLen) return 0;
+	
+	cbIndexEnd = sizeof(struct hppVarImageHeaderStruct) + (size_t)pHeader->uiCount * sizeof(struct hppVarImageIndexStruct);
+	if(pHeader->uiCount > acbLen || cbIndexEnd > acbLen) return 0;
+	
+	if(pHeader->uiCrc != hppVarImageCrc(apchImage + sizeof(struct hppVarImageHeaderStruct), acbLen - sizeof(struct hppVarImageHeaderStruct))) return 0;
+	
+	// Keys and values must be inside the image and null terminated 
+	pIndex = (const struct hppVarImageIndexStruct*)(apchImage + sizeof(struct hppVarImageHeaderStruct));
+	
+	for(i = 0; i < pHeader->uiCount; i++, pIndex++)
+	{
+		if(pIndex->uiKeyOffset < cbIndexEnd || pIndex->uiKeyOffset >= acbLen || pIndex->uiValueOffset <= pIndex->uiKeyOffset) return 0;
+		if(pIndex->uiValueOffset >= acbLen || pIndex->uiValueLen >= acbLen - pIndex->uiValueOffset) return 0;
+		if(pIndex->uiValueOffset % HPP_VAR_IMAGE_VALUE_ALIGN != 0) return 0;
+		if(apchImage[pIndex->uiValueOffset - 1] != 0 || apchImage[pIndex->uiValueOffset + pIndex->uiValueLen] != 0) return 0;
+	}
+	
+	return pHeader->uiSequence;
+}
+
+
+// Compare two keys of the sorted key index of hppVarImageRemoveExisting(...)
+static int hppVarImageKeyCompare(const void* apKey1, const void* apKey2)
+{
+	return strcmp(*(const char* const*)apKey1, *(const char* const*)apKey2);
+}
+
+
+// Delete the variables with a key of the 'auiCount' entries of the snapshot image 'apchImage'. The keys of the image are sorted
+// in a temporary index, such that the variables are looked up in one pass with a binary search each. The persisted copies
+// are replaced by the image, no tombstones are needed. Returns false if memory was not sufficient for the index.
+static bool hppVarImageRemoveExisting(const char* apchImage, uint32_t auiCount)
+{
+	const struct hppVarImageIndexStruct* pIndex = (const struct hppVarImageIndexStruct*)(apchImage + sizeof(struct hppVarImageHeaderStruct));
+	struct hppVarListStruct** searchVarRef = &pFirstVar;
+	struct hppVarListStruct* searchVar;
+	const char** pszKeys;
+	uint32_t i;
+
+	if(auiCount == 0) return true;
+
+	pszKeys = (const char**)malloc(auiCount * sizeof(const char*));
+	if(pszKeys == NULL) return false;
+
+	for(i = 0; i < auiCount; i++) pszKeys[i] = apchImage + pIndex[i].uiKeyOffset;
+	qsort(pszKeys, auiCount, sizeof(const char*), hppVarImageKeyCompare);
+
+	while(*searchVarRef != NULL)
+	{
+		searchVar = *searchVarRef;
+		hppVarLookupCount++;
+
+		if(bsearch(&searchVar->szKey, pszKeys, auiCount, sizeof(const char*), hppVarImageKeyCompare) != NULL)
+		{
+			*searchVarRef = searchVar->pNext;
+			hppVarCodeChanged(searchVar);
+			hppVarFree(searchVar);
+		}
+		else searchVarRef = &searchVar->pNext;
+	}
+
+	free(pszKeys);
+	return true;
+}
+
+
+// Create the variables of the snapshot image 'apchImage' of 'acbLen' bytes with copies of the values or with the values
+// mapped into the image (abMap = true). Variables with the same key are replaced. The variables are marked as persisted. 
+// Returns the number of variables created or -1 if the image is not valid or memory was not sufficient for all variables. 
+static int hppVarImageInsert(const char* apchImage, size_t acbLen, bool abMap)
+{
+	const struct hppVarImageIndexStruct* pIndex = (const struct hppVarImageIndexStruct*)(apchImage + sizeof(struct hppVarImageHeaderStruct));
+	struct hppVarListStruct* pLoadedVars = NULL;
+	struct hppVarListStruct** pLoadedVarsEnd = &pLoadedVars;
+	struct hppVarListStruct* searchVar;
+	struct hppVarListStruct** searchVarRef;
+	const char* szKey;
+	uint32_t uiCount;
+	bool bSearch;
+	uint32_t i;
+
+	if(hppVarImageCheck(apchImage, acbLen) == 0) return -1;
+	uiCount = ((const struct hppVarImageHeaderStruct*)apchImage)->uiCount;
+
+	// Variables with a key of the image are replaced. They are removed in one pass before, or searched per key of the image
+	// if memory is not sufficient for that. An empty storage (the code at boot) is not searched at all.
+	bSearch = pFirstVar != NULL && !hppVarImageRemoveExisting(apchImage, uiCount);
+
+	// The loaded variables are collected in a list of their own and added in front of the existing ones at the end. 
+	// Keys are unique within the image, so only the variables existing before need to be searched.   
+	for(i = 0; i < uiCount; i++, pIndex++)
+	{
+		szKey = apchImage + pIndex->uiKeyOffset;
+		if(bSearch) hppVarLookupCount++;
+		
+		for(searchVarRef = &pFirstVar; bSearch && *searchVarRef != NULL; searchVarRef = &(*searchVarRef)->pNext)
+		{
+			if(strcmp((*searchVarRef)->szKey, szKey) == 0) 
+			{
+				searchVar = *searchVarRef;
+				*searchVarRef = searchVar->pNext;
+				
+				hppVarCodeChanged(searchVar);
+				hppVarFree(searchVar);                // The persisted copy is replaced, no tombstone needed
+				break;
+			}
+		}
+		
+		searchVar = hppVarAlloc(szKey, abMap ? 0 : pIndex->uiValueLen, abMap ? (char*)apchImage + pIndex->uiValueOffset : NULL);
+		if(searchVar == NULL) break;
+		
+		if(pFirstTombstone != NULL) hppVarTombstoneRemove(szKey);
+
+		searchVar->cbValueLen = pIndex->uiValueLen;
+		
+		if(abMap) searchVar->uiFlags = HPP_VAR_FLAG_PERSISTED | HPP_VAR_FLAG_MAPPED;
+		else
+		{
+			searchVar->uiFlags = HPP_VAR_FLAG_PERSISTED;
+			memcpy(searchVar->pValue, apchImage + pIndex->uiValueOffset, pIndex->uiValueLen + 1);
+		}
+		
+		*pLoadedVarsEnd = searchVar;
+		pLoadedVarsEnd = &searchVar->pNext;
+	}
+
+	*pLoadedVarsEnd = pFirstVar;
+	pFirstVar = pLoadedVars;
+	
+	return i == uiCount ? (int)uiCount : -1;
+}
+
+
+// Create the variables of the snapshot image 'apchImage' of 'acbLen' bytes. Variables with the same key are replaced. 
+// The variables are marked as persisted. Returns the number of variables created or -1 if the image is not valid or 
+// memory was not sufficient for all variables. 
+int hppVarImageLoad(const char* apchImage, size_t acbLen)
+{
+	return hppVarImageInsert(apchImage, acbLen, false);
+}
+
+
+// Create the variables of the snapshot image 'apchImage' of 'acbLen' bytes like hppVarImageLoad(...), but the values are not 
+// copied. They reference the image, which must not change as long as any of the values is mapped (see hppVarUnmap(...)). 
+// The image must start at a multiple of HPP_VAR_IMAGE_VALUE_ALIGN bytes, such that the mapped values are aligned.
+int hppVarImageMap(const char* apchImage, size_t acbLen)
+{
+	if((uintptr_t)apchImage % HPP_VAR_IMAGE_VALUE_ALIGN != 0) return -1;
+	
+	return hppVarImageInsert(apchImage, acbLen, true);
+}
+
+
+
 /* ============================================ */
 /* Conversion between Binary Types and Strings  */
 /* ============================================ */
@@ -46,6 +46,11 @@
 
 
 #include "../include/hppZephyr.h"
+#include "../include/hppProfiler.h"
+#include "../include/hppTimerWheel.h"
+#include "../include/hppAsyncQueue.h"
+#include "../include/hppSendBuffer.h"
+#include "../include/hppZephyrImageTokens.h"
 
 
 // Zephir Libraries
@@ -55,7 +60,6 @@
 #include <device.h>
 #include <shell/shell_uart.h>
 #include <drivers/gpio.h>
-#include <sys/ring_buffer.h>
 #include <drivers/uart.h>
 #include <usb/usb_device.h>
 #include <drivers/usb/usb_dc.h>
@@ -70,24 +74,76 @@
 #include "../include/hppNRF52840.h"
 #endif
 
+#if CONFIG_HPP_FLASH_XIP
+#include <storage/flash_map.h>
+#endif
+
 
 // ----------------
 // Settings
 // ----------------
 
-#define HPP_EVENT_TIMER_RESOURCE_COUNT  64
-
 #define HPP_MIN_TIMER_TIME              20
 
-#define HPP_ASYNC_RING_BUF_BUFFER_SIZE  2048
+// Buttons configured with io_cfg_btn
+#define HPP_BUTTON_COUNT                4       // maximum number of buttons
+#define HPP_BUTTON_DEBOUNCE_TIME        100     // default time in ms from the first edge of a burst until the pin is sampled
+#define HPP_BUTTON_DEFAULT_PIN          38      // port 1 pin 6: top button of the nRF52840 USB dongle
+
+// Snapshot images written with flash_snapshot. Each image is one entry of the settings storage (NVS), which must fit in
+// one flash sector less the allocation table entries.
+#define HPP_FLASH_IMAGE_MAX_SIZE        4000    // maximum size of one image in bytes
+
+// Async queues in the order of their priority. Each queue must hold at least one entry of HPP_ASYNC_MAX_DATA_SIZE bytes unless noted.
+#define HPP_ASYNC_QUEUE_TIMER           0       // timer expirations and H++ timer handlers
+#define HPP_ASYNC_QUEUE_COAP_RESPONSE   1       // responses to CoAP requests of H++ tasks and other task wake-ups
+#define HPP_ASYNC_QUEUE_COAP_REQUEST    2       // CoAP requests received
+#define HPP_ASYNC_QUEUE_BULK            3       // CLI, USB input and any other operation
+#define HPP_ASYNC_QUEUE_COUNT           4
+
+#define HPP_ASYNC_RING_BUF_TIMER_SIZE           512     // timer handles, expiration ticks and button events only
+#define HPP_ASYNC_RING_BUF_COAP_RESPONSE_SIZE   1536
+#define HPP_ASYNC_RING_BUF_COAP_REQUEST_SIZE    2048
+#define HPP_ASYNC_RING_BUF_BULK_SIZE            1536
+
+// Number of entries dispatched from each queue per round if lower priority queues are waiting (prevents starvation)
+#define HPP_ASYNC_QUEUE_WEIGHT_TIMER            8
+#define HPP_ASYNC_QUEUE_WEIGHT_COAP_RESPONSE    4
+#define HPP_ASYNC_QUEUE_WEIGHT_COAP_REQUEST     2
+#define HPP_ASYNC_QUEUE_WEIGHT_BULK             1
+
+#define HPP_ASYNC_GROUP_COUNT           2       // number of threads queueing XXX_WITH_NEXT groups at the same time
+
+// Batched dispatch: entries processed with one lock of the parser mutex
+#define HPP_ASYNC_BATCH_MAX_COUNT       8       // maximum number of entries per batch (1 = no batching)
+#define HPP_ASYNC_BATCH_MAX_TIME        10      // the batch is closed once it took longer than this number of ms
+#define HPP_ASYNC_BATCH_MAX_OUTPUTS     4       // maximum number of CoAP responses and CLI outputs sent together after the batch
 #define HPP_ASYNC_MAX_VAR_SIZE          32      // maximum var length for hppAsyncXXXX(...)
 #define HPP_ASYNC_MAX_DATA_SIZE         1280    // maximum data length for hppAsyncXXXX(...)  --> Thread IPv6 MTU size
 
-#define HPP_ASYNC_RINGBUF_SAFETY_BUFFER (sizeof(uint16_t) + sizeof(uint8_t) + 10)      // safety buffer for all hppAsyncXXX functions having a abSyncWithNext option
+#define HPP_ASYNC_RINGBUF_SAFETY_BUFFER (HPP_ASYNC_QUEUE_HEADER_SIZE + 10)      // safety buffer for all hppAsyncXXX functions having a abSyncWithNext option
+#define HPP_ASYNC_BLOCK_POOL_SIZE       4096    // maximum number of bytes in payload blocks queued by reference (hppAsyncBlockAlloc)
+
+// Queue statistics
+#define HPP_ASYNC_TLV_TYPE_COUNT        27      // highest TLV type + 1
+#define HPP_ASYNC_STATS_BUCKET_COUNT    8       // histogram buckets < 64us, < 256us, < 1ms, < 4ms, < 16ms, < 64ms, < 256ms and above
+
+// H++ tasks
+#define HPP_TASK_COUNT                  4       // maximum number of H++ tasks in progress at the same time
+#define HPP_TASK_SLICE_TICKS            200     // default number of expressions evaluated before a task is suspended (0 = never suspend)
+#define HPP_TASK_LOCAL_BASE_STEP        0x1000  // distance between the call depths used for the local variables of the tasks
+#define HPP_TASK_RESULT_VAR_KEY_LEN     20
+
+// Execution time budgets
+#define HPP_ENTRY_POINT_BUDGET          1000    // default execution time budget in ms for H++ code of each entry point (0 = unlimited)
 
 // USB
 #define HPP_ZEPHYR_USB_SEND_BUF_SIZE 512
 #define HPP_ZEPHYR_USB_RECV_BUF_SIZE 512        // must be <= HPP_ASYNC_MAX_DATA_SIZE
+#define HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE 64       // bytes read from or written to the CDC ACM FIFO at once (full speed bulk packet size)
+#define HPP_ZEPHYR_USB_SEND_TIMEOUT 100         // time in ms hppZephyrUsbSend waits for space in the send buffer before dropping data
+#define HPP_ZEPHYR_USB_FRAME_MAX_SIZE 512       // decoded bytes of a binary frame including header and CRC, must be <= HPP_ASYNC_MAX_DATA_SIZE
+#define HPP_ZEPHYR_USB_FRAME_MAX_VALUE_SIZE 32768   // maximum size of a value put or executed with multiple frames
 
 
 
@@ -111,34 +167,141 @@ K_MUTEX_DEFINE(hppParseMutex);
 // Main Thread Parser Semaphor
 K_SEM_DEFINE(hppParserSemaphor, 0, 10000);
 
+// USB send buffer: one writer at a time, signaled by the interrupt handler whenever it passed data to the FIFO
+K_MUTEX_DEFINE(hppZephyrUsbSendMutex);
+K_SEM_DEFINE(hppZephyrUsbSendSemaphor, 0, 1);
+
 
 
 // ----------------
 // Typedefs
 // ----------------
 
+typedef struct hppTimerStats
+{
+    uint32_t uiDispatchCount;                                       ///< Expirations dispatched (handler called or action executed)
+    uint32_t uiMissedCount;                                         ///< Expirations skipped or dropped because the queue was full
+    uint32_t uiLastExpected;                                        ///< Uptime in ms of the last dispatched expiration
+    uint32_t uiLastActual;                                          ///< Uptime in ms at which it was dispatched
+    uint32_t uiLastLateness;                                        ///< Lateness in us of the last dispatch
+    uint32_t uiMinLateness;                                         ///< Minimum lateness in us
+    uint32_t uiMaxLateness;                                         ///< Maximum lateness in us
+    uint64_t uiSumLateness;                                         ///< Sum of the lateness of all dispatches in us
+
+} hppTimerStats;
+
+
 typedef struct hppTimerResource
 {
-    struct k_timer mTimerResource;                                  ///< Zephyr timer Resource
+    uint32_t uiHandle;                                              ///< Timer wheel event of the timer
+    uint32_t uiPeriod;                                              ///< Period in ms, 0 for single shot timers
+    uint32_t uiSlack;                                               ///< Deferral in ms allowed to share a wake-up with other timers
+    uint8_t uiPolicy;                                               ///< hppTimerPolicyEnum
+    atomic_t mQueuedCount;                                          ///< Expirations queued but not dispatched yet
+    hppTimerStats mStats;
 
     hppTimerHandler pHandler;                                       ///< Handler function
     void* pContext;                                                 ///< Application context
 
+    uint8_t uiAction;                                               ///< Native action (hppTimerActionEnum) instead of the handler
+    const struct device* pGpioDev;                                  ///< GPIO port of the action
+    gpio_pin_t uiPin;                                               ///< GPIO pin of the action
+    char szVarName[HPP_VAR_NAME_MAX_LEN + 1];                       ///< Variable written by the action
+    char szValue[HPP_FIXSTR_MAX_LEN + 1];                           ///< Value written by the action
+
 } hppTimerResource;
 
 
-typedef struct hppEventTimerResource
+typedef struct hppFlashStats
 {
-    struct k_timer mTimerResource;                                  ///< Zephyr timer Resource
+    uint32_t uiSaveCount;                                           ///< Saves of global or code variables
+    uint32_t uiKeysWritten;                                         ///< Variables written
+    uint32_t uiKeysDeleted;                                         ///< Settings of deleted variables removed
+    uint32_t uiBytesWritten;                                        ///< Value bytes written
+    uint32_t uiLastBytesWritten;                                    ///< Value bytes written by the last save
+    uint32_t uiLastTime;                                            ///< Time in us of the last save
+    uint32_t uiMaxTime;                                             ///< Longest time in us of a save
+    uint32_t uiFailCount;                                           ///< Saves which returned false
+    uint32_t uiFallbackCount;                                       ///< Images too large, written as single settings instead
+    uint32_t uiRestoredKeys;                                        ///< Variables restored by the last restore
+    uint32_t uiRestoreTime;                                         ///< Time in us of the last restore
+    bool bRestoredImage;                                            ///< The last restore loaded a snapshot image
+
+} hppFlashStats;
+
+
+typedef struct hppButtonResource
+{
+    struct gpio_callback mCallback;                                 ///< GPIO interrupt callback of the pin
+    const struct device* pGpioDev;                                  ///< GPIO port, NULL if the resource is not in use
+    gpio_pin_t uiPin;                                               ///< Pin of the port
+    uint32_t uiPinID;                                               ///< Pin identifier (0..63) passed to the H++ handlers
+    uint8_t uiEdge;                                                 ///< Changes reported to the H++ handlers (hppButtonEdgeEnum)
+    uint32_t uiDebounceTime;                                        ///< Time in ms from the first edge of a burst until the pin is sampled
+    uint32_t uiHandle;                                              ///< Timer wheel event sampling the pin
+    atomic_t mDebouncing;                                           ///< A burst of edges is in progress, further edges are ignored
+    uint32_t uiBurstStart;                                          ///< Uptime in ms of the first edge of the present burst
+    bool bPressed;                                                  ///< Debounced state
+    uint32_t uiPressTime;                                           ///< Uptime in ms at which the button was pressed
+
+} hppButtonResource;
+
+
+typedef struct hppAsyncTypeStats
+{
+    uint32_t uiDispatchCount;                                       ///< Entries dispatched
+    uint32_t uiDropCount;                                           ///< Entries rejected since the queue was full
+    uint32_t uiMaxLatency;                                          ///< Longest time in us from queueing to dispatching an entry
+    uint32_t uiMaxExecTime;                                         ///< Longest time in us to process an entry
+    uint16_t auiLatencyHist[HPP_ASYNC_STATS_BUCKET_COUNT];          ///< Histogram of the latency (saturating)
+    uint16_t auiExecTimeHist[HPP_ASYNC_STATS_BUCKET_COUNT];         ///< Histogram of the processing time (saturating)
+
+} hppAsyncTypeStats;
 
-    hppQueuedTimerHandler pHandler;                                 ///< Handler function
-    void* pApplicationData;                                         ///< Application data
-    uint32_t mApplicationDataLen;                                   ///< Application data lenght in bytes
-    void* pContext;                                                 ///< Application context
 
-    bool mInUse;                                                    ///< Resource currently in use 
+typedef struct hppAsyncGroup
+{
+    k_tid_t mThread;                                                ///< Thread queueing the group, NULL if the resource is not in use
+    struct hppAsyncQueueStruct* pQueue;                             ///< Queue of all entries of the group
+
+} hppAsyncGroup;
+
+
+typedef struct hppAsyncOutput
+{
+    hppCoapMessageContext mCoapMessageContext;                      ///< CoAP request to respond to
+    char* pchData;                                                  ///< Response or CLI text
+    size_t cbDataLen;                                               ///< Length of the response
+    uint8_t uiType;                                                 ///< TLV type of the entry creating the output
+    bool bCli;                                                      ///< Write to Thread CLI instead of responding with CoAP
+    char szResultVarKey[HPP_TASK_RESULT_VAR_KEY_LEN + 1];           ///< Variable to be deleted after the output, empty if none
+
+} hppAsyncOutput;
+
+
+typedef struct hppTaskResource
+{
+    struct hppParseExpressionStruct* pParseContext;                 ///< Parser state of the task, NULL if the resource is not in use
+    uint8_t uiType;                                                 ///< TLV type which started the task
+    char* pchCode;                                                  ///< Copy of the code unless it is stored in a variable
+    char szResultVarKey[HPP_TASK_RESULT_VAR_KEY_LEN + 1];           ///< Variable holding the result of the task
+    hppCoapMessageContext mCoapMessageContext;                      ///< CoAP request the task responds to
+    uint32_t uiWaitID;                                              ///< ID of the event the task is waiting for, 0 if the task is runnable
+    const char* szWaitResultVarKey;                                 ///< Variable receiving the result of the event the task is waiting for
+    uint32_t uiWaitTimer;                                           ///< Timer event ending the wait (see hppTaskWaitTimeout), 0 if none
+
+} hppTaskResource;
+
+
+typedef struct hppEntryPointResource
+{
+    const char* szName;                                             ///< Name used by the H++ timeout(...) function
+    uint32_t uiBudget;                                              ///< Execution time budget in ms, 0 = unlimited
+    uint32_t uiRunCount;                                            ///< Number of H++ code executions finished
+    uint32_t uiMaxTime;                                             ///< Maximum execution time in ms measured
+    uint32_t uiOverrunCount;                                        ///< Number of H++ code executions stopped with timeout error
 
-} hppEventTimerResource;
+} hppEntryPointResource;
 
 
 
@@ -150,23 +313,100 @@ typedef struct hppEventTimerResource
 const struct device *hppGpioDev0;
 const struct device *hppGpioDev1;
 
-uint8_t hppAsyncRingBufBuffer[HPP_ASYNC_RING_BUF_BUFFER_SIZE];
-struct ring_buf hppAsyncRingBuf;
+uint8_t hppAsyncRingBufTimer[HPP_ASYNC_RING_BUF_TIMER_SIZE];
+uint8_t hppAsyncRingBufCoapResponse[HPP_ASYNC_RING_BUF_COAP_RESPONSE_SIZE];
+uint8_t hppAsyncRingBufCoapRequest[HPP_ASYNC_RING_BUF_COAP_REQUEST_SIZE];
+uint8_t hppAsyncRingBufBulk[HPP_ASYNC_RING_BUF_BULK_SIZE];
+struct hppAsyncQueueStruct hppAsyncQueues[HPP_ASYNC_QUEUE_COUNT];
+struct hppAsyncBatchStruct hppAsyncBatch;
+hppAsyncGroup hppAsyncGroups[HPP_ASYNC_GROUP_COUNT];
+struct hppAsyncQueueStruct* hppAsyncQueueLocked = NULL;   // queue of the XXX_WITH_NEXT group presently dispatched
+uint32_t hppAsyncPendingCount = 0;                 // entries signaled by the semaphore but not dispatched yet
+k_tid_t hppAsyncDispatcherThread = NULL;
+atomic_t hppAsyncBlockPoolUsed = ATOMIC_INIT(0);   // bytes of payload blocks allocated and not yet adopted or released
+hppAsyncOutput hppAsyncOutputs[HPP_ASYNC_BATCH_MAX_OUTPUTS];
+uint32_t hppAsyncOutputCount = 0;
+uint32_t hppAsyncCoalescedCount = 0;               // PUT entries skipped since the next entry of the queue updates the same variable
+hppAsyncTypeStats hppAsyncTypeStatistics[HPP_ASYNC_TLV_TYPE_COUNT];
 char hppAsyncDataBuffer[HPP_ASYNC_MAX_DATA_SIZE + 1];
 char hppAsyncVarName[HPP_ASYNC_MAX_VAR_SIZE + 1];
 
 
 // USB Interface
 const struct device *hppUsbDev;
-uint8_t hppZephyrUsbRingBufBuffer[HPP_ZEPHYR_USB_SEND_BUF_SIZE];
-struct ring_buf hppZephyrUsbRingBuf;
+uint8_t hppZephyrUsbSendBufferData[HPP_ZEPHYR_USB_SEND_BUF_SIZE];
+struct hppSendBufferStruct hppZephyrUsbSendBuffer;                  // counts the bytes sent, dropped and the waits for space
 uint8_t hppZephyrUsbRecvBufBuffer[HPP_ZEPHYR_USB_RECV_BUF_SIZE];
 uint16_t hppZephyrUsbRecvBufBufferLen = 0;
-
-
-// Timer resources
+bool hppZephyrUsbRecvOverflow = false;                              // the line received is too long, drop it up to its end
+
+// Binary USB frames received by the interrupt handler
+uint8_t hppZephyrUsbFrameBuffer[HPP_ZEPHYR_USB_FRAME_MAX_SIZE];
+uint16_t hppZephyrUsbFrameLen = 0;
+bool hppZephyrUsbFrameActive = false;                               // an END byte started a frame
+bool hppZephyrUsbFrameEscape = false;                               // the last byte was ESC
+bool hppZephyrUsbFrameOverflow = false;                             // the frame is too long, drop it up to its end
+
+// Value of multiple frames collected by the dispatcher
+char* hppZephyrUsbFrameValue = NULL;
+size_t hppZephyrUsbFrameValueLen = 0;
+uint8_t hppZephyrUsbFrameValueCmd;
+char hppZephyrUsbFrameValueName[HPP_ASYNC_MAX_VAR_SIZE + 1];
+bool hppZephyrUsbFrameValueDone = false;                            // the value was completed, a repeated last frame is acknowledged again
+
+// USB statistics
+uint32_t hppZephyrUsbRecvCount = 0;                                 // Bytes read from the FIFO
+uint32_t hppZephyrUsbRecvDropCount = 0;                             // Lines dropped since they exceeded the receive buffer
+uint32_t hppZephyrUsbFrameCount = 0;                                // Binary frames received and queued
+uint32_t hppZephyrUsbFrameDropCount = 0;                            // Binary frames dropped since they were too long or the queue was full
+
+
+// Timer resources: all timers and scheduled events are events of one timer wheel driven by one kernel timer
 hppTimerResource hppTimerResources[HPP_TIMER_RESOURCE_COUNT];
-hppEventTimerResource hppEventTimerResources[HPP_EVENT_TIMER_RESOURCE_COUNT];
+struct k_timer hppTimerWheelTimer;
+struct k_spinlock hppTimerWheelLock;
+bool hppTimerWheelArmed = false;                                    // hppTimerWheelTimer is started
+uint32_t hppTimerWheelArmedTick;                                    // Uptime in ms at which hppTimerWheelTimer expires
+
+// Wake-up counters of the timer wheel
+uint32_t hppTimerWakeupCount = 0;                                   // Runs of the kernel timer handler
+uint32_t hppTimerBusyWakeupCount = 0;                               // Runs expiring at least one event
+uint32_t hppTimerExpirationCount = 0;                               // Expired events
+uint32_t hppTimerDeferredCount = 0;                                 // Expired events deferred within their slack
+uint64_t hppTimerActiveTime = 0;                                    // Time in us in the kernel timer handler and dispatching timer entries
+
+// Flash persistence: only variables changed since the last save are written
+hppFlashStats hppFlashStatistics;
+uint32_t hppFlashAutosavePeriod = 0;                                // Time in ms between automatic saves, 0 = off
+bool hppFlashAutosaveCode = false;                                  // Automatic saves include the code variables
+uint32_t hppFlashAutosaveHandle = 0;                                // Event of the next automatic save
+
+// Snapshot images: two slots per class (index 0 = code, 1 = global variables) written alternately. The latest image stays valid 
+// until the next one has been written completely. Variables of a class with an image are saved as a new image only.
+uint32_t hppFlashImageSequence[2] = { 0, 0 };                       // Sequence number of the latest image, 0 = no image
+uint8_t hppFlashImageSlot[2] = { 0, 0 };                            // Slot of the latest image
+
+// Buttons: one GPIO interrupt callback per pin, bursts of edges are sampled once by an event of the timer wheel
+hppButtonResource hppButtonResources[HPP_BUTTON_COUNT];
+
+
+// H++ tasks
+hppTaskResource hppTaskResources[HPP_TASK_COUNT];
+uint32_t hppTaskSliceTicks = HPP_TASK_SLICE_TICKS;
+uint32_t hppTaskNext = 0;
+hppTaskResource* hppTaskCurrent = NULL;
+uint32_t hppTaskWaitCount = 0;
+
+
+// Execution time budgets of the entry points
+hppEntryPointResource hppEntryPointResources[hppEntryPoint_Count] = 
+{
+    { "other", HPP_ENTRY_POINT_BUDGET, 0, 0, 0 },
+    { "coap",  HPP_ENTRY_POINT_BUDGET, 0, 0, 0 },
+    { "timer", HPP_ENTRY_POINT_BUDGET, 0, 0, 0 },
+    { "cli",   HPP_ENTRY_POINT_BUDGET, 0, 0, 0 }
+};
+enum hppEntryPointEnum hppEntryPointCurrent = hppEntryPoint_Other;
 
 
 // ----------------
@@ -189,34 +429,127 @@ hppEventTimerResource hppEventTimerResources[HPP_EVENT_TIMER_RESOURCE_COUNT];
 #define HPP_ASYNC_TLV_USB_RECV                      14
 #define HPP_ASYNC_TLV_TIMER_EXPIRED                 15
 #define HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED           16
+#define HPP_ASYNC_TLV_TASK_SLICE                    17      // internal only, continues a suspended task without reading the ring buffer
+#define HPP_ASYNC_TLV_TASK_RESUME                   18
+#define HPP_ASYNC_TLV_STATS_GET_COAP_RESPONSE       19
+#define HPP_ASYNC_TLV_PARSE_VAR_TIMER               20
+#define HPP_ASYNC_TLV_VAR_PUT_BLOCK                 21      // value passed by reference to a block of hppAsyncBlockAlloc
+#define HPP_ASYNC_TLV_VAR_PUT_BLOCK_WITH_NEXT       22
+#define HPP_ASYNC_TLV_VAR_PUT_BLOCK_NON_CASE_SENSITIVE  23
+#define HPP_ASYNC_TLV_BUTTON                        24      // debounced change of a button: pin, pressed and hold time
+#define HPP_ASYNC_TLV_USB_FRAME                     25      // decoded binary frame received via USB
+#define HPP_ASYNC_TLV_VAR_PUT_TIMER                 26      // value written by a timer action
+
+
+// Binary USB frames: SLIP framed (each frame starts and ends with END, END and ESC in the frame are escaped by ESC ESC_END and
+// ESC ESC_ESC). Request: command, flags, name length, name, data, CRC. Response: command, status, flags, data, CRC. 
+// The CRC is a CRC-16/CCITT-FALSE of all bytes before it, little endian.
+#define HPP_ZEPHYR_USB_FRAME_END                    0xC0
+#define HPP_ZEPHYR_USB_FRAME_ESC                    0xDB
+#define HPP_ZEPHYR_USB_FRAME_ESC_END                0xDC
+#define HPP_ZEPHYR_USB_FRAME_ESC_ESC                0xDD
+
+#define HPP_ZEPHYR_USB_FRAME_CMD_PUT                'P'     // store the data in the variable 'name'
+#define HPP_ZEPHYR_USB_FRAME_CMD_GET                'G'     // respond with the value of the variable 'name'
+#define HPP_ZEPHYR_USB_FRAME_CMD_DELETE             'D'     // delete the variable 'name'
+#define HPP_ZEPHYR_USB_FRAME_CMD_EXECUTE            'X'     // execute the data as H++ code and respond with the result
+#define HPP_ZEPHYR_USB_FRAME_CMD_ENUMERATE          'E'     // respond with the names of all variables starting with 'name' (one per line)
+
+#define HPP_ZEPHYR_USB_FRAME_FLAG_MORE              0x01    // further frames of the same value follow
+#define HPP_ZEPHYR_USB_FRAME_FLAG_CONTINUE          0x02    // the data continues the value of the previous frame
+
+#define HPP_ZEPHYR_USB_FRAME_STATUS_OK              0
+#define HPP_ZEPHYR_USB_FRAME_STATUS_CRC             1       // CRC error, the request was not executed
+#define HPP_ZEPHYR_USB_FRAME_STATUS_INVALID         2       // frame too short or name too long
+#define HPP_ZEPHYR_USB_FRAME_STATUS_UNKNOWN         3       // unknown command
+#define HPP_ZEPHYR_USB_FRAME_STATUS_NOT_FOUND       4       // variable not found
+#define HPP_ZEPHYR_USB_FRAME_STATUS_SEQUENCE        5       // continued frame without a previous frame of the same value
+#define HPP_ZEPHYR_USB_FRAME_STATUS_TOO_LARGE       6       // value exceeds HPP_ZEPHYR_USB_FRAME_MAX_VALUE_SIZE
+#define HPP_ZEPHYR_USB_FRAME_STATUS_FAILED          7       // out of memory
+#define HPP_ZEPHYR_USB_FRAME_STATUS_OFFSET          8       // continued frame does not start at the end of the collected data, the value is discarded
 
 
 // ------------------------------------------
 // Flash memory and settings relate functions 
 // ------------------------------------------
 
+// Returns true if the key 'aszKey' belongs to the global variables (abGlobal = true, capital letter in front) or to the code
+static bool hppFlashIsKeyOf(const char aszKey[], bool abGlobal)
+{
+    if(abGlobal) return aszKey[0] >= 'A' && aszKey[0] <= 'Z';
+
+    return aszKey[0] >= 'a' && aszKey[0] <= 'z';
+}
+
+
+// Name of the setting of the variable 'aszKey'. The result is dynamically allocated and must be released with free().
+static char* hppFlashNewSettingName(const char aszKey[])
+{
+    char* pSettingName = (char*)malloc(strlen(aszKey) + 5);                 // space for header and zero byte
+
+    if(pSettingName == NULL) return NULL;
+
+    strcpy(pSettingName, "hpp/");                                           // header is 4 bytes long
+    strcpy(pSettingName + 4, aszKey);
+
+    return pSettingName;
+}
+
+
+static bool hppFlashIsGlobalKey(const char aszKey[])
+{
+    return hppFlashIsKeyOf(aszKey, true);
+}
+
+
+static bool hppFlashIsCodeKey(const char aszKey[])
+{
+    return hppFlashIsKeyOf(aszKey, false);
+}
+
+
+// Name of the setting of the snapshot image in slot 'auiSlot': "hppimg/g0", "hppimg/g1" for global variables or "hppimg/c0", "hppimg/c1" for code  
+static void hppFlashImageName(char aszName_Out[], bool abGlobal, uint8_t auiSlot)
+{
+    sprintf(aszName_Out, "hppimg/%c%u", abGlobal ? 'g' : 'c', auiSlot);
+}
+
+
+// Remove the tombstones of the global variables or the code
+static void hppFlashClearTombstones(bool abGlobal)
+{
+    struct hppVarTombstoneStruct** ppTombstone = &pFirstTombstone;
+    struct hppVarTombstoneStruct* pTombstone;
+
+    while(*ppTombstone != NULL)
+    {
+        pTombstone = *ppTombstone;
+
+        if(hppFlashIsKeyOf(pTombstone->szKey, abGlobal)) 
+        {
+            *ppTombstone = pTombstone->pNext;
+            free(pTombstone);
+        }
+        else ppTombstone = &pTombstone->pNext;
+    }
+}
+
+
 static int hppDeleteVarSettingHandler(const char *aKey, size_t aLen, settings_read_cb aReadCb, void* apReadCbArg, void *aContext)
 {
     uint16_t* piCount = (uint16_t*)aContext; 
-    char chBegin = 'a';
-    char chEnd = 'z';
-
-    printf("delete:%s\r\n", aKey);
+    char* pSettingName;
 
     if(piCount == NULL || strlen(aKey) < 1) return 0;
 
-    if(*piCount & 0x8000) { chBegin = 'A'; chEnd = 'Z'; }
-
-    if(aKey[0] >= chBegin && aKey[0] <= chEnd)
+    if(hppFlashIsKeyOf(aKey, (*piCount & 0x8000) != 0))
     {
-        char* pVarName = (char*)malloc(strlen(aKey) + 5);                      // space for header and zero byte
-        if(pVarName == NULL) return 0;
+        pSettingName = hppFlashNewSettingName(aKey);
+        if(pSettingName == NULL) return 0;
 
-        strcpy(pVarName, "hpp/");                                              // header is 4 bytes long
-        strcpy(pVarName + 4, aKey);
-        settings_delete(pVarName);
+        settings_delete(pSettingName);
         (*piCount)++;
-        free(pVarName);
+        free(pSettingName);
     }
 
     return 0;
@@ -226,10 +559,29 @@ static int hppDeleteVarSettingHandler(const char *aKey, size_t aLen, settings_re
 bool hppDeleteVarFromFlash(bool abGlobal)
 {
     uint16_t iCount = abGlobal ? 0x8000 : 0x0;
+    struct hppVarListStruct* searchVar;
+    char szImageName[12];
+    bool bImage = hppFlashImageSequence[abGlobal] != 0;
+    uint8_t i;
 
     settings_load_subtree_direct("hpp", hppDeleteVarSettingHandler, &iCount);
 
-    return (iCount & 0x7FFF) > 0; 
+    // Both slots, an older image may be left even if the latest one is not valid
+    for(i = 0; i < 2; i++)
+    {
+        hppFlashImageName(szImageName, abGlobal, i);
+        settings_delete(szImageName);
+    }
+
+    hppFlashImageSequence[abGlobal] = 0;
+
+    // The variables in RAM have no persisted copy anymore 
+    for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+        if(hppFlashIsKeyOf(searchVar->szKey, abGlobal)) searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | HPP_VAR_FLAG_DIRTY;
+
+    hppFlashClearTombstones(abGlobal);
+
+    return (iCount & 0x7FFF) > 0 || bImage; 
 }
 
 
@@ -237,16 +589,10 @@ static int hppReadVarSettingHandler(const char *aKey, size_t aLen, settings_read
 {
     char* pValue;
     uint16_t* piCount = (uint16_t*)aContext; 
-    char chBegin = 'a';
-    char chEnd = 'z';
-
-    printf("load:%s\r\n", aKey);
 
     if(piCount == NULL || strlen(aKey) < 1) return 0;
 
-    if(*piCount & 0x8000) { chBegin = 'A'; chEnd = 'Z'; }
-
-    if(aKey[0] >= chBegin && aKey[0] <= chEnd)
+    if(hppFlashIsKeyOf(aKey, (*piCount & 0x8000) != 0))
     {
         pValue = hppVarPut(aKey, hppNoInitValue, aLen);             // Just reserve memory and write 0 byte behind the data
         
@@ -254,6 +600,16 @@ static int hppReadVarSettingHandler(const char *aKey, size_t aLen, settings_read
         {
             aReadCb(apReadCbArg, pValue, aLen);
             (*piCount)++;
+
+#if CONFIG_HPP_MINIFY_CODE
+            // Code stored by older firmware versions may still include comments
+            if(hppVarIsCode(aKey) && memchr(pValue, 0, aLen) == NULL) 
+            {
+                hppVarPut(aKey, hppNoInitValue, hppMinifyCode(pValue, aLen));
+                return 0;                                           // the persisted copy differs, keep the variable dirty
+            }
+#endif
+            hppVarSetPersisted(aKey);
         }
     }
 
@@ -261,890 +617,2969 @@ static int hppReadVarSettingHandler(const char *aKey, size_t aLen, settings_read
 }
 
 
+// Latest valid snapshot image found by hppReadImageSettingHandler
+struct hppFlashImageLoadStruct
+{
+    bool bGlobal;
+    char* pchImage;
+    size_t cbImageLen;
+    uint32_t uiSequence;
+    uint8_t uiSlot;
+};
+
+
+static int hppReadImageSettingHandler(const char *aKey, size_t aLen, settings_read_cb aReadCb, void* apReadCbArg, void *aContext)
+{
+    struct hppFlashImageLoadStruct* pLoad = (struct hppFlashImageLoadStruct*)aContext; 
+    char* pchImage;
+    uint32_t uiSequence = 0;
+
+    if(pLoad == NULL || aKey[0] != (pLoad->bGlobal ? 'g' : 'c') || (aKey[1] != '0' && aKey[1] != '1') || aKey[2] != 0) return 0;
+
+    // The whole image is read at once and kept if it is valid and newer than the one of the other slot
+    pchImage = (char*)malloc(aLen + 1);
+    if(pchImage == NULL) return 0;
+
+    if(aReadCb(apReadCbArg, pchImage, aLen) == (ssize_t)aLen) uiSequence = hppVarImageCheck(pchImage, aLen);
+
+    if(uiSequence > pLoad->uiSequence)
+    {
+        free(pLoad->pchImage);
+
+        pLoad->pchImage = pchImage;
+        pLoad->cbImageLen = aLen;
+        pLoad->uiSequence = uiSequence;
+        pLoad->uiSlot = aKey[1] - '0';
+    }
+    else free(pchImage);
+
+    return 0;
+}
+
+
+#if CONFIG_HPP_FLASH_XIP
+// Copy the snapshot image 'apchImage' of the code to the partition hpp_xip unless it holds the same image already and create 
+// the code variables with their values mapped into the partition. Returns the number of variables or -1 if not successful.
+static int hppFlashMapImage(const char* apchImage, size_t acbLen)
+{
+    const struct flash_area* pArea;
+    const char* pchMapped;
+    uint8_t auiTail[8];
+    size_t cbAlign;
+    size_t cbHead;
+    int iResult = -1;
+
+    if(flash_area_open(FLASH_AREA_ID(hpp_xip), &pArea) != 0) return -1;
+
+    pchMapped = (const char*)(CONFIG_FLASH_BASE_ADDRESS + pArea->fa_off);
+    cbAlign = flash_area_align(pArea);
+    cbHead = acbLen - acbLen % cbAlign;
+
+    if(acbLen > pArea->fa_size || cbAlign > sizeof(auiTail))
+    {
+        flash_area_close(pArea);
+        return -1;
+    }
+
+    if(memcmp(pchMapped, apchImage, acbLen) != 0)
+    {
+        // Values mapped before must not reference the partition while it is written. The last bytes are padded to a full write block.
+        memset(auiTail, 0xFF, sizeof(auiTail));
+        memcpy(auiTail, apchImage + cbHead, acbLen - cbHead);
+
+        if(!hppVarUnmap(pchMapped, pArea->fa_size) || flash_area_erase(pArea, 0, pArea->fa_size) != 0 || 
+           flash_area_write(pArea, 0, apchImage, cbHead) != 0 || (cbHead < acbLen && flash_area_write(pArea, cbHead, auiTail, cbAlign) != 0)) 
+        {
+            flash_area_close(pArea);
+            return -1;
+        }
+    }
+
+    if(memcmp(pchMapped, apchImage, acbLen) == 0) iResult = hppVarImageMap(pchMapped, acbLen);
+
+    flash_area_close(pArea);
+    return iResult;
+}
+#endif
+
+
 bool hppReadVarFromFlash(bool abGlobal)
 {
     uint16_t iCount = abGlobal ? 0x8000 : 0x0;
+    struct hppFlashImageLoadStruct theImage = { abGlobal, NULL, 0, 0, 0 };
+    uint32_t uiStartTime = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    int iImageCount = -1;
+
+    // A snapshot image is loaded with one read and the variables are inserted at once. The single settings of the 
+    // variables are read if there is no valid image.
+    settings_load_subtree_direct("hppimg", hppReadImageSettingHandler, &theImage);
+
+    if(theImage.pchImage != NULL)
+    {
+#if CONFIG_HPP_FLASH_XIP
+        if(!abGlobal) iImageCount = hppFlashMapImage(theImage.pchImage, theImage.cbImageLen);
+        if(iImageCount < 0) 
+#endif
+        iImageCount = hppVarImageLoad(theImage.pchImage, theImage.cbImageLen);
+        free(theImage.pchImage);
+
+        hppFlashImageSequence[abGlobal] = theImage.uiSequence;
+        hppFlashImageSlot[abGlobal] = theImage.uiSlot;
+    }
+
+    if(iImageCount < 0) settings_load_subtree_direct("hpp", hppReadVarSettingHandler, &iCount);
+    else iCount += (uint16_t)(iImageCount & 0x7FFF);
 
-    settings_load_subtree_direct("hpp", hppReadVarSettingHandler, &iCount);
+    hppFlashStatistics.uiRestoredKeys = iCount & 0x7FFF;
+    hppFlashStatistics.uiRestoreTime = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()) - uiStartTime;
+    hppFlashStatistics.bRestoredImage = iImageCount >= 0;
 
     return (iCount & 0x7FFF) > 0; 
 }
 
 
-bool hppWriteVarToFlash(bool abGlobal)
+// Write the variables changed since the last save and delete the settings of variables deleted since then.
+// The number of value bytes written is added to 'apcbWritten'.
+static bool hppFlashWriteSettings(bool abGlobal, uint32_t* apcbWritten)
 {
 	struct hppVarListStruct* searchVar;
-    char* pVarName;
-    size_t cbVarNameMaxLen = 32;
-    size_t cbKeyLen;
-    char chBegin = 'a';
-    char chEnd = 'z';
+    struct hppVarTombstoneStruct** ppTombstone = &pFirstTombstone;
+    struct hppVarTombstoneStruct* pTombstone;
+    char* pSettingName;
+    bool bSuccess = true;
   
-    if(abGlobal) { chBegin = 'A'; chEnd = 'Z'; }
-
-    pVarName = (char*)malloc(cbVarNameMaxLen + 5);                          // space for header and zero byte
-    if(pVarName == NULL) return false;
-
-    strcpy(pVarName, "hpp/");                                               // header is 4 bytes long
-	searchVar = pFirstVar;
-
 	// Search for the right entries in save them
-	while(searchVar != NULL)
+	for(searchVar = pFirstVar; searchVar != NULL && bSuccess; searchVar = searchVar->pNext)
 	{
-		if(searchVar->szKey[0] >= chBegin && searchVar->szKey[0] <= chEnd)
-        { 
+		if(!hppFlashIsKeyOf(searchVar->szKey, abGlobal) || (searchVar->uiFlags & HPP_VAR_FLAG_DIRTY) == 0) continue;
 
-            printf("save:%s", searchVar->szKey);
+        pSettingName = hppFlashNewSettingName(searchVar->szKey);
 
-            cbKeyLen = strlen(searchVar->szKey);
+        if(pSettingName == NULL || settings_save_one(pSettingName, searchVar->pValue, searchVar->cbValueLen) != 0) bSuccess = false;
+        else
+        {
+            searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | HPP_VAR_FLAG_PERSISTED;
+            *apcbWritten += searchVar->cbValueLen;
+            hppFlashStatistics.uiKeysWritten++;
+        }
 
-            if(cbKeyLen > cbVarNameMaxLen)
-            {
-                char* pNewVarName = (char*)realloc(pVarName, cbKeyLen + 5); // space for header and zero byte
-                
-                if(pNewVarName == NULL)
-                {
-                    free(pVarName);                                         // realloc does not free the original pointer  
-                    return false; 
-                }
+        free(pSettingName);
+	}
 
-                pVarName = pNewVarName;
-                cbVarNameMaxLen = cbKeyLen;
-            }
+    // Tombstones of deleted variables
+    while(*ppTombstone != NULL && bSuccess)
+    {
+        pTombstone = *ppTombstone;
 
-            strcpy(pVarName + 4, searchVar->szKey);
+        if(!hppFlashIsKeyOf(pTombstone->szKey, abGlobal)) 
+        {
+            ppTombstone = &pTombstone->pNext;
+            continue;
+        }
 
-            printf(" (%s)\r\n", pVarName);
+        pSettingName = hppFlashNewSettingName(pTombstone->szKey);
 
-            if(settings_save_one(pVarName, searchVar->pValue, searchVar->cbValueLen) != 0)
-            {
-                free(pVarName);
-                return false;
-            }
+        if(pSettingName == NULL || settings_delete(pSettingName) != 0) bSuccess = false;
+        else
+        {
+            *ppTombstone = pTombstone->pNext;
+            free(pTombstone);
+            hppFlashStatistics.uiKeysDeleted++;
         }
 
-		searchVar = searchVar->pNext;
-	}
-    
-    free(pVarName);
-    return true;
-}
+        free(pSettingName);
+    }
 
+    return bSuccess;
+}
 
-// --------------------------------------------
-// Handler for timer related H++ function calls 
-// --------------------------------------------
 
-void hppTimerExecutionHandler(void *apContext)
+// Length of the snapshot image of all global variables or the code
+static size_t hppFlashImageLen(bool abGlobal)
 {
-    if(apContext == NULL) return;   // unknown H++ function
-
-    hppAsyncParseVar((const char*)apContext);
+    return hppVarImageBuild(NULL, 0, abGlobal ? hppFlashIsGlobalKey : hppFlashIsCodeKey, 0);
 }
 
 
-void hppEventExecutionHandler(void* apData, uint32_t aDataLen, void *apContext)
+// Write a snapshot image of all global variables or the code to the slot not holding the latest image. The single settings
+// of the variables are deleted once the first image has been written. The number of bytes written is added to 'apcbWritten'.
+static bool hppFlashWriteImage(bool abGlobal, uint32_t* apcbWritten)
 {
+	struct hppVarListStruct* searchVar;
+    bool (*pFilter)(const char aszKey[]) = abGlobal ? hppFlashIsGlobalKey : hppFlashIsCodeKey;
+    size_t cbImageLen = hppFlashImageLen(abGlobal);
+    uint8_t uiSlot = hppFlashImageSequence[abGlobal] != 0 ? 1 - hppFlashImageSlot[abGlobal] : 0;
+    uint16_t iCount = abGlobal ? 0x8000 : 0x0;
+    char szImageName[12];
+    char* pchImage;
     bool bSuccess;
 
-    if(apContext == NULL) return;   // unknown H++ function
+    if(cbImageLen > HPP_FLASH_IMAGE_MAX_SIZE) return false;
 
-    bSuccess = hppAsyncVarPut("0000:event", apData, aDataLen, true);
-    if(bSuccess) hppAsyncParseVar((const char*)apContext);
+    pchImage = (char*)malloc(cbImageLen);
+    if(pchImage == NULL) return false;
 
-    // Make sure to unlock the parser mutex after any hppAsyncXXX(...) call with abSyncWithNext=true if hppAsyncParseVarCoapResponse(...) was not executed.
-    if(!bSuccess) hppAsyncParseVar("");
-}
+    hppVarImageBuild(pchImage, cbImageLen, pFilter, hppFlashImageSequence[abGlobal] + 1);
+    hppFlashImageName(szImageName, abGlobal, uiSlot);
 
+    bSuccess = settings_save_one(szImageName, pchImage, cbImageLen) == 0;
+    free(pchImage);
 
-// ----------------------------------------
-// Handler for Zephyr reladed H++ functions 
-// ----------------------------------------
+    if(!bSuccess) return false;
 
-// Evaluate Function 'aszFunctionName' with paramaters stored in variables with the name 'aszParamName' whereby
-// variable names have the format '%04x_Param1'. The byte 'aszParamName[HPP_PARAM_PREFIX_LEN - 1]' is modifiyed to read the
-// respectiv parameter. 
-// The result is stored in the variable 'aszResultVarKey. Must return a pointer to the respective byte array of the result variable
-// and change 'apcbResultLen_Out' to the respective number of bytes 
-//
-// No need to use the async hppVar methods (hppAsyncVarXXX). The hppVar mutex is already locked during H++ execution.    
-static char* hppEvaluateZephyrFunction(char aszFunctionName[], char aszParamName[], const char aszResultVarKey[], size_t* apcbResultLen_Out)
-{
-	char szNumeric[HPP_NUMERIC_MAX_MEM];
+    if(hppFlashImageSequence[abGlobal] == 0) settings_load_subtree_direct("hpp", hppDeleteVarSettingHandler, &iCount);
 
-    size_t cbParam2;
-    char* pchParam1 = hppVarGet(aszParamName, NULL);
-    aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '2';
-    char* pchParam2 = hppVarGet(aszParamName, &cbParam2);
-    
-    if(pchParam1 == NULL) pchParam1 = "";
-    if(pchParam2 == NULL) pchParam2 = "";
-    
+    hppFlashImageSequence[abGlobal]++;
+    hppFlashImageSlot[abGlobal] = uiSlot;
 
-    // io_XXX commands
-    if(strncmp(aszFunctionName, "io_", 3) == 0)
+    for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
     {
-        // GPIO
-        const struct device *hppGpioDev = hppGpioDev0;
+        if(!pFilter(searchVar->szKey)) continue;
+        
+        searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | HPP_VAR_FLAG_PERSISTED;
+        hppFlashStatistics.uiKeysWritten++;
+    }
 
-        if(strcmp(aszFunctionName, "io_pin") == 0)   // port , pin
-            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, atoi(pchParam1) * 32 + atoi(pchParam2)), apcbResultLen_Out);
+    hppFlashClearTombstones(abGlobal);
+    *apcbWritten += cbImageLen;
 
-        if(strcmp(aszFunctionName, "io_set") == 0)    // pin, value (0, !=0)
-        {
-            gpio_pin_t pin = atoi(pchParam1);
-            int val = atoi(pchParam2) == 0 ? 0 : 1;
+    return true;
+}
 
-            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
-            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
-            
-            if(gpio_pin_set(hppGpioDev, pin, val) != 0) return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-                
-            return hppVarPutStr(aszResultVarKey, val == 0 ? "0" : "1", apcbResultLen_Out);
-        }
 
-        if(strcmp(aszFunctionName, "io_get") == 0)    // pin
-        {
-            int val;
-            gpio_pin_t pin = atoi(pchParam1);
+// The variables of a class with an image outgrew HPP_FLASH_IMAGE_MAX_SIZE: write all of them as single settings and delete the
+// images, later saves write single settings. The number of value bytes written is added to 'apcbWritten'.
+static bool hppFlashWriteImageFallback(bool abGlobal, uint32_t* apcbWritten)
+{
+	struct hppVarListStruct* searchVar;
+    char szImageName[12];
+    uint8_t i;
 
-            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
-            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+    // The single settings were deleted with the first image, deleted variables are not in flash apart from the image
+    for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+        if(hppFlashIsKeyOf(searchVar->szKey, abGlobal)) searchVar->uiFlags = (searchVar->uiFlags & ~HPP_VAR_FLAGS_PERSISTENCE) | HPP_VAR_FLAG_DIRTY;
 
-            val = gpio_pin_get(hppGpioDev, pin);
+    hppFlashClearTombstones(abGlobal);
 
-            if(val < 0) hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+    // The latest image stays until all settings are written
+    if(!hppFlashWriteSettings(abGlobal, apcbWritten)) return false;
 
-            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, val), apcbResultLen_Out);
-        }
+    for(i = 0; i < 2; i++)
+    {
+        hppFlashImageName(szImageName, abGlobal, i);
+        settings_delete(szImageName);
+    }
 
-        if(strcmp(aszFunctionName, "io_cfg_output") == 0)    // pin [, high_driver (false, true)]
-        {
-            gpio_flags_t flags = 0;
-            gpio_pin_t pin = atoi(pchParam1);
+    hppFlashImageSequence[abGlobal] = 0;
+    hppFlashStatistics.uiFallbackCount++;
 
-            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
-            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+    LOG_WRN("%s image larger than %d bytes, saved as single settings", abGlobal ? "global" : "code", HPP_FLASH_IMAGE_MAX_SIZE);
 
-            if(strcmp(pchParam2, "true") == 0) flags = GPIO_DS_ALT_LOW | GPIO_DS_ALT_HIGH;
-            else if(*pchParam2 == 0 || strcmp(pchParam2, "false")) flags = GPIO_DS_DFLT_LOW | GPIO_DS_DFLT_HIGH;
-            else return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+    return true;
+}
 
-            gpio_pin_configure(hppGpioDev, pin, GPIO_OUTPUT_LOW | flags); 
-        
-            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);            
-        }
 
-        if(strcmp(aszFunctionName, "io_cfg_input") == 0)    // pin [, pull (up = 1, down = 0)]
-        {
-            gpio_pin_t pin = atoi(pchParam1);
+// Returns true if any of the global variables or the code changed since the last save
+static bool hppFlashIsChanged(bool abGlobal)
+{
+	struct hppVarListStruct* searchVar;
+    struct hppVarTombstoneStruct* pTombstone;
 
-            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
-            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+    for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+        if((searchVar->uiFlags & HPP_VAR_FLAG_DIRTY) && hppFlashIsKeyOf(searchVar->szKey, abGlobal)) return true;
 
-            if(*pchParam2 == 0) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_INT_DISABLE);
-            else if(atoi(pchParam2) == 0) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_PULL_DOWN | GPIO_INT_DISABLE);
-            else if(atoi(pchParam2) == 1) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_PULL_UP | GPIO_INT_DISABLE);
-            else return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-                
-            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
-        }
+    for(pTombstone = pFirstTombstone; pTombstone != NULL; pTombstone = pTombstone->pNext) 
+        if(hppFlashIsKeyOf(pTombstone->szKey, abGlobal)) return true;
 
+    return false;
+}
 
-        // PWM
 
-        if(strcmp(aszFunctionName, "io_pwm_restart") == 0)   // no param 
+// Write the global variables or the code as snapshot image (abImage = true) or as single settings. Variables of a class 
+// with an image are always written as a new image, but only if anything changed since the last save. If the image became
+// too large, the variables are written as single settings instead and false is returned.
+static bool hppFlashSave(bool abGlobal, bool abImage)
+{
+    uint32_t uiStartTime = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    uint32_t cbWritten = 0;
+    bool bSuccess = true;
+
+    if(abImage || hppFlashImageSequence[abGlobal] != 0) 
+    {
+        if(abImage || hppFlashIsChanged(abGlobal)) 
         {
-#if CONFIG_HPP_NRF52840            
-            if(NRF_PWM0->SEQ[0].REFRESH > 0) hppRestartPWM();
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-            return hppVarPutStr(aszResultVarKey, NRF_PWM0->SEQ[0].REFRESH > 0 ? "true" : "false", apcbResultLen_Out);
-#else
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-#endif
+            if(hppFlashImageSequence[abGlobal] != 0 && hppFlashImageLen(abGlobal) > HPP_FLASH_IMAGE_MAX_SIZE)
+            {
+                hppFlashWriteImageFallback(abGlobal, &cbWritten);
+                bSuccess = false;
+            }
+            else bSuccess = hppFlashWriteImage(abGlobal, &cbWritten);
         }
+    }
+    else bSuccess = hppFlashWriteSettings(abGlobal, &cbWritten);
 
-        if(strcmp(aszFunctionName, "io_pwm_stop") == 0)   // no param 
-        {
-#if CONFIG_HPP_NRF52840            
-            hppStopPWM();
-            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
-#else
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-#endif
-        }
-                    
-        if(strcmp(aszFunctionName, "io_pwm_start") == 0)   // count_stop, seq, val_repeat, seq_repeat, pin1 [, pin2, pin3, pin4]
-        {
-#if CONFIG_HPP_NRF52840            
-            size_t cSequenceLen;
-            int iPin1, iPin2, iPin3, iPin4; 
+    if(!bSuccess) hppFlashStatistics.uiFailCount++;
+    hppFlashStatistics.uiSaveCount++;
+    hppFlashStatistics.uiBytesWritten += cbWritten;
+    hppFlashStatistics.uiLastBytesWritten = cbWritten;
+    hppFlashStatistics.uiLastTime = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()) - uiStartTime;
+    if(hppFlashStatistics.uiMaxTime < hppFlashStatistics.uiLastTime) hppFlashStatistics.uiMaxTime = hppFlashStatistics.uiLastTime;
 
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
-            char* pchParam3 = hppVarGet(aszParamName, NULL);
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
-            char* pchParam4 = hppVarGet(aszParamName, NULL);
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '5';
-            char* pchParam5 = hppVarGet(aszParamName, NULL);
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '6';
-            char* pchParam6 = hppVarGet(aszParamName, NULL);
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '7';
-            char* pchParam7 = hppVarGet(aszParamName, NULL);
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '8';
-            char* pchParam8 = hppVarGet(aszParamName, NULL);
+    return bSuccess;
+}
 
-            if(pchParam3 == NULL) pchParam3 = "1";
-            if(pchParam4 == NULL) pchParam4 = "0";
-            if(pchParam5 == NULL) iPin1 = -1; else iPin1 = atoi(pchParam5);
-            if(pchParam6 == NULL) iPin2 = -1; else iPin2 = atoi(pchParam6);
-            if(pchParam7 == NULL) iPin3 = -1; else iPin3 = atoi(pchParam7);
-            if(pchParam8 == NULL) iPin4 = -1; else iPin4 = atoi(pchParam8);
 
-            if(iPin3 < 0 && iPin4 < 0)    
-            {
-                if(iPin2 < 0) cSequenceLen = cbParam2 / 2;    // only one pin active --> 2 bytes per sequence
-                else cSequenceLen = cbParam2 / 4;                       // two pins active --> 4 bytes per sequence
-            }
-            else cSequenceLen = cbParam2 / 8;   // three or four pins active --> 8 bytes per sequence
+bool hppWriteVarToFlash(bool abGlobal)
+{
+    return hppFlashSave(abGlobal, false);
+}
 
-            if(cSequenceLen >= 2 || (atoi(pchParam4) == 0 && cSequenceLen >= 1))
-            {
-                hppStartPWM(atoi(pchParam1), iPin1, iPin2, iPin3, iPin4, (uint16_t*) pchParam2,
-                            cSequenceLen, atoi(pchParam3), atoi(pchParam4));
-                return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
-            }
 
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-#else
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-#endif
-        }
+bool hppWriteImageToFlash(bool abGlobal)
+{
+    return hppFlashSave(abGlobal, true);
+}
 
-        
-        // Buttons
 
-        if(strcmp(aszFunctionName, "io_cfg_btn") == 0)    // pin [, activ_low/high(0/1), pull_up/down (1/0)] 
-        {
-            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
-        }
-              
-   }
+// Handler of the autosave event. Runs in the dispatcher with the parser mutex locked. 
+static void hppFlashAutosaveHandler(void* apData, uint32_t aDataLen, void *apContext)
+{
+    hppFlashAutosaveHandle = 0;
 
-    // flash_XXX commands
-    if(strncmp(aszFunctionName, "flash_", 6) == 0)
-    {
-        if(strcmp(aszFunctionName, "flash_save") == 0)   
-        {         
-            //hppDeleteVarFromFlash(true);        // Delete existing data 
-            return hppVarPutStr(aszResultVarKey, hppWriteVarToFlash(true) ? "true" : "false", apcbResultLen_Out);
-        }
+    hppWriteVarToFlash(true);
+    if(hppFlashAutosaveCode) hppWriteVarToFlash(false);
 
-        if(strcmp(aszFunctionName, "flash_save_code") == 0)   
-        {
-            //hppDeleteVarFromFlash(false);       // Delete existing code
-            return hppVarPutStr(aszResultVarKey, hppWriteVarToFlash(false) ? "true" : "false", apcbResultLen_Out);
-        }
+    // The save may be deferred by a quarter of the period to share a wake-up with other timers
+    if(hppFlashAutosavePeriod > 0) hppFlashAutosaveHandle = hppTimerScheduleEvent(hppFlashAutosavePeriod, hppFlashAutosavePeriod / 4, hppFlashAutosaveHandler, NULL, 0, NULL);
+}
 
-        if(strcmp(aszFunctionName, "flash_restore") == 0)    
-        {
-            return hppVarPutStr(aszResultVarKey, hppReadVarFromFlash(true) ? "true" : "false", apcbResultLen_Out);
-        }
 
-        if(strcmp(aszFunctionName, "flash_delete") == 0)    
-        {
-            return hppVarPutStr(aszResultVarKey, hppDeleteVarFromFlash(true) ? "true" : "false", apcbResultLen_Out);
-        }
+bool hppFlashAutosave(uint32_t aPeriod, bool abCode)
+{
+    hppTimerCancelEvent(hppFlashAutosaveHandle);
 
-        if(strcmp(aszFunctionName, "flash_delete_code") == 0)    
-        {          
-            return hppVarPutStr(aszResultVarKey, hppDeleteVarFromFlash(false) ? "true" : "false", apcbResultLen_Out);
-        }
-    }
+    hppFlashAutosaveHandle = 0;
+    hppFlashAutosavePeriod = aPeriod;
+    hppFlashAutosaveCode = abCode;
 
-    // timer_XXX commands
-    if(strncmp(aszFunctionName, "timer_", 6) == 0)
-    {
-        // Parameters: timer_id, time (in ms), function name  --->  timer_id =  0..HPP_TIMER_RESOURCE_COUNT - 1 (7)     
-        if(strcmp(aszFunctionName, "timer_start") == 0 || strcmp(aszFunctionName, "timer_once") == 0)   
-        {
-            char* pchParam3;
-            unsigned int uiTimer;
-            uint32_t uiTime;
-            bool bSuccess = false;
+    if(aPeriod == 0) return true;
 
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
-            pchParam3 = hppVarGet(aszParamName, NULL);
-            if(pchParam3 == NULL) pchParam3 = "";
-   
-            uiTimer = atoi(pchParam1);
-            uiTime = atol(pchParam2);
-            if(uiTime < HPP_MIN_TIMER_TIME) uiTime = HPP_MIN_TIMER_TIME;  // minimum time for HPP interpreter  
+    hppFlashAutosaveHandle = hppTimerScheduleEvent(aPeriod, aPeriod / 4, hppFlashAutosaveHandler, NULL, 0, NULL);
 
-            if(*pchParam3 != 0) 
-            {
-                bSuccess = hppTimerStart(uiTimer, uiTime, aszFunctionName[6] == 's', hppTimerExecutionHandler, (void*)hppVarGetKey(pchParam3, true));
-            }
+    return hppFlashAutosaveHandle != 0;
+}
 
-            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
-        }
 
-        // Parameter: timer_id     
-        if(strcmp(aszFunctionName, "timer_stop") == 0)   
-        {
-            unsigned int uiTimer;
-            bool bSuccess = false;
+// Write the flash statistics in the format "saves,keys written,keys deleted,bytes written,last bytes,last time,max time,dirty,
+// tombstones,restored,restore time,image,mapped,failed,fallbacks". Bytes are value bytes or image bytes, times in us. dirty and 
+// tombstones are the variables to be written and deleted by the next save of all variables. restored, restore time and image (true
+// if a snapshot image was loaded) refer to the last restore. mapped are the value bytes read from flash in place instead of the heap.
+// failed are the saves which returned false, fallbacks the images too large written as single settings instead.
+// Returns the length like snprintf.
+size_t hppFlashStatsDump(char* aszOut, size_t acbMaxLen)
+{
+    struct hppVarListStruct* searchVar;
+    struct hppVarTombstoneStruct* pTombstone;
+    uint32_t uiDirtyCount = 0;
+    uint32_t uiTombstoneCount = 0;
+    uint32_t cbMapped = 0;
 
-            uiTimer = atoi(pchParam1);   
-            bSuccess = hppTimerStop(uiTimer);
-            
-            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
-        }
+    for(searchVar = pFirstVar; searchVar != NULL; searchVar = searchVar->pNext)
+    {
+        if((searchVar->uiFlags & HPP_VAR_FLAG_DIRTY) && (hppFlashIsKeyOf(searchVar->szKey, true) || hppFlashIsKeyOf(searchVar->szKey, false))) uiDirtyCount++;
+        if((searchVar->uiFlags & (HPP_VAR_FLAG_MAPPED | HPP_VAR_FLAG_INTERNED)) == HPP_VAR_FLAG_MAPPED) cbMapped += searchVar->cbValueLen + 1;   // values in flash
+    }
 
-        // Parameters: time (in ms), function name, event  (name passed to variable "event")   
-        if(strcmp(aszFunctionName, "timer_event") == 0)   
-        {
-            char* pchParam3;
-            uint32_t uiTime;
-            bool bSuccess = false;
+    for(pTombstone = pFirstTombstone; pTombstone != NULL; pTombstone = pTombstone->pNext) uiTombstoneCount++;
 
-            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
-            pchParam3 = hppVarGet(aszParamName, NULL);
-            if(pchParam3 == NULL) pchParam3 = "";
+    return snprintf(aszOut, acbMaxLen, "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%s,%lu,%lu,%lu", (unsigned long)hppFlashStatistics.uiSaveCount, 
+                    (unsigned long)hppFlashStatistics.uiKeysWritten, (unsigned long)hppFlashStatistics.uiKeysDeleted, 
+                    (unsigned long)hppFlashStatistics.uiBytesWritten, (unsigned long)hppFlashStatistics.uiLastBytesWritten,
+                    (unsigned long)hppFlashStatistics.uiLastTime, (unsigned long)hppFlashStatistics.uiMaxTime, 
+                    (unsigned long)uiDirtyCount, (unsigned long)uiTombstoneCount, (unsigned long)hppFlashStatistics.uiRestoredKeys,
+                    (unsigned long)hppFlashStatistics.uiRestoreTime, hppFlashStatistics.bRestoredImage ? "true" : "false", 
+                    (unsigned long)cbMapped, (unsigned long)hppFlashStatistics.uiFailCount, (unsigned long)hppFlashStatistics.uiFallbackCount);
+}
 
-            uiTime = atol(pchParam1);
-            if(uiTime < HPP_MIN_TIMER_TIME) uiTime = HPP_MIN_TIMER_TIME;  // minimum time for HPP interpreter  
 
-            if(*pchParam2 != 0) 
-            {
-                bSuccess = hppTimerScheduleEvent(uiTime, hppEventExecutionHandler, pchParam3, strlen(pchParam3) + 1, (void*)hppVarGetKey(pchParam2, true));
-            }
+void hppFlashStatsReset()
+{
+    memset(&hppFlashStatistics, 0, sizeof(hppFlashStats));
+}
 
-            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
-        }
+
+// ------------------------------------------------------------------
+// Execution time budgets of the entry points
+// ------------------------------------------------------------------
+
+// Entry point of H++ code started by the TLV type 'auiType'
+static enum hppEntryPointEnum hppEntryPointGetByType(uint8_t auiType)
+{
+    switch(auiType)
+    {
+        case HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE: return hppEntryPoint_CoAP;
+        case HPP_ASYNC_TLV_PARSE_VAR_TIMER: return hppEntryPoint_Timer;
+        case HPP_ASYNC_TLV_PARSE_TEXT_CLI: return hppEntryPoint_CLI;
     }
-    
-    return NULL;
-}	
 
+    return hppEntryPoint_Other;
+}
 
 
-// ------------------------------------------------------------------
-// Synchronized function calls for relevant hppVarXXX functions
-// ------------------------------------------------------------------
+enum hppEntryPointEnum hppEntryPointGetByName(const char* aszName)
+{
+    uint32_t i;
 
-/*
+    for(i = 0; i < hppEntryPoint_Count; i++) 
+        if(strcmp(hppEntryPointResources[i].szName, aszName) == 0) return (enum hppEntryPointEnum)i;
 
-bool hppSyncVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
+    return hppEntryPoint_Count;
+}
+
+
+uint32_t hppEntryPointGetBudget()
 {
-    bool bRetVal;
+    return hppEntryPointResources[hppEntryPointCurrent].uiBudget;
+}
 
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    bRetVal = (hppVarPut(aszKey, apValue, acbValueLen) != NULL);
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
 
-    return bRetVal;
+void hppEntryPointSetBudget(enum hppEntryPointEnum aEntryPoint, uint32_t auiBudget)
+{
+    uint32_t i;
+
+    for(i = 0; i < hppEntryPoint_Count; i++) 
+        if(aEntryPoint == hppEntryPoint_Count || (uint32_t)aEntryPoint == i) hppEntryPointResources[i].uiBudget = auiBudget;
 }
 
-bool hppSyncVarPutStr(const char aszKey[], const char aszValue[], size_t* apcbResultLen_Out)
+
+void hppEntryPointRecordRun(uint32_t auiTime)
 {
-    bool bRetVal;
+    hppEntryPointResource* pEntryPoint = &(hppEntryPointResources[hppEntryPointCurrent]);
 
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    bRetVal = (hppVarPutStr(aszKey, aszValue, apcbResultLen_Out) != NULL);
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    pEntryPoint->uiRunCount++;
+    if(pEntryPoint->uiMaxTime < auiTime) pEntryPoint->uiMaxTime = auiTime;
+}
 
-    return bRetVal;
+
+void hppEntryPointRecordOverrun()
+{
+    hppEntryPointResources[hppEntryPointCurrent].uiOverrunCount++;
 }
 
 
-char* hppSyncVarPutBegin(const char aszKey[], const char apValue[], size_t acbValueLen)
+// Write the budgets and statistics of all entry points in the format "name,budget,runs,max,overruns" (one line each).
+// Returns the length of the text which would have been written if 'acbMaxLen' had been sufficiently large (like snprintf).
+static size_t hppEntryPointDump(char* aszOut, size_t acbMaxLen)
 {
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    return hppVarPut(aszKey, apValue, acbValueLen);
+    hppEntryPointResource* pEntryPoint;
+    size_t cbLen = 0;
+    uint32_t i;
+    int iLen;
+
+    if(aszOut != NULL && acbMaxLen > 0) aszOut[0] = 0;
+
+    for(i = 0; i < hppEntryPoint_Count; i++) 
+    {
+        pEntryPoint = &(hppEntryPointResources[i]);
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s%s,%lu,%lu,%lu,%lu", 
+                        i > 0 ? "\n" : "", pEntryPoint->szName, (unsigned long)pEntryPoint->uiBudget, (unsigned long)pEntryPoint->uiRunCount, 
+                        (unsigned long)pEntryPoint->uiMaxTime, (unsigned long)pEntryPoint->uiOverrunCount);
+
+        if(iLen > 0) cbLen += (size_t)iLen;
+    }
+
+    return cbLen;
 }
 
-void hppSyncVarPutEnd()
+
+
+// ------------------------------------------------------------------
+// Queue statistics
+// ------------------------------------------------------------------
+
+// Names of the TLV types in the statistics
+static const char* hppAsyncTypeNames[HPP_ASYNC_TLV_TYPE_COUNT] = 
+{ 
+    "", "var_get", "var_put", "var_put_next", "var_put_uri", "var_delete", "parse", "parse_cli", "parse_var", "parse_coap", 
+    "coap_context", "coap_context_next", "wkc_get", "var_hide", "usb_recv", "timer", "event_timer", "task_slice", "task_resume", 
+    "stats_get", "parse_timer", "var_put_block", "var_put_block_next", "var_put_block_uri", "button", "usb_frame", "var_put_timer" 
+};
+
+
+// Microsecond clock used by the profiler and the queue statistics
+static uint32_t hppProfilerClockUs(void)
 {
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
 }
 
 
+// Count 'auiTime' in us in the histogram 'apuiHist' with buckets growing by factor 4 starting with 64us
+static void hppAsyncStatsHistAdd(uint16_t* apuiHist, uint32_t auiTime)
+{
+    uint32_t uiBucket = 0;
+
+    while(uiBucket < HPP_ASYNC_STATS_BUCKET_COUNT - 1 && auiTime >= (64u << (2 * uiBucket))) uiBucket++;
 
-bool hppSyncVarExists(const char aszKey[], size_t* apcbValueLen_Out)
+    if(apuiHist[uiBucket] < UINT16_MAX) apuiHist[uiBucket]++;
+}
+
+
+// Record an entry of the type 'auiType' which was dispatched 'auiLatency' us after it was queued and took 'auiExecTime' us
+static void hppAsyncStatsRecordDispatch(uint8_t auiType, uint32_t auiLatency, uint32_t auiExecTime)
 {
-    bool bRetVal;
+    hppAsyncTypeStats* pStats;
 
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    bRetVal =  (hppVarGet(aszKey, apcbValueLen_Out) != NULL);
-    k_mutex_unlock(&hppVarMutex);
+    if(auiType >= HPP_ASYNC_TLV_TYPE_COUNT) return;
 
-    return bRetVal;
+    pStats = &(hppAsyncTypeStatistics[auiType]);
+    pStats->uiDispatchCount++;
+
+    if(pStats->uiMaxLatency < auiLatency) pStats->uiMaxLatency = auiLatency;
+    if(pStats->uiMaxExecTime < auiExecTime) pStats->uiMaxExecTime = auiExecTime;
+
+    hppAsyncStatsHistAdd(pStats->auiLatencyHist, auiLatency);
+    hppAsyncStatsHistAdd(pStats->auiExecTimeHist, auiExecTime);
 }
 
-char* hppSyncVarGetBegin(const char aszKey[], size_t* apcbValueLen_Out)
+
+static void hppAsyncStatsReset()
 {
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    return hppVarGet(aszKey, apcbValueLen_Out);
+    uint32_t i;
+
+    k_sched_lock();
+    
+    for(i = 0; i < HPP_ASYNC_QUEUE_COUNT; i++) 
+    {
+        hppAsyncQueueResetStats(&(hppAsyncQueues[i]));
+    }
+    
+    memset(hppAsyncTypeStatistics, 0, sizeof(hppAsyncTypeStatistics));
+    hppAsyncCoalescedCount = 0;
+
+    k_sched_unlock();
 }
 
-void hppSyncVarGetEnd()
+
+// Write the histogram 'apuiHist' as list of counts separated by ';'. Returns the length like snprintf.
+static size_t hppAsyncStatsHistDump(char* aszOut, size_t acbMaxLen, const uint16_t* apuiHist)
 {
-    k_mutex_unlock(&hppVarMutex);
+    size_t cbLen = 0;
+    uint32_t i;
+    int iLen;
+
+    for(i = 0; i < HPP_ASYNC_STATS_BUCKET_COUNT; i++) 
+    {
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s%u", i > 0 ? ";" : "", (unsigned int)apuiHist[i]);
+        if(iLen > 0) cbLen += (size_t)iLen;
+    }
+
+    return cbLen;
 }
 
 
+// Write the statistics of the queues in the format "queue,size,used,high water,puts,drops" (one line each) followed by
+// "type,runs,drops,max latency,max time,latency histogram,time histogram" for each TLV type in use and a line "coalesced,n".
+// Times are in us, histograms are lists of counts of the buckets < 64us, < 256us, < 1ms, < 4ms, < 16ms, < 64ms, < 256ms and above
+// separated by ';'. Returns the length of the text which would have been written if 'acbMaxLen' had been sufficiently large (like snprintf).
+static size_t hppAsyncStatsDump(char* aszOut, size_t acbMaxLen)
+{
+    struct hppAsyncQueueStruct* pQueue;
+    hppAsyncTypeStats* pStats;
+    size_t cbLen = 0;
+    uint32_t i;
+    int iLen;
+
+    if(aszOut != NULL && acbMaxLen > 0) aszOut[0] = 0;
+
+    for(i = 0; i < HPP_ASYNC_QUEUE_COUNT; i++) 
+    {
+        pQueue = &(hppAsyncQueues[i]);
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s,%lu,%lu,%lu,%lu,%lu\n", 
+                        pQueue->szName, (unsigned long)hppAsyncQueueCapacity(pQueue), (unsigned long)hppAsyncQueueUsed(pQueue),
+                        (unsigned long)pQueue->uiHighWater, (unsigned long)pQueue->uiPutCount, (unsigned long)pQueue->uiDropCount);
+
+        if(iLen > 0) cbLen += (size_t)iLen;
+    }
+
+    for(i = 1; i < HPP_ASYNC_TLV_TYPE_COUNT; i++) 
+    {
+        pStats = &(hppAsyncTypeStatistics[i]);
+        if(pStats->uiDispatchCount == 0 && pStats->uiDropCount == 0) continue;
+
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%s,%lu,%lu,%lu,%lu,", 
+                        hppAsyncTypeNames[i], (unsigned long)pStats->uiDispatchCount, (unsigned long)pStats->uiDropCount, 
+                        (unsigned long)pStats->uiMaxLatency, (unsigned long)pStats->uiMaxExecTime);
+        if(iLen > 0) cbLen += (size_t)iLen;
+
+        cbLen += hppAsyncStatsHistDump(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, pStats->auiLatencyHist);
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, ",");
+        if(iLen > 0) cbLen += (size_t)iLen;
+        cbLen += hppAsyncStatsHistDump(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, pStats->auiExecTimeHist);
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "\n");
+        if(iLen > 0) cbLen += (size_t)iLen;
+    }
+
+    iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "coalesced,%lu", (unsigned long)hppAsyncCoalescedCount);
+    if(iLen > 0) cbLen += (size_t)iLen;
+
+    return cbLen;
+}
+
+
+
+// ------------------------------------------------------------------
+// H++ tasks executed in slices
+// ------------------------------------------------------------------
+
+// Number of tasks in progress. Tasks waiting for an event are not counted if 'abRunnableOnly' is true.
+static uint32_t hppTaskCount(bool abRunnableOnly)
+{
+    uint32_t i;
+    uint32_t uiCount = 0;
+
+    for(i = 0; i < HPP_TASK_COUNT; i++) 
+        if(hppTaskResources[i].pParseContext != NULL && (!abRunnableOnly || hppTaskResources[i].uiWaitID == 0)) uiCount++;
+
+    return uiCount;
+}
+
+
+// Start H++ code 'aszCode' as task. The code is copied if 'abCopyCode' is true. The present CoAP context is assigned to the task.
+// Returns NULL if tasks are switched off or no task resource is available.
+static hppTaskResource* hppTaskBegin(const char* aszCode, bool abCopyCode, uint8_t auiType)
+{
+    hppTaskResource* pTask = NULL;
+    uint32_t i;
+
+    if(hppTaskSliceTicks == 0) return NULL;
+
+    for(i = 0; i < HPP_TASK_COUNT; i++) 
+    {
+        if(hppTaskResources[i].pParseContext == NULL) 
+        {
+            pTask = &(hppTaskResources[i]);
+            break;
+        }
+    }
+
+    if(pTask == NULL) return NULL;
+
+    pTask->pchCode = NULL;
+
+    if(abCopyCode)
+    {
+        pTask->pchCode = malloc(strlen(aszCode) + 1);
+        if(pTask->pchCode == NULL) return NULL;
+        
+        strcpy(pTask->pchCode, aszCode);
+        aszCode = pTask->pchCode;
+    }
+
+    // Each task uses its own result variable and its own range of call depths for local variables
+    sprintf(pTask->szResultVarKey, "#%u:ReturnWithError", (unsigned int)i + 1);
+    pTask->pParseContext = hppParseExpressionBegin(aszCode, pTask->szResultVarKey, (i + 1) * HPP_TASK_LOCAL_BASE_STEP);
+    
+    if(pTask->pParseContext == NULL)
+    {
+        if(pTask->pchCode != NULL) free(pTask->pchCode);
+        pTask->pchCode = NULL;
+        return NULL;
+    }
+    
+    pTask->uiType = auiType;
+    pTask->mCoapMessageContext = hppMyCurrentCoapMessageContext;
+    pTask->uiWaitID = 0;
+
+    return pTask;
+}
+
+
+// Execute the next slice of task 'apTask'. The CoAP context of the task is the present one while the task is executed. 
+// Returns true if the task has finished. The CoAP context of the task remains the present one in this case.
+static bool hppTaskContinue(hppTaskResource* apTask)
+{
+    bool bDone;
+
+    hppMyCurrentCoapMessageContext = apTask->mCoapMessageContext;
+
+    hppTaskCurrent = apTask;
+    hppEntryPointCurrent = hppEntryPointGetByType(apTask->uiType);
+    bDone = hppParseExpressionContinue(apTask->pParseContext, hppTaskSliceTicks);
+    hppEntryPointCurrent = hppEntryPoint_Other;
+    hppTaskCurrent = NULL;
+
+    if(bDone) return true;
+    
+    apTask->mCoapMessageContext = hppMyCurrentCoapMessageContext;    // The task may have responded already
+
+    // Invalidate CoAP call context
+    hppMyCurrentCoapMessageContext.mCoapMessageTokenLength = 0;
+    hppMyCurrentCoapMessageContext.mCoapCode = OT_COAP_CODE_EMPTY;
+
+    return false;
+}
+
+
+// Finish task 'apTask' and release the task resource. The key of the result variable is copied to 'aszResultVarKey_Out'.
+// Returns the result of the task.
+static char* hppTaskEnd(hppTaskResource* apTask, char* aszResultVarKey_Out)
+{
+    char* pchResult = hppParseExpressionEnd(apTask->pParseContext);
+
+    strcpy(aszResultVarKey_Out, apTask->szResultVarKey);
+    if(apTask->pchCode != NULL) free(apTask->pchCode);
+    apTask->pchCode = NULL;
+    apTask->pParseContext = NULL;
+
+    return pchResult;
+}
+
+
+// Get the next task in progress (round robin). Returns NULL if there is none.
+static hppTaskResource* hppTaskGetNext()
+{
+    uint32_t i;
+
+    for(i = 0; i < HPP_TASK_COUNT; i++) 
+    {
+        hppTaskNext = (hppTaskNext + 1) % HPP_TASK_COUNT;
+        if(hppTaskResources[hppTaskNext].pParseContext != NULL && hppTaskResources[hppTaskNext].uiWaitID == 0) return &(hppTaskResources[hppTaskNext]);
+    }
+
+    return NULL;
+}
+
+
+// Suspend the task presently executed until hppTaskResume is called with the returned ID. The result of the event is stored in 
+// 'aszResultVarKey' then. Must be called from a H++ function binding which returns immediately afterwards.
+// Returns 0 if the H++ code does not run as task. The function binding must not wait for the event in this case.
+uint32_t hppTaskWait(const char aszResultVarKey[])
+{
+    if(hppTaskCurrent == NULL) return 0;
+    if(!hppParseExpressionYield()) return 0;
+
+    // The ID includes the task index and a counter such that late events of a finished task do not wake up a new one 
+    hppTaskWaitCount++;
+    hppTaskCurrent->uiWaitID = ((hppTaskWaitCount & 0xffffff) << 8) | ((hppTaskCurrent - hppTaskResources) + 1);
+    hppTaskCurrent->szWaitResultVarKey = aszResultVarKey;
+    hppTaskCurrent->uiWaitTimer = 0;
+
+    return hppTaskCurrent->uiWaitID;
+}
+
+
+// Get the task waiting for the event 'aTaskWaitID'. Returns NULL if the task has finished or waits for another event already.
+static hppTaskResource* hppTaskGetWaiting(uint32_t aTaskWaitID)
+{
+    uint32_t uiIndex = (aTaskWaitID & 0xff) - 1;
+    hppTaskResource* pTask;
+
+    if(aTaskWaitID == 0 || uiIndex >= HPP_TASK_COUNT) return NULL;
+
+    pTask = &(hppTaskResources[uiIndex]);
+    if(pTask->pParseContext == NULL || pTask->uiWaitID != aTaskWaitID) return NULL;
+
+    return pTask;
+}
+
+
+// Wake up the task waiting for the event 'aTaskWaitID' and pass the result 'apValue'. Events of finished tasks are ignored.
+// A timer event ending the wait is cancelled. The parser mutex must be locked. Use hppAsyncTaskResume otherwise.
+// Returns true if a waiting task has been found.
+bool hppTaskResume(uint32_t aTaskWaitID, const char apValue[], size_t acbValueLen)
+{
+    hppTaskResource* pTask = hppTaskGetWaiting(aTaskWaitID);
+
+    if(pTask == NULL) return false;
+
+    hppVarPut(pTask->szWaitResultVarKey, apValue, acbValueLen);
+    pTask->uiWaitID = 0;
+
+    if(pTask->uiWaitTimer != 0)
+    {
+        hppTimerCancelEvent(pTask->uiWaitTimer);    // nothing to do if the timer itself has woken up the task
+        pTask->uiWaitTimer = 0;
+    }
+
+    return true;
+}
+
+
+// Timer handler ending the wait of a task (see hppTaskWaitTimeout). The context is the result passed to the task.
+static void hppTaskWaitTimeoutHandler(void* apData, uint32_t aDataLen, void *apContext)
+{
+    if(apData == NULL || aDataLen != sizeof(uint32_t) || apContext == NULL) return;
+
+    hppTaskResume(*(uint32_t*)apData, (const char*)apContext, strlen((const char*)apContext));
+}
+
+
+// Wake up the task waiting for the event 'aTaskWaitID' after 'auiTime' ms with the result 'aszValue' unless it is woken up before
+bool hppTaskWaitTimeout(uint32_t aTaskWaitID, uint32_t auiTime, const char aszValue[])
+{
+    hppTaskResource* pTask = hppTaskGetWaiting(aTaskWaitID);
+
+    if(pTask == NULL || aszValue == NULL) return false;
+
+    hppTimerCancelEvent(pTask->uiWaitTimer);
+    pTask->uiWaitTimer = hppTimerScheduleEvent(auiTime, 0, hppTaskWaitTimeoutHandler, &aTaskWaitID, sizeof(uint32_t), (void*)aszValue);
+
+    return pTask->uiWaitTimer != 0;
+}
+
+
+
+// --------------------------------------------
+// Handler for timer related H++ function calls 
+// --------------------------------------------
+
+void hppTimerExecutionHandler(void *apContext)
+{
+    if(apContext == NULL) return;   // unknown H++ function
+
+    hppAsyncParseVarTimer((const char*)apContext);
+}
+
+
+void hppEventExecutionHandler(void* apData, uint32_t aDataLen, void *apContext)
+{
+    bool bSuccess;
+
+    if(apContext == NULL) return;   // unknown H++ function
+
+    bSuccess = hppAsyncVarPut("0000:event", apData, aDataLen, true);
+    if(bSuccess) bSuccess = hppAsyncParseVarTimer((const char*)apContext);
+
+    // Make sure to unlock the parser mutex after any hppAsyncXXX(...) call with abSyncWithNext=true if hppAsyncParseVarCoapResponse(...) was not executed.
+    if(!bSuccess) hppAsyncParseVar("");
+}
+
+
+// ----------------------------------------
+// Handler for Zephyr reladed H++ functions 
+// ----------------------------------------
+
+// Evaluate Function 'aszFunctionName' with paramaters stored in variables with the name 'aszParamName' whereby
+// variable names have the format '%04x_Param1'. The byte 'aszParamName[HPP_PARAM_PREFIX_LEN - 1]' is modifiyed to read the
+// respectiv parameter. 
+// The result is stored in the variable 'aszResultVarKey. Must return a pointer to the respective byte array of the result variable
+// and change 'apcbResultLen_Out' to the respective number of bytes 
+//
+// No need to use the async hppVar methods (hppAsyncVarXXX). The hppVar mutex is already locked during H++ execution.    
+static char* hppEvaluateZephyrFunction(char aszFunctionName[], char aszParamName[], const char aszResultVarKey[], size_t* apcbResultLen_Out)
+{
+	char szNumeric[HPP_NUMERIC_MAX_MEM];
+
+    size_t cbParam2;
+    char* pchParam1 = hppVarGet(aszParamName, NULL);
+    aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '2';
+    char* pchParam2 = hppVarGet(aszParamName, &cbParam2);
+    
+    if(pchParam1 == NULL) pchParam1 = "";
+    if(pchParam2 == NULL) pchParam2 = "";
+    
+
+    // io_XXX commands
+    if(strncmp(aszFunctionName, "io_", 3) == 0)
+    {
+        // GPIO
+        const struct device *hppGpioDev = hppGpioDev0;
+
+        if(strcmp(aszFunctionName, "io_pin") == 0)   // port , pin
+            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, atoi(pchParam1) * 32 + atoi(pchParam2)), apcbResultLen_Out);
+
+        if(strcmp(aszFunctionName, "io_set") == 0)    // pin, value (0, !=0)
+        {
+            gpio_pin_t pin = atoi(pchParam1);
+            int val = atoi(pchParam2) == 0 ? 0 : 1;
+
+            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
+            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+            
+            if(gpio_pin_set(hppGpioDev, pin, val) != 0) return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+                
+            return hppVarPutStr(aszResultVarKey, val == 0 ? "0" : "1", apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "io_get") == 0)    // pin
+        {
+            int val;
+            gpio_pin_t pin = atoi(pchParam1);
+
+            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
+            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+
+            val = gpio_pin_get(hppGpioDev, pin);
+
+            if(val < 0) hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, val), apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "io_cfg_output") == 0)    // pin [, high_driver (false, true)]
+        {
+            gpio_flags_t flags = 0;
+            gpio_pin_t pin = atoi(pchParam1);
+
+            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
+            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+
+            if(strcmp(pchParam2, "true") == 0) flags = GPIO_DS_ALT_LOW | GPIO_DS_ALT_HIGH;
+            else if(*pchParam2 == 0 || strcmp(pchParam2, "false")) flags = GPIO_DS_DFLT_LOW | GPIO_DS_DFLT_HIGH;
+            else return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+            gpio_pin_configure(hppGpioDev, pin, GPIO_OUTPUT_LOW | flags); 
+        
+            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);            
+        }
+
+        if(strcmp(aszFunctionName, "io_cfg_input") == 0)    // pin [, pull (up = 1, down = 0)]
+        {
+            gpio_pin_t pin = atoi(pchParam1);
+
+            if(pin > 63) return hppVarPutStr(aszResultVarKey, "invalid", apcbResultLen_Out);
+            if(pin > 31) { hppGpioDev = hppGpioDev1; pin -= 32; }
+
+            if(*pchParam2 == 0) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_INT_DISABLE);
+            else if(atoi(pchParam2) == 0) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_PULL_DOWN | GPIO_INT_DISABLE);
+            else if(atoi(pchParam2) == 1) gpio_pin_configure(hppGpioDev, pin, GPIO_INPUT | GPIO_PULL_UP | GPIO_INT_DISABLE);
+            else return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+                
+            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+        }
+
+
+        // PWM
+
+        if(strcmp(aszFunctionName, "io_pwm_restart") == 0)   // no param 
+        {
+#if CONFIG_HPP_NRF52840            
+            if(NRF_PWM0->SEQ[0].REFRESH > 0) hppRestartPWM();
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+            return hppVarPutStr(aszResultVarKey, NRF_PWM0->SEQ[0].REFRESH > 0 ? "true" : "false", apcbResultLen_Out);
+#else
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+#endif
+        }
+
+        if(strcmp(aszFunctionName, "io_pwm_stop") == 0)   // no param 
+        {
+#if CONFIG_HPP_NRF52840            
+            hppStopPWM();
+            return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+#else
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+#endif
+        }
+                    
+        if(strcmp(aszFunctionName, "io_pwm_start") == 0)   // count_stop, seq, val_repeat, seq_repeat, pin1 [, pin2, pin3, pin4]
+        {
+#if CONFIG_HPP_NRF52840            
+            size_t cSequenceLen;
+            int iPin1, iPin2, iPin3, iPin4; 
+
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
+            char* pchParam3 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
+            char* pchParam4 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '5';
+            char* pchParam5 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '6';
+            char* pchParam6 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '7';
+            char* pchParam7 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '8';
+            char* pchParam8 = hppVarGet(aszParamName, NULL);
+
+            if(pchParam3 == NULL) pchParam3 = "1";
+            if(pchParam4 == NULL) pchParam4 = "0";
+            if(pchParam5 == NULL) iPin1 = -1; else iPin1 = atoi(pchParam5);
+            if(pchParam6 == NULL) iPin2 = -1; else iPin2 = atoi(pchParam6);
+            if(pchParam7 == NULL) iPin3 = -1; else iPin3 = atoi(pchParam7);
+            if(pchParam8 == NULL) iPin4 = -1; else iPin4 = atoi(pchParam8);
+
+            if(iPin3 < 0 && iPin4 < 0)    
+            {
+                if(iPin2 < 0) cSequenceLen = cbParam2 / 2;    // only one pin active --> 2 bytes per sequence
+                else cSequenceLen = cbParam2 / 4;                       // two pins active --> 4 bytes per sequence
+            }
+            else cSequenceLen = cbParam2 / 8;   // three or four pins active --> 8 bytes per sequence
+
+            if(cSequenceLen >= 2 || (atoi(pchParam4) == 0 && cSequenceLen >= 1))
+            {
+                hppStartPWM(atoi(pchParam1), iPin1, iPin2, iPin3, iPin4, (uint16_t*) pchParam2,
+                            cSequenceLen, atoi(pchParam3), atoi(pchParam4));
+                return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+            }
+
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+#else
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+#endif
+        }
+
+        
+        // Buttons
+
+        if(strcmp(aszFunctionName, "io_cfg_btn") == 0)    // pin [, activ_low/high(0/1), pull_up/down (1/0) [, debounce time (ms) [, edge (0 = both, 1 = push, 2 = release)]]]
+        {
+            char* pchParam3;
+            char* pchParam4;
+            char* pchParam5;
+            int iPull = -1;
+            bool bSuccess;
+
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
+            pchParam3 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
+            pchParam4 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '5';
+            pchParam5 = hppVarGet(aszParamName, NULL);
+            if(pchParam3 == NULL) pchParam3 = "";
+            if(pchParam4 == NULL) pchParam4 = "";
+            if(pchParam5 == NULL) pchParam5 = "";
+
+            if(*pchParam3 != 0) iPull = atoi(pchParam3) == 0 ? 0 : 1;
+            else if(*pchParam1 == 0) iPull = 1;     // default button is active low without external pull up
+
+            bSuccess = hppButtonConfigure(*pchParam1 == 0 ? HPP_BUTTON_DEFAULT_PIN : atoi(pchParam1), atoi(pchParam2) != 0, iPull,
+                                          *pchParam4 == 0 ? HPP_BUTTON_DEBOUNCE_TIME : atol(pchParam4), atoi(pchParam5));
+
+            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
+        }
+              
+   }
+
+    // flash_XXX commands
+    if(strncmp(aszFunctionName, "flash_", 6) == 0)
+    {
+        if(strcmp(aszFunctionName, "flash_save") == 0)   
+        {         
+            return hppVarPutStr(aszResultVarKey, hppWriteVarToFlash(true) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "flash_save_code") == 0)   
+        {
+            return hppVarPutStr(aszResultVarKey, hppWriteVarToFlash(false) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameter: [true to write the code instead of the global variables]
+        if(strcmp(aszFunctionName, "flash_snapshot") == 0)   
+        {
+            return hppVarPutStr(aszResultVarKey, hppWriteImageToFlash(strcmp(pchParam1, "true") != 0) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameters: period in ms (0 = off) [, true to save the code as well]
+        if(strcmp(aszFunctionName, "flash_autosave") == 0)   
+        {
+            return hppVarPutStr(aszResultVarKey, hppFlashAutosave(atol(pchParam1), strcmp(pchParam2, "true") == 0) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameter: [true to reset the statistics after reading them]
+        if(strcmp(aszFunctionName, "flash_stats") == 0)   
+        {
+            char szStats[192];
+
+            hppFlashStatsDump(szStats, sizeof(szStats));
+            if(strcmp(pchParam1, "true") == 0) hppFlashStatsReset();
+
+            return hppVarPutStr(aszResultVarKey, szStats, apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "flash_restore") == 0)    
+        {
+            return hppVarPutStr(aszResultVarKey, hppReadVarFromFlash(true) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "flash_delete") == 0)    
+        {
+            return hppVarPutStr(aszResultVarKey, hppDeleteVarFromFlash(true) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        if(strcmp(aszFunctionName, "flash_delete_code") == 0)    
+        {          
+            return hppVarPutStr(aszResultVarKey, hppDeleteVarFromFlash(false) ? "true" : "false", apcbResultLen_Out);
+        }
+    }
+
+    // timer_XXX commands
+    if(strncmp(aszFunctionName, "timer_", 6) == 0)
+    {
+        // Parameters: timer_id, time (in ms), function name [, slack (in ms)]  --->  timer_id =  0..HPP_TIMER_RESOURCE_COUNT - 1 (7)     
+        if(strcmp(aszFunctionName, "timer_start") == 0 || strcmp(aszFunctionName, "timer_once") == 0)   
+        {
+            char* pchParam3;
+            char* pchParam4;
+            unsigned int uiTimer;
+            uint32_t uiTime;
+            bool bSuccess = false;
+
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
+            pchParam3 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
+            pchParam4 = hppVarGet(aszParamName, NULL);
+            if(pchParam3 == NULL) pchParam3 = "";
+            if(pchParam4 == NULL) pchParam4 = "";
+   
+            uiTimer = atoi(pchParam1);
+            uiTime = atol(pchParam2);
+            if(uiTime < HPP_MIN_TIMER_TIME) uiTime = HPP_MIN_TIMER_TIME;  // minimum time for HPP interpreter  
+
+            if(*pchParam3 != 0) 
+            {
+                bSuccess = hppTimerStart(uiTimer, uiTime, aszFunctionName[6] == 's', atol(pchParam4), hppTimerExecutionHandler, (void*)hppVarGetKey(pchParam3, true));
+            }
+
+            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameters: timer_id, time (in ms), action ('set', 'clear', 'toggle', 'pwm_restart' or 'var') [, pin or variable name [, value]]
+        if(strcmp(aszFunctionName, "timer_action") == 0)   
+        {
+            static const char* aszActions[] = { "set", "clear", "toggle", "pwm_restart", "var", NULL };
+            char* pchParam3;
+            char* pchParam4;
+            char* pchParam5;
+            uint32_t uiTime;
+            int i;
+
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
+            pchParam3 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
+            pchParam4 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '5';
+            pchParam5 = hppVarGet(aszParamName, NULL);
+            if(pchParam3 == NULL) pchParam3 = "";
+            if(pchParam4 == NULL) pchParam4 = "";
+            if(pchParam5 == NULL) pchParam5 = "";
+
+            for(i = 0; aszActions[i] != NULL && strcmp(aszActions[i], pchParam3) != 0; i++) ;
+            if(aszActions[i] == NULL) return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+            // GPIO actions need a pin number, a missing or misspelled one must not switch pin 0
+            if(i + 1 <= hppTimerAction_GpioToggle && (*pchParam4 == 0 || strspn(pchParam4, "0123456789") != strlen(pchParam4)))
+                return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+            uiTime = atol(pchParam2);
+            if(uiTime < HPP_MIN_TIMER_TIME) uiTime = HPP_MIN_TIMER_TIME;
+
+            return hppVarPutStr(aszResultVarKey, hppTimerStartAction(atoi(pchParam1), uiTime, i + 1, atoi(pchParam4), pchParam4, pchParam5) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameters: timer_id, policy ('catchup', 'skip' or 'delay') for the next timer_start 
+        if(strcmp(aszFunctionName, "timer_policy") == 0)   
+        {
+            static const char* aszPolicies[] = { "catchup", "skip", "delay", NULL };
+            int i;
+
+            for(i = 0; aszPolicies[i] != NULL && strcmp(aszPolicies[i], pchParam2) != 0; i++) ;
+
+            return hppVarPutStr(aszResultVarKey, aszPolicies[i] != NULL && hppTimerSetPolicy(atoi(pchParam1), i) ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameter: [true to reset the counters after reading them]
+        if(strcmp(aszFunctionName, "timer_wakeups") == 0)   
+        {
+            char szWakeups[80];
+
+            hppTimerWakeupsDump(szWakeups, sizeof(szWakeups));
+            if(strcmp(pchParam1, "true") == 0) hppTimerWakeupsReset();
+
+            return hppVarPutStr(aszResultVarKey, szWakeups, apcbResultLen_Out);
+        }
+
+        // Parameter: [true to reset the statistics after reading them]
+        if(strcmp(aszFunctionName, "timer_stats") == 0)   
+        {
+            size_t cbLen = hppTimerStatsDump(NULL, 0);
+            char* pchResult = hppVarPut(aszResultVarKey, hppNoInitValue, cbLen);
+
+            if(pchResult != NULL) hppTimerStatsDump(pchResult, cbLen + 1);
+            if(apcbResultLen_Out != NULL) *apcbResultLen_Out = cbLen;
+            if(strcmp(pchParam1, "true") == 0) hppTimerStatsReset();
+
+            return pchResult;
+        }
+
+        // Parameter: timer_id     
+        if(strcmp(aszFunctionName, "timer_stop") == 0)   
+        {
+            unsigned int uiTimer;
+            bool bSuccess = false;
+
+            uiTimer = atoi(pchParam1);   
+            bSuccess = hppTimerStop(uiTimer);
+            
+            return hppVarPutStr(aszResultVarKey, bSuccess ? "true" : "false", apcbResultLen_Out);
+        }
+
+        // Parameters: time (in ms), function name, event  (name passed to variable "event") [, slack (in ms)]  --->  returns a handle for timer_cancel
+        if(strcmp(aszFunctionName, "timer_event") == 0)   
+        {
+            char* pchParam3;
+            char* pchParam4;
+            char szHandle[12];
+            uint32_t uiTime;
+            uint32_t uiHandle = 0;
+
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '3';
+            pchParam3 = hppVarGet(aszParamName, NULL);
+            aszParamName[HPP_PARAM_PREFIX_LEN - 1] = '4';
+            pchParam4 = hppVarGet(aszParamName, NULL);
+            if(pchParam3 == NULL) pchParam3 = "";
+            if(pchParam4 == NULL) pchParam4 = "";
+
+            uiTime = atol(pchParam1);
+            if(uiTime < HPP_MIN_TIMER_TIME) uiTime = HPP_MIN_TIMER_TIME;  // minimum time for HPP interpreter  
+
+            if(*pchParam2 != 0) 
+            {
+                uiHandle = hppTimerScheduleEvent(uiTime, atol(pchParam4), hppEventExecutionHandler, pchParam3, strlen(pchParam3) + 1, (void*)hppVarGetKey(pchParam2, true));
+            }
+
+            if(uiHandle == 0) return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+            snprintf(szHandle, sizeof(szHandle), "%lu", (unsigned long)uiHandle);
+            return hppVarPutStr(aszResultVarKey, szHandle, apcbResultLen_Out);
+        }
+
+        // Parameter: handle returned by timer_event     
+        if(strcmp(aszFunctionName, "timer_cancel") == 0)   
+        {
+            return hppVarPutStr(aszResultVarKey, hppTimerCancelEvent(strtoul(pchParam1, NULL, 10)) ? "true" : "false", apcbResultLen_Out);
+        }
+    }
+
+    // Parameter: time in ms. Suspends the calling task without blocking other tasks and events. Returns true once the time has elapsed.
+    // Returns false immediately without raising an error if the code does not run as task (task_slice(0), all task resources in 
+    // use or code ending a group of XXX_WITH_NEXT entries, see hppAsyncVarPut) or if no timer event is available.
+    if(strcmp(aszFunctionName, "sleep") == 0)   
+    {
+        uint32_t uiTaskWaitID = hppTaskWait(aszResultVarKey);
+
+        if(uiTaskWaitID == 0) return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+
+        if(!hppTaskWaitTimeout(uiTaskWaitID, atol(pchParam1), "true"))
+        {
+            hppTaskResume(uiTaskWaitID, "false", 5);    // No timer available, continue with the next slice
+            return hppVarPutStr(aszResultVarKey, "false", apcbResultLen_Out);
+        }
+
+        return hppVarPutStr(aszResultVarKey, "true", apcbResultLen_Out);
+    }
+
+    // Parameter: [true to reset the statistics after reading them]
+    if(strcmp(aszFunctionName, "queue_stats") == 0)   
+    {
+        size_t cbLen = hppAsyncStatsDump(NULL, 0);
+        char* pchResult = hppVarPut(aszResultVarKey, hppNoInitValue, cbLen);
+
+        if(pchResult != NULL) hppAsyncStatsDump(pchResult, cbLen + 1);
+        if(apcbResultLen_Out != NULL) *apcbResultLen_Out = cbLen;
+        if(strcmp(pchParam1, "true") == 0) hppAsyncStatsReset();
+
+        return pchResult;
+    }
+
+    // Parameter: [true to reset the statistics after reading them]
+    if(strcmp(aszFunctionName, "usb_stats") == 0)   
+    {
+        char szStats[100];
+
+        hppZephyrUsbStatsDump(szStats, sizeof(szStats));
+        if(strcmp(pchParam1, "true") == 0) hppZephyrUsbStatsReset();
+
+        return hppVarPutStr(aszResultVarKey, szStats, apcbResultLen_Out);
+    }
+
+    // task_XXX commands
+    if(strncmp(aszFunctionName, "task_", 5) == 0)
+    {
+        // Parameter: [number of expressions evaluated before a task is suspended (0 = tasks run to completion)]   
+        if(strcmp(aszFunctionName, "task_slice") == 0)   
+        {
+            if(*pchParam1 != 0) hppTaskSliceTicks = atol(pchParam1);
+            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, hppTaskSliceTicks), apcbResultLen_Out);
+        }
+
+        // No parameter. Number of tasks in progress including the calling one     
+        if(strcmp(aszFunctionName, "task_count") == 0)   
+        {
+            return hppVarPutStr(aszResultVarKey, hppI2A(szNumeric, hppTaskCount(false)), apcbResultLen_Out);
+        }
+    }
+    
+    return NULL;
+}	
+
+
+
+// ------------------------------------------------------------------
+// Synchronized function calls for relevant hppVarXXX functions
+// ------------------------------------------------------------------
+
+/*
+
+bool hppSyncVarPut(const char aszKey[], const char apValue[], size_t acbValueLen)
+{
+    bool bRetVal;
+
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    bRetVal = (hppVarPut(aszKey, apValue, acbValueLen) != NULL);
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+
+    return bRetVal;
+}
+
+bool hppSyncVarPutStr(const char aszKey[], const char aszValue[], size_t* apcbResultLen_Out)
+{
+    bool bRetVal;
+
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    bRetVal = (hppVarPutStr(aszKey, aszValue, apcbResultLen_Out) != NULL);
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+
+    return bRetVal;
+}
+
+
+char* hppSyncVarPutBegin(const char aszKey[], const char apValue[], size_t acbValueLen)
+{
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    return hppVarPut(aszKey, apValue, acbValueLen);
+}
+
+void hppSyncVarPutEnd()
+{
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+}
+
+
+
+bool hppSyncVarExists(const char aszKey[], size_t* apcbValueLen_Out)
+{
+    bool bRetVal;
+
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    bRetVal =  (hppVarGet(aszKey, apcbValueLen_Out) != NULL);
+    k_mutex_unlock(&hppVarMutex);
+
+    return bRetVal;
+}
+
+char* hppSyncVarGetBegin(const char aszKey[], size_t* apcbValueLen_Out)
+{
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    return hppVarGet(aszKey, apcbValueLen_Out);
+}
+
+void hppSyncVarGetEnd()
+{
+    k_mutex_unlock(&hppVarMutex);
+}
+
+
+
+const char* hppSyncVarGetKeyBegin(const char aszKey[], bool abCaseSensitive)
+{
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    return hppVarGetKey(aszKey, abCaseSensitive);
+}
+
+void hppSyncVarGetKeyEnd()
+{
+    k_mutex_unlock(&hppVarMutex);
+}
+
+
+bool hppSyncVarDelete(const char aszKey[])
+{
+    bool retVal;
+
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    retVal = hppVarDelete(aszKey);
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+
+    return retVal;
+}
+
+
+void hppSyncVarDeleteAll(const char aszKeyPrefix[])
+{
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    hppVarDeleteAll(aszKeyPrefix);
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+}
+
+
+int hppSyncVarCount(const char aszKeyPrefix[], bool abExludeRootElements)
+{
+    int retVal;
+
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    retVal = hppVarCount(aszKeyPrefix, abExludeRootElements);
+    k_mutex_unlock(&hppVarMutex);
+
+    return retVal;
+}
+
+
+int hppSyncVarGetAll(char* aszResult, size_t acbMaxLen, const char aszKeyPrefix[], const char aszFormat[])
+{
+    int retVal;
+
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    retVal = hppVarGetAll(aszResult, acbMaxLen, aszKeyPrefix, aszFormat);
+    k_mutex_unlock(&hppVarMutex);
+
+    return retVal;
+}
+*/
+
+
+// ------------------------------------------------------------------
+// Synchronized function calls for H++ parser functions
+// ------------------------------------------------------------------
+
+/*
+bool hppSyncParseExpression(const char* aszCode, const char* aszResultVarKey)
+{
+    int bRetVal;
+
+    k_mutex_lock(&hppParseMutex, K_FOREVER);     // Parser Mutex is outside to ensure hppSyncTryLockParserMutext(..) makes parser and variable available
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    bRetVal = (hppParseExpression(aszCode, aszResultVarKey) != NULL);
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+
+    return bRetVal;
+}
+
+char* hppSyncParseExpressionBegin(const char* aszCode, const char* aszResultVarKey)
+{
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    k_mutex_lock(&hppVarMutex, K_FOREVER);
+    return hppParseExpression(aszCode, aszResultVarKey);
+}
+
+void hppSyncParseExpressionEnd()
+{
+    k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
+}
+
+
+bool hppSyncTryLockParserMutext(int iWaitTimeInMs)
+{
+    if (k_mutex_lock(&hppParseMutex, K_MSEC(iWaitTimeInMs)) == 0) return true; 
+    return false;
+}
+
+void hppSyncUnlockParserMutext()
+{
+    k_mutex_unlock(&hppParseMutex);
+}
+*/
+
+
+
+bool hppSyncAddExternalFunctionLibrary(hppExternalFunctionType aExternalFunctionType)
+{
+    bool retVal;
+
+    //k_mutex_lock(&hppVarMutex, K_FOREVER);
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    retVal = hppAddExternalFunctionLibrary(aExternalFunctionType);
+    k_mutex_unlock(&hppParseMutex);
+    //k_mutex_unlock(&hppVarMutex);
+
+    return retVal;
+}
+
+
+hppExternalPollFunctionType hppSyncAddExternalPollFunction(hppExternalPollFunctionType aNewExternalPollFunction)
+{
+    hppExternalPollFunctionType retVal;
+
+    //k_mutex_lock(&hppVarMutex, K_FOREVER);
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    retVal = hppAddExternalPollFunction(aNewExternalPollFunction);
+    k_mutex_unlock(&hppParseMutex);
+    //k_mutex_unlock(&hppVarMutex);
+
+    return retVal;
+}
+
+
+
+// ------------------------------------------------------------------
+// Async queues with priorities
+// ------------------------------------------------------------------
+
+#define HPP_ASYNC_TLV_IS_WITH_NEXT(t) ((t) == HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT || (t) == HPP_ASYNC_TLV_VAR_PUT_BLOCK_WITH_NEXT || \
+                                       (t) == HPP_ASYNC_TLV_SET_COAP_CONTEXT_WITH_NEXT)
+
+
+// Queue of entries of the type 'auiType'
+static struct hppAsyncQueueStruct* hppAsyncQueueGetByType(uint8_t auiType)
+{
+    switch(auiType)
+    {
+        case HPP_ASYNC_TLV_TIMER_EXPIRED:
+        case HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED:
+        case HPP_ASYNC_TLV_PARSE_VAR_TIMER:
+        case HPP_ASYNC_TLV_VAR_PUT_TIMER:
+        case HPP_ASYNC_TLV_BUTTON:
+            return &(hppAsyncQueues[HPP_ASYNC_QUEUE_TIMER]);
+
+        case HPP_ASYNC_TLV_TASK_RESUME:
+            return &(hppAsyncQueues[HPP_ASYNC_QUEUE_COAP_RESPONSE]);
+
+        case HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE:
+        case HPP_ASYNC_TLV_VAR_PUT_NON_CASE_SENSITIVE:
+        case HPP_ASYNC_TLV_VAR_PUT_BLOCK_NON_CASE_SENSITIVE:
+        case HPP_ASYNC_TLV_VAR_DELETE:
+        case HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE:
+        case HPP_ASYNC_TLV_SET_COAP_CONTEXT:
+        case HPP_ASYNC_TLV_SET_COAP_CONTEXT_WITH_NEXT:
+        case HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE:
+        case HPP_ASYNC_TLV_VAR_HIDE:
+        case HPP_ASYNC_TLV_STATS_GET_COAP_RESPONSE:
+            return &(hppAsyncQueues[HPP_ASYNC_QUEUE_COAP_REQUEST]);
+
+        case HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT:
+        case HPP_ASYNC_TLV_VAR_PUT_BLOCK_WITH_NEXT:
+            // Groups started by the dispatcher pass data to timer handlers, groups of other threads belong to CoAP requests or events
+            if(k_current_get() == hppAsyncDispatcherThread) return &(hppAsyncQueues[HPP_ASYNC_QUEUE_TIMER]);
+            return &(hppAsyncQueues[HPP_ASYNC_QUEUE_COAP_REQUEST]);
+    }
+
+    return &(hppAsyncQueues[HPP_ASYNC_QUEUE_BULK]);
+}
+
+
+// XXX_WITH_NEXT group queued by the present thread. Returns NULL if there is none.
+static hppAsyncGroup* hppAsyncGroupGet()
+{
+    uint32_t i;
+
+    if(k_is_in_isr()) return NULL;
+
+    for(i = 0; i < HPP_ASYNC_GROUP_COUNT; i++) 
+        if(hppAsyncGroups[i].mThread == k_current_get()) return &(hppAsyncGroups[i]);
+
+    return NULL;
+}
+
+
+// Get the queue for an entry of the type 'auiType'. All entries of a XXX_WITH_NEXT group use the queue of the first entry such 
+// that they are dispatched together. Must be called with the scheduler locked. Returns NULL if no further group can be started.
+static struct hppAsyncQueueStruct* hppAsyncQueueBeginPut(uint8_t auiType)
+{
+    hppAsyncGroup* pGroup = hppAsyncGroupGet();
+    uint32_t i;
+
+    if(pGroup != NULL) return pGroup->pQueue;
+    if(!HPP_ASYNC_TLV_IS_WITH_NEXT(auiType) || k_is_in_isr()) return hppAsyncQueueGetByType(auiType);
+
+    // Start a new group. The group ends with the first entry not having the XXX_WITH_NEXT type.
+    for(i = 0; i < HPP_ASYNC_GROUP_COUNT; i++) 
+    {
+        if(hppAsyncGroups[i].mThread == NULL) 
+        {
+            hppAsyncGroups[i].mThread = k_current_get();
+            hppAsyncGroups[i].pQueue = hppAsyncQueueGetByType(auiType);
+            return hppAsyncGroups[i].pQueue;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Signal the entry of the type 'auiType' put in the queue 'apQueue' returned by hppAsyncQueueBeginPut to the dispatcher.
+// Must be called with the scheduler locked.
+static void hppAsyncQueueEndPut(struct hppAsyncQueueStruct* apQueue, uint8_t auiType)
+{
+    hppAsyncGroup* pGroup = hppAsyncGroupGet();
+
+    if(pGroup != NULL && !HPP_ASYNC_TLV_IS_WITH_NEXT(auiType)) pGroup->mThread = NULL;
+
+    hppAsyncQueueRecordPut(apQueue);
+
+    k_sem_give(&hppParserSemaphor);
+}
+
+
+// Count an entry of the type 'auiType' rejected by 'apQueue' (NULL if no queue was available). 
+// Must be called with the scheduler locked.
+static void hppAsyncRecordDrop(struct hppAsyncQueueStruct* apQueue, uint8_t auiType)
+{
+    if(apQueue != NULL) hppAsyncQueueRecordDrop(apQueue);
+    if(auiType < HPP_ASYNC_TLV_TYPE_COUNT) hppAsyncTypeStatistics[auiType].uiDropCount++;
+}
+
+
+// Select the queue of the next entry to be dispatched (see hppAsyncQueueSelect). The entries of a XXX_WITH_NEXT group 
+// are dispatched from the same queue without interruption. Returns NULL if there is no entry.
+static struct hppAsyncQueueStruct* hppAsyncQueueGetNext()
+{
+    if(hppAsyncQueueLocked != NULL) return hppAsyncQueueIsEmpty(hppAsyncQueueLocked) ? NULL : hppAsyncQueueLocked;
+
+    return hppAsyncQueueSelect(hppAsyncQueues, HPP_ASYNC_QUEUE_COUNT);
+}
+
+
+// Wait for the next entry to be dispatched and return its queue. Returns NULL if 'abWait' is false and there is no entry.
+// Each entry gives the semaphore once. Signals are counted since the entry may be in another queue than the one of the 
+// XXX_WITH_NEXT group presently dispatched.
+static struct hppAsyncQueueStruct* hppAsyncQueueWait(bool abWait)
+{
+    struct hppAsyncQueueStruct* pQueue;
+
+    while(1)
+    {
+        if(hppAsyncPendingCount > 0 && (pQueue = hppAsyncQueueGetNext()) != NULL)
+        {
+            hppAsyncPendingCount--;
+            return pQueue;
+        }
+
+        if(k_sem_take(&hppParserSemaphor, abWait ? K_FOREVER : K_NO_WAIT) != 0) return NULL;
+        hppAsyncPendingCount++;
+    }
+}
+
+
+// Returns true if hppAsyncQueueWait(true) will return without blocking
+static bool hppAsyncQueueIsReady()
+{
+    if(hppAsyncQueueLocked != NULL) return !hppAsyncQueueIsEmpty(hppAsyncQueueLocked);
+
+    return hppAsyncPendingCount > 0 || k_sem_count_get(&hppParserSemaphor) > 0;
+}
+
+
+// Returns true if the PUT entry of the type 'auiType' for the variable 'aszVarName' just read from 'apQueue' is overwritten
+// by the next entry of the same queue anyway. Only the last of consecutive updates of a variable needs to be stored then.
+static bool hppAsyncIsCoalesced(struct hppAsyncQueueStruct* apQueue, uint8_t auiType, const char* aszVarName)
+{
+    if(HPP_ASYNC_TLV_IS_WITH_NEXT(auiType)) return false;    // part of a group, e.g. the payload of a CoAP request
+    if(!hppAsyncQueueIsCoalesced(apQueue, auiType, aszVarName)) return false;
+
+    hppAsyncCoalescedCount++;
+    return true;
+}
+
+
+
+// ------------------------------------------------------------------
+// Asynchronous function call for H++ var and parser functions
+// ------------------------------------------------------------------
+
+static bool hppAsyncProcessVarInt(const char* aszVarName, uint8_t auiType)
+{
+    uint8_t uiType = auiType;
+    uint16_t uiLen;
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(aszVarName == NULL) return false;
+    uiLen = strlen(aszVarName);
+    if(uiLen > HPP_ASYNC_MAX_VAR_SIZE) return false;
+    
+    k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= uiLen + HPP_ASYNC_QUEUE_HEADER_SIZE)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, uiLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, aszVarName, uiLen);
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    k_sched_unlock();
+
+    return bRetVal;
+}
+
+
+bool hppAsyncProcessDataInt(const uint8_t apData[], uint16_t acbDataLen, uint8_t auiType)
+{
+    uint8_t uiType = auiType;
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(apData == NULL) return false;
+    if(acbDataLen > HPP_ASYNC_MAX_DATA_SIZE) return false;
+    
+    if(!k_is_in_isr()) k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= acbDataLen + HPP_ASYNC_QUEUE_HEADER_SIZE)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, acbDataLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, apData, acbDataLen);
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    if(!k_is_in_isr()) k_sched_unlock();
+
+    return bRetVal;
+}
+
+
+bool hppAsyncVarGetFromUriCoapResponse(const char aszVarName[])
+{
+    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE);
+}
+
+
+bool hppAsyncVarPutInt(const char aszVarName[], const char apValue[], uint16_t acbValueLen, uint8_t auiType)
+{
+    uint8_t uiType = auiType;
+    uint16_t uiVarNameLen;
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(aszVarName == NULL || apValue == NULL) return false;
+    uiVarNameLen = strlen(aszVarName);
+    if(uiVarNameLen > HPP_ASYNC_MAX_VAR_SIZE) return false;
+    if(acbValueLen > HPP_ASYNC_MAX_DATA_SIZE) return false;
+    
+    if(!k_is_in_isr()) k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= acbValueLen + uiVarNameLen + sizeof(uint16_t) + HPP_ASYNC_QUEUE_HEADER_SIZE + HPP_ASYNC_RINGBUF_SAFETY_BUFFER)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, uiVarNameLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, aszVarName, uiVarNameLen);
+        hppAsyncQueuePut(pQueue, &acbValueLen, sizeof(uint16_t));
+        hppAsyncQueuePut(pQueue, apValue, acbValueLen);
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    if(!k_is_in_isr()) k_sched_unlock();
+
+    return bRetVal;
+}
+
+bool hppAsyncVarPut(const char aszVarName[], const char apValue[], uint16_t acbValueLen, bool abSyncWithNext)
+{
+    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT : HPP_ASYNC_TLV_VAR_PUT;
+
+    return hppAsyncVarPutInt(aszVarName, apValue, acbValueLen, uiType);
+}
+
+bool hppAsyncVarPutStr(const char aszVarName[], const char aszValue[], bool abSyncWithNext)
+{
+    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT : HPP_ASYNC_TLV_VAR_PUT;
+
+    return hppAsyncVarPut(aszVarName, aszValue, strlen(aszValue), uiType);
+}
+
+bool hppAsyncVarPutFromUri(const char aszVarName[], const char apValue[], uint16_t acbValueLen)
+{
+    return hppAsyncVarPutInt(aszVarName, apValue, acbValueLen, HPP_ASYNC_TLV_VAR_PUT_NON_CASE_SENSITIVE);
+}
+
+
+char* hppAsyncBlockAlloc(uint16_t acbLen)
+{
+    char* pchBlock;
+
+    if(acbLen > HPP_ASYNC_MAX_DATA_SIZE) return NULL;
+
+    // Reserve the bytes in the pool first such that concurrent producers cannot exceed it
+    if(atomic_add(&hppAsyncBlockPoolUsed, acbLen + 1) + acbLen + 1 > HPP_ASYNC_BLOCK_POOL_SIZE)
+    {
+        atomic_sub(&hppAsyncBlockPoolUsed, acbLen + 1);
+        return NULL;
+    }
+
+    pchBlock = (char*)malloc(acbLen + 1);        // Add one byte for zero termination, see hppVarPutAdopt(...)
+    if(pchBlock == NULL) atomic_sub(&hppAsyncBlockPoolUsed, acbLen + 1);
+
+    return pchBlock;
+}
+
+
+// Return the pool share of a block of 'acbLen' bytes which was adopted by a variable or released.
+static void hppAsyncBlockRelease(uint16_t acbLen)
+{
+    atomic_sub(&hppAsyncBlockPoolUsed, acbLen + 1);
+}
+
+
+void hppAsyncBlockFree(char* apBlock, uint16_t acbLen)
+{
+    if(apBlock == NULL) return;
+
+    free(apBlock);
+    hppAsyncBlockRelease(acbLen);
+}
+
+
+// Put the block 'apBlock' of hppAsyncBlockAlloc(...) in queue as new value of a variable. Only the reference is queued.
+// The block is released if not successful.
+static bool hppAsyncVarPutBlockInt(const char aszVarName[], char* apBlock, uint16_t acbValueLen, uint8_t auiType)
+{
+    uint8_t uiType = auiType;
+    uint16_t uiVarNameLen;
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(aszVarName == NULL || apBlock == NULL || strlen(aszVarName) > HPP_ASYNC_MAX_VAR_SIZE) 
+    {
+        hppAsyncBlockFree(apBlock, acbValueLen);
+        return false;
+    }
+
+    uiVarNameLen = strlen(aszVarName);
+    
+    if(!k_is_in_isr()) k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= uiVarNameLen + sizeof(char*) + sizeof(uint16_t) + HPP_ASYNC_QUEUE_HEADER_SIZE + HPP_ASYNC_RINGBUF_SAFETY_BUFFER)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, uiVarNameLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, aszVarName, uiVarNameLen);
+        hppAsyncQueuePut(pQueue, &acbValueLen, sizeof(uint16_t));
+        hppAsyncQueuePut(pQueue, &apBlock, sizeof(char*));
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    if(!k_is_in_isr()) k_sched_unlock();
+
+    if(!bRetVal) hppAsyncBlockFree(apBlock, acbValueLen);
+
+    return bRetVal;
+}
+
+bool hppAsyncVarPutBlock(const char aszVarName[], char* apBlock, uint16_t acbValueLen, bool abSyncWithNext)
+{
+    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_VAR_PUT_BLOCK_WITH_NEXT : HPP_ASYNC_TLV_VAR_PUT_BLOCK;
+
+    return hppAsyncVarPutBlockInt(aszVarName, apBlock, acbValueLen, uiType);
+}
+
+
+// Store the value of a variable received via CoAP, CLI or USB frames. Code images created with hppCompileImage are restored 
+// to code, uploaded code is minified in place. With 'abAdopt' the heap buffer 'apchValue' is passed to the variable storage
+// like with hppVarPutAdopt(...) and released if not stored. Called with the parser mutex locked. Returns false if unsuccessfull.
+static bool hppAsyncVarStore(const char aszVarKey[], char* apchValue, size_t acbValueLen, bool abAdopt)
+{
+    size_t cbImageCodeLen;
+    char* pchCode;
+    bool bRetVal = true;
+
+    // Code images created with hppCompileImage are restored to code when stored
+    cbImageCodeLen = hppVarIsCode(aszVarKey) ? hppGetImageCodeLen((uint8_t*)apchValue, acbValueLen) : 0;
+
+    if(cbImageCodeLen > 0)
+    {
+        pchCode = hppVarPut(aszVarKey, hppNoInitValue, cbImageCodeLen);
+        
+        if(pchCode == NULL) bRetVal = false;
+        else if(hppLoadImage((uint8_t*)apchValue, acbValueLen, pchCode, cbImageCodeLen + 1) == 0) 
+        {
+            LOG_WRN("invalid code image for %s", aszVarKey);
+            hppVarDelete(aszVarKey);
+            bRetVal = false;
+        }
+
+        if(abAdopt) free(apchValue);
+        return bRetVal;
+    }
+
+#if CONFIG_HPP_MINIFY_CODE
+    if(hppVarIsCode(aszVarKey) && memchr(apchValue, 0, acbValueLen) == NULL) 
+        acbValueLen = hppMinifyCode(apchValue, acbValueLen);      // strip comments of uploaded code
+#endif
+
+    if(abAdopt) return hppVarPutAdopt(aszVarKey, apchValue, acbValueLen) != NULL;
+
+    return hppVarPut(aszVarKey, apchValue, acbValueLen) != NULL;
+}
+
+bool hppAsyncVarPutBlockFromUri(const char aszVarName[], char* apBlock, uint16_t acbValueLen)
+{
+    return hppAsyncVarPutBlockInt(aszVarName, apBlock, acbValueLen, HPP_ASYNC_TLV_VAR_PUT_BLOCK_NON_CASE_SENSITIVE);
+}
+
+
+bool hppAsyncVarDelete(const char aszVarName[])
+{
+    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_VAR_DELETE);
+}
+
+
+bool hppAsyncParseExpression(const char* aszCode, bool aWriteResultToCli)
+{
+    return hppAsyncProcessDataInt(aszCode, strlen(aszCode), aWriteResultToCli ? HPP_ASYNC_TLV_PARSE_TEXT_CLI : HPP_ASYNC_TLV_PARSE_TEXT);
+}
+
+
+bool hppAsyncParseVar(const char* aszVarName)
+{
+    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_PARSE_VAR);
+}
+
+
+bool hppAsyncParseVarCoapResponse(const char* aszVarName)
+{
+    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE);
+}
+
+
+bool hppAsyncParseVarTimer(const char* aszVarName)
+{
+    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_PARSE_VAR_TIMER);
+}
+
+
+bool hppAsyncVarGetWellKnownCore()
+{
+    return hppAsyncProcessVarInt("", HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE);
+}
+
+
+bool hppAsyncStatsGet(const char* aszName)
+{
+    return hppAsyncProcessVarInt(aszName, HPP_ASYNC_TLV_STATS_GET_COAP_RESPONSE);
+}
+
+
+bool hppAsyncVarHide(const char* aszPassword)
+{
+    if(aszPassword == NULL) aszPassword = "";
+    return hppAsyncProcessVarInt(aszPassword, HPP_ASYNC_TLV_VAR_HIDE);
+}
+
+
+
+// ------------------------------------------------------------------
+// Asynchronous function call for H++ Thread functions
+// ------------------------------------------------------------------
+
+bool hppAsyncSetCoapContext(hppCoapMessageContext* apCoapMessageContext, bool abSyncWithNext)
+{
+    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_SET_COAP_CONTEXT_WITH_NEXT : HPP_ASYNC_TLV_SET_COAP_CONTEXT;
+    uint16_t uiLen = sizeof(hppCoapMessageContext);
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(apCoapMessageContext == NULL) return false;
+  
+    if(!k_is_in_isr()) k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= uiLen + HPP_ASYNC_QUEUE_HEADER_SIZE + HPP_ASYNC_RINGBUF_SAFETY_BUFFER)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, uiLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, apCoapMessageContext, uiLen);
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    if(!k_is_in_isr()) k_sched_unlock();
+
+    return bRetVal;
+}
+
+
+bool hppAsyncTaskResume(uint32_t aTaskWaitID, const char apValue[], uint16_t acbValueLen)
+{
+    uint8_t uiType = HPP_ASYNC_TLV_TASK_RESUME;
+    uint16_t uiLen = acbValueLen + sizeof(uint32_t);
+    struct hppAsyncQueueStruct* pQueue;
+    bool bRetVal;
+
+    if(apValue == NULL) return false;
+    if(acbValueLen > HPP_ASYNC_MAX_DATA_SIZE) return false;
+  
+    if(!k_is_in_isr()) k_sched_lock();
+
+    pQueue = hppAsyncQueueBeginPut(uiType);
+
+    if(pQueue != NULL && hppAsyncQueueSpace(pQueue) >= uiLen + HPP_ASYNC_QUEUE_HEADER_SIZE)
+    {
+        hppAsyncQueuePutHeader(pQueue, uiType, uiLen, hppProfilerClockUs());
+        hppAsyncQueuePut(pQueue, &aTaskWaitID, sizeof(uint32_t));
+        hppAsyncQueuePut(pQueue, apValue, acbValueLen);
+        hppAsyncQueueEndPut(pQueue, uiType);
+        bRetVal = true;
+    }
+    else
+    {
+        hppAsyncRecordDrop(pQueue, uiType);
+        bRetVal = false;
+    }
+
+    if(!k_is_in_isr()) k_sched_unlock();
+
+    return bRetVal;
+}
+
+
+// ------------------------------------------------------------------
+// Asynchronous function call for Usb Input
+// ------------------------------------------------------------------
+
+bool hppAsyncUsbInput(const uint8_t apData[], uint16_t acbDataLen)
+{
+    return hppAsyncProcessDataInt(apData, acbDataLen, HPP_ASYNC_TLV_USB_RECV);
+}
+
+
+
+
+// ------------------------------------------------------------------
+// Timer functions 
+// ------------------------------------------------------------------
+
+// Restart the kernel timer for the tick 'auiTick'. Called with hppTimerWheelLock locked.
+static void hppTimerWheelArmAtInt(uint32_t auiTick)
+{
+    int32_t iDelay = (int32_t)(auiTick - k_uptime_get_32());
+
+    hppTimerWheelArmed = true;
+    hppTimerWheelArmedTick = auiTick;
+    k_timer_start(&hppTimerWheelTimer, iDelay > 0 ? K_MSEC(iDelay) : K_NO_WAIT, K_NO_WAIT);
+}
+
+
+// Restart the kernel timer for the next expiration. The wheel moves events to lower levels on the way without waking up 
+// the CPU. Called with hppTimerWheelLock locked.
+static void hppTimerWheelArmInt()
+{
+    uint32_t uiTick;
+
+    if(hppTimerWheelNextExpiry(&uiTick)) hppTimerWheelArmAtInt(uiTick);
+    else
+    {
+        hppTimerWheelArmed = false;
+        k_timer_stop(&hppTimerWheelTimer);
+    }
+}
+
+
+// Handler of the events of the timers with IDs
+static void hppTimerResourceHandlerInt(void* apData, uint32_t aDataLen, void *apContext)
+{
+    hppTimerResource* pTimer = (hppTimerResource*)apContext;
+
+    if(pTimer->pHandler) (pTimer->pHandler)(pTimer->pContext);
+}
+
+
+// Record the dispatch of an expiration of the timer 'apTimer' which was due at the uptime 'auiExpected' in ms
+static void hppTimerStatsRecordInt(hppTimerResource* apTimer, uint32_t auiExpected)
+{
+    hppTimerStats* pStats = &(apTimer->mStats);
+    uint64_t uiNowUs = k_ticks_to_us_floor64(k_uptime_ticks());
+    uint32_t uiNow = (uint32_t)(uiNowUs / 1000);
+    int32_t iLateMs = (int32_t)(uiNow - auiExpected);
+    uint32_t uiLateness = iLateMs < 0 ? 0 : (uint32_t)iLateMs * 1000 + (uint32_t)(uiNowUs % 1000);
+
+    if(pStats->uiDispatchCount == 0 || pStats->uiMinLateness > uiLateness) pStats->uiMinLateness = uiLateness;
+    if(pStats->uiMaxLateness < uiLateness) pStats->uiMaxLateness = uiLateness;
+
+    pStats->uiSumLateness += uiLateness;
+    pStats->uiLastLateness = uiLateness;
+    pStats->uiLastExpected = auiExpected;
+    pStats->uiLastActual = uiNow;
+    pStats->uiDispatchCount++;
+}
+
+
+// Native action of a timer. Runs in the kernel timer handler, independent of the dispatcher and the interpreter.
+static void hppTimerActionHandlerInt(void* apData, uint32_t aDataLen, void *apContext)
+{
+    hppTimerResource* pTimer = (hppTimerResource*)apContext;
+
+    switch(pTimer->uiAction)
+    {
+        case hppTimerAction_GpioSet: gpio_pin_set(pTimer->pGpioDev, pTimer->uiPin, 1); break;
+        case hppTimerAction_GpioClear: gpio_pin_set(pTimer->pGpioDev, pTimer->uiPin, 0); break;
+        case hppTimerAction_GpioToggle: gpio_pin_toggle(pTimer->pGpioDev, pTimer->uiPin); break;
+
+        case hppTimerAction_PwmRestart:
+#if CONFIG_HPP_NRF52840            
+            if(NRF_PWM0->SEQ[0].REFRESH > 0) hppRestartPWM();
+#endif
+        break;
+
+        // The variable storage belongs to the dispatcher: queue the value in the timer queue without any H++ code to parse
+        case hppTimerAction_VarPut: 
+            if(!hppAsyncVarPutInt(pTimer->szVarName, pTimer->szValue, strlen(pTimer->szValue), HPP_ASYNC_TLV_VAR_PUT_TIMER)) pTimer->mStats.uiMissedCount++;
+        break;
+    }
+}
+
+
+// Sample the pin of a button at the end of a burst of edges. Runs in the kernel timer handler. Queues one entry per burst 
+// if the debounced state changed.
+static void hppButtonDebounceHandlerInt(void* apData, uint32_t aDataLen, void *apContext)
+{
+    hppButtonResource* pButton = (hppButtonResource*)apContext;
+    uint32_t auiData[3];
+    bool bPressed;
+
+    atomic_set(&(pButton->mDebouncing), 0);     // the next edge starts a new burst
+
+    bPressed = gpio_pin_get(pButton->pGpioDev, pButton->uiPin) > 0;
+    if(bPressed == pButton->bPressed) return;   // glitch or pushed and released within the debounce time
+
+    pButton->bPressed = bPressed;
+    if(bPressed) pButton->uiPressTime = pButton->uiBurstStart;
+
+    if(pButton->uiEdge == (bPressed ? hppButtonEdge_Release : hppButtonEdge_Push)) return;
+
+    auiData[0] = pButton->uiPinID;
+    auiData[1] = bPressed;
+    auiData[2] = bPressed ? 0 : pButton->uiBurstStart - pButton->uiPressTime;
+
+    hppAsyncProcessDataInt((uint8_t*)auiData, sizeof(auiData), HPP_ASYNC_TLV_BUTTON);
+}
+
+
+// Called by hppTimerWheelAdvance in the kernel timer handler: pass the event and its expiration tick to the dispatcher
+static void hppTimerWheelExpiredInt(uint32_t auiHandle, struct hppTimerWheelEventStruct* apEvent)
+{
+    hppTimerResource* pTimer = NULL;
+    uint8_t uiType = HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED;
+    uint32_t auiData[2] = { auiHandle, apEvent->uiExpired };
+
+    hppTimerExpirationCount++;
+    if(apEvent->uiExpired != hppTimerWheelGetTick()) hppTimerDeferredCount++;
+
+    if(apEvent->pHandler == hppTimerActionHandlerInt)
+    {
+        hppTimerActionHandlerInt(apEvent->auiData, apEvent->cbDataLen, apEvent->pContext);
+        hppTimerStatsRecordInt((hppTimerResource*)apEvent->pContext, apEvent->uiExpired);
+        hppTimerWheelRelease(auiHandle);
+        return;
+    }
+
+    if(apEvent->pHandler == hppButtonDebounceHandlerInt)
+    {
+        hppButtonDebounceHandlerInt(apEvent->auiData, apEvent->cbDataLen, apEvent->pContext);
+        hppTimerWheelRelease(auiHandle);
+        return;
+    }
+
+    if(apEvent->pHandler == hppTimerResourceHandlerInt)
+    {
+        pTimer = (hppTimerResource*)apEvent->pContext;
+        uiType = HPP_ASYNC_TLV_TIMER_EXPIRED;
+
+        // The dispatcher is behind: skip the expiration, the next ones keep their schedule
+        if(pTimer->uiPolicy == hppTimerPolicy_Skip && atomic_get(&(pTimer->mQueuedCount)) > 0)
+        {
+            pTimer->mStats.uiMissedCount++;
+            return;
+        }
+    }
+
+    // Release single shot events here if the queue is full
+    if(!hppAsyncProcessDataInt((uint8_t*)auiData, sizeof(auiData), uiType)) 
+    {
+        if(pTimer != NULL) pTimer->mStats.uiMissedCount++;
+        hppTimerWheelRelease(auiHandle);
+        return;
+    }
+
+    if(pTimer != NULL) atomic_inc(&(pTimer->mQueuedCount));
+}
+
+
+static void hppTimerWheelTimerHandlerInt(struct k_timer *apTimer)
+{
+    uint32_t uiStartTime = hppProfilerClockUs();
+    uint32_t uiExpirationCount = hppTimerExpirationCount;
+    k_spinlock_key_t mKey = k_spin_lock(&hppTimerWheelLock);
+
+    hppTimerWheelAdvance(k_uptime_get_32(), hppTimerWheelExpiredInt);
+    hppTimerWheelArmInt();
+
+    k_spin_unlock(&hppTimerWheelLock, mKey);
+
+    hppTimerWakeupCount++;
+    if(hppTimerExpirationCount != uiExpirationCount) hppTimerBusyWakeupCount++;
+    hppTimerActiveTime += hppProfilerClockUs() - uiStartTime;
+}
+
+
+// Add an event to the wheel and restart the kernel timer if the event expires before it
+static uint32_t hppTimerWheelAddInt(uint32_t aDelay, uint32_t aPeriod, uint32_t aSlack, hppQueuedTimerHandler apHandler, void* apData, uint32_t aDataLen, void *apContext)
+{
+    k_spinlock_key_t mKey = k_spin_lock(&hppTimerWheelLock);
+    uint32_t uiHandle = hppTimerWheelAdd(k_uptime_get_32(), aDelay, aPeriod, aSlack, apHandler, apData, aDataLen, apContext);
+    uint32_t uiExpiry;
+
+    if(uiHandle != 0)
+    {
+        uiExpiry = hppTimerWheelGet(uiHandle)->uiExpiry;
+        if(!hppTimerWheelArmed || (int32_t)(uiExpiry - hppTimerWheelArmedTick) < 0) hppTimerWheelArmAtInt(uiExpiry);
+    }
+
+    k_spin_unlock(&hppTimerWheelLock, mKey);
+
+    return uiHandle;
+}
+
+
+// Call the handler of an event in the dispatcher. 'auiExpected' is the uptime in ms at which the event expired.
+static void hppTimerWheelDispatch(uint32_t auiHandle, uint32_t auiExpected)
+{
+    struct hppTimerWheelEventStruct* pEvent;
+    hppTimerResource* pTimer = NULL;
+    k_spinlock_key_t mKey = k_spin_lock(&hppTimerWheelLock);
+
+    pEvent = hppTimerWheelGet(auiHandle);
+    k_spin_unlock(&hppTimerWheelLock, mKey);
+
+    if(pEvent == NULL) return;   // Cancelled after it expired
+
+    if(pEvent->pHandler == hppTimerResourceHandlerInt)
+    {
+        pTimer = (hppTimerResource*)pEvent->pContext;
+        atomic_dec(&(pTimer->mQueuedCount));
+        hppTimerStatsRecordInt(pTimer, auiExpected);
+    }
+
+    if(pEvent->pHandler) (pEvent->pHandler)(pEvent->auiData, pEvent->cbDataLen, pEvent->pContext);
+
+    mKey = k_spin_lock(&hppTimerWheelLock);
+    hppTimerWheelRelease(auiHandle);
+    k_spin_unlock(&hppTimerWheelLock, mKey);
+
+    // Without drift compensation the next period starts now
+    if(pTimer != NULL && pTimer->uiPolicy == hppTimerPolicy_Delay && pTimer->uiPeriod > 0 && pTimer->uiHandle == auiHandle)
+    {
+        pTimer->uiHandle = hppTimerWheelAddInt(pTimer->uiPeriod, 0, pTimer->uiSlack, hppTimerResourceHandlerInt, NULL, 0, pTimer);
+    }
+}
+
+
+// Timers with IDs
+bool hppTimerStart(uint32_t aTimerID, uint32_t aTime, bool aIsContinous, uint32_t aSlack, hppTimerHandler aTimerHandler, void *apContext)
+{
+    hppTimerResource* pTimer;
+
+    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT) return false;
+    if(aTimerHandler == NULL) return false;
+
+    hppTimerStop(aTimerID);
+
+    pTimer = &hppTimerResources[aTimerID];
+    pTimer->pHandler = aTimerHandler;
+    pTimer->pContext = apContext;
+    pTimer->uiAction = hppTimerAction_None;
+    pTimer->uiPeriod = aIsContinous ? aTime : 0;
+    pTimer->uiSlack = aSlack;
+    memset(&(pTimer->mStats), 0, sizeof(hppTimerStats));
+
+    // Drift compensated timers are periodic events of the wheel, others are restarted after each dispatch
+    pTimer->uiHandle = hppTimerWheelAddInt(aTime, pTimer->uiPolicy == hppTimerPolicy_Delay ? 0 : pTimer->uiPeriod, aSlack, hppTimerResourceHandlerInt, NULL, 0, pTimer);
+
+    return pTimer->uiHandle != 0;
+}
+
+
+bool hppTimerSetPolicy(uint32_t aTimerID, uint8_t auiPolicy)
+{
+    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT || auiPolicy > hppTimerPolicy_Delay) return false;
+
+    hppTimerResources[aTimerID].uiPolicy = auiPolicy;
+
+    return true;
+}
+
+
+bool hppTimerStartAction(uint32_t aTimerID, uint32_t aTime, uint8_t auiAction, uint32_t auiPin, const char* aszVarName, const char* aszValue)
+{
+    hppTimerResource* pTimer;
+
+    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT) return false;
+    if(auiAction == hppTimerAction_None || auiAction > hppTimerAction_VarPut) return false;
+    if(auiAction <= hppTimerAction_GpioToggle && auiPin > 63) return false;
+    if(auiAction == hppTimerAction_VarPut && (*aszVarName == 0 || strlen(aszVarName) > HPP_VAR_NAME_MAX_LEN || strlen(aszValue) > HPP_FIXSTR_MAX_LEN)) return false;
+
+    hppTimerStop(aTimerID);
+
+    pTimer = &hppTimerResources[aTimerID];
+    pTimer->pHandler = NULL;
+    pTimer->pContext = NULL;
+    pTimer->uiAction = auiAction;
+    pTimer->uiPeriod = aTime;
+    memset(&(pTimer->mStats), 0, sizeof(hppTimerStats));
+    pTimer->pGpioDev = auiPin > 31 ? hppGpioDev1 : hppGpioDev0;
+    pTimer->uiPin = auiPin & 31;
+
+    if(auiAction == hppTimerAction_VarPut)
+    {
+        strcpy(pTimer->szVarName, aszVarName);
+        strcpy(pTimer->szValue, aszValue);
+    }
+
+    pTimer->uiSlack = 0;
+    pTimer->uiHandle = hppTimerWheelAddInt(aTime, aTime, 0, hppTimerActionHandlerInt, NULL, 0, pTimer);
+
+    return pTimer->uiHandle != 0;
+}
+
 
-const char* hppSyncVarGetKeyBegin(const char aszKey[], bool abCaseSensitive)
+bool hppTimerStop(uint32_t aTimerID)
 {
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    return hppVarGetKey(aszKey, abCaseSensitive);
+    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT) return false;
+
+    hppTimerCancelEvent(hppTimerResources[aTimerID].uiHandle);
+    hppTimerResources[aTimerID].uiHandle = 0;
+    atomic_set(&(hppTimerResources[aTimerID].mQueuedCount), 0);
+
+    return true;
 }
 
-void hppSyncVarGetKeyEnd()
+
+// Scheduled Events
+uint32_t hppTimerScheduleEvent(uint32_t aDelayFromNow, uint32_t aSlack, hppQueuedTimerHandler apHandler, void* apData, uint32_t aDataLen, void *apContext)
 {
-    k_mutex_unlock(&hppVarMutex);
+    if(apHandler == NULL) return 0;
+
+    return hppTimerWheelAddInt(aDelayFromNow, 0, aSlack, apHandler, apData, aDataLen, apContext);
 }
 
 
-bool hppSyncVarDelete(const char aszKey[])
+bool hppTimerCancelEvent(uint32_t aHandle)
 {
-    bool retVal;
+    k_spinlock_key_t mKey = k_spin_lock(&hppTimerWheelLock);
+    bool bSuccess = hppTimerWheelCancel(aHandle);
 
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    retVal = hppVarDelete(aszKey);
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    k_spin_unlock(&hppTimerWheelLock, mKey);
 
-    return retVal;
+    return bSuccess;
 }
 
 
-void hppSyncVarDeleteAll(const char aszKeyPrefix[])
+// Write the statistics of the timers with IDs in use in the format "id,policy,period,dispatched,missed,last expected,last actual,
+// last late,mean late,max late,jitter" (one line each). Times are uptimes in ms, lateness and jitter (max - min lateness) in us.
+// Returns the length of the text which would have been written if 'acbMaxLen' had been sufficiently large (like snprintf).
+size_t hppTimerStatsDump(char* aszOut, size_t acbMaxLen)
 {
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    hppVarDeleteAll(aszKeyPrefix);
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    static const char* aszPolicies[] = { "catchup", "skip", "delay" };
+    hppTimerResource* pTimer;
+    size_t cbLen = 0;
+    uint32_t i;
+    int iLen;
+
+    if(aszOut != NULL && acbMaxLen > 0) aszOut[0] = 0;
+
+    for(i = 0; i < HPP_TIMER_RESOURCE_COUNT; i++) 
+    {
+        pTimer = &(hppTimerResources[i]);
+        if(pTimer->uiHandle == 0 && pTimer->mStats.uiDispatchCount == 0 && pTimer->mStats.uiMissedCount == 0) continue;
+
+        iLen = snprintf(cbLen < acbMaxLen ? aszOut + cbLen : NULL, cbLen < acbMaxLen ? acbMaxLen - cbLen : 0, "%lu,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", 
+                        (unsigned long)i, pTimer->uiAction != hppTimerAction_None ? "action" : aszPolicies[pTimer->uiPolicy], (unsigned long)pTimer->uiPeriod, 
+                        (unsigned long)pTimer->mStats.uiDispatchCount, (unsigned long)pTimer->mStats.uiMissedCount, 
+                        (unsigned long)pTimer->mStats.uiLastExpected, (unsigned long)pTimer->mStats.uiLastActual, (unsigned long)pTimer->mStats.uiLastLateness,
+                        (unsigned long)(pTimer->mStats.uiDispatchCount > 0 ? pTimer->mStats.uiSumLateness / pTimer->mStats.uiDispatchCount : 0),
+                        (unsigned long)pTimer->mStats.uiMaxLateness, (unsigned long)(pTimer->mStats.uiMaxLateness - pTimer->mStats.uiMinLateness));
+
+        if(iLen > 0) cbLen += (size_t)iLen;
+    }
+
+    return cbLen;
 }
 
 
-int hppSyncVarCount(const char aszKeyPrefix[], bool abExludeRootElements)
+void hppTimerStatsReset()
 {
-    int retVal;
+    uint32_t i;
 
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    retVal = hppVarCount(aszKeyPrefix, abExludeRootElements);
-    k_mutex_unlock(&hppVarMutex);
+    for(i = 0; i < HPP_TIMER_RESOURCE_COUNT; i++) memset(&(hppTimerResources[i].mStats), 0, sizeof(hppTimerStats));
+}
 
-    return retVal;
+
+// Write the wake-up counters in the format "wakeups,expirations,deferred,saved,active time". saved is the number of wake-ups 
+// saved compared to one wake-up per expiration, the active time in us. Returns the length like snprintf.
+size_t hppTimerWakeupsDump(char* aszOut, size_t acbMaxLen)
+{
+    return snprintf(aszOut, acbMaxLen, "%lu,%lu,%lu,%lu,%lu", (unsigned long)hppTimerWakeupCount, (unsigned long)hppTimerExpirationCount,
+                    (unsigned long)hppTimerDeferredCount, (unsigned long)(hppTimerExpirationCount - hppTimerBusyWakeupCount), (unsigned long)hppTimerActiveTime);
 }
 
 
-int hppSyncVarGetAll(char* aszResult, size_t acbMaxLen, const char aszKeyPrefix[], const char aszFormat[])
+void hppTimerWakeupsReset()
 {
-    int retVal;
+    k_spinlock_key_t mKey = k_spin_lock(&hppTimerWheelLock);
 
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    retVal = hppVarGetAll(aszResult, acbMaxLen, aszKeyPrefix, aszFormat);
-    k_mutex_unlock(&hppVarMutex);
+    hppTimerWakeupCount = 0;
+    hppTimerBusyWakeupCount = 0;
+    hppTimerExpirationCount = 0;
+    hppTimerDeferredCount = 0;
+    hppTimerActiveTime = 0;
 
-    return retVal;
+    k_spin_unlock(&hppTimerWheelLock, mKey);
 }
-*/
+
 
 
 // ------------------------------------------------------------------
-// Synchronized function calls for H++ parser functions
+// Buttons 
 // ------------------------------------------------------------------
 
-/*
-bool hppSyncParseExpression(const char* aszCode, const char* aszResultVarKey)
+// GPIO interrupt of a button. The first edge of a burst schedules the sampling of the pin, bounces until then are ignored.
+static void hppButtonGpioHandlerInt(const struct device *apDev, struct gpio_callback *apCallback, gpio_port_pins_t auiPins)
 {
-    int bRetVal;
-
-    k_mutex_lock(&hppParseMutex, K_FOREVER);     // Parser Mutex is outside to ensure hppSyncTryLockParserMutext(..) makes parser and variable available
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    bRetVal = (hppParseExpression(aszCode, aszResultVarKey) != NULL);
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    hppButtonResource* pButton = CONTAINER_OF(apCallback, hppButtonResource, mCallback);
 
-    return bRetVal;
-}
+    if(atomic_set(&(pButton->mDebouncing), 1) != 0) return;
 
-char* hppSyncParseExpressionBegin(const char* aszCode, const char* aszResultVarKey)
-{
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    k_mutex_lock(&hppVarMutex, K_FOREVER);
-    return hppParseExpression(aszCode, aszResultVarKey);
-}
+    pButton->uiBurstStart = k_uptime_get_32();
+    pButton->uiHandle = hppTimerWheelAddInt(pButton->uiDebounceTime, 0, 0, hppButtonDebounceHandlerInt, NULL, 0, pButton);
 
-void hppSyncParseExpressionEnd()
-{
-    k_mutex_unlock(&hppVarMutex);
-    k_mutex_unlock(&hppParseMutex);
+    if(pButton->uiHandle == 0) atomic_set(&(pButton->mDebouncing), 0);   // no event available, try again with the next edge
 }
 
 
-bool hppSyncTryLockParserMutext(int iWaitTimeInMs)
+bool hppButtonConfigure(uint32_t auiPin, bool abActiveHigh, int aiPull, uint32_t auiDebounceTime, uint8_t auiEdge)
 {
-    if (k_mutex_lock(&hppParseMutex, K_MSEC(iWaitTimeInMs)) == 0) return true; 
-    return false;
-}
+    hppButtonResource* pButton = NULL;
+    gpio_flags_t flags = GPIO_INPUT;
+    uint32_t i;
 
-void hppSyncUnlockParserMutext()
-{
-    k_mutex_unlock(&hppParseMutex);
-}
-*/
+    if(auiPin > 63 || aiPull > 1 || auiEdge > hppButtonEdge_Release) return false;
 
+    // Reconfigure the button of the pin or take a free resource
+    for(i = 0; i < HPP_BUTTON_COUNT; i++)
+    {
+        if(hppButtonResources[i].pGpioDev != NULL && hppButtonResources[i].uiPinID == auiPin) 
+        {
+            pButton = &(hppButtonResources[i]);
+            gpio_pin_interrupt_configure(pButton->pGpioDev, pButton->uiPin, GPIO_INT_DISABLE);
+            gpio_remove_callback(pButton->pGpioDev, &(pButton->mCallback));
+            hppTimerCancelEvent(pButton->uiHandle);
+            break;
+        }
 
+        if(pButton == NULL && hppButtonResources[i].pGpioDev == NULL) pButton = &(hppButtonResources[i]);
+    }
 
-bool hppSyncAddExternalFunctionLibrary(hppExternalFunctionType aExternalFunctionType)
-{
-    bool retVal;
+    if(pButton == NULL) return false;
 
-    //k_mutex_lock(&hppVarMutex, K_FOREVER);
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    retVal = hppAddExternalFunctionLibrary(aExternalFunctionType);
-    k_mutex_unlock(&hppParseMutex);
-    //k_mutex_unlock(&hppVarMutex);
+    if(!abActiveHigh) flags |= GPIO_ACTIVE_LOW;
+    if(aiPull == 1) flags |= GPIO_PULL_UP;
+    else if(aiPull == 0) flags |= GPIO_PULL_DOWN;
 
-    return retVal;
-}
+    pButton->pGpioDev = auiPin > 31 ? hppGpioDev1 : hppGpioDev0;
+    pButton->uiPin = auiPin & 31;
+    pButton->uiPinID = auiPin;
+    pButton->uiEdge = auiEdge;
+    pButton->uiDebounceTime = auiDebounceTime > 0 ? auiDebounceTime : 1;
+    pButton->uiHandle = 0;
+    atomic_set(&(pButton->mDebouncing), 0);
 
+    if(gpio_pin_configure(pButton->pGpioDev, pButton->uiPin, flags) != 0)
+    {
+        pButton->pGpioDev = NULL;
+        return false;
+    }
 
-hppExternalPollFunctionType hppSyncAddExternalPollFunction(hppExternalPollFunctionType aNewExternalPollFunction)
-{
-    hppExternalPollFunctionType retVal;
+    pButton->bPressed = gpio_pin_get(pButton->pGpioDev, pButton->uiPin) > 0;
+    pButton->uiPressTime = k_uptime_get_32();
 
-    //k_mutex_lock(&hppVarMutex, K_FOREVER);
-    k_mutex_lock(&hppParseMutex, K_FOREVER);
-    retVal = hppAddExternalPollFunction(aNewExternalPollFunction);
-    k_mutex_unlock(&hppParseMutex);
-    //k_mutex_unlock(&hppVarMutex);
+    // Both edges are needed to measure the hold time, 'auiEdge' only selects the H++ handlers called
+    gpio_init_callback(&(pButton->mCallback), hppButtonGpioHandlerInt, BIT(pButton->uiPin));
+    gpio_add_callback(pButton->pGpioDev, &(pButton->mCallback));
 
-    return retVal;
+    if(gpio_pin_interrupt_configure(pButton->pGpioDev, pButton->uiPin, GPIO_INT_EDGE_BOTH) != 0)
+    {
+        gpio_remove_callback(pButton->pGpioDev, &(pButton->mCallback));
+        pButton->pGpioDev = NULL;
+        return false;
+    }
+
+    return true;
 }
 
 
 
 // ------------------------------------------------------------------
-// Asynchronous function call for H++ var and parser functions
+// Binary USB frames
 // ------------------------------------------------------------------
 
-static bool hppAsyncProcessVarInt(const char* aszVarName, uint8_t auiType)
+// Continue the CRC-16/CCITT-FALSE 'auiCrc' (polynomial 0x1021, start with 0xFFFF) over the bytes 'apData'
+static uint16_t hppZephyrUsbFrameCrc(uint16_t auiCrc, const uint8_t apData[], size_t acbDataLen)
 {
-    uint8_t uiType = auiType;
-    uint16_t uiLen;
-    bool bRetVal;
-
-    if(aszVarName == NULL) return false;
-    uiLen = strlen(aszVarName);
-    if(uiLen > HPP_ASYNC_MAX_VAR_SIZE) return false;
-    
-    k_sched_lock();
+    uint16_t uiCrc = auiCrc;
+    size_t i;
+    int iBit;
 
-    if(ring_buf_space_get(&hppAsyncRingBuf) >= uiLen + sizeof(uint16_t) + sizeof(uint8_t))
+    for(i = 0; i < acbDataLen; i++)
     {
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiType, sizeof(uint8_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiLen, sizeof(uint16_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)aszVarName, uiLen);
-        k_sem_give(&hppParserSemaphor);
-        bRetVal = true;
+        uiCrc ^= (uint16_t)apData[i] << 8;
+        for(iBit = 0; iBit < 8; iBit++) uiCrc = (uiCrc & 0x8000) ? (uint16_t)((uiCrc << 1) ^ 0x1021) : (uint16_t)(uiCrc << 1);
     }
-    else bRetVal = false;
-
-    k_sched_unlock();
 
-    return bRetVal;
+    return uiCrc;
 }
 
 
-bool hppAsyncProcessDataInt(const uint8_t apData[], uint16_t acbDataLen, uint8_t auiType)
+// Append the escaped bytes 'apData' to the output buffer 'apOut' holding 'acbOut' bytes. The buffer is sent whenever it is full.
+// Returns the number of bytes in the buffer.
+static uint32_t hppZephyrUsbFrameEncode(uint8_t apOut[], uint32_t acbOut, const uint8_t apData[], size_t acbDataLen)
 {
-    uint8_t uiType = auiType;
-    bool bRetVal;
-
-    if(apData == NULL) return false;
-    if(acbDataLen > HPP_ASYNC_MAX_DATA_SIZE) return false;
-    
-    if(!k_is_in_isr()) k_sched_lock();
+    size_t i;
 
-    if(ring_buf_space_get(&hppAsyncRingBuf) >= acbDataLen + sizeof(uint16_t))
+    for(i = 0; i < acbDataLen; i++)
     {
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiType, sizeof(uint8_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&acbDataLen, sizeof(uint16_t));
-        ring_buf_put(&hppAsyncRingBuf, apData, acbDataLen);
-        k_sem_give(&hppParserSemaphor);
-        bRetVal = true;
-    }
-    else bRetVal = false;
+        if(acbOut + 2 > HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE) 
+        {
+            hppZephyrUsbSend(apOut, acbOut);
+            acbOut = 0;
+        }
 
-    if(!k_is_in_isr()) k_sched_unlock();
+        if(apData[i] == HPP_ZEPHYR_USB_FRAME_END) 
+        {
+            apOut[acbOut++] = HPP_ZEPHYR_USB_FRAME_ESC;
+            apOut[acbOut++] = HPP_ZEPHYR_USB_FRAME_ESC_END;
+        }
+        else if(apData[i] == HPP_ZEPHYR_USB_FRAME_ESC) 
+        {
+            apOut[acbOut++] = HPP_ZEPHYR_USB_FRAME_ESC;
+            apOut[acbOut++] = HPP_ZEPHYR_USB_FRAME_ESC_ESC;
+        }
+        else apOut[acbOut++] = apData[i];
+    }
 
-    return bRetVal;
+    return acbOut;
 }
 
 
-bool hppAsyncVarGetFromUriCoapResponse(const char aszVarName[])
+// Create a response of the command 'auiCmd' with the status 'auiStatus' and a copy of the data. The response is sent by 
+// hppAsyncOutputFlush once the batch is finished, such that the parser mutex is not locked while waiting for the USB interface.
+// Returns NULL if memory was not sufficient. The host repeats the request after a timeout in this case.
+static char* hppZephyrUsbFrameNewResponse(uint8_t auiCmd, uint8_t auiStatus, const char* apData, size_t acbDataLen, size_t* apcbResponseLen_Out)
 {
-    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE);
+    char* pchResponse = (char*)malloc(acbDataLen + 2);
+
+    *apcbResponseLen_Out = 0;
+    if(pchResponse == NULL) return NULL;
+
+    pchResponse[0] = (char)auiCmd;
+    pchResponse[1] = (char)auiStatus;
+    if(acbDataLen > 0) memcpy(pchResponse + 2, apData, acbDataLen);
+
+    *apcbResponseLen_Out = acbDataLen + 2;
+    return pchResponse;
 }
 
 
-bool hppAsyncVarPutInt(const char aszVarName[], const char apValue[], uint16_t acbValueLen, uint8_t auiType)
+// Send the response 'apchResponse' created with hppZephyrUsbFrameNewResponse(...) as frames. Data longer than a frame is split
+// into frames with the flag MORE. Must be called with the parser mutex unlocked.
+static void hppZephyrUsbFrameRespond(const char* apchResponse, size_t acbResponseLen)
 {
-    uint8_t uiType = auiType;
-    uint16_t uiVarNameLen;
-    bool bRetVal;
+    uint8_t auiOut[HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE];
+    uint8_t auiHeader[3];
+    uint8_t auiCrc[2];
+    uint32_t cbOut;
+    uint16_t uiCrc;
+    size_t cbPart;
+    uint8_t auiCmd = (uint8_t)apchResponse[0];
+    uint8_t auiStatus = (uint8_t)apchResponse[1];
+    const char* apData = apchResponse + 2;
+    size_t acbDataLen = acbResponseLen - 2;
+
+    do
+    {
+        cbPart = acbDataLen > HPP_ZEPHYR_USB_FRAME_MAX_SIZE - 5 ? HPP_ZEPHYR_USB_FRAME_MAX_SIZE - 5 : acbDataLen;
 
-    if(aszVarName == NULL || apValue == NULL) return false;
-    uiVarNameLen = strlen(aszVarName);
-    if(uiVarNameLen > HPP_ASYNC_MAX_VAR_SIZE) return false;
-    if(acbValueLen > HPP_ASYNC_MAX_DATA_SIZE) return false;
-    
-    if(!k_is_in_isr()) k_sched_lock();
+        auiHeader[0] = auiCmd;
+        auiHeader[1] = auiStatus;
+        auiHeader[2] = cbPart < acbDataLen ? HPP_ZEPHYR_USB_FRAME_FLAG_MORE : 0;
 
-    if(ring_buf_space_get(&hppAsyncRingBuf) >= acbValueLen + uiVarNameLen + 2*sizeof(uint16_t) + sizeof(uint8_t) + HPP_ASYNC_RINGBUF_SAFETY_BUFFER)
-    {
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiType, sizeof(uint8_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiVarNameLen, sizeof(uint16_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)aszVarName, uiVarNameLen);
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&acbValueLen, sizeof(uint16_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)apValue, acbValueLen);
-        k_sem_give(&hppParserSemaphor);
-        bRetVal = true;
-    }
-    else bRetVal = false;
+        // The CRC covers the header and the data of the frame
+        uiCrc = hppZephyrUsbFrameCrc(0xFFFF, auiHeader, sizeof(auiHeader));
+        uiCrc = hppZephyrUsbFrameCrc(uiCrc, (const uint8_t*)apData, cbPart);
+        auiCrc[0] = (uint8_t)uiCrc;
+        auiCrc[1] = (uint8_t)(uiCrc >> 8);
 
-    if(!k_is_in_isr()) k_sched_unlock();
+        cbOut = 0;
+        auiOut[cbOut++] = HPP_ZEPHYR_USB_FRAME_END;
+        cbOut = hppZephyrUsbFrameEncode(auiOut, cbOut, auiHeader, sizeof(auiHeader));
+        cbOut = hppZephyrUsbFrameEncode(auiOut, cbOut, (const uint8_t*)apData, cbPart);
+        cbOut = hppZephyrUsbFrameEncode(auiOut, cbOut, auiCrc, sizeof(auiCrc));
 
-    return bRetVal;
-}
+        if(cbOut + 1 > HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE) 
+        {
+            hppZephyrUsbSend(auiOut, cbOut);
+            cbOut = 0;
+        }
 
-bool hppAsyncVarPut(const char aszVarName[], const char apValue[], uint16_t acbValueLen, bool abSyncWithNext)
-{
-    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT : HPP_ASYNC_TLV_VAR_PUT;
+        auiOut[cbOut++] = HPP_ZEPHYR_USB_FRAME_END;
+        hppZephyrUsbSend(auiOut, cbOut);
 
-    return hppAsyncVarPutInt(aszVarName, apValue, acbValueLen, uiType);
+        apData += cbPart;
+        acbDataLen -= cbPart;
+    }
+    while(acbDataLen > 0);
 }
 
-bool hppAsyncVarPutStr(const char aszVarName[], const char aszValue[], bool abSyncWithNext)
+
+// Collect the data of a put or execute frame. Returns the status of the frame. The collected value is passed in 'appchValue_Out'
+// with the last frame of the value (flag MORE not set) and must be released with free(...) then.
+// The data of a continued frame starts with the offset of the data in the value (4 bytes, low byte first). A repeated frame,
+// e.g. after its response has been lost, is acknowledged again without adding its data. This includes the last frame of the
+// value completed last, whose end offset is kept. The value is discarded on a gap.
+static uint8_t hppZephyrUsbFrameCollect(uint8_t auiCmd, uint8_t auiFlags, const char* aszName, const char* apData, size_t acbDataLen, char** appchValue_Out)
 {
-    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT : HPP_ASYNC_TLV_VAR_PUT;
+    char* pchValue;
+    uint32_t uiOffset;
 
-    return hppAsyncVarPut(aszVarName, aszValue, strlen(aszValue), uiType);
-}
+    *appchValue_Out = NULL;
 
-bool hppAsyncVarPutFromUri(const char aszVarName[], const char apValue[], uint16_t acbValueLen)
-{
-    return hppAsyncVarPutInt(aszVarName, apValue, acbValueLen, HPP_ASYNC_TLV_VAR_PUT_NON_CASE_SENSITIVE);
-}
+    if(auiFlags & HPP_ZEPHYR_USB_FRAME_FLAG_CONTINUE)
+    {
+        if(acbDataLen < 4) return HPP_ZEPHYR_USB_FRAME_STATUS_INVALID;
 
+        uiOffset = (uint8_t)apData[0] | ((uint8_t)apData[1] << 8) | ((uint8_t)apData[2] << 16) | ((uint32_t)(uint8_t)apData[3] << 24);
+        apData += 4;
+        acbDataLen -= 4;
 
-bool hppAsyncVarDelete(const char aszVarName[])
-{
-    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_VAR_DELETE);
-}
+        if(hppZephyrUsbFrameValueCmd != auiCmd || strcmp(hppZephyrUsbFrameValueName, aszName) != 0) return HPP_ZEPHYR_USB_FRAME_STATUS_SEQUENCE;
 
+        if(hppZephyrUsbFrameValue == NULL)
+        {
+            // Repetition of the last frame of the value completed last?
+            if(hppZephyrUsbFrameValueDone && uiOffset <= hppZephyrUsbFrameValueLen && uiOffset + acbDataLen == hppZephyrUsbFrameValueLen && 
+               (auiFlags & HPP_ZEPHYR_USB_FRAME_FLAG_MORE) == 0) return HPP_ZEPHYR_USB_FRAME_STATUS_OK;
 
-bool hppAsyncParseExpression(const char* aszCode, bool aWriteResultToCli)
-{
-    return hppAsyncProcessDataInt(aszCode, strlen(aszCode), aWriteResultToCli ? HPP_ASYNC_TLV_PARSE_TEXT_CLI : HPP_ASYNC_TLV_PARSE_TEXT);
-}
+            return HPP_ZEPHYR_USB_FRAME_STATUS_SEQUENCE;
+        }
 
+        if(uiOffset != hppZephyrUsbFrameValueLen)
+        {
+            // Repetition of the last frame which has been added already? 
+            if(uiOffset < hppZephyrUsbFrameValueLen && uiOffset + acbDataLen == hppZephyrUsbFrameValueLen && (auiFlags & HPP_ZEPHYR_USB_FRAME_FLAG_MORE)) 
+                return HPP_ZEPHYR_USB_FRAME_STATUS_OK;
 
-bool hppAsyncParseVar(const char* aszVarName)
-{
-    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_PARSE_VAR);
-}
+            free(hppZephyrUsbFrameValue);
+            hppZephyrUsbFrameValue = NULL;
+            return HPP_ZEPHYR_USB_FRAME_STATUS_OFFSET;
+        }
+    }
+    else
+    {
+        // A new value replaces a value of previous frames which was not completed
+        free(hppZephyrUsbFrameValue);
+        hppZephyrUsbFrameValue = NULL;
+        hppZephyrUsbFrameValueLen = 0;
+        hppZephyrUsbFrameValueCmd = auiCmd;
+        hppZephyrUsbFrameValueDone = false;
+        strcpy(hppZephyrUsbFrameValueName, aszName);
+    }
 
+    if(hppZephyrUsbFrameValueLen + acbDataLen > HPP_ZEPHYR_USB_FRAME_MAX_VALUE_SIZE) 
+    {
+        free(hppZephyrUsbFrameValue);
+        hppZephyrUsbFrameValue = NULL;
+        return HPP_ZEPHYR_USB_FRAME_STATUS_TOO_LARGE;
+    }
 
-bool hppAsyncParseVarCoapResponse(const char* aszVarName)
-{
-    return hppAsyncProcessVarInt(aszVarName, HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE);
-}
+    // One extra byte for the ending null byte, see hppVarPutAdopt(...)
+    pchValue = (char*)realloc(hppZephyrUsbFrameValue, hppZephyrUsbFrameValueLen + acbDataLen + 1);
 
+    if(pchValue == NULL)
+    {
+        free(hppZephyrUsbFrameValue);
+        hppZephyrUsbFrameValue = NULL;
+        return HPP_ZEPHYR_USB_FRAME_STATUS_FAILED;
+    }
 
-bool hppAsyncVarGetWellKnownCore()
-{
-    return hppAsyncProcessVarInt("", HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE);
-}
+    memcpy(pchValue + hppZephyrUsbFrameValueLen, apData, acbDataLen);
+    hppZephyrUsbFrameValueLen += acbDataLen;
+    pchValue[hppZephyrUsbFrameValueLen] = 0;
+    hppZephyrUsbFrameValue = pchValue;
 
+    if((auiFlags & HPP_ZEPHYR_USB_FRAME_FLAG_MORE) == 0)
+    {
+        *appchValue_Out = hppZephyrUsbFrameValue;
+        hppZephyrUsbFrameValue = NULL;
+        hppZephyrUsbFrameValueDone = true;
+    }
 
-bool hppAsyncVarHide(const char* aszPassword)
-{
-    if(aszPassword == NULL) aszPassword = "";
-    return hppAsyncProcessVarInt(aszPassword, HPP_ASYNC_TLV_VAR_HIDE);
+    return HPP_ZEPHYR_USB_FRAME_STATUS_OK;
 }
 
 
+// Execute a binary frame received via USB. Called by the dispatcher with the parser mutex locked. Returns the response created 
+// with hppZephyrUsbFrameNewResponse(...) and its length in 'apcbResponseLen_Out' or NULL if memory was not sufficient.
+static char* hppZephyrUsbFrameDispatch(const uint8_t apFrame[], uint32_t acbFrameLen, size_t* apcbResponseLen_Out)
+{
+    char szName[HPP_ASYNC_MAX_VAR_SIZE + 1];
+    uint8_t uiCmd = acbFrameLen > 0 ? apFrame[0] : 0;
+    uint8_t uiStatus;
+    uint32_t uiNameLen;
+    const char* pchData;
+    size_t cbData;
+    char* pchValue;
+    char* pchResult;
+    char* pchResponse;
+    size_t cbValue;
+    int iLen;
 
-// ------------------------------------------------------------------
-// Asynchronous function call for H++ Thread functions
-// ------------------------------------------------------------------
+    // Command, flags, name length and CRC
+    if(acbFrameLen < 5) uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_INVALID;
+    else if(hppZephyrUsbFrameCrc(0xFFFF, apFrame, acbFrameLen - 2) != (uint16_t)(apFrame[acbFrameLen - 2] | (apFrame[acbFrameLen - 1] << 8))) uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_CRC;
+    else if(apFrame[2] > HPP_ASYNC_MAX_VAR_SIZE || apFrame[2] + 5u > acbFrameLen) uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_INVALID;
+    else uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_OK;
 
-bool hppAsyncSetCoapContext(hppCoapMessageContext* apCoapMessageContext, bool abSyncWithNext)
-{
-    uint8_t uiType = abSyncWithNext ? HPP_ASYNC_TLV_SET_COAP_CONTEXT_WITH_NEXT : HPP_ASYNC_TLV_SET_COAP_CONTEXT;
-    uint16_t uiLen = sizeof(hppCoapMessageContext);
-    bool bRetVal;
+    if(uiStatus != HPP_ZEPHYR_USB_FRAME_STATUS_OK) return hppZephyrUsbFrameNewResponse(uiCmd, uiStatus, NULL, 0, apcbResponseLen_Out);
 
-    if(apCoapMessageContext == NULL) return false;
-  
-    if(!k_is_in_isr()) k_sched_lock();
+    uiNameLen = apFrame[2];
+
+    memcpy(szName, apFrame + 3, uiNameLen);
+    szName[uiNameLen] = 0;
+    pchData = (const char*)apFrame + 3 + uiNameLen;
+    cbData = acbFrameLen - 5 - uiNameLen;
 
-    if(ring_buf_space_get(&hppAsyncRingBuf) >= uiLen + sizeof(uint16_t) + sizeof(uint8_t) + HPP_ASYNC_RINGBUF_SAFETY_BUFFER)
+    switch(uiCmd)
     {
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiType, sizeof(uint8_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)&uiLen, sizeof(uint16_t));
-        ring_buf_put(&hppAsyncRingBuf, (uint8_t*)apCoapMessageContext, uiLen);
-        k_sem_give(&hppParserSemaphor);
-        bRetVal = true;
-    }
-    else bRetVal = false;
+        case HPP_ZEPHYR_USB_FRAME_CMD_PUT:
+            if(*szName == 0) uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_INVALID;
+            else uiStatus = hppZephyrUsbFrameCollect(uiCmd, apFrame[1], szName, pchData, cbData, &pchValue);
 
-    if(!k_is_in_isr()) k_sched_unlock();
+            // Stored like values put via CoAP or CLI: code images are restored to code, code is minified
+            if(uiStatus == HPP_ZEPHYR_USB_FRAME_STATUS_OK && pchValue != NULL && !hppAsyncVarStore(szName, pchValue, hppZephyrUsbFrameValueLen, true)) uiStatus = HPP_ZEPHYR_USB_FRAME_STATUS_FAILED;
 
-    return bRetVal;
-}
+            pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, uiStatus, NULL, 0, apcbResponseLen_Out);
+        break;
+
+        case HPP_ZEPHYR_USB_FRAME_CMD_EXECUTE:
+            uiStatus = hppZephyrUsbFrameCollect(uiCmd, apFrame[1], szName, pchData, cbData, &pchValue);
+
+            if(pchValue == NULL) pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, uiStatus, NULL, 0, apcbResponseLen_Out);
+            else
+            {
+                pchResult = hppParseExpression(pchValue, "ReturnWithError");
+                pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, uiStatus, pchResult, pchResult != NULL ? strlen(pchResult) : 0, apcbResponseLen_Out);
+                hppVarDelete("ReturnWithError");
+                free(pchValue);
+            }
+        break;
+
+        case HPP_ZEPHYR_USB_FRAME_CMD_GET:
+            pchValue = hppVarGet(szName, &cbValue);
+
+            if(pchValue == NULL) pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, HPP_ZEPHYR_USB_FRAME_STATUS_NOT_FOUND, NULL, 0, apcbResponseLen_Out);
+            else pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, HPP_ZEPHYR_USB_FRAME_STATUS_OK, pchValue, cbValue, apcbResponseLen_Out);
+        break;
+
+        case HPP_ZEPHYR_USB_FRAME_CMD_DELETE:
+            uiStatus = hppVarDelete(szName) ? HPP_ZEPHYR_USB_FRAME_STATUS_OK : HPP_ZEPHYR_USB_FRAME_STATUS_NOT_FOUND;
+            pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, uiStatus, NULL, 0, apcbResponseLen_Out);
+        break;
+
+        case HPP_ZEPHYR_USB_FRAME_CMD_ENUMERATE:
+            // The names are written behind the command and status bytes of the response directly
+            iLen = hppVarGetAll(NULL, 0, szName, "\\1\n%s");
+            pchResponse = iLen >= 0 ? (char*)malloc(iLen + 3) : NULL;
 
+            if(pchResponse == NULL) pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, HPP_ZEPHYR_USB_FRAME_STATUS_FAILED, NULL, 0, apcbResponseLen_Out);
+            else
+            {
+                pchResponse[0] = (char)uiCmd;
+                pchResponse[1] = (char)HPP_ZEPHYR_USB_FRAME_STATUS_OK;
+                hppVarGetAll(pchResponse + 2, iLen + 1, szName, "\\1\n%s");
+                *apcbResponseLen_Out = strlen(pchResponse + 2) + 2;
+            }
+        break;
 
-// ------------------------------------------------------------------
-// Asynchronous function call for Usb Input
-// ------------------------------------------------------------------
+        default:
+            pchResponse = hppZephyrUsbFrameNewResponse(uiCmd, HPP_ZEPHYR_USB_FRAME_STATUS_UNKNOWN, NULL, 0, apcbResponseLen_Out);
+        break;
+    }
 
-bool hppAsyncUsbInput(const uint8_t apData[], uint16_t acbDataLen)
-{
-    return hppAsyncProcessDataInt(apData, acbDataLen, HPP_ASYNC_TLV_USB_RECV);
+    return pchResponse;
 }
 
 
 
-
 // ------------------------------------------------------------------
-// Timer functions 
+// Zephyr main Loop
 // ------------------------------------------------------------------
 
-static void hppTimerHandlerInt(struct k_timer *aTimer)
+// Create the text of the statistics resource /stats/<aszName>. Returns NULL if the statistics do not exist. 
+// The result is dynamically allocated and must be released with free().
+static char* hppNew_Stats(const char* aszName)
 {
-    uint32_t iTimerID = (uint32_t)k_timer_user_data_get(aTimer);
+    char* pchStats = NULL;
+    size_t cbLen;
 
-    if(iTimerID < HPP_TIMER_RESOURCE_COUNT)
+    if(strcmp(aszName, "prof") == 0)
+    {
+        cbLen = hppProfilerDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppProfilerDump(pchStats, cbLen + 1);
+    }
+    else if(strcmp(aszName, "budget") == 0)
+    {
+        cbLen = hppEntryPointDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppEntryPointDump(pchStats, cbLen + 1);
+    }
+    else if(strcmp(aszName, "queue") == 0)
     {
-       hppAsyncProcessDataInt((uint8_t*) &iTimerID, sizeof(uint32_t), HPP_ASYNC_TLV_TIMER_EXPIRED);
+        cbLen = hppAsyncStatsDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppAsyncStatsDump(pchStats, cbLen + 1);
     }
+    else if(strcmp(aszName, "timer") == 0)
+    {
+        cbLen = hppTimerStatsDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppTimerStatsDump(pchStats, cbLen + 1);
+    }
+    else if(strcmp(aszName, "flash") == 0)
+    {
+        cbLen = hppFlashStatsDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppFlashStatsDump(pchStats, cbLen + 1);
+    }
+    else if(strcmp(aszName, "usb") == 0)
+    {
+        cbLen = hppZephyrUsbStatsDump(NULL, 0);
+        pchStats = (char*)malloc(cbLen + 1);
+        if(pchStats != NULL) hppZephyrUsbStatsDump(pchStats, cbLen + 1);
+    }
+
+    return pchStats;
 }
 
 
-bool hppTimerStart(uint32_t aTimerID, uint32_t aTime, bool aIsContinous, hppTimerHandler aTimerHandler, void *apContext)
+// Add an output of the entry of the type 'auiType' presently dispatched. It is written by hppAsyncOutputFlush once the batch is 
+// finished. The CoAP context is taken from the present one which is invalidated, except for CLI outputs and responses to USB frames. 
+// 'aszResultVarKey' is the variable holding 'apchData' which is deleted after the output, NULL if none.
+static void hppAsyncOutputAdd(char* apchData, size_t acbDataLen, uint8_t auiType, bool abCli, const char* aszResultVarKey)
 {
-    k_timeout_t theDuration = K_MSEC(aTime);
-    k_timeout_t thePeriod = aIsContinous ? K_MSEC(aTime) :  K_NO_WAIT;
+    hppAsyncOutput* pOutput = &(hppAsyncOutputs[hppAsyncOutputCount++]);
 
-    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT) return false;
-    if(aTimerHandler == NULL) return false;
+    pOutput->pchData = apchData;
+    pOutput->cbDataLen = acbDataLen;
+    pOutput->uiType = auiType;
+    pOutput->bCli = abCli;
+    strcpy(pOutput->szResultVarKey, aszResultVarKey != NULL ? aszResultVarKey : "");
 
-    hppTimerResources[aTimerID].pHandler = aTimerHandler;
-    hppTimerResources[aTimerID].pContext = apContext;
+    if(abCli || auiType == HPP_ASYNC_TLV_USB_FRAME) return;
 
-    k_timer_user_data_set(&(hppTimerResources[aTimerID].mTimerResource), (void*) aTimerID);
-    k_timer_start(&(hppTimerResources[aTimerID].mTimerResource), theDuration, thePeriod);
+    pOutput->mCoapMessageContext = hppMyCurrentCoapMessageContext;
 
-    return true;
+    // Invalidate CoAP call context
+    hppMyCurrentCoapMessageContext.mCoapMessageTokenLength = 0;
+    hppMyCurrentCoapMessageContext.mCoapCode = OT_COAP_CODE_EMPTY;
 }
 
 
-bool hppTimerStop(uint32_t aTimerID)
+// Write all outputs of the batch with one lock of the Thread mutex and release them afterwards with one lock of the parser mutex.
+// Must be called with the parser mutex unlocked. Functions in hppThread.c require locking the Thread mutex. Avoid doing that while
+// the parser mutex is locked to prevent deadlock situation. Responses to USB frames are sent before, they need neither mutex.
+static void hppAsyncOutputFlush()
 {
-    if(aTimerID >= HPP_TIMER_RESOURCE_COUNT) return false;
+    hppAsyncOutput* pOutput;
+    uint32_t i;
 
-    k_timer_stop(&(hppTimerResources[aTimerID].mTimerResource));
+    if(hppAsyncOutputCount == 0) return;
 
-    return true;
-}
+    for(i = 0; i < hppAsyncOutputCount; i++)
+    {
+        pOutput = &(hppAsyncOutputs[i]);
 
+        if(pOutput->uiType == HPP_ASYNC_TLV_USB_FRAME) hppZephyrUsbFrameRespond(pOutput->pchData, pOutput->cbDataLen);
+    }
 
-// Scheduled Events
-static void hppEventTimerHandlerInt(struct k_timer *apTimer)
-{
-    uint32_t iTimerID = (uint32_t)k_timer_user_data_get(apTimer);
+    openthread_api_mutex_lock(hppOpenThreadContext); 
 
-    if(iTimerID < HPP_EVENT_TIMER_RESOURCE_COUNT)
+    for(i = 0; i < hppAsyncOutputCount; i++)
     {
-        if(!hppAsyncProcessDataInt((uint8_t*) &iTimerID, sizeof(uint32_t), HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED))
-        {
-            // Release resource here if the schedule queue is full
-            hppEventTimerResource* pEventTimer = &(hppEventTimerResources[iTimerID]);
+        pOutput = &(hppAsyncOutputs[i]);
 
-            if(pEventTimer->pApplicationData) free(pEventTimer->pApplicationData);
-            pEventTimer->pApplicationData = NULL;
-            pEventTimer->mInUse = false;
-        }
+        if(pOutput->uiType == HPP_ASYNC_TLV_USB_FRAME) continue;
+        else if(pOutput->bCli) hppCliOutputStr(pOutput->pchData, true);
+        else hppCoapRespondTo(&(pOutput->mCoapMessageContext), pOutput->pchData, pOutput->cbDataLen, pOutput->uiType == HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE ? 40 : 0);
     }
-}
 
+    openthread_api_mutex_unlock(hppOpenThreadContext);
 
-bool hppTimerScheduleEvent(uint32_t aDelayFromNow, hppQueuedTimerHandler apHandler, void* apData, uint32_t aDataLen, void *apContext)
-{
-    k_timeout_t theDuration = K_MSEC(aDelayFromNow);
-    void* pAppData;
-    uint32_t i;
-
-    if(apHandler == NULL) return false;
+    k_mutex_lock(&hppParseMutex, K_FOREVER);
+    //k_mutex_lock(&hppVarMutex, K_FOREVER);
 
-    k_sched_lock();
-    
-    for(i = 0; i < HPP_EVENT_TIMER_RESOURCE_COUNT; i++) 
+    for(i = 0; i < hppAsyncOutputCount; i++)
     {
-        if(hppEventTimerResources[i].mInUse == false) 
-        {
-            hppEventTimerResources[i].mInUse = true;
-            break;
-        }
-    }
-
-    k_sched_unlock();
+        pOutput = &(hppAsyncOutputs[i]);
 
-    if(i >= HPP_EVENT_TIMER_RESOURCE_COUNT) return false;
+        if(pOutput->szResultVarKey[0] != 0) hppVarDelete(pOutput->szResultVarKey);
 
-    if(apData != NULL && aDataLen > 0)
-    {
-        pAppData = malloc(aDataLen);
-        if(pAppData == NULL) 
+        if((pOutput->uiType == HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE || pOutput->uiType == HPP_ASYNC_TLV_STATS_GET_COAP_RESPONSE || 
+            pOutput->uiType == HPP_ASYNC_TLV_USB_FRAME) && pOutput->pchData != NULL)
         {
-            hppEventTimerResources[i].mInUse = false;
-            return false;
+            free(pOutput->pchData);     // response has been dynamically allocated with hppNew_WellknownCore(), hppNew_Stats() or hppZephyrUsbFrameNewResponse()
         }
-
-        memcpy(pAppData, apData, aDataLen);
-        hppEventTimerResources[i].pApplicationData = pAppData;
-        hppEventTimerResources[i].mApplicationDataLen = aDataLen;
     }
 
-    hppEventTimerResources[i].pContext = apContext;
-    hppEventTimerResources[i].pHandler = apHandler;
-
-    k_timer_user_data_set(&(hppEventTimerResources[i].mTimerResource), (void*) i);
-    k_timer_start(&(hppEventTimerResources[i].mTimerResource), theDuration, K_NO_WAIT);
+    //k_mutex_unlock(&hppVarMutex);
+    k_mutex_unlock(&hppParseMutex);
 
-    return true;
+    hppAsyncOutputCount = 0;
 }
 
 
-
-// ------------------------------------------------------------------
-// Zephyr main Loop
-// ------------------------------------------------------------------
-
 static void hppUserModeMain(void *p1, void *p2, void *p3)
 {
     uint8_t uiType;
@@ -1156,33 +3591,70 @@ static void hppUserModeMain(void *p1, void *p2, void *p3)
     char* pchCoap = NULL;
     size_t iCoapResponseLen = 0;
     char* pchResult;
+    char szResultVarKey[HPP_TASK_RESULT_VAR_KEY_LEN + 1] = "ReturnWithError";
     bool bKeepLocked = false;
-    uint32_t uiTimerID;
-    hppTimerResource* pTimer;
-    hppEventTimerResource* pEventTimer;
+    bool bBatchLocked = false;
+    bool bBatchEnd;
+    uint32_t uiQueueTime = 0;
+    uint32_t uiStartTime;
+    uint8_t uiStatsType;
+    bool bParse;
+    bool bParseDone;
+    bool bTaskSlice;
+    bool bTaskTurn = false;
+    bool bGroupShared = false;
+    uint32_t auiTimerData[2];
+    uint32_t auiButtonData[3];
+    char szNumeric[HPP_NUMERIC_MAX_MEM];
+    hppTaskResource* pTask;
+    uint32_t uiTaskWaitID;
+    struct hppAsyncQueueStruct* pQueue = NULL;
+    char* pchBlock;
+    char* pchUsbResponse;
+    size_t cbUsbResponseLen;
 
     LOG_INF("main (user mode) priority: %d", k_thread_priority_get(k_current_get()));
 
     while(1)
     {
-        k_sem_take(&hppParserSemaphor, K_FOREVER);
-
-        // Single reader use-case, no locking needed
-        ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&uiType, sizeof(uint8_t));
-        ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&uiLen, sizeof(uint16_t));
+        // Alternate between queue entries and slices of suspended tasks such that neither of them can starve.
+        // Tasks are not continued while a group of XXX_WITH_NEXT entries is processed.
+        bTaskSlice = false;
+
+        if(bKeepLocked || bBatchLocked || hppTaskCount(true) == 0) pQueue = hppAsyncQueueWait(true);
+        else if(bTaskTurn || (pQueue = hppAsyncQueueWait(false)) == NULL) bTaskSlice = true;
+
+        bTaskTurn = !bTaskSlice;
+        bBatchEnd = false;
+        bParse = false;
+        bParseDone = false;
+        pchCode = NULL;
+        pTask = NULL;
+
+        if(bTaskSlice) uiType = HPP_ASYNC_TLV_TASK_SLICE;
+        else
+        {
+            // Single reader use-case, no locking needed
+            hppAsyncQueueGetHeader(pQueue, &uiType, &uiLen, &uiQueueTime);
+        }
 
-        if(!bKeepLocked)     // already locked from preceeding operation?
+        if(!bKeepLocked && !bBatchLocked)     // already locked from preceeding operation?
         {
             //k_mutex_lock(&hppVarMutex, K_FOREVER);
             k_mutex_lock(&hppParseMutex, K_FOREVER);
+            hppAsyncBatchBegin(&hppAsyncBatch, k_uptime_get_32());
         }
 
+        uiStartTime = hppProfilerClockUs();
+        uiStatsType = uiType;
+        if(bTaskSlice) uiQueueTime = uiStartTime;
+
         bKeepLocked = false;   // unless needed the next command, the mutexes shall be unlocked after execution 
 
         switch(uiType)
         {
             case HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncVarName, uiLen);
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);
                 hppAsyncVarName[uiLen] = 0;
 
                 if(uiLen > 0 && hppMyCurrentCoapMessageContext.mCoapMessageTokenLength != 0)
@@ -1204,21 +3676,55 @@ static void hppUserModeMain(void *p1, void *p2, void *p3)
             case HPP_ASYNC_TLV_VAR_PUT_WITH_NEXT:
                 bKeepLocked = true;
             case HPP_ASYNC_TLV_VAR_PUT_NON_CASE_SENSITIVE:
+            case HPP_ASYNC_TLV_VAR_PUT_TIMER:
             case HPP_ASYNC_TLV_VAR_PUT:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncVarName, uiLen);
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);
                 hppAsyncVarName[uiLen] = 0;
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&uiLen, sizeof(uint16_t));
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncDataBuffer, uiLen);
+                hppAsyncQueueGet(pQueue, &uiLen, sizeof(uint16_t));
+                hppAsyncQueueGet(pQueue, hppAsyncDataBuffer, uiLen);
+
+                if(hppAsyncIsCoalesced(pQueue, uiType, hppAsyncVarName)) break;
 
                 if(uiType == HPP_ASYNC_TLV_VAR_PUT_NON_CASE_SENSITIVE) pchVarKey = hppVarGetKey(hppAsyncVarName, false);
                 else pchVarKey = NULL;
 
-                if(pchVarKey != NULL) hppVarPut(pchVarKey, hppAsyncDataBuffer, uiLen);  
-                else hppVarPut(hppAsyncVarName, hppAsyncDataBuffer, uiLen);         // case sensitve or new var
+                if(pchVarKey == NULL) pchVarKey = hppAsyncVarName;                 // case sensitve or new var
+
+                // Parameters (local variables of call depth zero) are moved to the task started by the group, others are shared
+                if(bKeepLocked && strncmp(pchVarKey, "0000:", 5) != 0) bGroupShared = true;
+
+                hppAsyncVarStore(pchVarKey, hppAsyncDataBuffer, uiLen, false);
+            break;
+
+            case HPP_ASYNC_TLV_VAR_PUT_BLOCK_WITH_NEXT:
+                bKeepLocked = true;
+            case HPP_ASYNC_TLV_VAR_PUT_BLOCK_NON_CASE_SENSITIVE:
+            case HPP_ASYNC_TLV_VAR_PUT_BLOCK:
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);
+                hppAsyncVarName[uiLen] = 0;
+                hppAsyncQueueGet(pQueue, &uiLen, sizeof(uint16_t));
+                hppAsyncQueueGet(pQueue, &pchBlock, sizeof(char*));
+                hppAsyncBlockRelease(uiLen);       // the block is owned by the variable storage from now on
+
+                if(hppAsyncIsCoalesced(pQueue, uiType, hppAsyncVarName))
+                {
+                    free(pchBlock);
+                    break;
+                }
+
+                if(uiType == HPP_ASYNC_TLV_VAR_PUT_BLOCK_NON_CASE_SENSITIVE) pchVarKey = hppVarGetKey(hppAsyncVarName, false);
+                else pchVarKey = NULL;
+
+                if(pchVarKey == NULL) pchVarKey = hppAsyncVarName;                 // case sensitve or new var
+
+                // Parameters (local variables of call depth zero) are moved to the task started by the group, others are shared
+                if(bKeepLocked && strncmp(pchVarKey, "0000:", 5) != 0) bGroupShared = true;
+
+                hppAsyncVarStore(pchVarKey, pchBlock, uiLen, true);
             break;
 
             case HPP_ASYNC_TLV_VAR_DELETE:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncVarName, uiLen);
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);
                 hppAsyncVarName[uiLen] = 0;
                 hppVarDelete(hppAsyncVarName);
             break;
@@ -1226,55 +3732,38 @@ static void hppUserModeMain(void *p1, void *p2, void *p3)
             case HPP_ASYNC_TLV_SET_COAP_CONTEXT_WITH_NEXT:
                 bKeepLocked = true;
             case HPP_ASYNC_TLV_SET_COAP_CONTEXT:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&hppMyCurrentCoapMessageContext, sizeof(hppMyCurrentCoapMessageContext));
+                hppAsyncQueueGet(pQueue, &hppMyCurrentCoapMessageContext, sizeof(hppMyCurrentCoapMessageContext));
             break;
 
             case HPP_ASYNC_TLV_PARSE_TEXT:
             case HPP_ASYNC_TLV_PARSE_TEXT_CLI:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncDataBuffer, uiLen);
+                hppAsyncQueueGet(pQueue, hppAsyncDataBuffer, uiLen);
                 hppAsyncDataBuffer[uiLen] = 0;
-                pchResult = hppParseExpression(hppAsyncDataBuffer, "ReturnWithError");
-                hppVarDelete("ReturnWithError");
-
-                if(uiType == HPP_ASYNC_TLV_PARSE_TEXT_CLI) pchCli = pchResult;
-                else hppVarDelete("ReturnWithError");
+                pchCode = hppAsyncDataBuffer;
+                bParse = true;
             break;
 
             case HPP_ASYNC_TLV_PARSE_VAR:
             case HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncVarName, uiLen);
+            case HPP_ASYNC_TLV_PARSE_VAR_TIMER:
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);
                 hppAsyncVarName[uiLen] = 0;
 
-                if(uiLen > 0) pchCode = hppVarGet(hppAsyncVarName, NULL);
+                if(uiLen > 0) pchCode = hppVarGetCode(hppAsyncVarName, NULL);
                 else pchCode = NULL;  // hppAsyncParseVar("") is used to unlock the mutex in case of  XXX_WITH_NEXT operation which was not fully executed
 
-                if(pchCode != NULL)
-                {
-                    pchResult = hppParseExpression(pchCode,  "ReturnWithError");
-                }
-                else pchResult = "not found";  
+                bParse = true;
+            break;
 
-                // Create CoAP Response if the H++ itself did not respond yet
-                if(uiType == HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE)
-                {
-                    if(hppMyCurrentCoapMessageContext.mHasResponded == 0 && hppMyCurrentCoapMessageContext.mCoapMessageTokenLength != 0) 
-                    {
-                        pchCoap = pchResult;
-                    }
-                    
-                    if(pchCoap == NULL)
-                    {
-                        hppVarDelete("ReturnWithError");
-                        // Invalidate CoAP call context
-                        hppMyCurrentCoapMessageContext.mCoapMessageTokenLength = 0;
-                        hppMyCurrentCoapMessageContext.mCoapCode = OT_COAP_CODE_EMPTY;
-                    }
-                    else 
-                    {
-                        bSendCoapResponse = true; 
-                        iCoapResponseLen = strlen(pchCoap);
-                    }
-                }
+            case HPP_ASYNC_TLV_TASK_RESUME:
+                hppAsyncQueueGet(pQueue, &uiTaskWaitID, sizeof(uint32_t));
+                uiLen -= sizeof(uint32_t);
+                hppAsyncQueueGet(pQueue, hppAsyncDataBuffer, uiLen);
+                hppTaskResume(uiTaskWaitID, hppAsyncDataBuffer, uiLen);
+            break;
+
+            case HPP_ASYNC_TLV_TASK_SLICE:
+                pTask = hppTaskGetNext();
             break;
 
             case HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE:   
@@ -1293,8 +3782,21 @@ static void hppUserModeMain(void *p1, void *p2, void *p3)
                 }
             break;
 
+            case HPP_ASYNC_TLV_STATS_GET_COAP_RESPONSE:
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);     // hppAsyncVarName is the name of the statistics
+                hppAsyncVarName[uiLen] = 0;
+
+                if(hppMyCurrentCoapMessageContext.mCoapMessageTokenLength != 0)
+                {
+                    pchCoap = hppNew_Stats(hppAsyncVarName);
+                    bSendCoapResponse = true;
+
+                    if(pchCoap != NULL) iCoapResponseLen = strlen(pchCoap);   
+                }
+            break;
+
             case HPP_ASYNC_TLV_VAR_HIDE:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncVarName, uiLen);    // hppAsyncVarName is password
+                hppAsyncQueueGet(pQueue, hppAsyncVarName, uiLen);    // hppAsyncVarName is password
                 hppAsyncVarName[uiLen] = 0;
 
                 hppHideVarResources = true;
@@ -1308,87 +3810,157 @@ static void hppUserModeMain(void *p1, void *p2, void *p3)
             break;
 
             case HPP_ASYNC_TLV_USB_RECV:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)hppAsyncDataBuffer, uiLen);
+                hppAsyncQueueGet(pQueue, hppAsyncDataBuffer, uiLen);
                 hppAsyncDataBuffer[uiLen] = 0;
                 shell_execute_cmd(shell_backend_uart_get_ptr(), hppAsyncDataBuffer);   // Send to H++ handler instead?
             break;
 
-            case HPP_ASYNC_TLV_TIMER_EXPIRED:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&uiTimerID, sizeof(uint32_t));
-                if(uiTimerID >= HPP_TIMER_RESOURCE_COUNT) break;
-                
-                pTimer = &(hppTimerResources[uiTimerID]);
-                if(pTimer->pHandler) (pTimer->pHandler)(pTimer->pContext);
+            case HPP_ASYNC_TLV_USB_FRAME:
+                hppAsyncQueueGet(pQueue, hppAsyncDataBuffer, uiLen);
+                pchUsbResponse = hppZephyrUsbFrameDispatch((uint8_t*)hppAsyncDataBuffer, uiLen, &cbUsbResponseLen);
+                if(pchUsbResponse != NULL) hppAsyncOutputAdd(pchUsbResponse, cbUsbResponseLen, uiType, false, NULL);
             break;
 
+            case HPP_ASYNC_TLV_TIMER_EXPIRED:
             case HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED:
-                ring_buf_get(&hppAsyncRingBuf, (uint8_t*)&uiTimerID, sizeof(uint32_t));
-                if(uiTimerID >= HPP_EVENT_TIMER_RESOURCE_COUNT) break;
-                
-                pEventTimer = &(hppEventTimerResources[uiTimerID]);
-                if(pEventTimer->pHandler) (pEventTimer->pHandler)(pEventTimer->pApplicationData, pEventTimer->mApplicationDataLen, pEventTimer->pContext);
-                if(pEventTimer->pApplicationData) free(pEventTimer->pApplicationData);
-                pEventTimer->pApplicationData = NULL;
-                pEventTimer->mInUse = false;
+                hppAsyncQueueGet(pQueue, auiTimerData, sizeof(auiTimerData));
+                hppTimerWheelDispatch(auiTimerData[0], auiTimerData[1]);
+            break;
+
+            case HPP_ASYNC_TLV_BUTTON:
+                hppAsyncQueueGet(pQueue, auiButtonData, sizeof(auiButtonData));
+
+                pchCode = hppVarGetCode(auiButtonData[1] != 0 ? "btn_push" : "btn_release", NULL);
+                bParse = pchCode != NULL;   // no handler defined
+
+                // Parameters of the handler are local variables of call depth zero (see hppParseExpressionBegin)
+                if(bParse)
+                {
+                    hppVarPutStr("0000:pin", hppI2A(szNumeric, auiButtonData[0]), NULL);
+                    if(auiButtonData[1] == 0) hppVarPutStr("0000:hold_time", hppI2A(szNumeric, auiButtonData[2]), NULL);
+                }
             break;
         }
 
-        if(!bKeepLocked)
+
+        // Start H++ code as task which may be suspended after each slice. Run it to completion if no task resource is available.
+        if(bParse)
         {
-            k_mutex_unlock(&hppParseMutex);
-            //k_mutex_unlock(&hppVarMutex);
-        }
+            bParseDone = true;
+            sprintf(szResultVarKey, "#R%u:ReturnWithError", (unsigned int)hppAsyncOutputCount);    // one result variable per output of the batch
 
+            if(pchCode == NULL) pchResult = "not found";
+            else
+            {
+                // Code ending a group of XXX_WITH_NEXT entries which has written shared variables runs to completion. Other entries 
+                // could change the variables while a task is suspended, so the group would not be executed atomically anymore.
+                if(bGroupShared) pTask = NULL;
+                else pTask = hppTaskBegin(pchCode, uiType == HPP_ASYNC_TLV_PARSE_TEXT || uiType == HPP_ASYNC_TLV_PARSE_TEXT_CLI, uiType);
+                
+                if(pTask == NULL) 
+                {
+                    hppEntryPointCurrent = hppEntryPointGetByType(uiType);
+                    pchResult = hppParseExpression(pchCode, szResultVarKey);
+                    hppEntryPointCurrent = hppEntryPoint_Other;
+                }
+                else bParseDone = false;
+            }
 
-        // Functions in hppThread.c require locking the Thread mutex. Avoid doing that while the variable mutex is locked to prevent deadlock situation.
+            // Parameters are moved to the task or released with the local variables of the handler, unless the handler could not start
+            if(uiType == HPP_ASYNC_TLV_BUTTON) 
+            {
+                hppVarDelete("0000:pin");
+                hppVarDelete("0000:hold_time");
+            }
+        }
 
-        // Write result to Thread CLI
-        if(pchCli != NULL)
+        // Execute the next slice of a new or a suspended task
+        if(pTask != NULL && hppTaskContinue(pTask))
         {
-            openthread_api_mutex_lock(hppOpenThreadContext); 
-            hppCliOutputStr(pchCli, true);              
-            openthread_api_mutex_unlock(hppOpenThreadContext);
-          
-            k_mutex_lock(&hppParseMutex, K_FOREVER);
-            //k_mutex_lock(&hppVarMutex, K_FOREVER);
-            hppVarDelete("ReturnWithError");
-            //k_mutex_unlock(&hppVarMutex);
-            k_mutex_unlock(&hppParseMutex);
-        
-            pchCli = NULL;
+            uiType = pTask->uiType;
+            pchResult = hppTaskEnd(pTask, szResultVarKey);
+            bParseDone = true;
         }
 
-        // Send result with CoAP
-        if(bSendCoapResponse == true)
+        if(bParseDone)
         {
-            openthread_api_mutex_lock(hppOpenThreadContext);
-            hppCoapRespondTo(&hppMyCurrentCoapMessageContext, pchCoap, iCoapResponseLen, uiType == HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE ? 40 : 0);
-            
-            // Invalidate CoAP call context
-            hppMyCurrentCoapMessageContext.mCoapMessageTokenLength = 0;
-            hppMyCurrentCoapMessageContext.mCoapCode = OT_COAP_CODE_EMPTY;
-            
-            openthread_api_mutex_unlock(hppOpenThreadContext);
+            if(uiType == HPP_ASYNC_TLV_PARSE_TEXT_CLI) pchCli = pchResult;
 
-            if(uiType ==  HPP_ASYNC_TLV_PARSE_VAR || uiType == HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE)
+            // Create CoAP Response if the H++ itself did not respond yet
+            if(uiType == HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE)
             {
-
-                k_mutex_lock(&hppParseMutex, K_FOREVER);
-                //k_mutex_lock(&hppVarMutex, K_FOREVER);
-                hppVarDelete("ReturnWithError");
-                //k_mutex_unlock(&hppVarMutex);
-                k_mutex_unlock(&hppParseMutex);
+                if(hppMyCurrentCoapMessageContext.mHasResponded == 0 && hppMyCurrentCoapMessageContext.mCoapMessageTokenLength != 0) 
+                {
+                    pchCoap = pchResult;
+                }
+                
+                if(pchCoap == NULL)
+                {
+                    // Invalidate CoAP call context
+                    hppMyCurrentCoapMessageContext.mCoapMessageTokenLength = 0;
+                    hppMyCurrentCoapMessageContext.mCoapCode = OT_COAP_CODE_EMPTY;
+                }
+                else 
+                {
+                    bSendCoapResponse = true; 
+                    iCoapResponseLen = strlen(pchCoap);
+                }
             }
 
-            if(uiType == HPP_ASYNC_TLV_VAR_GET_WKC_COAP_RESPONSE && pchCoap != NULL)
+            if(pchCli == NULL && !bSendCoapResponse) hppVarDelete(szResultVarKey);
+        }
+
+        hppAsyncStatsRecordDispatch(uiStatsType, uiStartTime - uiQueueTime, hppProfilerClockUs() - uiStartTime);
+
+        if(uiStatsType == HPP_ASYNC_TLV_TIMER_EXPIRED || uiStatsType == HPP_ASYNC_TLV_EVENT_TIMER_EXPIRED || uiStatsType == HPP_ASYNC_TLV_PARSE_VAR_TIMER ||
+           uiStatsType == HPP_ASYNC_TLV_VAR_PUT_TIMER)
+        {
+            hppTimerActiveTime += hppProfilerClockUs() - uiStartTime;
+        }
+
+        // Outputs are written after the batch. Results of tasks and variable values may be changed by the next entries, 
+        // so the batch ends with them.
+        if(pchCli != NULL)
+        {
+            hppAsyncOutputAdd(pchCli, strlen(pchCli), uiType, true, szResultVarKey);
+            bBatchEnd = bBatchEnd || pTask != NULL;
+            pchCli = NULL;
+        }
+        else if(bSendCoapResponse)
+        {
+            if(uiType == HPP_ASYNC_TLV_PARSE_VAR || uiType == HPP_ASYNC_TLV_PARSE_VAR_COAP_RESPONSE || uiType == HPP_ASYNC_TLV_PARSE_VAR_TIMER)
+            {
+                hppAsyncOutputAdd(pchCoap, iCoapResponseLen, uiType, false, szResultVarKey);
+                bBatchEnd = bBatchEnd || pTask != NULL;
+            }
+            else 
             {
-                free(pchCoap);     // response has been dynamically allocated with hppNew_WellknownCore()
+                hppAsyncOutputAdd(pchCoap, iCoapResponseLen, uiType, false, NULL);
+                bBatchEnd = bBatchEnd || uiType == HPP_ASYNC_TLV_VAR_GET_COAP_RESPONSE;
             }
             
             bSendCoapResponse = false;
             iCoapResponseLen = 0;
             pchCoap = NULL;
         }
+
+        // The next entry of a XXX_WITH_NEXT group is read from the same queue
+        hppAsyncQueueLocked = bKeepLocked ? pQueue : NULL;
+        if(!bKeepLocked) bGroupShared = false;
+
+        if(!bKeepLocked)
+        {
+            // Continue the batch with the next entry without unlocking the mutex if there is one
+            bBatchLocked = hppAsyncBatchNext(&hppAsyncBatch, k_uptime_get_32(), hppAsyncOutputCount, bBatchEnd, hppAsyncQueueIsReady());
+
+            if(!bBatchLocked)
+            {
+                k_mutex_unlock(&hppParseMutex);
+                //k_mutex_unlock(&hppVarMutex);
+
+                hppAsyncOutputFlush();
+            }
+        }
     }
 }
 
@@ -1403,6 +3975,7 @@ void hppMainLoop()
     LOG_INF("main priority: %d", k_thread_priority_get(k_current_get()));
 
     // Downgrade thread to user mode 
+    hppAsyncDispatcherThread = k_current_get();
     k_thread_user_mode_enter(hppUserModeMain, NULL, NULL, NULL);
 }
 
@@ -1411,50 +3984,130 @@ void hppMainLoop()
 // USB Communication
 // ------------------------------------------------------------------
 
+// Decode the byte 'ach' of a binary frame and queue the frame once it is complete
+static void hppZephyrUsbRecvFrameInt(uint8_t ach)
+{
+    if(ach == HPP_ZEPHYR_USB_FRAME_END)
+    {
+        if(!hppZephyrUsbFrameActive)
+        {
+            // Start of a frame, a text line in progress is dropped
+            hppZephyrUsbFrameActive = true;
+            hppZephyrUsbFrameLen = 0;
+            hppZephyrUsbFrameEscape = false;
+            hppZephyrUsbFrameOverflow = false;
+            hppZephyrUsbRecvBufBufferLen = 0;
+            return;
+        }
+
+        if(hppZephyrUsbFrameLen == 0 && !hppZephyrUsbFrameOverflow) return;     // END END between frames
+
+        if(hppZephyrUsbFrameOverflow || !hppAsyncProcessDataInt(hppZephyrUsbFrameBuffer, hppZephyrUsbFrameLen, HPP_ASYNC_TLV_USB_FRAME)) hppZephyrUsbFrameDropCount++;
+        else hppZephyrUsbFrameCount++;
+
+        hppZephyrUsbFrameActive = false;
+        return;
+    }
+
+    if(hppZephyrUsbFrameEscape)
+    {
+        if(ach == HPP_ZEPHYR_USB_FRAME_ESC_END) ach = HPP_ZEPHYR_USB_FRAME_END;
+        else if(ach == HPP_ZEPHYR_USB_FRAME_ESC_ESC) ach = HPP_ZEPHYR_USB_FRAME_ESC;
+
+        hppZephyrUsbFrameEscape = false;
+    }
+    else if(ach == HPP_ZEPHYR_USB_FRAME_ESC)
+    {
+        hppZephyrUsbFrameEscape = true;
+        return;
+    }
+
+    if(hppZephyrUsbFrameLen >= HPP_ZEPHYR_USB_FRAME_MAX_SIZE) hppZephyrUsbFrameOverflow = true;
+    else hppZephyrUsbFrameBuffer[hppZephyrUsbFrameLen++] = ach;
+}
+
+
+// Assemble the lines of the data read from the FIFO and pass them as OT commands to the Zephyr shell
+static void hppZephyrUsbRecvInt(const uint8_t apData[], int acbDataLen)
+{
+    uint8_t ch;
+    int i;
+
+    hppZephyrUsbRecvCount += acbDataLen;
+
+    for(i = 0; i < acbDataLen; i++)
+    {
+        ch = apData[i];
+
+        // Binary frames start with an END byte which is not used in text
+        if(ch == HPP_ZEPHYR_USB_FRAME_END || hppZephyrUsbFrameActive)
+        {
+            hppZephyrUsbRecvFrameInt(ch);
+            continue;
+        }
+
+        if(ch == '\n' || ch == '\r') 
+        {
+            if(!hppZephyrUsbRecvOverflow && hppZephyrUsbRecvBufBufferLen > 3) hppAsyncUsbInput(hppZephyrUsbRecvBufBuffer, hppZephyrUsbRecvBufBufferLen);
+
+            hppZephyrUsbRecvBufBufferLen = 0;
+            hppZephyrUsbRecvOverflow = false;
+            continue;
+        }
+
+        if(hppZephyrUsbRecvOverflow) continue;
+
+        if(hppZephyrUsbRecvBufBufferLen == 0)
+        {
+            strcpy(hppZephyrUsbRecvBufBuffer, "ot ");       // Simulate OT command to Zephyr shell
+            hppZephyrUsbRecvBufBufferLen = 3;
+        }
+
+        if(ch == '\"' || ch == '\'') hppZephyrUsbRecvBufBuffer[hppZephyrUsbRecvBufBufferLen++] = '\\';   // escape " and '
+        hppZephyrUsbRecvBufBuffer[hppZephyrUsbRecvBufBufferLen++] = ch;
+
+        // Drop the line in case of buffer overflow
+        if(hppZephyrUsbRecvBufBufferLen >= HPP_ZEPHYR_USB_RECV_BUF_SIZE - 1) 
+        {
+            hppZephyrUsbRecvOverflow = true;
+            hppZephyrUsbRecvDropCount++;
+        }
+    }
+}
+
+
+static int hppZephyrUsbFifoFill(void* apContext, const uint8_t* apData, uint32_t acbDataLen)
+{
+    return uart_fifo_fill((const struct device*)apContext, apData, acbDataLen);
+}
+
+
 static void hppZephyrUsbInterruptHandler(const struct device *apDev, void *apUuserData)
 {
+    uint8_t auiChunk[HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE];
     int iLen;
-    uint8_t ch;
 	ARG_UNUSED(apUuserData);
 
 	while(uart_irq_update(apDev) && uart_irq_is_pending(apDev))
 	{
 		if(uart_irq_rx_ready(apDev))
 		{
-            do 
-            {
-                if(hppZephyrUsbRecvBufBufferLen == 0)
-                {
-                    strcpy(hppZephyrUsbRecvBufBuffer, "ot ");       // Simulate OT command to Zephyr shell
-                    hppZephyrUsbRecvBufBufferLen = 3;
-                }
-
-                iLen = uart_fifo_read(apDev, &ch, 1);
-                if(ch == '\"' || ch == '\'') hppZephyrUsbRecvBufBuffer[hppZephyrUsbRecvBufBufferLen++] = '\\';   // escape " and '
-                if(iLen == 1) hppZephyrUsbRecvBufBuffer[hppZephyrUsbRecvBufBufferLen++] = ch;
-                if(hppZephyrUsbRecvBufBufferLen >= HPP_ZEPHYR_USB_RECV_BUF_SIZE - 1) hppZephyrUsbRecvBufBufferLen = 0;  // Drop data in case of buffer overflow
-            }
-            while(iLen == 1 && ch != '\n' && ch != '\r');
-
-            if((ch == '\n' || ch == '\r') && hppZephyrUsbRecvBufBufferLen > 0) 
-            {
-                if(hppZephyrUsbRecvBufBufferLen > 3)
-                hppAsyncUsbInput(hppZephyrUsbRecvBufBuffer, hppZephyrUsbRecvBufBufferLen - 1);     // Drop '\n' or '\r'
-
-                hppZephyrUsbRecvBufBufferLen = 0;
-            }
+            while((iLen = uart_fifo_read(apDev, auiChunk, sizeof(auiChunk))) > 0) hppZephyrUsbRecvInt(auiChunk, iLen);
 		}
 
 		if(uart_irq_tx_ready(apDev))
 		{
-            iLen = ring_buf_get(&hppZephyrUsbRingBuf, &ch, 1);    // read one byte, uart_irq_tx_ready(..) only guarantees ne more byte 
-
-            if(iLen > 0) uart_fifo_fill(apDev, &ch, iLen);
-            else 
+            // Fill the FIFO with as many bytes of the send buffer as it takes, the rest stays in the buffer for the next interrupt
+            if(hppSendBufferIsEmpty(&hppZephyrUsbSendBuffer)) 
             {
 				uart_irq_tx_disable(apDev);
 				continue;
 			}
+
+            if(hppSendBufferDrain(&hppZephyrUsbSendBuffer, HPP_ZEPHYR_USB_FIFO_CHUNK_SIZE, hppZephyrUsbFifoFill, (void*)apDev) > 0)
+            {
+                k_sem_give(&hppZephyrUsbSendSemaphor);
+            }
 		}
 	}
 }
@@ -1475,18 +4128,55 @@ void hppZephyrUsbStatusCallbackHandler(enum usb_dc_status_code cb_status, const
 }
 
 
+static void hppZephyrUsbSendKick(void* apContext)
+{
+    uart_irq_tx_enable(hppUsbDev); 
+}
+
+
+static bool hppZephyrUsbSendWait(void* apContext)
+{
+    return k_sem_take(&hppZephyrUsbSendSemaphor, K_MSEC(HPP_ZEPHYR_USB_SEND_TIMEOUT)) == 0;
+}
+
+
 int hppZephyrUsbSend(const uint8_t apData[], uint16_t acbDataLen)
 {
-    int iLen;
+    uint32_t cbSent;
 
     if(apData == NULL || acbDataLen == 0) return 0;
+    if(k_is_in_isr()) return 0;     // the mutex keeps the writers of the send buffer apart
 
-    iLen = ring_buf_put(&hppZephyrUsbRingBuf, apData, acbDataLen);
-    
-    if(iLen <= 0) ring_buf_reset(&hppZephyrUsbRingBuf);   // empty buffer and start over next time  
-    else uart_irq_tx_enable(hppUsbDev); 
+    k_mutex_lock(&hppZephyrUsbSendMutex, K_FOREVER);
 
-    return iLen > 0 ? iLen : 0;
+    // Backpressure: wait until the interrupt handler passed data to the FIFO. A host not reading the data stalls the output 
+    // and the data is dropped without waiting until the host reads again.
+    cbSent = hppSendBufferWrite(&hppZephyrUsbSendBuffer, apData, acbDataLen, hppZephyrUsbSendKick, hppZephyrUsbSendWait, NULL);
+
+    k_mutex_unlock(&hppZephyrUsbSendMutex);
+
+    return cbSent;
+}
+
+
+// Write the USB statistics in the format "sent,received,dropped,lines dropped,waits,stalled,frames,frames dropped". sent and received 
+// are the bytes passed to and read from the FIFO, dropped the bytes not sent, lines dropped the received lines too long, frames the
+// binary frames received. Returns the length like snprintf.
+size_t hppZephyrUsbStatsDump(char* aszOut, size_t acbMaxLen)
+{
+    return snprintf(aszOut, acbMaxLen, "%lu,%lu,%lu,%lu,%lu,%s,%lu,%lu", (unsigned long)hppZephyrUsbSendBuffer.uiSentCount, (unsigned long)hppZephyrUsbRecvCount,
+                    (unsigned long)hppZephyrUsbSendBuffer.uiDropCount, (unsigned long)hppZephyrUsbRecvDropCount, (unsigned long)hppZephyrUsbSendBuffer.uiWaitCount, 
+                    hppZephyrUsbSendBuffer.bStalled ? "true" : "false", (unsigned long)hppZephyrUsbFrameCount, (unsigned long)hppZephyrUsbFrameDropCount);
+}
+
+
+void hppZephyrUsbStatsReset()
+{
+    hppSendBufferResetStats(&hppZephyrUsbSendBuffer);
+    hppZephyrUsbRecvCount = 0;
+    hppZephyrUsbRecvDropCount = 0;
+    hppZephyrUsbFrameCount = 0;
+    hppZephyrUsbFrameDropCount = 0;
 }
 
 
@@ -1499,7 +4189,7 @@ static void hppZephyrUsbInit()
     usb_enable(NULL);
     usb_dc_set_status_callback(hppZephyrUsbStatusCallbackHandler);
 
-    ring_buf_init(&hppZephyrUsbRingBuf, sizeof(hppZephyrUsbRingBufBuffer), hppZephyrUsbRingBufBuffer);    
+    hppSendBufferInit(&hppZephyrUsbSendBuffer, hppZephyrUsbSendBufferData, sizeof(hppZephyrUsbSendBufferData));
 
     ret = uart_line_ctrl_get(hppUsbDev, UART_LINE_CTRL_BAUD_RATE, &uiBaudrate);
     
@@ -1519,24 +4209,19 @@ static void hppZephyrUsbInit()
 
 void hppZephyrInit()
 {
-    int i;
-
     hppGpioDev0 = device_get_binding("GPIO_0");
     hppGpioDev1 = device_get_binding("GPIO_1");
 
-    ring_buf_init(&hppAsyncRingBuf, sizeof(hppAsyncRingBufBuffer), hppAsyncRingBufBuffer);
+    hppAsyncQueueInit(&(hppAsyncQueues[HPP_ASYNC_QUEUE_TIMER]), "timer", hppAsyncRingBufTimer, sizeof(hppAsyncRingBufTimer), HPP_ASYNC_QUEUE_WEIGHT_TIMER);
+    hppAsyncQueueInit(&(hppAsyncQueues[HPP_ASYNC_QUEUE_COAP_RESPONSE]), "coap_response", hppAsyncRingBufCoapResponse, sizeof(hppAsyncRingBufCoapResponse), HPP_ASYNC_QUEUE_WEIGHT_COAP_RESPONSE);
+    hppAsyncQueueInit(&(hppAsyncQueues[HPP_ASYNC_QUEUE_COAP_REQUEST]), "coap_request", hppAsyncRingBufCoapRequest, sizeof(hppAsyncRingBufCoapRequest), HPP_ASYNC_QUEUE_WEIGHT_COAP_REQUEST);
+    hppAsyncQueueInit(&(hppAsyncQueues[HPP_ASYNC_QUEUE_BULK]), "bulk", hppAsyncRingBufBulk, sizeof(hppAsyncRingBufBulk), HPP_ASYNC_QUEUE_WEIGHT_BULK);
+    hppAsyncBatchInit(&hppAsyncBatch, HPP_ASYNC_BATCH_MAX_COUNT, HPP_ASYNC_BATCH_MAX_TIME, HPP_ASYNC_BATCH_MAX_OUTPUTS);
     hppZephyrUsbInit();
 
     // Init timer objects
-    for(i = 0 ; i < HPP_TIMER_RESOURCE_COUNT ; i++)
-    {
-        k_timer_init(&(hppTimerResources[i].mTimerResource), hppTimerHandlerInt, NULL);
-    } 
-
-    for(i = 0 ; i < HPP_EVENT_TIMER_RESOURCE_COUNT ; i++)
-    {
-        k_timer_init(&(hppEventTimerResources[i].mTimerResource), hppEventTimerHandlerInt, NULL);
-    }
+    hppTimerWheelInit(k_uptime_get_32());
+    k_timer_init(&hppTimerWheelTimer, hppTimerWheelTimerHandlerInt, NULL);
 
   
 	LOG_INF("Start Halloween");
@@ -1547,4 +4232,6 @@ void hppZephyrInit()
 	}
 
     hppSyncAddExternalFunctionLibrary(hppEvaluateZephyrFunction);
+    hppAddImageTokens(hppZephyrImageTokens);
+    hppProfilerSetClock(hppProfilerClockUs);
 }
\ No newline at end of file